@@ -0,0 +1,170 @@
+/**
+  \brief Benchmark de la delimitacion de pkts en un flujo TCP: bucle byte a byte como el de
+  Pkt::parse frente a Pkt_framer (memchr del sincronismo y vistas sin copia).
+  Todos comprueban el mismo checksum de 16 bits al final de cada pkt. Los servidores usan el
+  framer con check_with_pkt, que vuelve a pasar cada candidato por Pkt::parse: esa es la
+  configuracion que se despliega; la del checksum directo es la cota del framer solo
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include "pkt_framer.h"
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+#include <x86intrin.h>
+#define BENCH_UNIT "cycles"
+static inline uint64_t bench_now( void ) {
+    return __rdtsc();
+}
+#else
+#define BENCH_UNIT "ns"
+static inline uint64_t bench_now( void ) {
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+#endif
+
+static const uint8_t header_len   = 16;
+static const uint8_t trailer_len  = 2;
+static const uint16_t max_msg_len = 182;
+static const uint16_t read_len    = 1024;
+static const Pkt_layout_t layout  = { { pkt_sync_lossy, pkt_sync_no_lossy }, 2, 14, 2, header_len, trailer_len, max_msg_len };
+
+static uint16_t checksum( const uint8_t* data, uint16_t len ) {
+    uint16_t sum = 0;
+    for ( uint16_t i = 0; i < len; i++ ) {
+        sum += data[i];
+    }
+    return sum;
+}
+
+static bool check_sum( const uint8_t* pkt, uint16_t len, void* arg ) {
+    (void)arg;
+    uint16_t sum;
+    memcpy( &sum, pkt + len - trailer_len, sizeof( sum ) );
+    return sum == checksum( pkt, len - trailer_len );
+}
+
+// Parser byte a byte con la misma estructura que Pkt::parse: sincronismo, cabecera, cuerpo y checksum
+class Byte_parser {
+    public:
+        Byte_parser() : pos( 0 ), total( 0 ) {}
+
+        bool parse( uint8_t byte ) {
+            if ( pos == 0 && byte != pkt_sync_lossy && byte != pkt_sync_no_lossy ) {
+                return false;
+            }
+            buf[pos++] = byte;
+            if ( pos == header_len ) {
+                uint16_t msg_len;
+                memcpy( &msg_len, buf + 14, sizeof( msg_len ) );
+                if ( msg_len > max_msg_len ) {
+                    pos = 0;
+                    return false;
+                }
+                total = header_len + msg_len + trailer_len;
+            }
+            if ( pos > header_len && pos == total ) {
+                pos = 0;
+                return check_sum( buf, total, NULL );
+            }
+            return false;
+        }
+
+        uint8_t buf[header_len + max_msg_len + trailer_len];
+
+    private:
+        uint16_t pos;
+        uint16_t total;
+};
+
+typedef struct {
+    uint32_t pkts;
+    uint32_t bytes;
+} Sink_t;
+
+static void sink( const uint8_t* pkt, uint16_t len, void* arg ) {
+    Sink_t* s = (Sink_t*)arg;
+    s->pkts++;
+    s->bytes += pkt[len - 1];
+}
+
+int main( void ) {
+    const uint32_t stream_len = 1 << 20;
+    const uint8_t rounds      = 20;
+    uint8_t* stream           = (uint8_t*)malloc( stream_len );
+    uint32_t len              = 0;
+    uint32_t expected         = 0;
+
+    // Pkts de 20 a 80 bytes de mensaje, como los de sensores, con algo de ruido entre ellos
+    srand( 1 );
+    while ( len + header_len + max_msg_len + trailer_len + 8 < stream_len ) {
+        if ( rand() % 16 == 0 ) {
+            uint8_t noise = rand() % 8;
+            memset( stream + len, 0x55, noise );
+            len += noise;
+        }
+        uint16_t msg_len = 20 + rand() % 60;
+        uint8_t* p       = stream + len;
+        memset( p, 0, header_len );
+        p[0] = rand() % 2 ? pkt_sync_lossy : pkt_sync_no_lossy;
+        memcpy( p + 14, &msg_len, sizeof( msg_len ) );
+        for ( uint16_t i = 0; i < msg_len; i++ ) {
+            p[header_len + i] = rand() & 0x7F;
+        }
+        uint16_t sum = checksum( p, header_len + msg_len );
+        memcpy( p + header_len + msg_len, &sum, sizeof( sum ) );
+        len += header_len + msg_len + trailer_len;
+        expected++;
+    }
+
+    Sink_t byte_sink = { 0, 0 };
+    uint64_t start   = bench_now();
+    for ( uint8_t r = 0; r < rounds; r++ ) {
+        Byte_parser parser;
+        for ( uint32_t off = 0; off < len; off += read_len ) {
+            uint32_t n = len - off < read_len ? len - off : read_len;
+            for ( uint32_t i = 0; i < n; i++ ) {
+                if ( parser.parse( stream[off + i] ) ) {
+                    sink( parser.buf, header_len, &byte_sink );
+                }
+            }
+        }
+    }
+    uint64_t per_byte = bench_now() - start;
+
+    Sink_t framer_sink = { 0, 0 };
+    start              = bench_now();
+    for ( uint8_t r = 0; r < rounds; r++ ) {
+        Pkt_framer framer( layout, check_sum );
+        for ( uint32_t off = 0; off < len; off += read_len ) {
+            uint32_t n = len - off < read_len ? len - off : read_len;
+            framer.feed( stream + off, n, sink, &framer_sink );
+        }
+    }
+    uint64_t framed = bench_now() - start;
+
+    Sink_t shipped_sink = { 0, 0 };
+    start               = bench_now();
+    for ( uint8_t r = 0; r < rounds; r++ ) {
+        Byte_parser parser;
+        Pkt_framer framer( layout, Pkt_framer::check_with_pkt<Byte_parser>, &parser );
+        for ( uint32_t off = 0; off < len; off += read_len ) {
+            uint32_t n = len - off < read_len ? len - off : read_len;
+            framer.feed( stream + off, n, sink, &shipped_sink );
+        }
+    }
+    uint64_t shipped = bench_now() - start;
+
+    uint64_t total_bytes = (uint64_t)len * rounds;
+    printf( "stream: %u bytes, %u pkts (per-byte ok %u, framer ok %u, framer + parse ok %u)\n", len, expected, byte_sink.pkts / rounds, framer_sink.pkts / rounds, shipped_sink.pkts / rounds );
+    printf( "per-byte parse:               %8.3f %s/byte\n", (double)per_byte / total_bytes, BENCH_UNIT );
+    printf( "Pkt_framer, checksum:         %8.3f %s/byte\n", (double)framed / total_bytes, BENCH_UNIT );
+    printf( "Pkt_framer + check_with_pkt:  %8.3f %s/byte\n", (double)shipped / total_bytes, BENCH_UNIT );
+    free( stream );
+    return 0;
+}
@@ -0,0 +1,123 @@
+/**
+  \brief Benchmark del parser de lineas de subida: frame_parser original (strtok/strstr,
+  copia del Base64, VLA y memcpy) frente a Lora_uplink_parser (una pasada, sin copias).
+  Las lineas son capturas del network server de Multitech
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "base64.h"
+#include "lora_uplink_parser.h"
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+#include <x86intrin.h>
+#define BENCH_UNIT "cycles"
+static inline uint64_t bench_now( void ) {
+    return __rdtsc();
+}
+#else
+#define BENCH_UNIT "ns"
+static inline uint64_t bench_now( void ) {
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+#endif
+
+static const char* captured_lines[] = {
+    "lora/00-00-00-00-02-65-e9-e8/up {\"tmst\":3734965956,\"time\":\"2021-01-05T20:42:44.962524Z\",\"tmms\":1293914582962,\"chan\":2,\"rfch\":0,\"freq\":868.5,\"stat\":1,\"modu\":\"LORA\",\"datr\":\"SF9BW125\",\"codr\":\"4/5\",\"lsnr\":10.0,\"rssi\":-47,\"opts\":\"\",\"size\":51,\"fcnt\":18,\"cls\":0,\"port\":2,\"mhdr\":\"801dce3001801200\",\"data\":\"LOjpZQJ7AAAAgggEz/RfxSsAAAAAAAAAaYukIWAYKUNMXFDe3m/BVp8cAkAgAAJAgIAZ\",\"appeui\":\"00-80-00-00-00-00-e1-9c\",\"deveui\":\"00-00-00-00-02-65-e9-e8\",\"ack\":false,\"adr\":true,\"gweui\":\"00-80-00-00-a0-00-69-3f\",\"seqn\":18}",
+    "lora/00-00-00-00-02-65-e9-e9/up {\"tmst\":3735965956,\"time\":\"2021-01-05T20:42:45.962524Z\",\"tmms\":1293914583962,\"chan\":5,\"rfch\":1,\"freq\":867.5,\"stat\":1,\"modu\":\"LORA\",\"datr\":\"SF7BW125\",\"codr\":\"4/5\",\"lsnr\":7.5,\"rssi\":-88,\"opts\":\"\",\"size\":24,\"fcnt\":203,\"cls\":0,\"port\":2,\"mhdr\":\"401dce3001cb0000\",\"data\":\"LOnpZQJ7AAAAAgALz/RfxSsAAAA=\",\"appeui\":\"00-80-00-00-00-00-e1-9c\",\"deveui\":\"00-00-00-00-02-65-e9-e9\",\"ack\":false,\"adr\":true,\"gweui\":\"00-80-00-00-a0-00-69-3f\",\"seqn\":203}",
+    "lora/00-00-00-00-02-65-ea-01/up {\"tmst\":3736965956,\"time\":\"2021-01-05T20:42:46.962524Z\",\"tmms\":1293914584962,\"chan\":0,\"rfch\":0,\"freq\":868.1,\"stat\":1,\"modu\":\"LORA\",\"datr\":\"SF12BW125\",\"codr\":\"4/5\",\"lsnr\":-12.2,\"rssi\":-118,\"opts\":\"\",\"size\":93,\"fcnt\":7,\"cls\":0,\"port\":2,\"mhdr\":\"801dce3001070000\",\"data\":\"LAHqZQJ7AAAAgggEz/RfxSsAAAAAAAAAaYukIWAYKUNMXFDe3m/BVp8cAkAgAAJAgIAZLAHqZQJ7AAAAgggEz/RfxSsAAAAAAAAAaYukIWAYKUNMXFDe3m/BVp8c\",\"appeui\":\"00-80-00-00-00-00-e1-9c\",\"deveui\":\"00-00-00-00-02-65-ea-01\",\"ack\":false,\"adr\":true,\"gweui\":\"00-80-00-00-a0-00-69-3f\",\"seqn\":7}",
+};
+
+static const uint16_t max_len    = 1024;
+static const uint8_t  prefix_len = 31;
+
+typedef struct {
+    uint16_t len;
+    uint8_t data[max_len];
+    char prefix[prefix_len + 1];
+} Lora_data;
+
+// Copia del Lora_udp_server::frame_parser original como referencia
+static bool legacy_frame_parser( Base64& base64, char* buffer, Lora_data& lora_data ) {
+    char* pch;
+    const uint16_t encoded_data_len = 500;
+    char encoded_data[encoded_data_len];
+
+    pch = strtok( buffer, " " );
+    if ( pch == nullptr ) {
+        return false;
+    }
+    if ( strlen( pch ) != prefix_len || strstr( pch, "lora/" ) == NULL || strstr( pch, "/up" ) == NULL ) {
+        return false;
+    }
+    strncpy( lora_data.prefix, pch, strlen( pch ) );
+
+    pch = strtok( NULL, "\0" );
+    if ( pch == NULL ) {
+        return false;
+    }
+
+    char* sub_pch = strstr( pch, "\"data\":\"" );
+    pch           = strtok( sub_pch, ":" );
+    if ( pch != nullptr ) {
+        pch = strtok( NULL, "\"" );
+        if ( pch != nullptr && strlen( pch ) < encoded_data_len ) {
+            strcpy( encoded_data, pch );
+        }
+        else {
+            return false;
+        }
+    }
+    else {
+        return false;
+    }
+
+    size_t decoded_data_len = base64.decoded_size( encoded_data );
+    uint8_t decoded_data[decoded_data_len];
+    if ( !base64.decode( encoded_data, (unsigned char*)decoded_data, decoded_data_len ) ) {
+        return false;
+    }
+    lora_data.len = decoded_data_len;
+    memcpy( lora_data.data, decoded_data, decoded_data_len );
+    return true;
+}
+
+int main( void ) {
+    const uint32_t iterations = 200000;
+    const uint8_t n_lines     = sizeof( captured_lines ) / sizeof( captured_lines[0] );
+    char line[max_len + 1];
+    Lora_data lora_data;
+    Base64 base64;
+    Lora_uplink_parser parser;
+    Lora_uplink_t uplink;
+    uint32_t ok_legacy = 0;
+    uint32_t ok_single = 0;
+
+    // El parser original destruye la linea con strtok, ambos casos pagan la misma copia de restauracion
+    uint64_t start = bench_now();
+    for ( uint32_t i = 0; i < iterations; i++ ) {
+        const char* src = captured_lines[i % n_lines];
+        strcpy( line, src );
+        memset( lora_data.prefix, 0, prefix_len + 1 );
+        memset( lora_data.data, 0, max_len );
+        ok_legacy += legacy_frame_parser( base64, line, lora_data );
+    }
+    uint64_t legacy = bench_now() - start;
+
+    start = bench_now();
+    for ( uint32_t i = 0; i < iterations; i++ ) {
+        const char* src = captured_lines[i % n_lines];
+        strcpy( line, src );
+        ok_single += parser.parse( line, strlen( line ), lora_data.data, max_len, uplink );
+    }
+    uint64_t single = bench_now() - start;
+
+    printf( "uplinks: %u (legacy ok %u, single-pass ok %u)\n", iterations, ok_legacy, ok_single );
+    printf( "legacy frame_parser: %8.1f %s/uplink\n", (double)legacy / iterations, BENCH_UNIT );
+    printf( "Lora_uplink_parser:  %8.1f %s/uplink\n", (double)single / iterations, BENCH_UNIT );
+    return 0;
+}
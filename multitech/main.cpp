@@ -1,15 +1,28 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include "log.h"
 #include "lora_udp_server.h"
-#include "fifo_pkt.h"
+#include "gwmp_server.h"
+#include "pkt_ring.h"
+#include "pkt_pool.h"
+#include "pkt_log.h"
 #include "orbcommST2100_controller.h"
 #include "pkt_filter.h"
 #include "comm_mgr.h"
+#include "upload_engine.h"
+#include "http_sink.h"
+#include "mqtt_sink.h"
 #include "model_location.h"
 #include "commands_ids.h"
 #include "imei_list.h"
+#include "event_loop.h"
+#include "event_fd.h"
+#include "timer_fd.h"
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <utility>
 
 #include "pkt.h"
 #include "lossy.h"
@@ -17,22 +30,81 @@
 
 constexpr uint16_t max_elements = 100;
 constexpr uint16_t max_pkt_size = 200;
+constexpr uint16_t max_satellite_elements = 16;
+constexpr uint16_t uplink_log_entries = 2 * max_elements; // pkts retenidos hasta que los confirman todos los destinos
+constexpr uint16_t pkt_pool_slots = uplink_log_entries + max_satellite_elements + 2 * Upload_window<Pkt>::max_lane + 2; // el log, la cola de satelite y las vias de reintento de ambos destinos llenos y uno en curso
+constexpr uint8_t cloud_upload_window = 4; // peticiones en curso hacia la API de cloud
+constexpr uint8_t local_upload_window = 2; // peticiones en curso hacia la API local
+constexpr bool cloud_batch_bodies = false; // la API de cloud acepta varios pkt[]= por peticion y responde 207 con los fallidos
+constexpr uint8_t cloud_batch_pkts = 1;    // pkts por peticion a la API de cloud; con lotes, 8: cada ida y vuelta movil cuesta
+constexpr uint8_t mqtt_batch_pkts = 8;     // PUBLISH por escritura al broker, no cambia lo que recibe
+constexpr uint32_t cloud_batch_age_ms = 2000; // espera maxima de un lote incompleto a cloud [ms]
+constexpr uint16_t cloud_replay_min_pkts = 32; // pkts sin enviar a cloud que se reponen como atraso (tras un corte)
+constexpr uint8_t cloud_live_share = 80;   // % del envio a cloud para los pkts nuevos mientras se repone un atraso
+constexpr Pkt_encoding_t cloud_encoding = pkt_encoding_csv; // codificacion de los pkts que acepta la API de cloud
+constexpr Pkt_encoding_t local_encoding = pkt_encoding_csv; // codificacion de los pkts que acepta la API local
+constexpr bool cloud_gzip_bodies = false;  // la API de cloud acepta Content-Encoding: gzip
+constexpr bool local_gzip_bodies = false;  // la API local acepta Content-Encoding: gzip
+constexpr uint32_t gzip_min_body = 256;    // cuerpos mas cortos no compensan la cabecera gzip [bytes]
+constexpr bool cloud_over_mqtt = false;    // subida a cloud por MQTT en lugar de HTTPS: una sesion persistente en vez de una peticion por lote
+constexpr uint16_t mqtt_port = 1883;       // puerto del broker, MQTT sobre TCP sin TLS
+constexpr char mqtt_topic_prefix[] = "witrac/gateway"; // topic de publicacion: <prefijo>/<mobile_id>
+constexpr uint8_t cloud_mqtt_window = 16;  // PUBLISH sin PUBACK hacia el broker
+constexpr uint16_t mqtt_keepalive_s = 60;  // silencio maximo antes de un PINGREQ [s]
+constexpr Pkt_encoding_t mqtt_encoding = pkt_encoding_raw; // el payload MQTT es binario: el pkt tal cual
+constexpr uint8_t lora_rx_batch_size = 32; // datagramas leidos por llamada a recvmmsg
+constexpr uint8_t lora_ingest_workers = 2; // workers de ingesta, repartidos por DevEUI
+constexpr uint32_t lora_dedup_window_s = 120; // ventana de deteccion de duplicados [s]
+constexpr Ack_mode_t lora_ack_mode    = ack_mode_all; // politica de ACK de las subidas
+constexpr uint8_t lora_ack_every_n    = 4;            // pkts por ACK en ack_mode_every_n
+constexpr uint32_t lora_ack_window_s  = 600;          // ventana en ack_mode_coalesce [s]
+constexpr Duty_policy_t lora_duty_policy = duty_policy_defer; // respuestas que no caben en el ciclo de trabajo
+constexpr uint32_t lora_duty_max_defer_s = 300;       // espera maxima de una respuesta aplazada [s]
+constexpr bool gwmp_ingest            = false;        // entrada directa desde el packet forwarder de Semtech
+constexpr uint16_t gwmp_port          = Gwmp_server::default_port;
+constexpr char gwmp_keys_file[]       = "gwmp_keys.txt"; // "DEVADDR APPSKEY" de los dispositivos ABP
 Lossy lossy;
 Data_formatter_interface* Pkt_byte_sync::data_formatter_interface = &lossy;
 Data_formatter_interface* Payload_formatter::data_formatter_impl  = &lossy;
 
-Fifo_pkt fifo_lora_input( max_elements, max_pkt_size );
-Fifo_pkt fifo_cloud_output( max_elements, max_pkt_size );
-Fifo_pkt fifo_local_output( max_elements, max_pkt_size );
+Pkt_ring lora_input( max_elements, max_pkt_size );
+Pkt_admission lora_admission;                     // prioridades y ritmo por dispositivo de lora_input
+Pkt_pool<Pkt> pkt_pool( pkt_pool_slots, max_pkt_size );    // buffers de los pkts desde la ingesta hasta el ultimo envio
+Pkt_log<Pkt> uplink_log( uplink_log_entries );     // cada pkt una vez para todos los destinos
+Pkt_log_reader<Pkt> cloud_output( uplink_log );    // lector 0
+Pkt_log_reader<Pkt> local_output( uplink_log );    // lector 1
+Pkt_queue<Pkt> satellite_output( max_satellite_elements ); // pkts que no pudieron subirse por la red movil
 
 char url_cloud[100] = { "https://api.witrac.es/api/gateway_lora" };
 char url_local[100] = { "http://192.168.2.100:8080/api/sensors/gateway/lora" };
+char mqtt_host[100] = { "mqtt.witrac.es" };
 
-Lora_udp_server lora_udp_server( fifo_lora_input, max_pkt_size );
+Lora_udp_server lora_udp_server( lora_input, max_pkt_size );
+Gwmp_server gwmp_server( lora_input, max_pkt_size );
 Comm_mgr comm_cloud( max_pkt_size, url_cloud );
 Comm_mgr comm_local( max_pkt_size, url_local );
 OrbcommST2100_controller controller;
 
+Event_loop event_loop;
+Event_fd cloud_event;                             // pkts nuevos en cloud_output
+Event_fd local_event;                             // pkts nuevos en local_output
+Timer_fd satellite_timer;                         // siguiente paso del envio por satelite
+Timer_fd position_timer;                          // siguiente envio de la posicion
+Timer_fd link_report_timer;                       // informe periodico de enlace y canales
+constexpr uint32_t retry_time_ms = 10000;         // tiempo de reintento tras un fallo
+constexpr uint32_t link_report_time_ms = 600000;  // periodo del informe de enlace y canales
+constexpr uint32_t upload_retry_base_ms = 2000;   // primera espera de reintento de una API
+constexpr uint32_t upload_retry_max_ms = 300000;  // espera maxima de reintento de una API
+constexpr uint8_t cloud_max_attempts = 5;         // envios por la red movil de un pkt sin satelite disponible
+constexpr uint8_t local_max_attempts = 255;       // envios a la API local antes de abandonar un pkt
+
+char mobile_id[16];                               // id del orbcom
+Upload_engine upload_engine;                      // peticiones HTTP asincronas sobre event_loop
+Http_sink cloud_http( cloud_output, comm_cloud, mobile_id, cloud_upload_window, (uint32_t)time( NULL ) );
+Mqtt_sink<Pkt> cloud_mqtt( cloud_output, mqtt_host, mqtt_port, mobile_id, mqtt_topic_prefix, cloud_mqtt_window, (uint32_t)time( NULL ) );
+Upload_sink<Pkt>& cloud_sink = cloud_over_mqtt ? (Upload_sink<Pkt>&)cloud_mqtt : (Upload_sink<Pkt>&)cloud_http; // solo se inicializa el transporte elegido
+Http_sink local_sink( local_output, comm_local, mobile_id, local_upload_window, (uint32_t)time( NULL ) + 1 );
+
 Imei_list imei_list;
 constexpr uint32_t send_imei_time_s_max = 86400; // 24H
 
@@ -41,32 +113,58 @@ constexpr uint8_t data_format = 2;                // formato del mensaje: ASCII-
 constexpr uint8_t sin         = 128;              // identificador del mensaje de datos
 uint32_t gateway_imei         = 0;                // imei del gateway
 char msg_name[8]              = "0";              // nombre del mensaje
-char mobile_id[16];                               // id del orbcom
 float latitud                             = 0;    // latitud obtenida del orbcom
 float longitud                            = 0;    // longitud obtenida del orbcom
 constexpr uint32_t send_position_time_max = 3600; // tiempo maximo hasta volver a enviar la posicion
 uint32_t send_position_time               = 0;    // tiempo desde la ultima vez que se envio la posicion
 
-void sleep_seconds( uint32_t seconds ) {
-    uint32_t now = time( 0 );
-    while ( time( 0 ) < now + seconds ) {};
+// Extrae el siguiente pkt de la cola de ingesta directamente sobre el buffer del pkt
+static bool pop_lora_input( Pkt& pkt ) {
+    uint16_t len = 0;
+    return lora_input.try_pop( (uint8_t*)pkt.bytes(), Pkt::get_pkt_overhead() + pkt.get_msg_len(), len );
+}
+
+// Publica un pkt para todos los destinos: una sola entrada del log, un cursor por destino
+static void put_outputs( Pkt_handle<Pkt>&& pkt ) {
+    if ( !uplink_log.push( std::move( pkt ), uplink_log.all_readers() ) ) {
+        log( pkt->hdr->src, "Uplink log full, pkt dropped\n" );
+    }
 }
 
 static void lora_receive( void ) {
-    if ( fifo_lora_input.available() > 0 ) {
-        Pkt pkt( max_pkt_size );
-        fifo_lora_input.get_pkt( pkt );
-        log( pkt.hdr->src, "Frame->" );
-        for ( uint_fast16_t i = 0; i < pkt.get_size(); i++ ) {
-            printf( " %d", pkt[i] );
+    uint16_t moved = 0;
+
+    while ( 1 ) {
+        // Un solo buffer por pkt desde aqui hasta el ultimo envio
+        Pkt_handle<Pkt> pkt = pkt_pool.acquire();
+        if ( !pkt ) {
+            // Solo ocurre con las colas de salida llenas: se descarta para no dejar la cola de ingesta sin vaciar
+            static Pkt discarded( max_pkt_size );
+            if ( pop_lora_input( discarded ) ) {
+                log( discarded.hdr->src, "Pkt pool exhausted, pkt dropped\n" );
+                continue;
+            }
+            break;
+        }
+        if ( !pop_lora_input( *pkt ) ) {
+            break;
+        }
+        log( pkt->hdr->src, "Frame->" );
+        for ( uint_fast16_t i = 0; i < pkt->get_size(); i++ ) {
+            printf( " %d", ( *pkt )[i] );
         }
         printf( "\n" );
-        fifo_cloud_output.put_pkt( pkt );
-        fifo_local_output.put_pkt( pkt );
+        put_outputs( std::move( pkt ) );
+        moved++;
+    }
+
+    if ( moved > 0 ) {
+        cloud_event.notify();
+        local_event.notify();
     }
 }
 
-static void send_cloud_by_satellite( Pkt& pkt ) {
+static bool send_cloud_by_satellite( Pkt& pkt ) {
     uint8_t msg_status = 0;
     Wtc_err_t result   = controller.send_status( msg_name, msg_status );
 
@@ -76,49 +174,90 @@ static void send_cloud_by_satellite( Pkt& pkt ) {
         controller.send( msg_name, priority, sin, data_format, pkt_filter.pkt_filtered, pkt_filter.pkt_filtered.get_size() );
     }
     else if ( result == wtc_success && msg_status == OrbcommST2100_msg_status::completed ) {
-        fifo_cloud_output.get_pkt( pkt );
         imei_list.update_imei_timestamp( pkt.hdr->src, time( 0 ) );
         log( pkt.hdr->src, "Pkt successfully sent to cloud API by satellite\n" );
+        return true;
     }
     else {
         // El mensaje no se ha enviado
     }
+    return false;
 }
 
-static void send_cloud( void ) {
-    if ( fifo_cloud_output.available() > 0 ) {
-        Pkt pkt( max_pkt_size );
-        fifo_cloud_output.copy_pkt( pkt );
+// Vacia la cola de satelite. El envio de cada pkt se completa en reintentos sucesivos
+static void send_satellite( void ) {
+    Pkt* head;
 
-        if ( comm_cloud.send( pkt, mobile_id ) ) {
-            log( pkt.hdr->src, "Pkt successfully sent to cloud API by cellular\n" );
-            fifo_cloud_output.get_pkt( pkt );
-        }
-        else {
-            log( pkt.hdr->src, "Error sending pkt to cloud API by cellular\n" );
-            if ( imei_list.check_send_pkt_by_satellite( pkt.hdr->src, time( 0 ), send_imei_time_s_max ) ) {
-                log( pkt.hdr->src, "Sending pkt by satellite \n" );
-                send_cloud_by_satellite( pkt );
-            }
-            else {
-                fifo_cloud_output.get_pkt( pkt );
-            }
+    while ( ( head = satellite_output.front() ) != NULL ) {
+        if ( !send_cloud_by_satellite( *head ) ) {
+            satellite_timer.start( retry_time_ms );
+            return;
         }
+        satellite_output.pop();
     }
 }
 
-static void send_local( void ) {
-    if ( fifo_local_output.available() > 0 ) {
-        Pkt pkt( max_pkt_size );
-        fifo_local_output.copy_pkt( pkt );
+// Resultado de cada pkt subido a cloud. Un pkt que no se pudo subir pasa a satelite si su
+// dispositivo no ha enviado por satelite recientemente, y si no se reintenta por la red movil
+static Upload_verdict_t on_cloud_result( void* arg, const Pkt_handle<Pkt>& pkt, bool ok, long response_code ) {
+    (void)arg;
+    if ( ok ) {
+        log( pkt->hdr->src, "Pkt successfully sent to cloud API by cellular\n" );
+        return upload_keep;
+    }
 
-        if ( comm_local.send( pkt, mobile_id ) ) {
-            log( pkt.hdr->src, "Pkt successfully sent to local API\n" );
-            fifo_local_output.get_pkt( pkt );
-        }
-        else {
-            log( pkt.hdr->src, "Error sending pkt to local API\n" );
-        }
+    log( pkt->hdr->src, "Error sending pkt to cloud API by cellular (%ld)\n", response_code );
+    if ( !imei_list.check_send_pkt_by_satellite( pkt->hdr->src, time( 0 ), send_imei_time_s_max ) ) {
+        return upload_keep;
+    }
+    log( pkt->hdr->src, "Sending pkt by satellite \n" );
+    if ( !satellite_output.push( pkt.share() ) ) {
+        log( pkt->hdr->src, "Satellite output full, pkt dropped\n" );
+    }
+    satellite_timer.start( retry_time_ms );
+    return upload_drop;
+}
+
+// Resultado de cada pkt subido a local. Tras un fallo el pkt pasa a la via de reintentos
+static Upload_verdict_t on_local_result( void* arg, const Pkt_handle<Pkt>& pkt, bool ok, long response_code ) {
+    (void)arg;
+    if ( ok ) {
+        log( pkt->hdr->src, "Pkt successfully sent to local API\n" );
+        return upload_keep;
+    }
+
+    log( pkt->hdr->src, "Error sending pkt to local API (%ld)\n", response_code );
+    return upload_keep;
+}
+
+// Cambios de la conexion con el broker MQTT de cloud
+static void on_mqtt_event( void* arg, Mqtt_event_t event, uint32_t detail ) {
+    (void)arg;
+    switch ( event ) {
+        case mqtt_event_connect_failed:
+            log( (uint32_t)0, "MQTT connect to %s:%u failed: %s\n", mqtt_host, mqtt_port, strerror( detail ) );
+            break;
+        case mqtt_event_not_resolved:
+            log( (uint32_t)0, "MQTT broker %s not resolved\n", mqtt_host );
+            break;
+        case mqtt_event_refused:
+            log( (uint32_t)0, "MQTT connection to %s:%u refused (%u)\n", mqtt_host, mqtt_port, detail );
+            break;
+        case mqtt_event_connected:
+            log( (uint32_t)0, "MQTT connected to %s:%u; session present: %u\n", mqtt_host, mqtt_port, detail );
+            break;
+        case mqtt_event_lost:
+            log( (uint32_t)0, "MQTT connection to %s:%u lost\n", mqtt_host, mqtt_port );
+            break;
+        case mqtt_event_connect_timeout:
+            log( (uint32_t)0, "MQTT connection to %s:%u timed out\n", mqtt_host, mqtt_port );
+            break;
+        case mqtt_event_puback_timeout:
+            log( (uint32_t)0, "MQTT PUBACK timed out after %u ms\n", detail );
+            break;
+        case mqtt_event_pingresp_timeout:
+            log( (uint32_t)0, "MQTT PINGRESP timed out\n" );
+            break;
     }
 }
 
@@ -135,6 +274,13 @@ static bool get_position( void ) {
 static void send_position( void ) {
     if ( time( 0 ) > ( send_position_time + send_position_time_max ) ) {
         if ( get_position() ) {
+            // El pkt se crea directamente en un buffer del pool; sin buffer se reintenta mas tarde
+            Pkt_handle<Pkt> pkt_position = pkt_pool.acquire();
+            if ( !pkt_position ) {
+                log( (uint32_t)0, "Pkt pool exhausted, position delayed\n" );
+                position_timer.start( retry_time_ms );
+                return;
+            }
             log( (uint32_t)0, "Position -> latitud: %f; longitud: %f\n", latitud, longitud );
             send_position_time = time( 0 );
             // Creamos el modelo
@@ -143,20 +289,183 @@ static void send_position( void ) {
             location.longitud  = longitud;
             location.timestamp = send_position_time;
             // Creamos el pkt con lossy
-            Pkt pkt_position( max_pkt_size );
             Payload_mgr payload_mgr( max_pkt_size );
             payload_mgr.reset();
             location.to_pkt_payload( &payload_mgr );
 
-            pkt_position.hdr->len = payload_mgr.get_used_size();
-            pkt_position.build( gateway_imei, 123, cmd_sensor_data, send_position_time, payload_mgr.get_bytes(), payload_mgr.get_used_size() );
+            pkt_position->hdr->len = payload_mgr.get_used_size();
+            pkt_position->build( gateway_imei, 123, cmd_sensor_data, send_position_time, payload_mgr.get_bytes(), payload_mgr.get_used_size() );
 
-            fifo_cloud_output.put_pkt( pkt_position );
+            if ( !uplink_log.push( std::move( pkt_position ), cloud_output.mask() ) ) {
+                log( (uint32_t)0, "Cloud output full, position dropped\n" );
+            }
+            cloud_event.notify();
+            position_timer.start( send_position_time_max * 1000UL );
         }
         else {
             log( (uint32_t)0, "Error getting position\n" );
+            position_timer.start( retry_time_ms );
         }
     }
+    else {
+        position_timer.start( ( send_position_time + send_position_time_max + 1 - time( 0 ) ) * 1000UL );
+    }
+}
+
+// Informe de ocupacion de canales, de ciclo de trabajo de las bajadas, de latencia de la API, de descartes en la admision y de los dispositivos que podrian usar un SF mas rapido
+static Link_device_report_t link_reports[Link_stats::max_devices];
+static Admission_device_report_t admission_reports[Pkt_admission::max_devices];
+static void send_link_report( void ) {
+    Channel_report_t channels[Channel_usage::max_channels];
+    uint8_t n_channels = lora_udp_server.get_channel_usage().get_channels( channels, Channel_usage::max_channels, time( NULL ) );
+    for ( uint8_t i = 0; i < n_channels; i++ ) {
+        log( (uint32_t)0, "Channel %u kHz -> uplinks: %u; airtime: %u us; utilization: %u/1000\n", channels[i].freq_khz, channels[i].uplinks, channels[i].airtime_us, channels[i].utilization );
+    }
+
+    Duty_band_report_t bands[Duty_cycle::max_bands];
+    uint8_t n_bands = lora_udp_server.get_duty_cycle().get_bands( bands, Duty_cycle::max_bands, time( NULL ) );
+    for ( uint8_t i = 0; i < n_bands; i++ ) {
+        if ( bands[i].used_us > 0 || bands[i].refused > 0 ) {
+            log( (uint32_t)0, "Duty cycle %u-%u kHz -> used: %u/%u us; usage: %u/1000; refused: %u\n", bands[i].min_khz, bands[i].max_khz, bands[i].used_us, bands[i].budget_us, bands[i].usage, bands[i].refused );
+        }
+    }
+    Lora_udp_stats_t udp = lora_udp_server.get_stats();
+    log( (uint32_t)0, "Lora udp -> wakeups: %u; datagrams: %u; truncated: %u; full batches: %u; max batch: %u; dispatch drops: %u\n", udp.wakeups, udp.datagrams, udp.truncated, udp.full_batches, udp.max_batch, udp.dispatch_drops );
+    Dedup_stats_t dedup = lora_udp_server.get_dedup_stats();
+    log( (uint32_t)0, "Dedup -> hits: %u; misses: %u; evictions: %u\n", dedup.hits, dedup.misses, dedup.evictions );
+    Ack_policy_stats_t acks = lora_udp_server.get_ack_stats();
+    log( (uint32_t)0, "Ack policy -> sent: %u; suppressed: %u; time conf forced: %u; airtime saved: %llu us\n", acks.acks_sent, acks.acks_suppressed, acks.time_conf_forced, (unsigned long long)acks.airtime_saved_us );
+    Lora_udp_client_stats_t downlink = lora_udp_server.get_downlink_stats();
+    log( (uint32_t)0, "Downlinks -> sent: %u; deferred: %u; dropped: %u; expired: %u\n", downlink.sent, downlink.duty_deferred, downlink.duty_dropped, downlink.duty_expired );
+
+    static const char* class_names[n_admission_classes] = { "alarm", "position", "periodic", "unclassified" };
+    for ( uint8_t i = 0; i < n_admission_classes; i++ ) {
+        Admission_class_stats_t admitted = lora_admission.get_class_stats( (Admission_class_t)i );
+        log( (uint32_t)0, "Admission %s -> accepted: %u; shed: %u; rate limited: %u; refused: %u\n", class_names[i], admitted.accepted, admitted.shed, admitted.rate_limited, admitted.refused );
+    }
+    uint16_t n_admitted = lora_admission.get_devices( admission_reports, Pkt_admission::max_devices );
+    for ( uint16_t i = 0; i < n_admitted; i++ ) {
+        if ( admission_reports[i].dropped > 0 ) {
+            log( admission_reports[i].device, "Admission drops: %u of %u\n", admission_reports[i].dropped, admission_reports[i].accepted + admission_reports[i].dropped );
+        }
+    }
+
+    static const char* comm_names[2]    = { "cloud", "local" };
+    static const char* breaker_names[3] = { "closed", "open", "half-open" };
+    Comm_stats_t comms[2]               = { comm_cloud.get_stats(), comm_local.get_stats() };
+    Upload_sink_stats_t uploads[2]      = { cloud_sink.get_stats(), local_sink.get_stats() };
+    Sink_health_report_t healths[2]     = { cloud_sink.get_health(), local_sink.get_health() };
+    Pkt_log_reader_stats_t readers[2]   = { cloud_output.get_stats(), local_output.get_stats() };
+    Pkt_log_stats_t uplinks             = uplink_log.get_stats();
+    log( (uint32_t)0, "Uplink log -> used: %u/%u; high water: %u; pushed: %u; refused: %u; oldest held by: %s\n", uplinks.used, uplinks.capacity, uplinks.high_water, uplinks.pushed, uplinks.refused, uplinks.laggard < 2 ? comm_names[uplinks.laggard] : "none" );
+    for ( uint8_t i = 0; i < 2; i++ ) {
+        log( (uint32_t)0, "Upload %s -> queued: %u; max queued: %u; overrun: %u; in flight: %u; requests: %u; pkts sent: %u; delivered: %u; failed: %u; dropped: %u\n", comm_names[i], readers[i].pending, readers[i].max_pending, readers[i].overrun, uploads[i].in_flight, uploads[i].started, uploads[i].batched, uploads[i].delivered, uploads[i].failed, uploads[i].dropped );
+        log( (uint32_t)0, "Retry %s -> lane: %u; retried: %u; abandoned: %u; breaker: %s; failures: %u; opened: %u; backoff: %u ms; srtt/timeout: %u/%u ms\n", comm_names[i], uploads[i].retry_lane, uploads[i].retried, uploads[i].abandoned, breaker_names[healths[i].state], healths[i].failures, healths[i].opened, healths[i].backoff_ms, healths[i].srtt_ms, healths[i].timeout_ms );
+        const Comm_stats_t& comm = comms[i];
+        if ( comm.requests > 0 ) {
+            log( (uint32_t)0, "Comm %s -> requests: %u; errors: %u; connects: %u; reused: %u; retries: %u; latency last/avg/max: %u/%u/%u ms; last dns/connect/tls: %u/%u/%u ms; body/wire: %llu/%llu bytes; compressed: %u\n", comm_names[i], comm.requests, comm.errors, comm.connects, comm.reused, comm.retries, comm.last_us / 1000, (uint32_t)( comm.total_us / comm.requests / 1000 ), comm.max_us / 1000, comm.last_dns_us / 1000, comm.last_connect_us / 1000, comm.last_tls_us / 1000, (unsigned long long)comm.body_bytes, (unsigned long long)comm.wire_bytes, comm.compressed );
+        }
+    }
+
+    Replay_report_t replay = cloud_http.get_replay();
+    if ( replay.replays > 0 ) {
+        log( (uint32_t)0, "Replay cloud -> active: %u; left: %u/%u; rate: %u pkts/min; eta: %u s; elapsed: %u s; replays: %u; live/backlog: %llu/%llu bytes\n", replay.active, replay.left, replay.total, replay.rate_ppm, replay.eta_s, replay.elapsed_s, replay.replays, (unsigned long long)replay.live_bytes, (unsigned long long)replay.backlog_bytes );
+    }
+    if ( cloud_over_mqtt ) {
+        Mqtt_link_stats_t mqtt = cloud_mqtt.get_link_stats();
+        log( (uint32_t)0, "Mqtt cloud -> connected: %u; connects: %u; resumed: %u; lost: %u; pings: %u; bytes out/in: %llu/%llu\n", mqtt.connected, mqtt.connects, mqtt.resumed, mqtt.lost, mqtt.pings, (unsigned long long)mqtt.bytes_out, (unsigned long long)mqtt.bytes_in );
+    }
+
+    Pkt_pool_stats_t pool = pkt_pool.get_stats();
+    log( (uint32_t)0, "Pkt pool -> in use: %u/%u; high water: %u; exhausted: %u\n", pool.in_use, pool.slots, pool.high_water, pool.exhausted );
+
+    uint16_t n_devices = lora_udp_server.get_link_stats().get_devices( link_reports, Link_stats::max_devices );
+    for ( uint16_t i = 0; i < n_devices; i++ ) {
+        const Link_device_report_t& device = link_reports[i];
+        if ( device.suggested_sf < device.sf ) {
+            log( (uint32_t)0, "Device %s -> SF%u could use SF%u; rssi: %i dBm; lsnr min/avg/max: %i/%i/%i (0.1 dB)\n", device.eui, device.sf, device.suggested_sf, device.rssi_avg, device.lsnr_min, device.lsnr_avg, device.lsnr_max );
+        }
+    }
+}
+
+// Callbacks del bucle de eventos. Cada etapa consume su evento y vacia su fifo
+static void on_ingest( void* arg, uint32_t events ) {
+    (void)arg;
+    (void)events;
+    lora_input.consume_wakeup();
+    // Se vacia la cola hasta poder dormir sin perder una notificacion
+    do {
+        lora_receive();
+    } while ( !lora_input.arm_wait() );
+}
+
+static void on_cloud( void* arg, uint32_t events ) {
+    (void)events;
+    ( (Event_fd*)arg )->consume();
+    cloud_sink.pump();
+}
+
+static void on_satellite( void* arg, uint32_t events ) {
+    (void)events;
+    ( (Timer_fd*)arg )->consume();
+    send_satellite();
+}
+
+static void on_local( void* arg, uint32_t events ) {
+    (void)events;
+    ( (Event_fd*)arg )->consume();
+    local_sink.pump();
+}
+
+static void on_position( void* arg, uint32_t events ) {
+    (void)arg;
+    (void)events;
+    position_timer.consume();
+    send_position();
+}
+
+static void on_link_report( void* arg, uint32_t events ) {
+    (void)arg;
+    (void)events;
+    link_report_timer.consume();
+    send_link_report();
+}
+
+static bool init_pipeline( void ) {
+    if ( !event_loop.init() || !lora_input.init() || !cloud_event.init() || !local_event.init() ) {
+        return false;
+    }
+    if ( !satellite_timer.init() || !position_timer.init() || !link_report_timer.init() ) {
+        return false;
+    }
+
+    bool added = event_loop.add( lora_input.get_fd(), EPOLLIN, on_ingest, nullptr );
+    added &= event_loop.add( cloud_event.get_fd(), EPOLLIN, on_cloud, &cloud_event );
+    added &= event_loop.add( satellite_timer.get_fd(), EPOLLIN, on_satellite, &satellite_timer );
+    added &= event_loop.add( local_event.get_fd(), EPOLLIN, on_local, &local_event );
+    added &= event_loop.add( position_timer.get_fd(), EPOLLIN, on_position, nullptr );
+    added &= event_loop.add( link_report_timer.get_fd(), EPOLLIN, on_link_report, nullptr );
+    comm_cloud.set_encoding( cloud_encoding );
+    comm_local.set_encoding( local_encoding );
+    if ( !added || !upload_engine.init( event_loop ) || !local_sink.init( upload_engine, event_loop ) ) {
+        return false;
+    }
+    if ( cloud_over_mqtt ? !cloud_mqtt.init( event_loop ) : !cloud_http.init( upload_engine, event_loop ) ) {
+        return false;
+    }
+    cloud_http.set_replay( cloud_replay_min_pkts, cloud_live_share );
+    cloud_mqtt.set_encoding( mqtt_encoding );
+    cloud_mqtt.set_keepalive( mqtt_keepalive_s );
+    cloud_mqtt.set_event_cb( on_mqtt_event, nullptr );
+    comm_cloud.set_compression( cloud_gzip_bodies, gzip_min_body );
+    comm_local.set_compression( local_gzip_bodies, gzip_min_body );
+    comm_cloud.set_batching( cloud_batch_bodies );
+    cloud_sink.set_batch( cloud_over_mqtt ? mqtt_batch_pkts : cloud_batch_pkts, cloud_batch_age_ms );
+    cloud_sink.set_retry( upload_retry_base_ms, upload_retry_max_ms, cloud_max_attempts );
+    local_sink.set_retry( upload_retry_base_ms, upload_retry_max_ms, local_max_attempts );
+    cloud_sink.set_result_cb( on_cloud_result, nullptr );
+    local_sink.set_result_cb( on_local_result, nullptr );
+    return true;
 }
 
 main( void ) {
@@ -178,12 +487,43 @@ main( void ) {
     }
     fclose( imei_file );
 
-    sleep_seconds( 5 );
+    sleep( 5 );
+
+    if ( !init_pipeline() ) {
+        log( (uint32_t)0, "Error pipeline init\n" );
+        exit( EXIT_FAILURE );
+    }
 
+    lora_udp_server.set_batch_size( lora_rx_batch_size );
+    lora_udp_server.set_workers( lora_ingest_workers );
+    lora_udp_server.set_dedup_window( lora_dedup_window_s );
+    lora_udp_server.set_ack_policy( lora_ack_mode, lora_ack_every_n, lora_ack_window_s );
+    lora_udp_server.set_duty_policy( lora_duty_policy, lora_duty_max_defer_s );
+    // cmd_sensor_data lleva tanto lecturas como alarmas y no hay otro comando de subida: sin clases
+    // no hay descarte por nivel ni por ritmo, solo se rechaza sin ACK con la cola llena. Para
+    // activarlo, asignar con set_class los comandos que solo lleven un tipo de dato y fijar set_rate
+    lora_udp_server.set_admission( &lora_admission );
+    gwmp_server.set_admission( &lora_admission );
     if ( !lora_udp_server.init( 1784, 1786 ) ) {
         exit( EXIT_FAILURE );
     }
 
+    if ( gwmp_ingest ) {
+        // Las subidas por GWMP no reciben ACK ni configuracion de hora: sin ACK a cada pkt, el
+        // dispositivo no sabe que se ha guardado
+        if ( lora_ack_mode == ack_mode_all ) {
+            log( (uint32_t)0, "Error GWMP ingest sends no acks, not allowed with ack_mode_all\n" );
+            exit( EXIT_FAILURE );
+        }
+        int16_t devices = gwmp_server.load_devices( gwmp_keys_file );
+        if ( devices < 0 ) {
+            log( (uint32_t)0, "Error GWMP keys file %s\n", gwmp_keys_file );
+        }
+        if ( !gwmp_server.init( gwmp_port ) ) {
+            exit( EXIT_FAILURE );
+        }
+    }
+
     if ( controller.init() != wtc_success ) {
         exit( EXIT_FAILURE );
     }
@@ -197,11 +537,10 @@ main( void ) {
     memset( mobile_id, 0, sizeof( mobile_id ) );
     controller.get_mobile_id( mobile_id );
 
-    while ( 1 ) {
-        send_position();
-        lora_receive();
-        send_cloud();
-        send_local();
-        sleep_seconds( 10 );
-    }
+    // Primera posicion y vaciado de lo recibido durante el arranque
+    position_timer.start( 0 );
+    link_report_timer.start( link_report_time_ms, link_report_time_ms );
+    on_ingest( nullptr, 0 );
+
+    event_loop.run();
 }
\ No newline at end of file
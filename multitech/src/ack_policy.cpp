@@ -0,0 +1,92 @@
+#include "ack_policy.h"
+#include <string.h>
+
+Ack_policy::Ack_policy( Ack_mode_t mode_0, uint8_t every_n_0, uint32_t window_s_0 ) {
+    memset( devices, 0, sizeof( devices ) );
+    memset( &stats, 0, sizeof( stats ) );
+    configure( mode_0, every_n_0, window_s_0 );
+}
+
+Ack_policy::~Ack_policy() {}
+
+void Ack_policy::configure( Ack_mode_t mode_0, uint8_t every_n_0, uint32_t window_s_0 ) {
+    mode     = mode_0;
+    every_n  = every_n_0 > 0 ? every_n_0 : 1;
+    window_s = window_s_0;
+}
+
+Ack_policy::Device_state_t& Ack_policy::lookup( uint32_t device, uint32_t now_s ) {
+    // Sondeo lineal desde el hash; si la tabla esta llena se reemplaza el menos reciente
+    uint16_t start  = (uint32_t)( device * 2654435761UL ) >> 24;
+    uint16_t oldest = start % max_devices;
+    for ( uint16_t i = 0; i < max_devices; i++ ) {
+        uint16_t pos = ( start + i ) % max_devices;
+        if ( devices[pos].used && devices[pos].device == device ) {
+            return devices[pos];
+        }
+        if ( !devices[pos].used ) {
+            oldest = pos;
+            break;
+        }
+        if ( devices[pos].last_seen_s < devices[oldest].last_seen_s ) {
+            oldest = pos;
+        }
+    }
+
+    Device_state_t& state = devices[oldest];
+    state.device          = device;
+    state.last_ack_s      = 0;
+    state.last_seen_s     = now_s;
+    state.since_ack       = 0;
+    state.used            = true;
+    return state;
+}
+
+bool Ack_policy::should_send( uint32_t device, bool confirmed, bool time_conf, uint32_t now_s, uint32_t airtime_us ) {
+    bool send = true;
+
+    if ( mode != ack_mode_all ) {
+        Device_state_t& state = lookup( device, now_s );
+        state.last_seen_s     = now_s;
+        if ( state.since_ack < UINT8_MAX ) {
+            state.since_ack++;
+        }
+
+        switch ( mode ) {
+            case ack_mode_every_n:
+                send = state.since_ack >= every_n;
+                break;
+            case ack_mode_on_request:
+                send = confirmed;
+                break;
+            case ack_mode_coalesce:
+                send = state.last_ack_s == 0 || now_s - state.last_ack_s >= window_s;
+                break;
+            default:
+                break;
+        }
+
+        // La correccion de hora no puede esperar: el dispositivo seguiria fechando mal sus medidas
+        if ( !send && time_conf ) {
+            send = true;
+            stats.time_conf_forced++;
+        }
+        if ( send ) {
+            state.since_ack  = 0;
+            state.last_ack_s = now_s;
+        }
+    }
+
+    if ( send ) {
+        stats.acks_sent++;
+    }
+    else {
+        stats.acks_suppressed++;
+        stats.airtime_saved_us += airtime_us;
+    }
+    return send;
+}
+
+Ack_policy_stats_t Ack_policy::get_stats( void ) const {
+    return stats;
+}
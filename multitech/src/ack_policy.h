@@ -0,0 +1,98 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+  \brief Modos de envio de ACK
+*/
+typedef enum : uint8_t {
+    ack_mode_all = 0,           ///< ACK a cada pkt guardado (comportamiento original)
+    ack_mode_every_n,           ///< ACK cada N pkts de un mismo dispositivo
+    ack_mode_on_request,        ///< ACK solo a las subidas confirmadas
+    ack_mode_coalesce           ///< Un ACK por ventana que cubre todo lo recibido desde el anterior
+} Ack_mode_t;
+
+/**
+  \brief Estadisticas de la politica de ACK
+*/
+typedef struct {
+    uint32_t acks_sent;             ///< Respuestas enviadas
+    uint32_t acks_suppressed;       ///< Respuestas ahorradas
+    uint32_t time_conf_forced;      ///< Respuestas forzadas por deriva del timestamp
+    uint64_t airtime_saved_us;      ///< Tiempo de transmision ahorrado [us]
+} Ack_policy_stats_t;
+
+/**
+  \class Ack_policy
+  \brief Decide si un pkt guardado recibe ACK, para reducir el tiempo de transmision del
+  gateway (sordo a las subidas mientras transmite y limitado por ciclo de trabajo).
+  Los dispositivos son clase A: un ACK solo puede salir en la ventana de recepcion que sigue
+  a una subida, por lo que agrupar significa responder a la primera subida tras la ventana.
+  Una respuesta de configuracion de hora (deriva del timestamp) siempre se envia
+*/
+class Ack_policy {
+
+    public:
+
+        /**
+          \brief Constructor de la clase
+          \param mode_0 Modo de envio
+          \param every_n_0 Pkts por ACK en ack_mode_every_n
+          \param window_s_0 Ventana en ack_mode_coalesce [s]
+        */
+        Ack_policy( Ack_mode_t mode_0 = ack_mode_all, uint8_t every_n_0 = 1, uint32_t window_s_0 = 0 );
+
+        /**
+          \brief Destructor de la clase
+        */
+        ~Ack_policy();
+
+        /**
+          \brief Cambia el modo de envio
+          \param mode_0 Modo de envio
+          \param every_n_0 Pkts por ACK en ack_mode_every_n
+          \param window_s_0 Ventana en ack_mode_coalesce [s]
+        */
+        void configure( Ack_mode_t mode_0, uint8_t every_n_0, uint32_t window_s_0 );
+
+        /**
+          \brief Decide si se responde a un pkt
+          \param device Identificador del dispositivo (src del pkt)
+          \param confirmed La subida es confirmada
+          \param time_conf La respuesta seria una configuracion de hora
+          \param now_s Instante actual [s]
+          \param airtime_us Tiempo en el aire de la respuesta, se acumula si se ahorra [us]
+          \return true si hay que enviar la respuesta
+        */
+        bool should_send( uint32_t device, bool confirmed, bool time_conf, uint32_t now_s, uint32_t airtime_us );
+
+        /**
+          \brief Devuelve las estadisticas
+        */
+        Ack_policy_stats_t get_stats( void ) const;
+
+    private:
+
+        typedef struct {
+            uint32_t device;
+            uint32_t last_ack_s;        ///< Instante del ultimo ACK
+            uint32_t last_seen_s;       ///< Instante del ultimo pkt, para reemplazar entradas
+            uint8_t since_ack;          ///< Pkts recibidos desde el ultimo ACK
+            bool used;
+        } Device_state_t;
+
+        static const uint16_t max_devices = 256;
+
+        /**
+          \brief Devuelve el estado de un dispositivo, reemplazando el menos reciente si no hay sitio
+          \param device Identificador del dispositivo
+          \param now_s Instante actual [s]
+        */
+        Device_state_t& lookup( uint32_t device, uint32_t now_s );
+
+        Ack_mode_t mode;
+        uint8_t every_n;
+        uint32_t window_s;
+        Device_state_t devices[max_devices];
+        Ack_policy_stats_t stats;
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+  \class Aes128
+  \brief Cifrado AES-128 de un bloque (FIPS-197). Solo el sentido directo: LoRaWAN lo usa
+  en modo contador, que cifra y descifra el FRMPayload con la misma operacion
+*/
+class Aes128 {
+
+    public:
+
+        static const uint8_t block_len = 16;
+        static const uint8_t key_len   = 16;
+
+        /**
+          \brief Constructor de la clase
+        */
+        Aes128();
+
+        /**
+          \brief Destructor de la clase
+        */
+        ~Aes128();
+
+        /**
+          \brief Expande la clave
+          \param key Clave de 16 bytes
+        */
+        void set_key( const uint8_t key[key_len] );
+
+        /**
+          \brief Cifra un bloque
+          \param in Bloque de entrada
+          \param out Bloque de salida, puede ser el mismo que in
+        */
+        void encrypt( const uint8_t in[block_len], uint8_t out[block_len] ) const;
+
+    private:
+
+        static const uint8_t rounds = 10;
+
+        uint8_t round_keys[( rounds + 1 ) * block_len];
+};
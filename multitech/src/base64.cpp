@@ -1,5 +1,107 @@
 #include "base64.h"
 
+// Tabla inversa de 256 entradas: un acceso por caracter, 0xFF para caracteres no validos.
+// Permite validar y decodificar un cuarteto con 4 accesos y una sola comprobacion
+static const uint8_t b64dec[256] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x3E, 0xFF, 0xFF, 0xFF, 0x3F,
+    0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E,
+    0x0F, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F, 0x30, 0x31, 0x32, 0x33, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+};
+
+static const uint8_t b64invalid = 0x80;
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+// Camino SSSE3 (x86), seleccionado en tiempo de ejecucion. Algoritmos de W. Mula:
+// 12 bytes -> 16 caracteres al codificar y 16 caracteres -> 12 bytes al decodificar.
+// El gateway (ARM926EJ-S, ARMv5TE) no tiene NEON y compila solo el camino escalar
+#define BASE64_SSSE3
+#include <tmmintrin.h>
+
+__attribute__( ( target( "ssse3" ) ) ) static size_t encode_ssse3( const unsigned char* in, size_t len, char* out ) {
+	const __m128i shuffle  = _mm_set_epi8( 10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1 );
+	const __m128i shift_lut = _mm_setr_epi8( 'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+	                                         '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0 );
+	size_t i = 0;
+	size_t j = 0;
+
+	// Se cargan 16 bytes y se consumen 12
+	for ( ; i + 16 <= len; i += 12, j += 16 ) {
+		__m128i v = _mm_shuffle_epi8( _mm_loadu_si128( (const __m128i*)&in[i] ), shuffle );
+
+		// Separa los 4 indices de 6 bits de cada grupo de 3 bytes
+		__m128i t0      = _mm_and_si128( v, _mm_set1_epi32( 0x0fc0fc00 ) );
+		__m128i t1      = _mm_mulhi_epu16( t0, _mm_set1_epi32( 0x04000040 ) );
+		__m128i t2      = _mm_and_si128( v, _mm_set1_epi32( 0x003f03f0 ) );
+		__m128i t3      = _mm_mullo_epi16( t2, _mm_set1_epi32( 0x01000010 ) );
+		__m128i indices = _mm_or_si128( t1, t3 );
+
+		// Traduce indice a caracter sumando el desplazamiento de su rango
+		__m128i range = _mm_subs_epu8( indices, _mm_set1_epi8( 51 ) );
+		__m128i less  = _mm_cmpgt_epi8( _mm_set1_epi8( 26 ), indices );
+		range         = _mm_or_si128( range, _mm_and_si128( less, _mm_set1_epi8( 13 ) ) );
+		__m128i chars = _mm_add_epi8( _mm_shuffle_epi8( shift_lut, range ), indices );
+
+		_mm_storeu_si128( (__m128i*)&out[j], chars );
+	}
+	return i;
+}
+
+__attribute__( ( target( "ssse3" ) ) ) static size_t decode_ssse3( const char* in, size_t len, unsigned char* out ) {
+	const __m128i shift_lut  = _mm_setr_epi8( 0, 0, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0 );
+	const __m128i mask_lut   = _mm_setr_epi8( (char)0xa8, (char)0xf8, (char)0xf8, (char)0xf8, (char)0xf8, (char)0xf8, (char)0xf8, (char)0xf8,
+	                                          (char)0xf8, (char)0xf8, (char)0xf0, 0x54, 0x50, 0x50, 0x50, 0x54 );
+	const __m128i bitpos_lut = _mm_setr_epi8( 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, (char)0x80, 0, 0, 0, 0, 0, 0, 0, 0 );
+	const __m128i pack       = _mm_setr_epi8( 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1 );
+	unsigned char block[16];
+	size_t i = 0;
+	size_t j = 0;
+
+	for ( ; i + 16 <= len; i += 16, j += 12 ) {
+		__m128i v      = _mm_loadu_si128( (const __m128i*)&in[i] );
+		__m128i hi     = _mm_and_si128( _mm_srli_epi32( v, 4 ), _mm_set1_epi8( 0x0f ) );
+		__m128i lo     = _mm_and_si128( v, _mm_set1_epi8( 0x0f ) );
+
+		// Validacion: cada nibble bajo indica que nibbles altos forman un caracter valido
+		__m128i allowed = _mm_and_si128( _mm_shuffle_epi8( mask_lut, lo ), _mm_shuffle_epi8( bitpos_lut, hi ) );
+		if ( _mm_movemask_epi8( _mm_cmpeq_epi8( allowed, _mm_setzero_si128() ) ) ) {
+			break; // El camino escalar localiza el error (o el relleno '=')
+		}
+
+		// '/' comparte nibble alto con '+' pero necesita desplazamiento 16 en lugar de 19
+		__m128i shift = _mm_shuffle_epi8( shift_lut, hi );
+		shift         = _mm_add_epi8( shift, _mm_and_si128( _mm_cmpeq_epi8( v, _mm_set1_epi8( '/' ) ), _mm_set1_epi8( -3 ) ) );
+		__m128i idx   = _mm_add_epi8( v, shift );
+
+		// Empaqueta 4 indices de 6 bits en 3 bytes
+		__m128i merged = _mm_maddubs_epi16( idx, _mm_set1_epi32( 0x01400140 ) );
+		merged         = _mm_madd_epi16( merged, _mm_set1_epi32( 0x00011000 ) );
+		_mm_storeu_si128( (__m128i*)block, _mm_shuffle_epi8( merged, pack ) );
+		memcpy( &out[j], block, 12 );
+	}
+	return i;
+}
+
+static bool detect_ssse3( void ) {
+	__builtin_cpu_init();
+	return __builtin_cpu_supports( "ssse3" );
+}
+
+static const bool has_ssse3 = detect_ssse3();
+#endif
+
 Base64::Base64() {
 }
 
@@ -33,7 +135,16 @@ bool Base64::encode( unsigned char* in, char* out, size_t len ) {
 	elen = encoded_size( len );
 	out[elen] = '\0';
 
-	for ( i=0, j=0; i<len; i+=3, j+=4 ) {
+	i = 0;
+	j = 0;
+#ifdef BASE64_SSSE3
+	if ( has_ssse3 ) {
+		i = encode_ssse3( in, len, out );
+		j = i / 3 * 4;
+	}
+#endif
+
+	for ( ; i<len; i+=3, j+=4 ) {
 		v = in[i];
 		v = i+1 < len ? v << 8 | in[i+1] : v << 8;
 		v = i+2 < len ? v << 8 | in[i+2] : v << 8;
@@ -56,7 +167,14 @@ bool Base64::encode( unsigned char* in, char* out, size_t len ) {
 }
 
 size_t Base64::decoded_size( const char* in ) {
-	size_t len;
+	if ( in == NULL ) {
+		return 0;
+	}
+
+	return decoded_size( in, strlen( in ) );
+}
+
+size_t Base64::decoded_size( const char* in, size_t inlen ) {
 	size_t ret;
 	size_t i;
 
@@ -64,10 +182,9 @@ size_t Base64::decoded_size( const char* in ) {
 		return 0;
 	}
 
-	len = strlen( in );
-	ret = len / 4 * 3;
+	ret = inlen / 4 * 3;
 
-	for ( i=len; i-->0; ) {
+	for ( i=inlen; i-->0; ) {
 		if ( in[i] == '=' ) {
 			ret--;
 		} else {
@@ -79,55 +196,76 @@ size_t Base64::decoded_size( const char* in ) {
 }
 
 bool Base64::isvalidchar( char c ) {
-	if ( c >= '0' && c <= '9' ) {
-		return true;
-	}
-	if ( c >= 'A' && c <= 'Z' ) {
-		return true;
-	}
-	if ( c >= 'a' && c <= 'z' ) {
-		return true;
-	}
-	if ( c == '+' || c == '/' || c == '=' ) {
-		return true;
-	}
-	return false;
+	return c == '=' || b64dec[(uint8_t)c] != 0xFF;
 }
 
 bool Base64::decode( const char* in, unsigned char* out, size_t outlen ) {
-	size_t len;
-	size_t i;
-	size_t j;
-	int    v;
+	if ( in == NULL || out == NULL ) {
+		return false;
+	}
+
+	return decode( in, strlen( in ), out, outlen );
+}
+
+bool Base64::decode( const char* in, size_t len, unsigned char* out, size_t outlen ) {
+	size_t   i;
+	size_t   j;
+	uint32_t v;
+	uint8_t  a, b, c, d;
 
 	if ( in == NULL || out == NULL ) {
 		return false;
-    }
+	}
 
-	len = strlen( in );
-	if ( outlen < decoded_size( in ) || len % 4 != 0 ) {
+	if ( len % 4 != 0 || outlen < decoded_size( in, len ) ) {
 		return false;
 	}
+	if ( len == 0 ) {
+		return true;
+	}
+
+	i = 0;
+	j = 0;
+#ifdef BASE64_SSSE3
+	// El ultimo cuarteto, que puede llevar relleno, siempre lo trata el camino escalar
+	if ( has_ssse3 ) {
+		i = decode_ssse3( in, len - 4, out );
+		j = i / 4 * 3;
+	}
+#endif
 
-	for ( i=0; i<len; i++ ) {
-		if ( !isvalidchar( in[i] ) ) {
+	// Cuartetos completos: validacion y decodificacion en la misma pasada
+	for ( ; i+4 < len; i+=4, j+=3 ) {
+		a = b64dec[(uint8_t)in[i]];
+		b = b64dec[(uint8_t)in[i+1]];
+		c = b64dec[(uint8_t)in[i+2]];
+		d = b64dec[(uint8_t)in[i+3]];
+		if ( ( a | b | c | d ) & b64invalid ) {
 			return false;
 		}
+		v = (uint32_t)a << 18 | (uint32_t)b << 12 | (uint32_t)c << 6 | d;
+
+		out[j]   = ( v >> 16 ) & 0xFF;
+		out[j+1] = ( v >> 8 ) & 0xFF;
+		out[j+2] = v & 0xFF;
 	}
 
-	for ( i=0, j=0; i<len; i+=4, j+=3 ) {
-		v = b64invs[in[i]-43];
-		v = ( v << 6 ) | b64invs[in[i+1]-43];
-		v = in[i+2]=='=' ? v << 6 : ( v << 6 ) | b64invs[in[i+2]-43];
-		v = in[i+3]=='=' ? v << 6 : ( v << 6 ) | b64invs[in[i+3]-43];
+	// Ultimo cuarteto: '=' solo en las dos ultimas posiciones
+	a = b64dec[(uint8_t)in[i]];
+	b = b64dec[(uint8_t)in[i+1]];
+	c = in[i+2] == '=' ? 0 : b64dec[(uint8_t)in[i+2]];
+	d = in[i+3] == '=' ? 0 : b64dec[(uint8_t)in[i+3]];
+	if ( ( a | b | c | d ) & b64invalid || ( in[i+2] == '=' && in[i+3] != '=' ) ) {
+		return false;
+	}
+	v = (uint32_t)a << 18 | (uint32_t)b << 12 | (uint32_t)c << 6 | d;
 
-		out[j] = ( v >> 16 ) & 0xFF;
-		if ( in[i+2] != '=' ) {
-			out[j+1] = ( v >> 8 ) & 0xFF;
-		}
-		if ( in[i+3] != '=' ) {
-			out[j+2] = v & 0xFF;
-		}
+	out[j] = ( v >> 16 ) & 0xFF;
+	if ( in[i+2] != '=' ) {
+		out[j+1] = ( v >> 8 ) & 0xFF;
+	}
+	if ( in[i+3] != '=' ) {
+		out[j+2] = v & 0xFF;
 	}
 
 	return true;
@@ -44,6 +44,14 @@ class Base64 {
         */
         size_t decoded_size( const char* in );
 
+        /**
+          \brief Devuelve el tamanyo de los datos decodificados sin recorrer la cadena con strlen
+          \param in Buffer de datos codificados
+          \param inlen Longitud de los datos codificados
+          \return Tamanyo de los datos decodificados
+        */
+        size_t decoded_size( const char* in, size_t inlen );
+
         /**
           \brief Comprueba si es un caracter valido para la codificacion/decodificacion
           \param c Caracter a comprobar
@@ -60,14 +68,18 @@ class Base64 {
         */
         bool decode( const char* in, unsigned char* out, size_t outlen );
 
+        /**
+          \brief Decodifica datos en Base64 de longitud conocida, sin necesidad de '\0' final.
+          Valida y decodifica en una sola pasada
+          \param in Buffer de datos codificados
+          \param inlen Longitud de los datos codificados
+          \param out Buffer de datos decodificados
+          \param outlen Tamanyo del buffer de datos decodificados
+          \return Resultado de la decofificacion
+        */
+        bool decode( const char* in, size_t inlen, unsigned char* out, size_t outlen );
+
     private:
 
         const char b64chars[65] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-        
-        int b64invs[80] = { 62, -1, -1, -1, 63, 52, 53, 54, 55, 56, 57, 58,
-                59, 60, 61, -1, -1, -1, -1, -1, -1, -1, 0, 1, 2, 3, 4, 5,
-                6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20,
-                21, 22, 23, 24, 25, -1, -1, -1, -1, -1, -1, 26, 27, 28,
-                29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42,
-                43, 44, 45, 46, 47, 48, 49, 50, 51 };
 };
\ No newline at end of file
@@ -0,0 +1,66 @@
+#include "channel_usage.h"
+#include <string.h>
+
+Channel_usage::Channel_usage() {
+    memset( channels, 0, sizeof( channels ) );
+    pthread_mutex_init( &lock, NULL );
+}
+
+Channel_usage::~Channel_usage() {
+    pthread_mutex_destroy( &lock );
+}
+
+bool Channel_usage::add( uint32_t freq_khz, uint32_t airtime_us, uint32_t now_s ) {
+    if ( freq_khz == 0 ) {
+        return false;
+    }
+
+    uint32_t epoch = now_s / bucket_s;
+    bool added     = false;
+    pthread_mutex_lock( &lock );
+    for ( uint8_t i = 0; i < max_channels; i++ ) {
+        Channel_t& channel = channels[i];
+        if ( channel.freq_khz == 0 ) {
+            channel.freq_khz = freq_khz;
+        }
+        if ( channel.freq_khz != freq_khz ) {
+            continue;
+        }
+
+        // Un cubo de una vuelta anterior se reinicia al reutilizarlo
+        Bucket_t& bucket = channel.buckets[epoch % n_buckets];
+        if ( bucket.epoch != epoch ) {
+            bucket.epoch      = epoch;
+            bucket.uplinks    = 0;
+            bucket.airtime_us = 0;
+        }
+        bucket.uplinks++;
+        bucket.airtime_us += airtime_us;
+        added = true;
+        break;
+    }
+    pthread_mutex_unlock( &lock );
+    return added;
+}
+
+uint8_t Channel_usage::get_channels( Channel_report_t* reports, uint8_t max_reports, uint32_t now_s ) {
+    uint32_t epoch = now_s / bucket_s;
+    uint8_t n      = 0;
+    pthread_mutex_lock( &lock );
+    for ( uint8_t i = 0; i < max_channels && n < max_reports && channels[i].freq_khz != 0; i++ ) {
+        Channel_report_t& report = reports[n++];
+        report.freq_khz          = channels[i].freq_khz;
+        report.uplinks           = 0;
+        report.airtime_us        = 0;
+        for ( uint8_t b = 0; b < n_buckets; b++ ) {
+            const Bucket_t& bucket = channels[i].buckets[b];
+            if ( epoch - bucket.epoch < n_buckets ) {
+                report.uplinks += bucket.uplinks;
+                report.airtime_us += bucket.airtime_us;
+            }
+        }
+        report.utilization = (uint64_t)report.airtime_us * 1000 / ( (uint64_t)n_buckets * bucket_s * 1000000UL );
+    }
+    pthread_mutex_unlock( &lock );
+    return n;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stdint.h>
+#include "pthread.h"
+
+/**
+  \brief Ocupacion de un canal en la ventana de medida
+*/
+typedef struct {
+    uint32_t freq_khz;          ///< Frecuencia central del canal [kHz]
+    uint32_t uplinks;           ///< Subidas oidas en la ventana
+    uint32_t airtime_us;        ///< Tiempo en el aire acumulado en la ventana [us]
+    uint16_t utilization;       ///< Ocupacion del canal en la ventana [por mil]
+} Channel_report_t;
+
+/**
+  \class Channel_usage
+  \brief Ocupacion de cada canal por el tiempo en el aire de las subidas oidas, en una ventana
+  deslizante de cubos de tiempo. Con ALOHA puro la tasa de exito cae a partir de un 18 % de
+  ocupacion, asi que un canal que se acerca a ese valor esta cerca de saturar. Segura entre threads
+*/
+class Channel_usage {
+
+    public:
+
+        static const uint8_t max_channels = 16;
+        static const uint8_t n_buckets    = 60;
+        static const uint16_t bucket_s    = 10;       ///< Ventana de n_buckets * bucket_s = 10 min
+
+        /**
+          \brief Constructor de la clase
+        */
+        Channel_usage();
+
+        /**
+          \brief Destructor de la clase
+        */
+        ~Channel_usage();
+
+        /**
+          \brief Registra una subida
+          \param freq_khz Frecuencia de la subida [kHz]
+          \param airtime_us Tiempo en el aire de la subida [us]
+          \param now_s Instante actual [s]
+          \return false si el canal es nuevo y no quedan canales libres
+        */
+        bool add( uint32_t freq_khz, uint32_t airtime_us, uint32_t now_s );
+
+        /**
+          \brief Ocupacion de todos los canales vistos
+          \param reports Array de salida
+          \param max_reports Tamanyo del array
+          \param now_s Instante actual [s]
+          \return Numero de canales escritos
+        */
+        uint8_t get_channels( Channel_report_t* reports, uint8_t max_reports, uint32_t now_s );
+
+    private:
+
+        typedef struct {
+            uint32_t epoch;             ///< Numero de cubo (now_s / bucket_s) al que pertenecen los datos
+            uint32_t uplinks;
+            uint32_t airtime_us;
+        } Bucket_t;
+
+        typedef struct {
+            uint32_t freq_khz;          ///< 0 = libre
+            Bucket_t buckets[n_buckets];
+        } Channel_t;
+
+        pthread_mutex_t lock;
+        Channel_t channels[max_channels];
+};
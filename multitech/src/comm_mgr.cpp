@@ -2,131 +2,203 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
 #include <curl/curl.h>
-#include "log.h"
 
+static pthread_mutex_t share_lock = PTHREAD_MUTEX_INITIALIZER;
 
-// Funcion para la recepción de infromación. GET
-// see: https://curl.haxx.se/libcurl/c/postinmemory.html
-static size_t receive_callback ( void *contents, size_t size, size_t nmemb, void* user_params ) {
-    size_t realsize = size * nmemb;
-    receive_params_t* p = (receive_params_t*) user_params;
-
-    if ( p->size + realsize < p->max_size ) {
-        // copy contents to buffer
-        memcpy( &( p->payload[p->size] ), contents, realsize );
-
-        // set new buffer size
-        p->size += realsize;
-
-        // ensure null termination
-        p->payload[p->size] = 0;
+static void share_lock_fcn( CURL* handle, curl_lock_data data, curl_lock_access access, void* user_ptr ) {
+    (void)handle;
+    (void)data;
+    (void)access;
+    (void)user_ptr;
+    pthread_mutex_lock( &share_lock );
+}
 
-        return realsize;
-    }
-    return -1;
+static void share_unlock_fcn( CURL* handle, curl_lock_data data, void* user_ptr ) {
+    (void)handle;
+    (void)data;
+    (void)user_ptr;
+    pthread_mutex_unlock( &share_lock );
 }
 
 Comm_mgr::Comm_mgr( uint16_t pkt_size, char* url_post_0 ):
     pkt( pkt_size ),
-    receive_params{ lib_buffer, 0, lib_max_len } {
-        memset( lib_buffer, 0, lib_max_len );
+    encoding( pkt_encoding_csv ),
+    p_headers( nullptr ),
+    p_headers_gzip( nullptr ),
+    gzip_enabled( false ),
+    gzip_min_len( 0 ),
+    batching( false ) {
+        memset( &stats, 0, sizeof( stats ) );
         strcat( (char*)url_post, url_post_0 );
 }
 
 Comm_mgr::~Comm_mgr( void ) {
+    curl_slist_free_all( p_headers );
+    curl_slist_free_all( p_headers_gzip );
+}
+
+CURLSH* Comm_mgr::get_share( void ) {
+    // Se crea una sola vez y vive lo que el proceso
+    static CURLSH* share = [] {
+        curl_global_init( CURL_GLOBAL_DEFAULT );
+        CURLSH* p_share = curl_share_init();
+        if ( p_share != nullptr ) {
+            curl_share_setopt( p_share, CURLSHOPT_LOCKFUNC, share_lock_fcn );
+            curl_share_setopt( p_share, CURLSHOPT_UNLOCKFUNC, share_unlock_fcn );
+            curl_share_setopt( p_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS );
+            curl_share_setopt( p_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION );
+        }
+        return p_share;
+    }();
+    return share;
 }
 
-bool Comm_mgr::send( Pkt& pkt_0, char* mobile_id ) {
-    char send_data_buffer[data_max_len] = {""};
+void Comm_mgr::setup_handle( CURL* easy ) {
+    CURLSH* share = get_share();
+    if ( p_headers == nullptr ) {
+        char content_type[64];
+        snprintf( content_type, sizeof( content_type ), "Content-Type: %s", Pkt_encoder::content_type( encoding ) );
+        p_headers      = curl_slist_append( p_headers, "Accept: application/x-www-form-urlencoded" );
+        p_headers      = curl_slist_append( p_headers, content_type );
+        p_headers_gzip = curl_slist_append( p_headers_gzip, "Accept: application/x-www-form-urlencoded" );
+        p_headers_gzip = curl_slist_append( p_headers_gzip, content_type );
+        p_headers_gzip = curl_slist_append( p_headers_gzip, "Content-Encoding: gzip" );
+    }
 
-    create_post_data( send_data_buffer, pkt_0, mobile_id );
+    curl_easy_setopt( easy, CURLOPT_SSL_VERIFYPEER, 0L );
+    curl_easy_setopt( easy, CURLOPT_URL, url_post );
+    curl_easy_setopt( easy, CURLOPT_POST, 0 );
+    curl_easy_setopt( easy, CURLOPT_HTTPHEADER, p_headers );
+    curl_easy_setopt( easy, CURLOPT_TIMEOUT, 5L );
+    if ( share != nullptr ) {
+        curl_easy_setopt( easy, CURLOPT_SHARE, share );
+    }
 
-    static const uint16_t max_response_len = 5000;
-    char response_buff[max_response_len];
-    uint16_t response_len = 0;
-    log( pkt_0.hdr->src, "URL: %s; Data: %s\n", url_post, send_data_buffer );
-    return post( url_post, send_data_buffer, response_buff, response_len, max_response_len );
+    // La conexion queda abierta entre peticiones; las sondas keep-alive la mantienen en el NAT
+    // y una conexion inactiva demasiado tiempo se sustituye por una nueva antes de usarla
+    curl_easy_setopt( easy, CURLOPT_TCP_KEEPALIVE, 1L );
+    curl_easy_setopt( easy, CURLOPT_TCP_KEEPIDLE, keepalive_idle_s );
+    curl_easy_setopt( easy, CURLOPT_TCP_KEEPINTVL, keepalive_idle_s );
+#if LIBCURL_VERSION_NUM >= 0x074100
+    curl_easy_setopt( easy, CURLOPT_MAXAGE_CONN, max_idle_s );
+#endif
 }
 
-void Comm_mgr::create_post_data( char* send_data, Pkt& pkt_0, char* mobile_id ) {
-    uint16_t write_data_pos = 0;
+void Comm_mgr::set_encoding( Pkt_encoding_t encoding_0 ) {
+    encoding = encoding_0;
+}
 
-    // MobileID
-    strcat( (char*)send_data, "MobileID=" );
-    write_data_pos += strlen( "MobileID=" );
-    strcat( (char*)send_data, mobile_id );
-    write_data_pos += strlen( mobile_id );
+Pkt_encoding_t Comm_mgr::get_encoding( void ) const {
+    return encoding;
+}
 
-    // Project
-    strcat( (char*)send_data, "&project=boluda" );
-    write_data_pos += strlen( "&project=boluda" );
+void Comm_mgr::set_compression( bool enabled, uint32_t min_len ) {
+    // Nivel 6: casi toda la ganancia de 9 con bastante menos CPU
+    gzip_enabled = enabled && gzip.init( 6 );
+    gzip_min_len = min_len;
+}
 
-    // Pkt
-    char aux_buffer[5];
-    strcat( (char*)send_data, "&pkt=" );
-    write_data_pos += strlen( "&pkt=" );
-    for ( uint_fast16_t i = 0; i < pkt_0.get_size(); i++ ) {
-        sprintf( &aux_buffer[0], "%d,", pkt_0.bytes()[i] );
-        strncpy( &send_data[write_data_pos], &aux_buffer[0], strlen( aux_buffer ) );
-        write_data_pos += strlen( aux_buffer );
-    }
-    send_data[write_data_pos-1] = '\0';
+void Comm_mgr::set_batching( bool enabled ) {
+    batching = enabled;
+}
+
+bool Comm_mgr::get_batching( void ) const {
+    return batching;
 }
 
-bool Comm_mgr::post( const char* url, const char* send_buff, char* response_buff,
-                        uint16_t& response_len, const uint16_t max_response_len ) {
-    CURL* p_curl;
-    CURLcode request_code;
+void Comm_mgr::set_body( CURL* easy, const char* body, uint32_t len, uint8_t* scratch, uint32_t scratch_len ) {
+    uint32_t packed_len = 0;
+    if ( gzip_enabled && len >= gzip_min_len ) {
+        packed_len = gzip.compress( (const uint8_t*)body, len, scratch, scratch_len );
+    }
 
-    // buffer restart
-    memset( lib_buffer, 0, lib_max_len );
+    if ( encoding == pkt_encoding_raw ) {
+        curl_easy_setopt( easy, CURLOPT_URL, url_raw );
+    }
 
-    receive_params.size = 0;
+    stats.body_bytes += len;
+    if ( packed_len > 0 ) {
+        stats.compressed++;
+        stats.wire_bytes += packed_len;
+        curl_easy_setopt( easy, CURLOPT_HTTPHEADER, p_headers_gzip );
+        curl_easy_setopt( easy, CURLOPT_POSTFIELDSIZE, (long)packed_len );
+        curl_easy_setopt( easy, CURLOPT_POSTFIELDS, scratch );
+    }
+    else {
+        stats.wire_bytes += len;
+        curl_easy_setopt( easy, CURLOPT_HTTPHEADER, p_headers );
+        curl_easy_setopt( easy, CURLOPT_POSTFIELDSIZE, (long)len );
+        curl_easy_setopt( easy, CURLOPT_POSTFIELDS, body );
+    }
+}
 
-    // create curl and check init
-    p_curl = curl_easy_init();
+uint16_t Comm_mgr::create_post_data( char* send_data, uint16_t max_len, Pkt& pkt_0, const char* mobile_id ) {
+    if ( encoding == pkt_encoding_raw ) {
+        // El MobileID no cambia: la url se compone una vez, con el primer pkt
+        if ( url_raw[0] == '\0' ) {
+            snprintf( url_raw, sizeof( url_raw ), "%s%cMobileID=%s&project=boluda", url_post, strchr( url_post, '?' ) ? '&' : '?', mobile_id );
+        }
+        return Pkt_encoder::encode( encoding, pkt_0.bytes(), pkt_0.get_size(), send_data, max_len );
+    }
 
-    if ( !p_curl ) {
-        return false;
+    static const char project[] = "&project=boluda&pkt=";
+    uint16_t id_len             = strlen( mobile_id );
+    uint16_t head_len           = sizeof( "MobileID=" ) - 1 + id_len + sizeof( project ) - 1;
+    if ( head_len >= max_len ) {
+        return 0;
     }
 
-    struct curl_slist* p_headers = nullptr;
-    p_headers = curl_slist_append( p_headers, "Accept: application/x-www-form-urlencoded" );
-    p_headers = curl_slist_append( p_headers, "Content-Type: application/x-www-form-urlencoded" );
-
-    curl_easy_setopt( p_curl, CURLOPT_SSL_VERIFYPEER, 0L );
-    curl_easy_setopt( p_curl, CURLOPT_URL, url );
-    curl_easy_setopt( p_curl, CURLOPT_WRITEFUNCTION, receive_callback );
-    curl_easy_setopt( p_curl, CURLOPT_WRITEDATA, (void*) &receive_params );
-    curl_easy_setopt( p_curl, CURLOPT_POST, 0 );
-    curl_easy_setopt( p_curl, CURLOPT_POSTFIELDS, send_buff );
-    curl_easy_setopt( p_curl, CURLOPT_HTTPHEADER, p_headers );
-    curl_easy_setopt( p_curl, CURLOPT_TIMEOUT, 5L );
-
-    // Perform the request, response will get the return code
-    request_code = curl_easy_perform( p_curl );
-    long response_code;
-    curl_easy_getinfo( p_curl, CURLINFO_RESPONSE_CODE, &response_code );
-    // always cleanup
-    curl_easy_cleanup( p_curl );
-    curl_slist_free_all( p_headers );
+    uint16_t pos = 0;
+    memcpy( &send_data[pos], "MobileID=", sizeof( "MobileID=" ) - 1 );
+    pos += sizeof( "MobileID=" ) - 1;
+    memcpy( &send_data[pos], mobile_id, id_len );
+    pos += id_len;
+    memcpy( &send_data[pos], project, sizeof( project ) - 1 );
+    pos += sizeof( project ) - 1;
 
-    if ( request_code == CURLE_OK ) {
-        if ( response_code == response_code_ok || response_code == response_code_accepted || response_code == response_code_created ) {
-            if ( receive_params.size + response_len <= max_response_len ) {
-              memcpy( response_buff, receive_params.payload, receive_params.size );
-              response_len += receive_params.size;
-              return true;
-            }
-        }
-        else {
-            if ( receive_params.size + response_len <= max_response_len ) {
-              memcpy( response_buff, receive_params.payload, receive_params.size );
-              response_len += receive_params.size;
-            }
-        }
+    uint16_t pkt_len = Pkt_encoder::encode( encoding, pkt_0.bytes(), pkt_0.get_size(), &send_data[pos], max_len - pos );
+    return pkt_len == 0 ? 0 : pos + pkt_len;
+}
+
+void Comm_mgr::record_request( CURL* easy, bool ok ) {
+    long connects         = 0;
+    curl_off_t total_us   = 0;
+    curl_off_t dns_us     = 0;
+    curl_off_t connect_us = 0;
+    curl_off_t tls_us     = 0;
+    curl_easy_getinfo( easy, CURLINFO_NUM_CONNECTS, &connects );
+    curl_easy_getinfo( easy, CURLINFO_TOTAL_TIME_T, &total_us );
+    curl_easy_getinfo( easy, CURLINFO_NAMELOOKUP_TIME_T, &dns_us );
+    curl_easy_getinfo( easy, CURLINFO_CONNECT_TIME_T, &connect_us );
+    curl_easy_getinfo( easy, CURLINFO_APPCONNECT_TIME_T, &tls_us );
+
+    stats.requests++;
+    if ( !ok ) {
+        stats.errors++;
+    }
+    if ( connects > 0 ) {
+        stats.connects += connects;
+    }
+    else {
+        stats.reused++;
+    }
+    stats.last_us         = total_us;
+    stats.last_dns_us     = dns_us;
+    stats.last_connect_us = connect_us;
+    stats.last_tls_us     = tls_us;
+    stats.total_us += total_us;
+    if ( stats.last_us > stats.max_us ) {
+        stats.max_us = stats.last_us;
     }
+}
+
+void Comm_mgr::record_retry( void ) {
+    stats.retries++;
+}
 
-    return false;
-}
\ No newline at end of file
+Comm_stats_t Comm_mgr::get_stats( void ) const {
+    return stats;
+}
@@ -1,17 +1,35 @@
 #pragma once
 
+#include <curl/curl.h>
 #include "pkt.h"
+#include "gzip_body.h"
+#include "pkt_encoder.h"
 
-// estructura para receive_callback
+/**
+  \brief Estadisticas de las peticiones de un Comm_mgr
+*/
 typedef struct {
-    char* const payload;
-    size_t size; // bytes recibidos
-    const size_t max_size;
-} receive_params_t;
+    uint32_t requests;          ///< Peticiones realizadas
+    uint32_t errors;            ///< Peticiones fallidas, por transporte o por codigo HTTP
+    uint32_t connects;          ///< Conexiones nuevas abiertas
+    uint32_t reused;            ///< Peticiones hechas sobre una conexion ya abierta
+    uint32_t retries;           ///< Repeticiones por encontrar cerrada una conexion reutilizada
+    uint32_t last_us;           ///< Duracion de la ultima peticion [us]
+    uint32_t max_us;            ///< Duracion maxima de una peticion [us]
+    uint64_t total_us;          ///< Suma de duraciones, total_us / requests es la media [us]
+    uint32_t last_dns_us;       ///< Resolucion DNS de la ultima peticion, 0 si vino de la cache [us]
+    uint32_t last_connect_us;   ///< Fin de la conexion TCP de la ultima peticion, 0 si se reutilizo [us]
+    uint32_t last_tls_us;       ///< Fin del handshake TLS de la ultima peticion, 0 si se reutilizo [us]
+    uint32_t compressed;        ///< Peticiones enviadas con el cuerpo comprimido
+    uint64_t body_bytes;        ///< Bytes de cuerpo antes de comprimir
+    uint64_t wire_bytes;        ///< Bytes de cuerpo enviados, comprimidos o no
+} Comm_stats_t;
 
 class Comm_mgr {
 
     public:
+      static const uint16_t data_max_len = 1024; // cabe un pkt de 200 bytes en decimal, la codificacion mas larga
+
       /**
         \brief Constructor de la clase
         \param pkt_size Tamanyo maximo de pkt que se puede almacenar
@@ -25,48 +43,102 @@ class Comm_mgr {
       ~Comm_mgr( void );
 
       /**
-        \brief Envia un pkt a la API con el formato correcto
-        \param pkt_0 Pkt a enviar
-        \param mobile_id id del módulo orbcomm
+        \brief Devuelve las estadisticas de las peticiones
       */
-      bool send( Pkt& pkt_0, char* mobile_id );
+      Comm_stats_t get_stats( void ) const;
 
-    private:
+      /**
+        \brief Fija en un handle las opciones comunes de las peticiones a este destino: url,
+        cabeceras, timeout, keep-alive y cache compartida. El cuerpo y la respuesta los fija el llamante
+        \param easy Handle a configurar
+      */
+      void setup_handle( CURL* easy );
+
+      /**
+        \brief Fija la codificacion de los pkts para este destino. Con pkt_encoding_raw el cuerpo es el
+        pkt sin codificar y MobileID y project van en la url. Antes de la primera peticion y de setup_handle
+        \param encoding_0 Codificacion que acepta el destino
+      */
+      void set_encoding( Pkt_encoding_t encoding_0 );
 
       /**
-        \brief Genera los datos a enviar
-        \param send_data Cadena de datos a enviar
+        \brief Devuelve la codificacion de los pkts
+      */
+      Pkt_encoding_t get_encoding( void ) const;
+
+      /**
+        \brief Activa la compresion gzip de los cuerpos. Solo si el destino acepta Content-Encoding: gzip
+        \param enabled Capacidad del destino
+        \param min_len Cuerpos mas cortos se envian sin comprimir [bytes]
+      */
+      void set_compression( bool enabled, uint32_t min_len );
+
+      /**
+        \brief Indica si el destino acepta lotes de Upload_batch: varios pkt[]= por peticion y la lista
+        de fallidos en un 207. Por defecto no: cada peticion lleva un pkt con el formato de create_post_data
+        \param enabled Capacidad del destino
+      */
+      void set_batching( bool enabled );
+
+      /**
+        \brief Devuelve si el destino acepta lotes
+      */
+      bool get_batching( void ) const;
+
+      /**
+        \brief Fija el cuerpo de la siguiente peticion de un handle, comprimido si esta activo, supera
+        el umbral y sale mas corto. Los buffers deben seguir vivos hasta que termine la peticion
+        \param easy Handle de la peticion
+        \param body Cuerpo sin comprimir
+        \param len Longitud del cuerpo
+        \param scratch Buffer para el cuerpo comprimido
+        \param scratch_len Tamanyo de scratch
+      */
+      void set_body( CURL* easy, const char* body, uint32_t len, uint8_t* scratch, uint32_t scratch_len );
+
+      /**
+        \brief Acumula el resultado, la duracion y el tipo de conexion de una peticion terminada
+        \param easy Handle de la peticion
+        \param ok true si la API acepto la peticion
+      */
+      void record_request( CURL* easy, bool ok );
+
+      /**
+        \brief Cuenta la repeticion de una peticion por encontrar cerrada su conexion reutilizada
+      */
+      void record_retry( void );
+
+      /**
+        \brief Genera los datos a enviar con la codificacion del destino
+        \param send_data Buffer de datos a enviar
+        \param max_len Tamanyo del buffer, incluido el '\0' de las codificaciones de texto
         \param pkt_0 Pkt a enviar
         \param mobile_id id del módulo orbcomm
+        \return Longitud de los datos, 0 si no caben
       */
-      void create_post_data( char* send_data, Pkt& pkt_0, char* mobile_id );
+      uint16_t create_post_data( char* send_data, uint16_t max_len, Pkt& pkt_0, const char* mobile_id );
+
+    private:
 
       /**
-        \brief Funcion post para enviar un string, guarda la respuesta del servidor
-        \param url Array de char con la url
-        \param send_buff Array de char a enviar
-        \param response_buff Buffer para recibir la respuesta
-        \param response_len Longitud del buffer de respuesta
-        \param max_response_len Longitud máxima del buffer
-        \return true si OK, CREATED o ACEPTED
+        \brief Cache de DNS y de sesiones TLS compartida por todos los Comm_mgr
       */
-      bool post( const char* url, const char* send_buff, char* response_buff,
-                        uint16_t& response_len, const uint16_t max_response_len );
+      static CURLSH* get_share( void );
 
       Pkt pkt;
-      typedef enum : uint16_t {
-        response_code_ok           = 200,
-        response_code_created      = 201,
-        response_code_accepted     = 202,
-        response_code_no_content   = 204,
-        response_code_unauthorized = 401
-      } Response_t;
-
-      static const uint16_t lib_max_len = 16384; // 1024*16
-      char lib_buffer[lib_max_len];
-      receive_params_t receive_params;
-      static const uint16_t data_max_len = 500;
+
+      static const long max_idle_s = 30; // una conexion inactiva mas tiempo no se reutiliza (timeouts del servidor y del NAT movil)
+      static const long keepalive_idle_s = 20; // sondas TCP keep-alive en la conexion abierta
       static const uint16_t url_max_len = 500;
       char url_post[url_max_len] = {""};
+      char url_raw[url_max_len]  = {""};  ///< url_post con MobileID y project, para pkt_encoding_raw
+      Pkt_encoding_t encoding;
+      struct curl_slist* p_headers;
+      struct curl_slist* p_headers_gzip;  ///< p_headers mas Content-Encoding: gzip
+      Gzip_body gzip;
+      bool gzip_enabled;
+      uint32_t gzip_min_len;
+      bool batching;                      ///< El destino acepta lotes de Upload_batch
+      Comm_stats_t stats;
 };
 
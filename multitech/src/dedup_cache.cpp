@@ -0,0 +1,77 @@
+#include "dedup_cache.h"
+#include <string.h>
+
+Dedup_cache::Dedup_cache( uint32_t window_s_0 ) : window_s( window_s_0 ) {
+    memset( entries, 0, sizeof( entries ) );
+    memset( &stats, 0, sizeof( stats ) );
+}
+
+Dedup_cache::~Dedup_cache() {}
+
+void Dedup_cache::set_window( uint32_t window_s_0 ) {
+    window_s = window_s_0;
+}
+
+bool Dedup_cache::check( uint64_t key, uint32_t now_s ) {
+    if ( key == 0 ) {
+        key = 1; // 0 marca entrada libre
+    }
+
+    uint16_t start  = ( key ^ ( key >> 32 ) ) & ( table_size - 1 );
+    int16_t free    = -1;
+    uint16_t oldest = start;
+    for ( uint_fast8_t i = 0; i < max_probe; i++ ) {
+        uint16_t pos   = ( start + i ) & ( table_size - 1 );
+        Entry_t& entry = entries[pos];
+        bool live      = entry.key != 0 && now_s - entry.seen_s < window_s;
+
+        if ( live && entry.key == key ) {
+            stats.hits++;
+            return true;
+        }
+        if ( !live && free < 0 ) {
+            free = pos;
+        }
+        if ( entry.seen_s < entries[oldest].seen_s ) {
+            oldest = pos;
+        }
+    }
+
+    // La clave puede estar mas alla de un hueco caducado, por eso se recorre el sondeo entero
+    if ( free < 0 ) {
+        free = oldest;
+        stats.evictions++;
+    }
+    entries[free].key    = key;
+    entries[free].seen_s = now_s;
+    stats.misses++;
+    return false;
+}
+
+void Dedup_cache::forget( uint64_t key ) {
+    if ( key == 0 ) {
+        key = 1;
+    }
+
+    // Como la busqueda recorre el sondeo entero, la entrada se puede liberar sin marca de borrado
+    uint16_t start = ( key ^ ( key >> 32 ) ) & ( table_size - 1 );
+    for ( uint_fast8_t i = 0; i < max_probe; i++ ) {
+        Entry_t& entry = entries[( start + i ) & ( table_size - 1 )];
+        if ( entry.key == key ) {
+            entry.key = 0;
+            return;
+        }
+    }
+}
+
+Dedup_stats_t Dedup_cache::get_stats( void ) const {
+    return stats;
+}
+
+uint64_t Dedup_cache::hash( const void* data, size_t len, uint64_t key ) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    for ( size_t i = 0; i < len; i++ ) {
+        key = ( key ^ bytes[i] ) * 1099511628211ULL;
+    }
+    return key;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+  \brief Estadisticas de la cache de duplicados
+*/
+typedef struct {
+    uint32_t hits;          ///< Pkts descartados por duplicados
+    uint32_t misses;        ///< Pkts nuevos registrados
+    uint32_t evictions;     ///< Entradas vigentes reemplazadas por falta de sitio
+} Dedup_stats_t;
+
+/**
+  \class Dedup_cache
+  \brief Cache acotada de pkts ya vistos dentro de una ventana de tiempo. Detecta las
+  retransmisiones de un dispositivo y las copias de una misma trama oida por varios gateways.
+  Tabla hash de direccionamiento abierto con sondeo lineal limitado; las entradas fuera de
+  la ventana se consideran libres y, si no hay sitio, se reemplaza la mas antigua del sondeo.
+  No es segura entre threads: se usa una por worker de ingesta
+*/
+class Dedup_cache {
+
+    public:
+
+        static const uint32_t default_window_s = 120;   ///< Ventana por defecto [s]
+
+        /**
+          \brief Constructor de la clase
+          \param window_s_0 Ventana de deteccion [s]
+        */
+        Dedup_cache( uint32_t window_s_0 = default_window_s );
+
+        /**
+          \brief Destructor de la clase
+        */
+        ~Dedup_cache();
+
+        /**
+          \brief Cambia la ventana de deteccion
+          \param window_s_0 Ventana de deteccion [s]
+        */
+        void set_window( uint32_t window_s_0 );
+
+        /**
+          \brief Comprueba si una clave se ha visto dentro de la ventana y, si no, la registra
+          \param key Clave del pkt
+          \param now_s Instante actual [s]
+          \return true si es un duplicado
+        */
+        bool check( uint64_t key, uint32_t now_s );
+
+        /**
+          \brief Olvida una clave registrada, para que su reintento no se tome por un duplicado
+          \param key Clave del pkt
+        */
+        void forget( uint64_t key );
+
+        /**
+          \brief Devuelve las estadisticas
+        */
+        Dedup_stats_t get_stats( void ) const;
+
+        /**
+          \brief Acumula datos en una clave (FNV-1a de 64 bits)
+          \param data Datos a acumular
+          \param len Longitud de los datos
+          \param key Clave previa, key_seed para empezar
+          \return Clave resultante
+        */
+        static uint64_t hash( const void* data, size_t len, uint64_t key = key_seed );
+
+        static const uint64_t key_seed = 14695981039346656037ULL;
+
+    private:
+
+        typedef struct {
+            uint64_t key;           ///< 0 = libre
+            uint32_t seen_s;        ///< Instante en que se vio por primera vez
+        } Entry_t;
+
+        static const uint16_t table_size = 1024;        ///< Potencia de 2
+        static const uint8_t max_probe   = 16;          ///< Entradas revisadas por busqueda
+
+        uint32_t window_s;
+        Entry_t entries[table_size];
+        Dedup_stats_t stats;
+};
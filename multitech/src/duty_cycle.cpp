@@ -0,0 +1,122 @@
+#include "duty_cycle.h"
+#include <string.h>
+
+// Sub-bandas de emision de EU868 y su ciclo de trabajo
+const Duty_cycle::Band_t Duty_cycle::bands[max_bands] = {
+    { 863000, 868000, 10 },
+    { 868000, 868600, 10 },
+    { 868700, 869200, 1 },
+    { 869400, 869650, 100 },
+    { 869700, 870000, 10 },
+};
+
+Duty_cycle::Duty_cycle() {
+    memset( buckets, 0, sizeof( buckets ) );
+    memset( refused, 0, sizeof( refused ) );
+    pthread_mutex_init( &lock, NULL );
+}
+
+Duty_cycle::~Duty_cycle() {
+    pthread_mutex_destroy( &lock );
+}
+
+int8_t Duty_cycle::band_of( uint32_t freq_khz ) {
+    // Sin metadatos de radio la bajada sale en RX1 por uno de los canales por defecto
+    if ( freq_khz == 0 ) {
+        freq_khz = default_freq_khz;
+    }
+    for ( uint8_t i = 0; i < max_bands; i++ ) {
+        if ( freq_khz >= bands[i].min_khz && freq_khz < bands[i].max_khz ) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+uint32_t Duty_cycle::budget_us( uint8_t band ) {
+    return (uint32_t)( (uint64_t)n_buckets * bucket_s * 1000UL * bands[band].duty_permille );
+}
+
+uint32_t Duty_cycle::used_us( uint8_t band, uint32_t epoch ) const {
+    uint32_t used = 0;
+    for ( uint8_t b = 0; b < n_buckets; b++ ) {
+        const Bucket_t& bucket = buckets[band][b];
+        if ( epoch - bucket.epoch < n_buckets ) {
+            used += bucket.airtime_us;
+        }
+    }
+    return used;
+}
+
+bool Duty_cycle::try_consume( uint32_t freq_khz, uint32_t airtime_us, uint32_t now_s ) {
+    int8_t band = band_of( freq_khz );
+    if ( band < 0 ) {
+        return false;
+    }
+
+    uint32_t epoch = now_s / bucket_s;
+    bool consumed  = false;
+    pthread_mutex_lock( &lock );
+    if ( (uint64_t)used_us( band, epoch ) + airtime_us <= budget_us( band ) ) {
+        // Un cubo de una vuelta anterior se reinicia al reutilizarlo
+        Bucket_t& bucket = buckets[band][epoch % n_buckets];
+        if ( bucket.epoch != epoch ) {
+            bucket.epoch      = epoch;
+            bucket.airtime_us = 0;
+        }
+        bucket.airtime_us += airtime_us;
+        consumed = true;
+    }
+    else {
+        refused[band]++;
+    }
+    pthread_mutex_unlock( &lock );
+    return consumed;
+}
+
+uint32_t Duty_cycle::wait_s( uint32_t freq_khz, uint32_t airtime_us, uint32_t now_s ) {
+    int8_t band = band_of( freq_khz );
+    if ( band < 0 || airtime_us > budget_us( band ) ) {
+        return UINT32_MAX;
+    }
+
+    uint32_t epoch = now_s / bucket_s;
+    uint32_t wait  = 0;
+    pthread_mutex_lock( &lock );
+    uint64_t used = used_us( band, epoch );
+    if ( used + airtime_us > budget_us( band ) ) {
+        // Los cubos salen de la ventana del mas antiguo al mas reciente
+        uint64_t excess = used + airtime_us - budget_us( band );
+        uint32_t oldest = epoch >= n_buckets ? epoch - n_buckets + 1 : 0;
+        for ( uint32_t e = oldest; e <= epoch; e++ ) {
+            const Bucket_t& bucket = buckets[band][e % n_buckets];
+            if ( bucket.epoch == e ) {
+                excess -= bucket.airtime_us < excess ? bucket.airtime_us : excess;
+            }
+            if ( excess == 0 ) {
+                wait = ( e + n_buckets ) * bucket_s - now_s;
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock( &lock );
+    return wait;
+}
+
+uint8_t Duty_cycle::get_bands( Duty_band_report_t* reports, uint8_t max_reports, uint32_t now_s ) {
+    uint32_t epoch = now_s / bucket_s;
+    uint8_t n      = 0;
+    pthread_mutex_lock( &lock );
+    for ( uint8_t i = 0; i < max_bands && n < max_reports; i++ ) {
+        Duty_band_report_t& report = reports[n++];
+        report.min_khz             = bands[i].min_khz;
+        report.max_khz             = bands[i].max_khz;
+        report.duty_permille       = bands[i].duty_permille;
+        report.budget_us           = budget_us( i );
+        report.used_us             = used_us( i, epoch );
+        report.refused             = refused[i];
+        report.usage               = (uint64_t)report.used_us * 1000 / report.budget_us;
+    }
+    pthread_mutex_unlock( &lock );
+    return n;
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <stdint.h>
+#include "pthread.h"
+
+/**
+  \brief Politica cuando una bajada no cabe en el ciclo de trabajo de su sub-banda
+*/
+typedef enum {
+    duty_policy_drop,           ///< Se descarta la bajada
+    duty_policy_defer           ///< Se aplaza hasta que la ventana libere tiempo o caduque
+} Duty_policy_t;
+
+/**
+  \brief Uso del ciclo de trabajo de una sub-banda en la ventana de medida
+*/
+typedef struct {
+    uint32_t min_khz;           ///< Limite inferior de la sub-banda [kHz]
+    uint32_t max_khz;           ///< Limite superior de la sub-banda [kHz]
+    uint16_t duty_permille;     ///< Ciclo de trabajo permitido [por mil]
+    uint32_t budget_us;         ///< Tiempo de emision permitido en la ventana [us]
+    uint32_t used_us;           ///< Tiempo de emision consumido en la ventana [us]
+    uint32_t refused;           ///< Bajadas que no cupieron en el presupuesto
+    uint16_t usage;             ///< Presupuesto consumido [por mil]
+} Duty_band_report_t;
+
+/**
+  \class Duty_cycle
+  \brief Presupuesto de emision del gateway por sub-banda EU868 (ETSI EN 300 220), en una
+  ventana deslizante de una hora hecha de cubos de tiempo. Cada bajada se cobra antes de
+  enviarla; si no cabe, no se cobra. Segura entre threads
+*/
+class Duty_cycle {
+
+    public:
+
+        static const uint8_t max_bands = 5;
+        static const uint8_t n_buckets = 60;
+        static const uint16_t bucket_s = 60;        ///< Ventana de n_buckets * bucket_s = 1 h
+        static const uint32_t default_freq_khz = 868100;  ///< Sub-banda asumida si se desconoce la frecuencia
+
+        /**
+          \brief Constructor de la clase
+        */
+        Duty_cycle();
+
+        /**
+          \brief Destructor de la clase
+        */
+        ~Duty_cycle();
+
+        /**
+          \brief Sub-banda de una frecuencia
+          \param freq_khz Frecuencia de emision [kHz], 0 si se desconoce
+          \return Indice de la sub-banda, -1 si la frecuencia no pertenece a ninguna
+        */
+        static int8_t band_of( uint32_t freq_khz );
+
+        /**
+          \brief Cobra una emision si cabe en el presupuesto de su sub-banda
+          \param freq_khz Frecuencia de emision [kHz], 0 si se desconoce
+          \param airtime_us Tiempo en el aire de la emision [us]
+          \param now_s Instante actual [s]
+          \return false si la emision no cabe o la frecuencia no pertenece a ninguna sub-banda
+        */
+        bool try_consume( uint32_t freq_khz, uint32_t airtime_us, uint32_t now_s );
+
+        /**
+          \brief Tiempo hasta que la ventana libere lo suficiente para una emision
+          \param freq_khz Frecuencia de emision [kHz], 0 si se desconoce
+          \param airtime_us Tiempo en el aire de la emision [us]
+          \param now_s Instante actual [s]
+          \return Espera [s], 0 si ya cabe, UINT32_MAX si no cabra nunca
+        */
+        uint32_t wait_s( uint32_t freq_khz, uint32_t airtime_us, uint32_t now_s );
+
+        /**
+          \brief Uso de todas las sub-bandas
+          \param reports Array de salida
+          \param max_reports Tamanyo del array
+          \param now_s Instante actual [s]
+          \return Numero de sub-bandas escritas
+        */
+        uint8_t get_bands( Duty_band_report_t* reports, uint8_t max_reports, uint32_t now_s );
+
+    private:
+
+        typedef struct {
+            uint32_t min_khz;
+            uint32_t max_khz;
+            uint16_t duty_permille;
+        } Band_t;
+
+        typedef struct {
+            uint32_t epoch;             ///< Numero de cubo (now_s / bucket_s) al que pertenecen los datos
+            uint32_t airtime_us;
+        } Bucket_t;
+
+        static const Band_t bands[max_bands];
+
+        /**
+          \brief Presupuesto de una sub-banda en la ventana [us]
+        */
+        static uint32_t budget_us( uint8_t band );
+
+        /**
+          \brief Tiempo consumido por una sub-banda en la ventana. Llamar con el mutex tomado
+        */
+        uint32_t used_us( uint8_t band, uint32_t epoch ) const;
+
+        pthread_mutex_t lock;
+        Bucket_t buckets[max_bands][n_buckets];
+        uint32_t refused[max_bands];
+};
@@ -0,0 +1,34 @@
+#include "event_fd.h"
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+Event_fd::Event_fd() : fd( -1 ) {}
+
+Event_fd::~Event_fd() {
+    if ( fd != -1 ) {
+        close( fd );
+    }
+}
+
+bool Event_fd::init( void ) {
+    fd = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+    return fd != -1;
+}
+
+void Event_fd::notify( uint64_t count ) {
+    // Si el contador desborda write devuelve EAGAIN, el lector ya esta despierto
+    ssize_t written = write( fd, &count, sizeof( count ) );
+    (void)written;
+}
+
+uint64_t Event_fd::consume( void ) {
+    uint64_t count = 0;
+    if ( read( fd, &count, sizeof( count ) ) != sizeof( count ) ) {
+        return 0;
+    }
+    return count;
+}
+
+int Event_fd::get_fd( void ) const {
+    return fd;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+  \class Event_fd
+  \brief Envoltorio de eventfd para despertar etapas del gateway desde otros threads
+*/
+class Event_fd {
+
+    public:
+
+        /**
+          \brief Constructor de la clase
+        */
+        Event_fd();
+
+        /**
+          \brief Destructor de la clase
+        */
+        ~Event_fd();
+
+        /**
+          \brief Crea el descriptor eventfd no bloqueante
+          \return Error de inicializacion
+        */
+        bool init( void );
+
+        /**
+          \brief Despierta a quien espera en el descriptor
+          \param count Numero de eventos a sumar al contador
+        */
+        void notify( uint64_t count = 1 );
+
+        /**
+          \brief Lee y pone a cero el contador de eventos
+          \return Numero de eventos acumulados desde la ultima lectura
+        */
+        uint64_t consume( void );
+
+        /**
+          \brief Devuelve el descriptor para registrarlo en el bucle de eventos
+        */
+        int get_fd( void ) const;
+
+    private:
+
+        int fd;     ///< Descriptor eventfd
+};
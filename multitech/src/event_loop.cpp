@@ -0,0 +1,86 @@
+#include "event_loop.h"
+#include <sys/epoll.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+Event_loop::Event_loop() : epoll_fd( -1 ) {
+    for ( uint_fast8_t i = 0; i < max_entries; i++ ) {
+        entries[i].fd = -1;
+    }
+}
+
+Event_loop::~Event_loop() {
+    if ( epoll_fd != -1 ) {
+        close( epoll_fd );
+    }
+}
+
+bool Event_loop::init( void ) {
+    epoll_fd = epoll_create1( EPOLL_CLOEXEC );
+    return epoll_fd != -1;
+}
+
+bool Event_loop::add( int fd, uint32_t events, Event_cb_t cb, void* arg ) {
+    for ( uint_fast8_t i = 0; i < max_entries; i++ ) {
+        if ( entries[i].fd == -1 ) {
+            struct epoll_event ev;
+            memset( &ev, 0, sizeof( ev ) );
+            ev.events   = events;
+            ev.data.ptr = &entries[i];
+            if ( epoll_ctl( epoll_fd, EPOLL_CTL_ADD, fd, &ev ) == -1 ) {
+                return false;
+            }
+            entries[i].fd  = fd;
+            entries[i].cb  = cb;
+            entries[i].arg = arg;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Event_loop::modify( int fd, uint32_t events ) {
+    for ( uint_fast8_t i = 0; i < max_entries; i++ ) {
+        if ( entries[i].fd == fd ) {
+            struct epoll_event ev;
+            memset( &ev, 0, sizeof( ev ) );
+            ev.events   = events;
+            ev.data.ptr = &entries[i];
+            return epoll_ctl( epoll_fd, EPOLL_CTL_MOD, fd, &ev ) == 0;
+        }
+    }
+    return false;
+}
+
+void Event_loop::remove( int fd ) {
+    for ( uint_fast8_t i = 0; i < max_entries; i++ ) {
+        if ( entries[i].fd == fd ) {
+            epoll_ctl( epoll_fd, EPOLL_CTL_DEL, fd, NULL );
+            entries[i].fd = -1;
+            return;
+        }
+    }
+}
+
+int Event_loop::run_once( int timeout_ms ) {
+    struct epoll_event events[max_events];
+
+    int nready = epoll_wait( epoll_fd, events, max_events, timeout_ms );
+    if ( nready < 0 ) {
+        return errno == EINTR ? 0 : -1;
+    }
+
+    for ( int i = 0; i < nready; i++ ) {
+        Event_entry_t* entry = (Event_entry_t*)events[i].data.ptr;
+        // Un callback anterior puede haber eliminado el descriptor
+        if ( entry->fd != -1 ) {
+            entry->cb( entry->arg, events[i].events );
+        }
+    }
+    return nready;
+}
+
+void Event_loop::run( void ) {
+    while ( run_once( -1 ) >= 0 ) {}
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+  \brief Callback de un descriptor registrado en el bucle de eventos
+  \param arg Argumento registrado junto al descriptor
+  \param events Eventos epoll recibidos (EPOLLIN, EPOLLOUT...)
+*/
+typedef void ( *Event_cb_t )( void* arg, uint32_t events );
+
+/**
+  \class Event_loop
+  \brief Bucle de eventos basado en epoll. Cada etapa del gateway registra su
+  descriptor (eventfd, timerfd o socket) y duerme en el kernel mientras no hay trabajo
+*/
+class Event_loop {
+
+    public:
+
+        /**
+          \brief Constructor de la clase
+        */
+        Event_loop();
+
+        /**
+          \brief Destructor de la clase
+        */
+        ~Event_loop();
+
+        /**
+          \brief Crea la instancia epoll
+          \return Error de inicializacion
+        */
+        bool init( void );
+
+        /**
+          \brief Registra un descriptor
+          \param fd Descriptor a vigilar
+          \param events Eventos epoll de interes
+          \param cb Callback a ejecutar con cada evento
+          \param arg Argumento para el callback
+          \return Resultado del registro
+        */
+        bool add( int fd, uint32_t events, Event_cb_t cb, void* arg );
+
+        /**
+          \brief Modifica los eventos de interes de un descriptor registrado
+          \param fd Descriptor registrado
+          \param events Nuevos eventos epoll de interes
+          \return Resultado de la operacion
+        */
+        bool modify( int fd, uint32_t events );
+
+        /**
+          \brief Elimina un descriptor del bucle
+          \param fd Descriptor registrado
+        */
+        void remove( int fd );
+
+        /**
+          \brief Espera eventos y ejecuta sus callbacks
+          \param timeout_ms Tiempo maximo de espera, -1 espera indefinida [ms]
+          \return Numero de eventos atendidos, -1 en caso de error
+        */
+        int run_once( int timeout_ms );
+
+        /**
+          \brief Atiende eventos indefinidamente
+        */
+        void run( void );
+
+    private:
+
+        typedef struct {
+            int fd;
+            Event_cb_t cb;
+            void* arg;
+        } Event_entry_t;
+
+        static const uint8_t max_entries = 32;
+        static const uint8_t max_events  = 16;
+
+        int epoll_fd;                           ///< Descriptor de la instancia epoll
+        Event_entry_t entries[max_entries];     ///< Descriptores registrados
+};
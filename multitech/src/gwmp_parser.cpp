@@ -0,0 +1,296 @@
+#include "gwmp_parser.h"
+#include <string.h>
+
+static const char* skip_spaces( const char* p, const char* end ) {
+    while ( p < end && ( *p == ' ' || *p == '\t' || *p == '\r' || *p == '\n' ) ) {
+        p++;
+    }
+    return p;
+}
+
+// Fin de una cadena que empieza en p ('"'), respetando los escapes. NULL si no se cierra
+static const char* skip_string( const char* p, const char* end ) {
+    for ( p++; p < end; p++ ) {
+        if ( *p == '\\' ) {
+            p++;
+        }
+        else if ( *p == '"' ) {
+            return p + 1;
+        }
+    }
+    return NULL;
+}
+
+// Fin de un valor JSON cualquiera. Los objetos y arrays se saltan contando la profundidad
+static const char* skip_value( const char* p, const char* end ) {
+    if ( p >= end ) {
+        return NULL;
+    }
+    if ( *p == '"' ) {
+        return skip_string( p, end );
+    }
+    if ( *p != '{' && *p != '[' ) {
+        while ( p < end && *p != ',' && *p != '}' && *p != ']' ) {
+            p++;
+        }
+        return p;
+    }
+    uint16_t depth = 0;
+    while ( p < end ) {
+        if ( *p == '"' ) {
+            p = skip_string( p, end );
+            if ( p == NULL ) {
+                return NULL;
+            }
+            continue;
+        }
+        if ( *p == '{' || *p == '[' ) {
+            depth++;
+        }
+        else if ( *p == '}' || *p == ']' ) {
+            if ( --depth == 0 ) {
+                return p + 1;
+            }
+        }
+        p++;
+    }
+    return NULL;
+}
+
+// Siguiente par clave/valor de un objeto. cursor queda tras el '{' o la ',' anterior.
+// Devuelve false al cerrar el objeto o si esta mal formado (cursor a NULL)
+static bool next_member( const char*& cursor, const char* end, const char*& key, size_t& key_len, const char*& value ) {
+    const char* p = skip_spaces( cursor, end );
+    if ( p < end && *p == '}' ) {
+        cursor = p + 1;
+        return false;
+    }
+    if ( p >= end || *p != '"' ) {
+        cursor = NULL;
+        return false;
+    }
+    const char* key_end = skip_string( p, end );
+    if ( key_end == NULL ) {
+        cursor = NULL;
+        return false;
+    }
+    key     = p + 1;
+    key_len = key_end - key - 1;
+
+    p = skip_spaces( key_end, end );
+    if ( p >= end || *p != ':' ) {
+        cursor = NULL;
+        return false;
+    }
+    value = skip_spaces( p + 1, end );
+
+    p = skip_value( value, end );
+    if ( p == NULL ) {
+        cursor = NULL;
+        return false;
+    }
+    p = skip_spaces( p, end );
+    if ( p < end && *p == ',' ) {
+        p++;
+    }
+    cursor = p;
+    return true;
+}
+
+static bool key_is( const char* key, size_t key_len, const char* name ) {
+    return key_len == strlen( name ) && memcmp( key, name, key_len ) == 0;
+}
+
+// Interpreta un valor decimal con signo como entero escalado: "868.1" con 3 decimales -> 868100
+static bool fixed_value( const char* value, const char* end, uint8_t decimals, int32_t& number ) {
+    bool negative = value < end && *value == '-';
+    if ( negative ) {
+        value++;
+    }
+    if ( value >= end || *value < '0' || *value > '9' ) {
+        return false;
+    }
+    uint32_t integer = 0;
+    while ( value < end && *value >= '0' && *value <= '9' ) {
+        integer = integer * 10 + ( *value - '0' );
+        value++;
+    }
+    if ( value < end && *value == '.' ) {
+        value++;
+    }
+    for ( uint8_t i = 0; i < decimals; i++ ) {
+        integer *= 10;
+        if ( value < end && *value >= '0' && *value <= '9' ) {
+            integer += *value - '0';
+            value++;
+        }
+    }
+    number = negative ? -(int32_t)integer : (int32_t)integer;
+    return true;
+}
+
+// Interpreta las claves de primer nivel de un elemento de "rxpk"
+static bool parse_packet( const char* object, const char* end, Gwmp_rxpk_t& rxpk ) {
+    memset( &rxpk, 0, sizeof( rxpk ) );
+    const char* cursor = object + 1;
+    const char* key;
+    size_t key_len;
+    const char* value;
+    uint8_t radio_fields = 0;
+    int32_t fixed;
+
+    while ( next_member( cursor, end, key, key_len, value ) ) {
+        if ( key_is( key, key_len, "data" ) ) {
+            const char* value_end = skip_string( value, end );
+            if ( *value != '"' || value_end == NULL ) {
+                return false;
+            }
+            rxpk.data     = value + 1;
+            rxpk.data_len = value_end - value - 2;
+        }
+        else if ( key_is( key, key_len, "stat" ) ) {
+            if ( fixed_value( value, end, 0, fixed ) ) {
+                rxpk.stat = fixed;
+            }
+        }
+        else if ( key_is( key, key_len, "datr" ) ) {
+            // En FSK "datr" es un numero (bps) y se deja sf a 0
+            const char* value_end = skip_string( value, end );
+            if ( *value == '"' && value_end != NULL && !Lora_airtime::parse_datr( value + 1, value_end - value - 2, rxpk.modulation ) ) {
+                rxpk.modulation.sf = 0;
+            }
+        }
+        else if ( key_is( key, key_len, "codr" ) ) {
+            const char* value_end = skip_string( value, end );
+            if ( *value == '"' && value_end != NULL ) {
+                Lora_airtime::parse_codr( value + 1, value_end - value - 2, rxpk.modulation );
+            }
+        }
+        else if ( key_is( key, key_len, "rssi" ) ) {
+            if ( fixed_value( value, end, 0, fixed ) ) {
+                rxpk.radio.rssi = fixed;
+                radio_fields++;
+            }
+        }
+        else if ( key_is( key, key_len, "lsnr" ) ) {
+            if ( fixed_value( value, end, 1, fixed ) ) {
+                rxpk.radio.lsnr = fixed;
+                radio_fields++;
+            }
+        }
+        else if ( key_is( key, key_len, "freq" ) ) {
+            if ( fixed_value( value, end, 3, fixed ) ) {
+                rxpk.radio.freq_khz = fixed;
+                radio_fields++;
+            }
+        }
+        else if ( key_is( key, key_len, "size" ) ) {
+            if ( fixed_value( value, end, 0, fixed ) ) {
+                rxpk.radio.size = fixed;
+            }
+        }
+        else if ( key_is( key, key_len, "tmst" ) ) {
+            if ( fixed_value( value, end, 0, fixed ) ) {
+                rxpk.radio.tmst = (uint32_t)fixed;
+            }
+        }
+    }
+    rxpk.radio.valid = radio_fields == 3;
+    return cursor != NULL && rxpk.data != NULL;
+}
+
+bool Gwmp_parser::parse_header( const uint8_t* datagram, size_t len, Gwmp_header_t& header ) {
+    // version | token (2) | identificador | [EUI del gateway (8)] | [JSON]
+    if ( datagram == NULL || len < header_len || datagram[0] != version ) {
+        return false;
+    }
+
+    header.version     = datagram[0];
+    header.token       = datagram[1] << 8 | datagram[2];
+    header.ident       = (Gwmp_ident_t)datagram[3];
+    header.gateway_eui = 0;
+    header.json        = NULL;
+    header.json_len    = 0;
+
+    size_t offset = header_len;
+    if ( header.ident == gwmp_push_data || header.ident == gwmp_pull_data || header.ident == gwmp_tx_ack ) {
+        if ( len < header_len + eui_len ) {
+            return false;
+        }
+        for ( uint8_t i = 0; i < eui_len; i++ ) {
+            header.gateway_eui = header.gateway_eui << 8 | datagram[header_len + i];
+        }
+        offset += eui_len;
+    }
+    if ( len > offset ) {
+        header.json     = (const char*)datagram + offset;
+        header.json_len = len - offset;
+    }
+    return true;
+}
+
+int16_t Gwmp_parser::parse_rxpk( const char* json, size_t len, Gwmp_rxpk_cb_t cb, void* arg ) {
+    // {"rxpk":[{"tmst":...,"data":"..."},{...}],"stat":{...}}
+    if ( json == NULL ) {
+        return -1;
+    }
+    const char* end    = json + len;
+    const char* cursor = skip_spaces( json, end );
+    if ( cursor >= end || *cursor != '{' ) {
+        return -1;
+    }
+    cursor++;
+
+    const char* key;
+    size_t key_len;
+    const char* value;
+    int16_t count = 0;
+    while ( next_member( cursor, end, key, key_len, value ) ) {
+        if ( !key_is( key, key_len, "rxpk" ) ) {
+            continue;
+        }
+        if ( *value != '[' ) {
+            return -1;
+        }
+        const char* element = skip_spaces( value + 1, end );
+        while ( element < end && *element == '{' ) {
+            const char* element_end = skip_value( element, end );
+            if ( element_end == NULL ) {
+                return -1;
+            }
+            Gwmp_rxpk_t rxpk;
+            if ( parse_packet( element, element_end, rxpk ) ) {
+                cb( rxpk, arg );
+                count++;
+            }
+            element = skip_spaces( element_end, end );
+            if ( element < end && *element == ',' ) {
+                element = skip_spaces( element + 1, end );
+            }
+        }
+    }
+    return cursor == NULL ? -1 : count;
+}
+
+uint8_t Gwmp_parser::build_ack( const Gwmp_header_t& header, uint8_t* out ) {
+    if ( header.ident != gwmp_push_data && header.ident != gwmp_pull_data ) {
+        return 0;
+    }
+    out[0] = version;
+    out[1] = header.token >> 8;
+    out[2] = header.token;
+    out[3] = header.ident == gwmp_push_data ? gwmp_push_ack : gwmp_pull_ack;
+    return header_len;
+}
+
+size_t Gwmp_parser::build_pull_resp( uint16_t token, const char* txpk, size_t txpk_len, uint8_t* out, size_t out_max ) {
+    if ( txpk == NULL || header_len + txpk_len > out_max ) {
+        return 0;
+    }
+    out[0] = version;
+    out[1] = token >> 8;
+    out[2] = token;
+    out[3] = gwmp_pull_resp;
+    memcpy( out + header_len, txpk, txpk_len );
+    return header_len + txpk_len;
+}
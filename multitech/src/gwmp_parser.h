@@ -0,0 +1,98 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "lora_uplink_parser.h"
+
+/**
+  \brief Identificadores de los datagramas del protocolo UDP del packet forwarder de Semtech (GWMP)
+*/
+typedef enum : uint8_t {
+    gwmp_push_data = 0x00,
+    gwmp_push_ack  = 0x01,
+    gwmp_pull_data = 0x02,
+    gwmp_pull_resp = 0x03,
+    gwmp_pull_ack  = 0x04,
+    gwmp_tx_ack    = 0x05
+} Gwmp_ident_t;
+
+/**
+  \brief Cabecera de un datagrama GWMP. json apunta dentro del datagrama original
+*/
+typedef struct {
+    uint8_t version;
+    uint16_t token;             ///< Token aleatorio que se devuelve en el ACK
+    Gwmp_ident_t ident;
+    uint64_t gateway_eui;       ///< Solo en PUSH_DATA, PULL_DATA y TX_ACK
+    const char* json;           ///< Objeto JSON tras la cabecera, NULL si no hay
+    size_t json_len;
+} Gwmp_header_t;
+
+/**
+  \brief Paquete recibido de un elemento del array "rxpk". data apunta al Base64 dentro del datagrama
+*/
+typedef struct {
+    int8_t stat;                        ///< CRC: 1 correcto, -1 erroneo, 0 sin CRC
+    Lora_modulation_t modulation;       ///< Campos "datr" y "codr", sf a 0 si no es LoRa
+    Lora_radio_t radio;
+    const char* data;                   ///< PHYPayload en Base64
+    size_t data_len;
+} Gwmp_rxpk_t;
+
+/**
+  \brief Callback por cada paquete de un array "rxpk"
+*/
+typedef void ( *Gwmp_rxpk_cb_t )( const Gwmp_rxpk_t& rxpk, void* arg );
+
+/**
+  \class Gwmp_parser
+  \brief Interpretacion y construccion de los datagramas GWMP (version 2). Los objetos "rxpk"
+  se recorren sin copias: solo se interpretan las claves de primer nivel de cada paquete y se
+  saltan los valores anidados (p.ej. "rsig")
+*/
+class Gwmp_parser {
+
+    public:
+
+        static const uint8_t version    = 2;
+        static const uint8_t header_len = 4;     ///< Version, token e identificador
+        static const uint8_t eui_len    = 8;
+
+        /**
+          \brief Interpreta la cabecera de un datagrama
+          \param datagram Datagrama recibido
+          \param len Longitud del datagrama
+          \param header Cabecera de salida
+          \return false si la version o la longitud no son validas
+        */
+        static bool parse_header( const uint8_t* datagram, size_t len, Gwmp_header_t& header );
+
+        /**
+          \brief Recorre el array "rxpk" de un PUSH_DATA
+          \param json Objeto JSON del datagrama
+          \param len Longitud del JSON
+          \param cb Callback por cada paquete
+          \param arg Argumento del callback
+          \return Numero de paquetes encontrados, -1 si el JSON esta mal formado
+        */
+        static int16_t parse_rxpk( const char* json, size_t len, Gwmp_rxpk_cb_t cb, void* arg );
+
+        /**
+          \brief Construye el ACK de un PUSH_DATA (PUSH_ACK) o de un PULL_DATA (PULL_ACK)
+          \param header Cabecera del datagrama a confirmar
+          \param out Buffer de salida, al menos header_len bytes
+          \return Longitud del ACK, 0 si el datagrama no lleva ACK
+        */
+        static uint8_t build_ack( const Gwmp_header_t& header, uint8_t* out );
+
+        /**
+          \brief Construye un PULL_RESP con el objeto "txpk" ya serializado
+          \param token Token del PULL_RESP, se devuelve en el TX_ACK
+          \param txpk Objeto JSON {"txpk":{...}}
+          \param txpk_len Longitud del JSON
+          \param out Buffer de salida
+          \param out_max Tamanyo del buffer de salida
+          \return Longitud del datagrama, 0 si no cabe
+        */
+        static size_t build_pull_resp( uint16_t token, const char* txpk, size_t txpk_len, uint8_t* out, size_t out_max );
+};
@@ -0,0 +1,367 @@
+#include "gwmp_server.h"
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <netinet/in.h>
+#include <errno.h>
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "log.h"
+
+static void die( const char* msg ) {
+    printf( "%s", msg );
+    fflush( stdout );
+    fflush( stderr );
+    exit( EXIT_FAILURE );
+}
+
+// Interpreta n digitos hexadecimales. false si alguno no lo es
+static bool parse_hex( const char* hex, uint8_t* out, uint8_t n_bytes ) {
+    for ( uint8_t i = 0; i < 2 * n_bytes; i++ ) {
+        char c = hex[i];
+        uint8_t nibble;
+        if ( c >= '0' && c <= '9' ) {
+            nibble = c - '0';
+        }
+        else if ( c >= 'a' && c <= 'f' ) {
+            nibble = c - 'a' + 10;
+        }
+        else if ( c >= 'A' && c <= 'F' ) {
+            nibble = c - 'A' + 10;
+        }
+        else {
+            return false;
+        }
+        out[i / 2] = i % 2 == 0 ? nibble << 4 : out[i / 2] | nibble;
+    }
+    return true;
+}
+
+Gwmp_server::Gwmp_server( Pkt_ring& lora_input_0, uint16_t max_pkt_size_0 ):
+    lora_input( lora_input_0 ),
+    max_pkt_size( max_pkt_size_0 ),
+    listen_sd( -1 ),
+    n_devices( 0 ),
+    pkt( max_pkt_size_0 ),
+    framer( Pkt_framer::layout_of( pkt, pkt_sync_lossy, pkt_sync_no_lossy ), Pkt_framer::check_with_pkt<Pkt>, &pkt ),
+    now( 0 ),
+    frame_key( 0 ),
+    frame_index( 0 ),
+    pull_addr_len( 0 ),
+    pull_token( 0 ),
+    admission( NULL ) {
+    pthread_mutex_init( &pull_lock, NULL );
+    memset( &stats, 0, sizeof( stats ) );
+}
+
+Gwmp_server::~Gwmp_server() {
+    close( listen_sd );
+    pthread_mutex_destroy( &pull_lock );
+}
+
+bool Gwmp_server::add_device( uint32_t dev_addr, const uint8_t app_s_key[16] ) {
+    Device_t* device = find_device( dev_addr );
+    if ( device == NULL ) {
+        if ( n_devices == max_devices ) {
+            return false;
+        }
+        device = &devices[n_devices++];
+    }
+    device->dev_addr = dev_addr;
+    device->fcnt     = 0;
+    device->has_fcnt = false;
+    memcpy( device->app_s_key, app_s_key, sizeof( device->app_s_key ) );
+    return true;
+}
+
+int16_t Gwmp_server::load_devices( const char* path ) {
+    FILE* file = fopen( path, "r" );
+    if ( file == NULL ) {
+        return -1;
+    }
+
+    char line[128];
+    int16_t loaded = 0;
+    while ( fgets( line, sizeof( line ), file ) != NULL ) {
+        // DEVADDR APPSKEY: 8 y 32 digitos hexadecimales
+        if ( line[0] == '#' || line[0] == '\n' || line[0] == '\r' || line[0] == '\0' ) {
+            continue;
+        }
+        uint8_t addr[4];
+        uint8_t key[16];
+        if ( strlen( line ) < 8 + 1 + 32 || line[8] != ' ' || !parse_hex( line, addr, sizeof( addr ) ) || !parse_hex( line + 9, key, sizeof( key ) ) ) {
+            log( (uint32_t)0, "GWMP bad device line: %s", line );
+            continue;
+        }
+        uint32_t dev_addr = (uint32_t)addr[0] << 24 | (uint32_t)addr[1] << 16 | (uint32_t)addr[2] << 8 | addr[3];
+        if ( !add_device( dev_addr, key ) ) {
+            log( (uint32_t)0, "GWMP device table full\n" );
+            break;
+        }
+        loaded++;
+    }
+    fclose( file );
+    return loaded;
+}
+
+int8_t Gwmp_server::init( uint16_t port ) {
+    // Inicio la estructura hints
+    struct addrinfo hints;
+    (void)memset( &hints, '\0', sizeof( struct addrinfo ) );
+    hints.ai_family   = AF_INET;                     // ipv4
+    hints.ai_socktype = SOCK_DGRAM;                  // Datagrama
+    hints.ai_protocol = 0;                           // Cualquier protocolo
+    hints.ai_flags    = AI_PASSIVE | AI_NUMERICSERV; // Recibo de cualquier address
+
+    addrinfo* result; // Resultado de getaddrinfo
+    addrinfo* rp;     // Iterador por los addresses devueltos
+
+    char server_port[6];
+    snprintf( server_port, sizeof( server_port ), "%u", port );
+    if ( 0 != ( getaddrinfo( NULL, server_port, &hints, &result ) ) ) {
+        die( "getaddrinfo()\n" );
+    }
+
+    // Recorro los disponibles, hasta que consigo un bind
+    for ( rp = result; rp != NULL; rp = rp->ai_next ) {
+        listen_sd = socket( rp->ai_family, rp->ai_socktype, rp->ai_protocol );
+
+        if ( listen_sd == -1 ) {
+            continue;
+        }
+
+        int option_value = 1;
+        if ( setsockopt( listen_sd, SOL_SOCKET, SO_REUSEADDR, &option_value, sizeof( int ) ) == -1 ) {
+            perror( "Setsockopt" );
+            exit( 1 );
+        }
+
+        // Si no se puede ampliar el buffer se sigue con el del sistema
+        int rcvbuf_value = rcvbuf_size;
+        setsockopt( listen_sd, SOL_SOCKET, SO_RCVBUF, &rcvbuf_value, sizeof( int ) );
+
+        if ( bind( listen_sd, rp->ai_addr, rp->ai_addrlen ) == 0 ) {
+            break; // Success
+        }
+
+        close( listen_sd );
+    }
+
+    // Si no he conseguido ninguno, salgo
+    if ( rp == NULL ) {
+        size_t err_len = snprintf( NULL, 0, "Could not bind on port %s\n", server_port );
+        char* err_str  = (char*)malloc( err_len + 1 );
+        snprintf( err_str, err_len + 1, "Could not bind on port %s\n", server_port );
+        die( err_str );
+        free( err_str );
+    }
+
+    freeaddrinfo( result ); // Libero resultados, ya no se necesitan
+
+    // Cada entrada del lote apunta siempre a su propio buffer y a su direccion de origen
+    memset( rx_msgs, 0, sizeof( rx_msgs ) );
+    for ( uint_fast8_t i = 0; i < max_batch_size; i++ ) {
+        rx_iovecs[i].iov_base         = rx_buffers[i];
+        rx_iovecs[i].iov_len          = max_len;
+        rx_msgs[i].msg_hdr.msg_iov    = &rx_iovecs[i];
+        rx_msgs[i].msg_hdr.msg_iovlen = 1;
+        rx_msgs[i].msg_hdr.msg_name   = &rx_addrs[i];
+    }
+
+    if ( pthread_create( &gwmp_server_thread, NULL, thread_fcn, (void*)this ) ) {
+        printf( "Error creating thread\n" );
+        return 0;
+    }
+
+    log( (uint32_t)0, "GWMP server thread created, %u devices\n", n_devices );
+    return 1;
+}
+
+void Gwmp_server::run( void ) {
+    while ( 1 ) {
+        // msg_namelen es de entrada/salida: se restaura antes de cada lectura
+        for ( uint_fast8_t i = 0; i < max_batch_size; i++ ) {
+            rx_msgs[i].msg_hdr.msg_namelen = sizeof( rx_addrs[i] );
+        }
+
+        // Bloquea hasta el primer datagrama y recoge los que ya esten en cola
+        int received = recvmmsg( listen_sd, rx_msgs, max_batch_size, MSG_WAITFORONE, NULL );
+        if ( received <= 0 ) {
+            continue;
+        }
+
+        now = time( NULL );
+        for ( int i = 0; i < received; i++ ) {
+            if ( rx_msgs[i].msg_hdr.msg_flags & MSG_TRUNC ) {
+                stats.bad_datagrams++;
+                continue;
+            }
+            process_datagram( rx_buffers[i], rx_msgs[i].msg_len, (const struct sockaddr*)&rx_addrs[i], rx_msgs[i].msg_hdr.msg_namelen );
+        }
+    }
+}
+
+void Gwmp_server::process_datagram( const uint8_t* datagram, size_t len, const struct sockaddr* addr, socklen_t addr_len ) {
+    Gwmp_header_t header;
+    if ( !Gwmp_parser::parse_header( datagram, len, header ) ) {
+        stats.bad_datagrams++;
+        return;
+    }
+
+    switch ( header.ident ) {
+        case gwmp_push_data:
+            stats.push_data++;
+            if ( header.json != NULL && Gwmp_parser::parse_rxpk( header.json, header.json_len, on_rxpk, this ) < 0 ) {
+                stats.bad_datagrams++;
+            }
+            break;
+        case gwmp_pull_data:
+            stats.pull_data++;
+            pthread_mutex_lock( &pull_lock );
+            memcpy( &pull_addr, addr, addr_len );
+            pull_addr_len = addr_len;
+            pthread_mutex_unlock( &pull_lock );
+            break;
+        case gwmp_tx_ack:
+            stats.tx_ack++;
+            break;
+        default:
+            stats.bad_datagrams++;
+            break;
+    }
+
+    // El PULL_ACK sale con la direccion ya registrada: tras el puede pedirse un PULL_RESP
+    uint8_t ack[Gwmp_parser::header_len];
+    uint8_t ack_len = Gwmp_parser::build_ack( header, ack );
+    if ( ack_len > 0 ) {
+        sendto( listen_sd, ack, ack_len, 0, addr, addr_len );
+    }
+}
+
+void Gwmp_server::on_rxpk( const Gwmp_rxpk_t& rxpk, void* server_void_ptr ) {
+    Gwmp_server* server = (Gwmp_server*)server_void_ptr;
+    server->stats.rxpk++;
+
+    if ( rxpk.stat != 1 ) {
+        server->stats.crc_errors++;
+        return;
+    }
+
+    size_t phy_len = server->base64.decoded_size( rxpk.data, rxpk.data_len );
+    if ( phy_len > max_phy_len || !server->base64.decode( rxpk.data, rxpk.data_len, server->phy, max_phy_len ) ) {
+        server->stats.not_data++;
+        return;
+    }
+
+    // Solo subidas de datos con FPort de aplicacion; FPort 0 son comandos MAC cifrados con la NwkSKey
+    Lorawan_frame_t frame;
+    if ( !Lorawan_frame::parse( server->phy, phy_len, frame ) || ( frame.mtype != mtype_unconfirmed_up && frame.mtype != mtype_confirmed_up ) || !frame.has_fport || frame.fport == 0 ) {
+        server->stats.not_data++;
+        return;
+    }
+
+    Device_t* device = server->find_device( frame.dev_addr );
+    if ( device == NULL ) {
+        server->stats.unknown_devices++;
+        return;
+    }
+
+    // El FCnt de 32 bits no viaja completo: se prueba primero el esperado y despues cada palabra
+    // alta hasta que el framer acepta algun pkt descifrado, cuyo checksum hace de MIC. Asi se
+    // recupera tras reiniciar el gateway y tras un reinicio del contador de un dispositivo ABP
+    uint32_t expected = full_fcnt( *device, frame.fcnt );
+    for ( uint8_t high = 0; high <= max_fcnt_high; high++ ) {
+        uint32_t fcnt = high == 0 ? expected : (uint32_t)( high - 1 ) << 16 | frame.fcnt;
+        if ( high > 0 && fcnt == expected ) {
+            continue;
+        }
+        if ( server->decode( *device, frame, fcnt ) ) {
+            // Solo un descifrado valido mueve el contador
+            device->fcnt     = fcnt;
+            device->has_fcnt = true;
+            server->stats.decrypted++;
+            return;
+        }
+    }
+    server->stats.undecoded++;
+}
+
+bool Gwmp_server::decode( const Device_t& device, const Lorawan_frame_t& frame, uint32_t fcnt ) {
+    Lorawan_frame::crypt_payload( device.app_s_key, frame.dev_addr, fcnt, true, frame.payload, frame.payload_len, payload );
+
+    // Los duplicados se descartan por pkt en on_frame, para poder olvidar solo los no encolados
+    frame_key   = Dedup_cache::hash( &frame.dev_addr, sizeof( frame.dev_addr ) );
+    frame_key   = Dedup_cache::hash( &fcnt, sizeof( fcnt ), frame_key );
+    frame_index = 0;
+
+    // Un pkt nunca continua en otro paquete de radio
+    framer.reset();
+    return framer.feed( payload, frame.payload_len, on_frame, this ) > 0;
+}
+
+void Gwmp_server::on_frame( const uint8_t* bytes, uint16_t len, void* server_void_ptr ) {
+    Gwmp_server* server = (Gwmp_server*)server_void_ptr;
+    uint8_t index       = server->frame_index++;
+    uint64_t key        = Dedup_cache::hash( &index, sizeof( index ), server->frame_key );
+    if ( server->dedup.check( key, server->now ) ) {
+        server->stats.duplicates++;
+        return;
+    }
+
+    server->stats.pkts++;
+    bool pushed;
+    if ( server->admission == NULL ) {
+        pushed = server->lora_input.try_push( bytes, len );
+    }
+    else {
+        pushed = server->admission->offer( server->lora_input, server->pkt.hdr->src, server->pkt.hdr->cmd, bytes, len, Pkt_admission::now_ms() ) == admission_accepted;
+    }
+    if ( !pushed ) {
+        // Un reintento del dispositivo repite el FCnt y no debe tomarse por un duplicado
+        server->dedup.forget( key );
+        server->stats.push_drops++;
+    }
+}
+
+void Gwmp_server::set_admission( Pkt_admission* admission_0 ) {
+    admission = admission_0;
+}
+
+bool Gwmp_server::send_pull_resp( const char* txpk, size_t txpk_len ) {
+    uint8_t datagram[max_len];
+
+    pthread_mutex_lock( &pull_lock );
+    size_t len = Gwmp_parser::build_pull_resp( ++pull_token, txpk, txpk_len, datagram, sizeof( datagram ) );
+    bool sent  = len > 0 && pull_addr_len > 0 && sendto( listen_sd, datagram, len, 0, (const struct sockaddr*)&pull_addr, pull_addr_len ) == (ssize_t)len;
+    pthread_mutex_unlock( &pull_lock );
+    return sent;
+}
+
+Gwmp_server::Device_t* Gwmp_server::find_device( uint32_t dev_addr ) {
+    for ( uint16_t i = 0; i < n_devices; i++ ) {
+        if ( devices[i].dev_addr == dev_addr ) {
+            return &devices[i];
+        }
+    }
+    return NULL;
+}
+
+uint32_t Gwmp_server::full_fcnt( const Device_t& device, uint16_t fcnt16 ) {
+    if ( !device.has_fcnt ) {
+        return fcnt16;
+    }
+    // Distancia con signo a los 16 bits bajos del ultimo: cubre el desbordamiento y las subidas reordenadas
+    return device.fcnt + (int16_t)(uint16_t)( fcnt16 - (uint16_t)device.fcnt );
+}
+
+Gwmp_stats_t Gwmp_server::get_stats( void ) const {
+    return stats;
+}
+
+void* Gwmp_server::thread_fcn( void* Gwmp_server_void_ptr ) {
+    ( (Gwmp_server*)Gwmp_server_void_ptr )->run();
+    return NULL;
+}
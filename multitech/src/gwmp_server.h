@@ -0,0 +1,209 @@
+#pragma once
+
+#include "stdint.h"   // Tipos uint8_t etc
+#include <netdb.h>    // addrinfo
+#include <sys/socket.h> // mmsghdr
+#include "pthread.h"
+#include "pkt.h"
+#include "pkt_ring.h"
+#include "pkt_framer.h"
+#include "base64.h"
+#include "dedup_cache.h"
+#include "gwmp_parser.h"
+#include "lorawan_frame.h"
+#include "pkt_admission.h"
+
+/**
+  \brief Estadisticas del servidor GWMP
+*/
+typedef struct {
+    uint32_t push_data;         ///< PUSH_DATA recibidos
+    uint32_t rxpk;              ///< Paquetes de radio recibidos
+    uint32_t crc_errors;        ///< Paquetes con CRC erroneo o sin CRC
+    uint32_t not_data;          ///< Paquetes que no son subidas de datos de aplicacion
+    uint32_t unknown_devices;   ///< Subidas de DevAddr sin claves configuradas
+    uint32_t duplicates;        ///< Pkts de subidas ya recibidas por otro gateway
+    uint32_t decrypted;         ///< Subidas descifradas con algun pkt valido
+    uint32_t undecoded;         ///< Subidas sin ningun pkt valido con los FCnt probados
+    uint32_t pkts;              ///< Pkts delimitados y encolados
+    uint32_t push_drops;        ///< Pkts no encolados por cola llena o por el control de admision
+    uint32_t pull_data;         ///< PULL_DATA recibidos
+    uint32_t tx_ack;            ///< TX_ACK recibidos
+    uint32_t bad_datagrams;     ///< Datagramas con cabecera o JSON invalidos
+} Gwmp_stats_t;
+
+/**
+  \class Gwmp_server
+  \brief Entrada directa desde el packet forwarder de Semtech (protocolo UDP GWMP), sin pasar por
+  el network server. Confirma PUSH_DATA y PULL_DATA, recorre los arrays "rxpk", descifra el
+  FRMPayload con la AppSKey de cada dispositivo y encola los pkts en la misma cola de ingesta
+  que el resto de servidores. Las claves de sesion solo se conocen para dispositivos ABP;
+  las subidas de otros dispositivos se cuentan y se descartan. Tampoco se envia ACK de
+  aplicacion ni configuracion de hora: una bajada LoRaWAN lleva un MIC calculado con la NwkSKey
+  y el fichero de claves solo tiene la AppSKey, de modo que send_pull_resp queda sin usar
+*/
+class Gwmp_server {
+
+    public:
+
+        static const uint16_t default_port = 1700;
+        static const uint16_t max_devices  = 256;
+
+        /**
+          \brief Constructor de la clase
+          \param lora_input_0 Cola para almacenar pkt's
+          \param max_pkt_size_0 Longitud maxima del pkt
+        */
+        Gwmp_server( Pkt_ring& lora_input_0, uint16_t max_pkt_size_0 );
+
+        /**
+          \brief Destructor de la clase
+        */
+        ~Gwmp_server();
+
+        /**
+          \brief Registra la AppSKey de un dispositivo ABP. Llamar antes de init
+          \param dev_addr DevAddr del dispositivo
+          \param app_s_key AppSKey del dispositivo
+          \return false si la tabla esta llena
+        */
+        bool add_device( uint32_t dev_addr, const uint8_t app_s_key[16] );
+
+        /**
+          \brief Carga dispositivos de un fichero de texto, una linea "DEVADDR APPSKEY" en hexadecimal
+          por dispositivo. Las lineas vacias o que empiezan por '#' se ignoran. Llamar antes de init
+          \param path Ruta del fichero
+          \return Dispositivos cargados, -1 si no se puede abrir
+        */
+        int16_t load_devices( const char* path );
+
+        /**
+          \brief Inicializa los parámetros del servidor
+          \param port Puerto listen del servidor
+          \return Error de inicializacion
+        */
+        int8_t init( uint16_t port );
+
+        /**
+          \brief Arranca el servidor
+        */
+        void run( void );
+
+        /**
+          \brief Envia un PULL_RESP al ultimo gateway que ha hecho PULL_DATA. Seguro desde cualquier thread
+          \param txpk Objeto JSON {"txpk":{...}}
+          \param txpk_len Longitud del JSON
+          \return false si no hay gateway conocido o falla el envio
+        */
+        bool send_pull_resp( const char* txpk, size_t txpk_len );
+
+        /**
+          \brief Fija el control de admision de la cola de ingesta. Llamar antes de init
+          \param admission_0 Control de admision, NULL encola sin control
+        */
+        void set_admission( Pkt_admission* admission_0 );
+
+        /**
+          \brief Devuelve las estadisticas (copia sin bloqueo, aproximada)
+        */
+        Gwmp_stats_t get_stats( void ) const;
+
+        /**
+          \brief Funcion estatica callback del thread
+          \param Gwmp_server_void_ptr puntero al objeto que crea el thread
+        */
+        static void* thread_fcn( void* Gwmp_server_void_ptr );
+
+    private:
+
+        typedef struct {
+            uint32_t dev_addr;
+            uint8_t app_s_key[16];
+            uint32_t fcnt;              ///< Ultimo contador de 32 bits con pkts validos
+            bool has_fcnt;
+        } Device_t;
+
+        Pkt_ring& lora_input;                           ///< Cola sin bloqueos hacia la etapa de ingesta
+        pthread_t gwmp_server_thread;                   ///< Thread de recepcion
+        uint16_t max_pkt_size;
+        int listen_sd;                                  ///< Descriptor socket abierto para listen
+
+        static const uint16_t max_len = 2048;           ///< Un PUSH_DATA puede llevar varios paquetes
+        static const uint8_t max_batch_size = 16;       ///< Datagramas maximos por lectura
+        static const int rcvbuf_size = 256 * 1024;      ///< Buffer del socket para absorber rafagas [bytes]
+        static const uint16_t max_phy_len = 256;        ///< PHYPayload maximo de LoRa [bytes]
+        static const uint8_t max_fcnt_high = 32;        ///< Palabras altas del FCnt probadas si falla la esperada
+
+        uint8_t rx_buffers[max_batch_size][max_len];    ///< Un buffer por datagrama del lote
+        struct iovec rx_iovecs[max_batch_size];
+        struct sockaddr_storage rx_addrs[max_batch_size];
+        struct mmsghdr rx_msgs[max_batch_size];
+
+        Device_t devices[max_devices];
+        uint16_t n_devices;
+        Base64 base64;
+        Dedup_cache dedup;                              ///< Una misma subida oida por varios gateways
+        Pkt pkt;                                        ///< Comprobacion final de los pkts delimitados
+        Pkt_framer framer;
+        uint8_t phy[max_phy_len];
+        uint8_t payload[max_phy_len];
+        uint32_t now;                                   ///< Instante del lote en curso [s]
+        uint64_t frame_key;                             ///< Clave de duplicados de la subida en curso (DevAddr y FCnt)
+        uint8_t frame_index;                            ///< Posicion del siguiente pkt dentro de la subida
+
+        pthread_mutex_t pull_lock;                      ///< Protege la direccion de bajada
+        struct sockaddr_storage pull_addr;              ///< Gateway del ultimo PULL_DATA
+        socklen_t pull_addr_len;                        ///< 0 si no ha llegado ningun PULL_DATA
+        uint16_t pull_token;
+
+        Pkt_admission* admission;                       ///< Control de admision compartido, NULL si no hay
+        Gwmp_stats_t stats;
+
+        /**
+          \brief Procesa un datagrama recibido y lo confirma
+          \param datagram Datagrama recibido
+          \param len Longitud del datagrama
+          \param addr Direccion del gateway
+          \param addr_len Longitud de la direccion
+        */
+        void process_datagram( const uint8_t* datagram, size_t len, const struct sockaddr* addr, socklen_t addr_len );
+
+        /**
+          \brief Callback del parser: descifra un paquete de radio y encola sus pkts
+          \param rxpk Paquete de radio
+          \param server_void_ptr Puntero al servidor
+        */
+        static void on_rxpk( const Gwmp_rxpk_t& rxpk, void* server_void_ptr );
+
+        /**
+          \brief Descifra una subida con un FCnt candidato y encola los pkts que el framer acepte
+          \param device Dispositivo de la subida
+          \param frame Subida recibida
+          \param fcnt FCnt de 32 bits candidato
+          \return false si el descifrado no da ningun pkt valido: el FCnt no es el de la subida
+        */
+        bool decode( const Device_t& device, const Lorawan_frame_t& frame, uint32_t fcnt );
+
+        /**
+          \brief Callback del framer: encola un pkt completo
+          \param bytes Pkt delimitado
+          \param len Longitud del pkt
+          \param server_void_ptr Puntero al servidor
+        */
+        static void on_frame( const uint8_t* bytes, uint16_t len, void* server_void_ptr );
+
+        /**
+          \brief Busca un dispositivo por DevAddr
+          \return NULL si no esta configurado
+        */
+        Device_t* find_device( uint32_t dev_addr );
+
+        /**
+          \brief Contador de 32 bits esperado a partir de sus 16 bits bajos, suponiendo que entre
+          dos subidas recibidas se pierden menos de 32768 tramas. Sin subidas anteriores se
+          toma como contador de 16 bits
+          \param device Dispositivo con el ultimo contador recibido
+          \param fcnt16 16 bits bajos del contador recibido
+        */
+        static uint32_t full_fcnt( const Device_t& device, uint16_t fcnt16 );
+};
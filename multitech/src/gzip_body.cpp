@@ -0,0 +1,37 @@
+#include "gzip_body.h"
+#include <string.h>
+
+Gzip_body::Gzip_body() : ready( false ) {
+    memset( &stream, 0, sizeof( stream ) );
+}
+
+Gzip_body::~Gzip_body() {
+    if ( ready ) {
+        deflateEnd( &stream );
+    }
+}
+
+bool Gzip_body::init( int level ) {
+    if ( ready ) {
+        return true;
+    }
+    // window_bits + 16 pide cabecera y cola gzip en lugar de zlib
+    ready = deflateInit2( &stream, level, Z_DEFLATED, window_bits + 16, mem_level, Z_DEFAULT_STRATEGY ) == Z_OK;
+    return ready;
+}
+
+uint32_t Gzip_body::compress( const uint8_t* in, uint32_t len, uint8_t* out, uint32_t max_len ) {
+    if ( !ready || len == 0 || deflateReset( &stream ) != Z_OK ) {
+        return 0;
+    }
+
+    // Solo compensa si sale mas corto: se limita la salida a len - 1 bytes
+    stream.next_in   = (Bytef*)in;
+    stream.avail_in  = len;
+    stream.next_out  = out;
+    stream.avail_out = max_len < len ? max_len : len - 1;
+    if ( deflate( &stream, Z_FINISH ) != Z_STREAM_END ) {
+        return 0;
+    }
+    return stream.total_out;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdint.h>
+#include <zlib.h>
+
+/**
+  \class Gzip_body
+  \brief Compresion gzip de cuerpos de peticion (Content-Encoding: gzip). El estado de zlib se
+  reserva una vez en init y se reutiliza en cada cuerpo; la ventana es pequenya porque los cuerpos
+  caben en unos pocos KB. No es segura entre threads
+*/
+class Gzip_body {
+
+    public:
+
+        static const int window_bits = 12;     ///< Ventana de 4 KB, el cuerpo maximo de un lote
+        static const int mem_level   = 5;      ///< ~32 KB de estado de zlib en total
+
+        /**
+          \brief Constructor de la clase
+        */
+        Gzip_body();
+
+        /**
+          \brief Destructor de la clase
+        */
+        ~Gzip_body();
+
+        /**
+          \brief Reserva el estado de zlib
+          \param level Nivel de compresion de 1 (rapido) a 9
+          \return Error de inicializacion
+        */
+        bool init( int level );
+
+        /**
+          \brief Comprime un cuerpo completo en formato gzip
+          \param in Cuerpo sin comprimir
+          \param len Longitud del cuerpo
+          \param out Buffer de salida
+          \param max_len Tamanyo del buffer de salida
+          \return Longitud comprimida, 0 si no cabe o no queda mas corto que el original
+        */
+        uint32_t compress( const uint8_t* in, uint32_t len, uint8_t* out, uint32_t max_len );
+
+    private:
+
+        z_stream stream;
+        bool ready;
+};
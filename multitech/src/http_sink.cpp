@@ -0,0 +1,357 @@
+#include "http_sink.h"
+#include <sys/epoll.h>
+#include <string.h>
+#include <time.h>
+
+// Errores de una conexion reutilizada que el otro extremo ya habia cerrado: la peticion no llego a procesarse
+static bool is_stale_connection( CURLcode code ) {
+    return code == CURLE_SEND_ERROR || code == CURLE_RECV_ERROR || code == CURLE_GOT_NOTHING;
+}
+
+Http_sink::Http_sink( Pkt_log_reader<Pkt>& queue_0, Comm_mgr& comm_0, const char* mobile_id_0, uint8_t window_0, uint32_t seed ) :
+    pkts( queue_0 ),
+    comm( comm_0 ),
+    mobile_id( mobile_id_0 ),
+    window( window_0 == 0 ? 1 : ( window_0 > max_window ? max_window : window_0 ) ),
+    engine( NULL ),
+    batch_pkts( 1 ),
+    batch_age_ms( 0 ),
+    lingering( false ),
+    linger_expired( false ),
+    health( seed ),
+    replay_min_pkts( 0 ) {
+    memset( slots, 0, sizeof( slots ) );
+    memset( &stats, 0, sizeof( stats ) );
+}
+
+Http_sink::~Http_sink() {
+    for ( uint8_t i = 0; i < window; i++ ) {
+        if ( slots[i].easy != NULL ) {
+            curl_easy_cleanup( slots[i].easy );
+        }
+    }
+}
+
+bool Http_sink::init( Upload_engine& engine_0, Event_loop& loop ) {
+    engine = &engine_0;
+    for ( uint8_t i = 0; i < window; i++ ) {
+        Slot_t& slot = slots[i];
+        slot.sink    = this;
+        slot.easy    = curl_easy_init();
+        if ( slot.easy == NULL ) {
+            return false;
+        }
+        comm.setup_handle( slot.easy );
+        curl_easy_setopt( slot.easy, CURLOPT_WRITEFUNCTION, response_fcn );
+        curl_easy_setopt( slot.easy, CURLOPT_WRITEDATA, &slot );
+    }
+    return linger_timer.init() && loop.add( linger_timer.get_fd(), EPOLLIN, on_linger, this ) &&
+           retry_timer.init() && loop.add( retry_timer.get_fd(), EPOLLIN, on_retry, this );
+}
+
+void Http_sink::set_batch( uint8_t max_pkts, uint32_t max_age_ms ) {
+    // Un cuerpo sin codificar lleva un solo pkt, y un destino sin lotes no entiende pkt[]= ni responde 207
+    if ( comm.get_encoding() == pkt_encoding_raw || !comm.get_batching() ) {
+        max_pkts = 1;
+    }
+    batch_pkts   = max_pkts == 0 ? 1 : ( max_pkts > Upload_batch::max_pkts ? Upload_batch::max_pkts : max_pkts );
+    batch_age_ms = max_age_ms;
+}
+
+void Http_sink::set_retry( uint32_t base_ms, uint32_t max_ms, uint8_t max_attempts_0 ) {
+    health.set_backoff( base_ms, max_ms );
+    pkts.set_max_attempts( max_attempts_0 );
+}
+
+void Http_sink::set_result_cb( Upload_result_cb_t<Pkt> cb, void* arg ) {
+    pkts.set_result_cb( cb, arg );
+}
+
+void Http_sink::set_replay( uint16_t min_pkts, uint8_t live_pct ) {
+    replay_min_pkts = min_pkts;
+    replay.set_share( live_pct );
+}
+
+Replay_report_t Http_sink::get_replay( void ) const {
+    return replay.get_report( pkts.backlog_left(), now_ms() );
+}
+
+void Http_sink::pump( void ) {
+    if ( engine == NULL ) {
+        return;
+    }
+    uint32_t now = now_ms();
+    pkts.resync();
+    pop_done();
+
+    // Primero los reintentos vencidos, aunque los nuevos no esperan a que terminen
+    if ( !pump_lane( now ) ) {
+        arm_retry( now );
+        return;
+    }
+
+    // Con el destino sano, lo acumulado hasta ahora es el atraso y lo que llegue sale por la via de nuevos
+    if ( replay_min_pkts > 0 && !replay.is_active() && health.get_state() == breaker_closed && pkts.unsent( lane_backlog ) >= replay_min_pkts ) {
+        replay.start( pkts.start_backlog(), now );
+    }
+
+    while ( free_slot() != NULL && health.allow( now ) ) {
+        bool replaying       = replay.is_active();
+        uint16_t head_unsent = pkts.unsent( lane_backlog );
+        uint16_t live_unsent = pkts.unsent( lane_live );
+
+        // El lote de la via que espera a llenarse: la cola entera o los nuevos
+        uint16_t fill = replaying ? live_unsent : head_unsent;
+        if ( fill > 0 && fill < batch_pkts && !linger_expired && !lingering ) {
+            lingering = true;
+            linger_timer.start( batch_age_ms );
+        }
+        bool fill_ready = fill > 0 && ( fill >= batch_pkts || linger_expired );
+
+        // El atraso no ocupa el ultimo hueco: un pkt nuevo no espera a que termine un lote entero
+        bool backlog_ready = replaying && head_unsent > 0 && ( free_slots() > 1 || window == 1 );
+        if ( !fill_ready && !backlog_ready ) {
+            break;
+        }
+        Replay_lane_t lane = lane_backlog;
+        if ( replaying ) {
+            lane = replay.pick( fill_ready, backlog_ready );
+        }
+        bool is_fill = !replaying || lane == lane_live;
+
+        uint16_t offsets[Upload_batch::max_pkts];
+        uint8_t max_n = is_fill || batch_pkts == 1 ? batch_pkts : Upload_batch::max_pkts;
+        uint8_t n     = pkts.next( lane, max_n, offsets );
+        uint8_t sent  = n > 0 ? start_batch( offsets, n, false, now ) : 0;
+        if ( sent == 0 ) {
+            break;
+        }
+
+        pkts.advance( lane, sent );
+        if ( replaying ) {
+            uint32_t bytes = 0;
+            for ( uint8_t i = 0; i < sent; i++ ) {
+                bytes += pkts.peek( offsets[i], false )->get_size();
+            }
+            replay.on_sent( lane, bytes );
+        }
+        if ( is_fill ) {
+            linger_expired = false;
+            if ( lingering ) {
+                linger_timer.stop();
+                lingering = false;
+            }
+        }
+    }
+    arm_retry( now );
+}
+
+Upload_sink_stats_t Http_sink::get_stats( void ) const {
+    Upload_sink_stats_t current = pkts.get_stats();
+    current.started             = stats.started;
+    current.batched             = stats.batched;
+    current.in_flight           = stats.in_flight;
+    return current;
+}
+
+Sink_health_report_t Http_sink::get_health( void ) const {
+    return health.get_report();
+}
+
+size_t Http_sink::response_fcn( void* contents, size_t size, size_t nmemb, void* user_ptr ) {
+    Slot_t* slot    = (Slot_t*)user_ptr;
+    size_t realsize = size * nmemb;
+    size_t room     = response_max_len - 1 - slot->response_len;
+    size_t copy     = realsize < room ? realsize : room;
+
+    // Solo interesa el principio de la respuesta: la lista de fallidos de un 207
+    memcpy( &slot->response[slot->response_len], contents, copy );
+    slot->response_len += copy;
+    slot->response[slot->response_len] = '\0';
+    return realsize;
+}
+
+void Http_sink::on_linger( void* arg, uint32_t events ) {
+    (void)events;
+    Http_sink* sink = (Http_sink*)arg;
+    sink->linger_timer.consume();
+    sink->lingering      = false;
+    sink->linger_expired = true;
+    sink->pump();
+}
+
+void Http_sink::on_retry( void* arg, uint32_t events ) {
+    (void)events;
+    Http_sink* sink = (Http_sink*)arg;
+    sink->retry_timer.consume();
+    sink->pump();
+}
+
+uint32_t Http_sink::now_ms( void ) {
+    struct timespec now;
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    return (uint32_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+void Http_sink::done_fcn( void* arg, CURL* easy, CURLcode result ) {
+    (void)easy;
+    Slot_t* slot = (Slot_t*)arg;
+    slot->sink->on_done( *slot, result );
+}
+
+Http_sink::Slot_t* Http_sink::free_slot( void ) {
+    for ( uint8_t i = 0; i < window; i++ ) {
+        if ( !slots[i].busy ) {
+            return &slots[i];
+        }
+    }
+    return NULL;
+}
+
+uint8_t Http_sink::free_slots( void ) const {
+    uint8_t n = 0;
+    for ( uint8_t i = 0; i < window; i++ ) {
+        if ( !slots[i].busy ) {
+            n++;
+        }
+    }
+    return n;
+}
+
+bool Http_sink::pump_lane( uint32_t now ) {
+    uint16_t ids[Upload_batch::max_pkts];
+    for ( ;; ) {
+        uint8_t n = pkts.lane_due( ids, batch_pkts, now );
+        if ( n == 0 ) {
+            return true;
+        }
+        // Sin hueco o con el cortocircuito abierto se sigue al terminar una peticion o en retry_timer
+        if ( start_batch( ids, n, true, now ) == 0 ) {
+            return false;
+        }
+    }
+}
+
+void Http_sink::arm_retry( uint32_t now ) {
+    // Con el cortocircuito abierto nada puede salir antes de que termine la espera; los reintentos
+    // vencidos sin arrancar esperan a que termine una peticion
+    uint32_t wait = health.get_state() == breaker_open ? health.wait_ms( now ) : pkts.lane_wait_ms( now );
+    if ( wait == UINT32_MAX ) {
+        retry_timer.stop();
+    }
+    else {
+        retry_timer.start( wait );
+    }
+}
+
+uint8_t Http_sink::start_batch( const uint16_t* ids, uint8_t n, bool from_lane, uint32_t now ) {
+    Slot_t* slot = free_slot();
+    if ( slot == NULL || !health.allow( now ) ) {
+        return 0;
+    }
+
+    uint8_t n_pkts = 0;
+    uint16_t len   = 0;
+    if ( batch_pkts == 1 ) {
+        len    = comm.create_post_data( slot->body, batch_max_len, *pkts.peek( ids[0], from_lane ), mobile_id );
+        n_pkts = len > 0 ? 1 : 0;
+    }
+    else {
+        len = Upload_batch::begin( slot->body, batch_max_len, mobile_id );
+        for ( ; n_pkts < n && len > 0; n_pkts++ ) {
+            Pkt& pkt         = *pkts.peek( ids[n_pkts], from_lane );
+            uint16_t new_len = Upload_batch::append_pkt( slot->body, len, batch_max_len, pkt.bytes(), pkt.get_size(), comm.get_encoding() );
+            if ( new_len == 0 ) {
+                break;
+            }
+            len = new_len;
+        }
+    }
+    if ( n_pkts == 0 ) {
+        return 0;
+    }
+    comm.set_body( slot->easy, slot->body, len, slot->packed, sizeof( slot->packed ) );
+    curl_easy_setopt( slot->easy, CURLOPT_TIMEOUT_MS, (long)health.get_timeout_ms() );
+    if ( !engine->start( slot->easy, done_fcn, slot ) ) {
+        return 0;
+    }
+    slot->probe = health.get_state() == breaker_half_open;
+    health.on_start();
+
+    slot->busy         = true;
+    slot->fresh        = false;
+    slot->response_len = 0;
+    pkts.on_start( slot->batch, ids, n_pkts, from_lane );
+    stats.started++;
+    stats.batched += n_pkts;
+    stats.in_flight++;
+    return n_pkts;
+}
+
+bool Http_sink::retry_fresh( Slot_t& slot, CURLcode result ) {
+    if ( slot.fresh ) {
+        curl_easy_setopt( slot.easy, CURLOPT_FRESH_CONNECT, 0L );
+        slot.fresh = false;
+        return false;
+    }
+    long connects = 0;
+    curl_easy_getinfo( slot.easy, CURLINFO_NUM_CONNECTS, &connects );
+    if ( connects != 0 || !is_stale_connection( result ) ) {
+        return false;
+    }
+
+    // El cuerpo sigue fijado en el handle: se repite tal cual
+    curl_easy_setopt( slot.easy, CURLOPT_FRESH_CONNECT, 1L );
+    slot.response_len = 0;
+    if ( !engine->start( slot.easy, done_fcn, &slot ) ) {
+        curl_easy_setopt( slot.easy, CURLOPT_FRESH_CONNECT, 0L );
+        return false;
+    }
+    slot.fresh = true;
+    comm.record_retry();
+    return true;
+}
+
+void Http_sink::on_done( Slot_t& slot, CURLcode result ) {
+    if ( retry_fresh( slot, result ) ) {
+        return;
+    }
+
+    long response_code  = 0;
+    curl_off_t total_us = 0;
+    curl_easy_getinfo( slot.easy, CURLINFO_RESPONSE_CODE, &response_code );
+    curl_easy_getinfo( slot.easy, CURLINFO_TOTAL_TIME_T, &total_us );
+    bool ok = result == CURLE_OK && response_code >= 200 && response_code < 300;
+    comm.record_request( slot.easy, ok );
+    slot.busy = false;
+    stats.in_flight--;
+
+    // El destino falla si no responde o si esta saturado; un 4xx rechaza los pkts, no el destino
+    uint32_t now      = now_ms();
+    bool sink_failure = result != CURLE_OK || response_code >= 500 || response_code == 429;
+    // Un fallo del destino solo gasta intentos con el cortocircuito cerrado: durante un corte los
+    // pkts que ya fallaron una vez no se abandonan antes que los que siguen esperando en la cola
+    bool charge = !sink_failure || ( !slot.probe && health.get_state() == breaker_closed );
+    if ( sink_failure ) {
+        health.on_failure( now );
+    }
+    else {
+        health.on_success( (uint32_t)( total_us / 1000 ) );
+    }
+
+    // Un 207 acepta el lote salvo los pkts que lista como fallidos; si no se entiende, fallan todos
+    uint32_t failed_mask = ok ? 0 : UINT32_MAX;
+    if ( ok && response_code == 207 && !Upload_batch::parse_failed( slot.response, slot.response_len, slot.batch.n_pkts, failed_mask ) ) {
+        failed_mask = UINT32_MAX;
+    }
+    if ( pkts.complete( slot.batch, failed_mask, response_code, charge, health, now ) ) {
+        replay.finish( now );
+    }
+    pump();
+}
+
+void Http_sink::pop_done( void ) {
+    if ( pkts.pop_done() ) {
+        replay.finish( now_ms() );
+    }
+}
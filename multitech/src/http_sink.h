@@ -0,0 +1,201 @@
+#pragma once
+
+#include <stdint.h>
+#include <curl/curl.h>
+#include "pkt_log.h"
+#include "upload_sink.h"
+#include "upload_window.h"
+#include "comm_mgr.h"
+#include "upload_engine.h"
+#include "upload_batch.h"
+#include "event_loop.h"
+#include "timer_fd.h"
+#include "replay_scheduler.h"
+
+/**
+  \class Http_sink
+  \brief Destino de subida HTTP. Vacia su lector de un Pkt_log hacia una API HTTP con hasta window
+  peticiones en curso sobre un Upload_engine. Los pkts en curso siguen pendientes en el log y se
+  confirman, en orden, al terminar. Un pkt fallido pasa a una via de reintentos propia con esperas
+  exponenciales por pkt, de modo que ni un pkt envenenado ni sus reintentos frenan a los nuevos.
+  Sink_health abre el cortocircuito tras varios fallos seguidos del destino y adapta el timeout de
+  las peticiones a la latencia medida; las pruebas fallidas durante un corte no gastan intentos de
+  sus pkts. Con lotes (set_batch) cada peticion lleva varios pkts en formato Upload_batch; un lote
+  incompleto espera como mucho max_age_ms a llenarse. Tras un corte
+  (set_replay) lo acumulado se repone por una via propia en lotes llenos mientras los pkts nuevos
+  salen por otra, repartiendo el envio con Replay_scheduler. Las posiciones, la via de reintentos y
+  los resultados de cada pkt se llevan en un Upload_window. Solo se usa desde el thread del bucle
+*/
+class Http_sink : public Upload_sink<Pkt> {
+
+    public:
+
+        static const uint8_t max_window = Upload_window<Pkt>::max_batches;
+        static const uint16_t batch_max_len = 4096;    ///< Cuerpo maximo de una peticion
+
+        /**
+          \brief Constructor de la clase
+          \param queue_0 Lector del log de pkts a subir
+          \param comm_0 Destino: url, cabeceras, formato del cuerpo y estadisticas de peticion
+          \param mobile_id_0 Identificador del gateway para el cuerpo de la peticion
+          \param window_0 Peticiones en curso maximas, de 1 a max_window
+          \param seed Semilla del jitter de los reintentos, distinta por destino
+        */
+        Http_sink( Pkt_log_reader<Pkt>& queue_0, Comm_mgr& comm_0, const char* mobile_id_0, uint8_t window_0, uint32_t seed );
+
+        /**
+          \brief Destructor de la clase
+        */
+        ~Http_sink();
+
+        /**
+          \brief Crea los handles persistentes, uno por peticion de la ventana
+          \param engine_0 Motor de transferencias
+          \param loop Bucle de eventos en el que se registran las esperas de los lotes y de los reintentos
+          \return Error de inicializacion
+        */
+        bool init( Upload_engine& engine_0, Event_loop& loop );
+
+        /**
+          \brief Activa los lotes. Con max_pkts 1 (por defecto) cada pkt va solo en el formato de Comm_mgr.
+          Solo hay lotes si Comm_mgr indica que el destino los acepta y no usa pkt_encoding_raw: fijar
+          ambas cosas antes
+          \param max_pkts Pkts maximos por peticion, de 1 a Upload_batch::max_pkts
+          \param max_age_ms Espera maxima de un lote incompleto [ms]
+        */
+        void set_batch( uint8_t max_pkts, uint32_t max_age_ms ) override;
+
+        /**
+          \brief Fija las esperas de reintento, del destino y de cada pkt, y los intentos por pkt
+          \param base_ms Primera espera [ms]
+          \param max_ms Espera maxima [ms]
+          \param max_attempts Fallos de un pkt con el cortocircuito cerrado antes de abandonarlo
+        */
+        void set_retry( uint32_t base_ms, uint32_t max_ms, uint8_t max_attempts ) override;
+
+        /**
+          \brief Fija el callback de pkts terminados. Sin callback los fallidos se reintentan
+        */
+        void set_result_cb( Upload_result_cb_t<Pkt> cb, void* arg ) override;
+
+        /**
+          \brief Activa la reposicion de atrasos. Con min_pkts o mas pkts sin enviar, los pendientes
+          pasan a la via del atraso y salen en lotes de Upload_batch::max_pkts sin esperar, dejando
+          siempre un hueco de la ventana libre para los nuevos, que salen por su via con set_batch
+          \param min_pkts Pkts sin enviar que marcan un atraso, 0 para no separar nunca las vias
+          \param live_pct Cuota de los nuevos cuando las dos vias tienen pkts [%]
+        */
+        void set_replay( uint16_t min_pkts, uint8_t live_pct );
+
+        /**
+          \brief Devuelve el progreso de la reposicion en curso o de la ultima
+        */
+        Replay_report_t get_replay( void ) const;
+
+        /**
+          \brief Arranca peticiones para los reintentos vencidos y para los pkts nuevos de la cola
+          mientras quepan en la ventana y el cortocircuito lo permita
+        */
+        void pump( void ) override;
+
+        /**
+          \brief Devuelve las estadisticas del destino
+        */
+        Upload_sink_stats_t get_stats( void ) const override;
+
+        /**
+          \brief Devuelve la salud del destino
+        */
+        Sink_health_report_t get_health( void ) const override;
+
+    private:
+
+        static const uint16_t response_max_len = 256;
+
+        typedef struct {
+            Http_sink* sink;
+            CURL* easy;                 ///< Handle persistente del hueco
+            bool busy;
+            bool from_lane;             ///< Pkts de la via de reintentos
+            bool fresh;                 ///< Repeticion por una conexion nueva en curso
+            bool probe;                 ///< Peticion de prueba del cortocircuito semiabierto
+            Upload_window_batch_t batch;
+            char body[batch_max_len];
+            uint8_t packed[batch_max_len];          ///< Cuerpo comprimido, si el destino lo acepta
+            char response[response_max_len];
+            uint16_t response_len;
+        } Slot_t;
+
+        static void done_fcn( void* arg, CURL* easy, CURLcode result );
+        static size_t response_fcn( void* contents, size_t size, size_t nmemb, void* user_ptr );
+        static void on_linger( void* arg, uint32_t events );
+        static void on_retry( void* arg, uint32_t events );
+        static uint32_t now_ms( void );
+
+        /**
+          \brief Hueco libre de la ventana
+          \return NULL si todos estan en curso
+        */
+        Slot_t* free_slot( void );
+
+        /**
+          \brief Arranca una peticion con los pkts dados de la cola o de la via de reintentos
+          \param ids Posiciones en la cola o entradas de la via
+          \param n Numero de pkts
+          \param from_lane true si son entradas de la via
+          \param now Instante actual [ms]
+          \return Pkts incluidos en la peticion, 0 si no se pudo arrancar
+        */
+        uint8_t start_batch( const uint16_t* ids, uint8_t n, bool from_lane, uint32_t now );
+
+        /**
+          \brief Arranca los reenvios vencidos de la via
+          \return false si quedan vencidos sin arrancar
+        */
+        bool pump_lane( uint32_t now );
+
+        /**
+          \brief Arma retry_timer para el fin de la espera del cortocircuito o del siguiente reintento
+        */
+        void arm_retry( uint32_t now );
+
+        /**
+          \brief Huecos libres de la ventana
+        */
+        uint8_t free_slots( void ) const;
+
+        /**
+          \brief Repite una vez por una conexion nueva la peticion que fallo al reutilizar una conexion
+          que el servidor o el NAT ya habian cerrado: no llego a procesarse y no es un fallo del destino
+          \return true si la peticion se ha vuelto a arrancar
+        */
+        bool retry_fresh( Slot_t& slot, CURLcode result );
+
+        /**
+          \brief Procesa una peticion terminada
+        */
+        void on_done( Slot_t& slot, CURLcode result );
+
+        /**
+          \brief Saca de la cola los pkts terminados contiguos desde la cabeza y cierra la reposicion
+          si ha terminado el atraso
+        */
+        void pop_done( void );
+
+        Upload_window<Pkt> pkts;
+        Comm_mgr& comm;
+        const char* mobile_id;
+        uint8_t window;
+        Upload_engine* engine;
+        uint8_t batch_pkts;
+        uint32_t batch_age_ms;
+        Timer_fd linger_timer;              ///< Espera de un lote incompleto
+        bool lingering;                     ///< linger_timer armado
+        bool linger_expired;                ///< El lote incompleto ya espero batch_age_ms
+        Timer_fd retry_timer;               ///< Fin de la espera del cortocircuito o del siguiente reintento
+        Sink_health health;
+        Slot_t slots[max_window];
+        uint16_t replay_min_pkts;
+        Replay_scheduler replay;
+        Upload_sink_stats_t stats;          ///< Peticiones; los resultados de los pkts los lleva pkts
+};
@@ -0,0 +1,142 @@
+#include "link_stats.h"
+#include <string.h>
+
+Link_stats::Link_stats() {
+    memset( devices, 0, sizeof( devices ) );
+    pthread_mutex_init( &lock, NULL );
+}
+
+Link_stats::~Link_stats() {
+    pthread_mutex_destroy( &lock );
+}
+
+int16_t Link_stats::required_lsnr( uint8_t sf ) {
+    // SF7 -7.5 dB ... SF12 -20 dB, 2.5 dB por SF
+    if ( sf < 7 || sf > 12 ) {
+        return 0;
+    }
+    return -75 - ( sf - 7 ) * 25;
+}
+
+Link_stats::Device_link_t* Link_stats::lookup( const char* eui, uint8_t eui_len, bool create ) {
+    if ( eui_len > Lora_uplink_parser::prefix_max_len ) {
+        return NULL;
+    }
+
+    uint32_t hash = 2166136261UL;
+    for ( uint8_t i = 0; i < eui_len; i++ ) {
+        hash = ( hash ^ (uint8_t)eui[i] ) * 16777619UL;
+    }
+
+    uint16_t start  = hash % max_devices;
+    uint16_t oldest = start;
+    for ( uint16_t i = 0; i < max_devices; i++ ) {
+        uint16_t pos          = ( start + i ) % max_devices;
+        Device_link_t& device = devices[pos];
+        if ( device.used && strncmp( device.eui, eui, eui_len ) == 0 && device.eui[eui_len] == '\0' ) {
+            return &device;
+        }
+        if ( !device.used ) {
+            oldest = pos;
+            break;
+        }
+        if ( device.last_seen_s < devices[oldest].last_seen_s ) {
+            oldest = pos;
+        }
+    }
+    if ( !create ) {
+        return NULL;
+    }
+
+    Device_link_t& device = devices[oldest];
+    memset( &device, 0, sizeof( device ) );
+    memcpy( device.eui, eui, eui_len );
+    device.used = true;
+    return &device;
+}
+
+bool Link_stats::update( const char* eui, uint8_t eui_len, const Lora_radio_t& radio, const Lora_modulation_t& modulation, uint32_t now_s ) {
+    if ( !radio.valid ) {
+        return false;
+    }
+
+    pthread_mutex_lock( &lock );
+    Device_link_t* device = lookup( eui, eui_len, true );
+    if ( device != NULL ) {
+        Link_sample_t& sample = device->samples[device->head];
+        sample.time_s         = now_s;
+        sample.rssi           = radio.rssi;
+        sample.lsnr           = radio.lsnr;
+        sample.sf             = modulation.sf;
+        device->head          = ( device->head + 1 ) % ring_len;
+        if ( device->count < ring_len ) {
+            device->count++;
+        }
+        device->uplinks++;
+        device->last_seen_s = now_s;
+    }
+    pthread_mutex_unlock( &lock );
+    return device != NULL;
+}
+
+void Link_stats::summarize( const Device_link_t& device, Link_device_report_t& report ) {
+    memset( &report, 0, sizeof( report ) );
+    memcpy( report.eui, device.eui, sizeof( report.eui ) );
+    report.uplinks     = device.uplinks;
+    report.last_seen_s = device.last_seen_s;
+    report.samples     = device.count;
+    if ( device.count == 0 ) {
+        return;
+    }
+
+    int32_t rssi_sum = 0;
+    int32_t lsnr_sum = 0;
+    report.lsnr_min  = INT16_MAX;
+    report.lsnr_max  = INT16_MIN;
+    for ( uint8_t i = 0; i < device.count; i++ ) {
+        const Link_sample_t& sample = device.samples[i];
+        rssi_sum += sample.rssi;
+        lsnr_sum += sample.lsnr;
+        if ( sample.lsnr < report.lsnr_min ) {
+            report.lsnr_min = sample.lsnr;
+        }
+        if ( sample.lsnr > report.lsnr_max ) {
+            report.lsnr_max = sample.lsnr;
+        }
+    }
+    report.rssi_avg = rssi_sum / device.count;
+    report.lsnr_avg = lsnr_sum / device.count;
+    report.sf       = device.samples[( device.head + ring_len - 1 ) % ring_len].sf;
+
+    // Criterio ADR: cada 3 dB de margen sobre el minimo del SF actual permite bajar un SF
+    report.suggested_sf = report.sf;
+    if ( report.sf >= 7 && report.sf <= 12 ) {
+        int16_t margin = report.lsnr_max - required_lsnr( report.sf ) - install_margin;
+        while ( margin >= 30 && report.suggested_sf > 7 ) {
+            report.suggested_sf--;
+            margin -= 30;
+        }
+    }
+}
+
+bool Link_stats::get_device( const char* eui, Link_device_report_t& report ) {
+    pthread_mutex_lock( &lock );
+    Device_link_t* device = lookup( eui, strlen( eui ), false );
+    if ( device != NULL ) {
+        summarize( *device, report );
+    }
+    pthread_mutex_unlock( &lock );
+    return device != NULL;
+}
+
+uint16_t Link_stats::get_devices( Link_device_report_t* reports, uint16_t max_reports ) {
+    uint16_t n = 0;
+    pthread_mutex_lock( &lock );
+    for ( uint16_t i = 0; i < max_devices && n < max_reports; i++ ) {
+        if ( devices[i].used ) {
+            summarize( devices[i], reports[n++] );
+        }
+    }
+    pthread_mutex_unlock( &lock );
+    return n;
+}
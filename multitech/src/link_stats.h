@@ -0,0 +1,113 @@
+#pragma once
+
+#include <stdint.h>
+#include "pthread.h"
+#include "lora_uplink_parser.h"
+
+/**
+  \brief Resumen de la calidad de enlace de un dispositivo sobre sus ultimas subidas
+*/
+typedef struct {
+    char eui[Lora_uplink_parser::prefix_max_len + 1];     ///< DevEUI tal como llega en el prefijo
+    uint32_t uplinks;           ///< Subidas recibidas desde que se registro el dispositivo
+    uint32_t last_seen_s;       ///< Instante de la ultima subida
+    uint8_t samples;            ///< Subidas usadas en el resumen
+    int16_t rssi_avg;           ///< RSSI medio [dBm]
+    int16_t lsnr_avg;           ///< SNR medio [0.1 dB]
+    int16_t lsnr_min;           ///< SNR minimo [0.1 dB]
+    int16_t lsnr_max;           ///< SNR maximo [0.1 dB]
+    uint8_t sf;                 ///< SF de la ultima subida, 0 si se desconoce
+    uint8_t suggested_sf;       ///< SF mas rapido con margen suficiente segun el SNR maximo
+} Link_device_report_t;
+
+/**
+  \class Link_stats
+  \brief Tabla por dispositivo con las ultimas subidas (RSSI, SNR y SF) para decidir que
+  dispositivos pueden pasar a un data rate mas rapido. La sugerencia de SF sigue el criterio
+  del ADR de LoRaWAN: margen = SNR maximo - SNR minimo demodulable del SF - margen de instalacion,
+  y se baja un SF por cada 3 dB de margen. Segura entre threads
+*/
+class Link_stats {
+
+    public:
+
+        static const uint8_t ring_len           = 16;     ///< Subidas recordadas por dispositivo
+        static const uint16_t max_devices       = 256;
+        static const int16_t install_margin     = 100;    ///< Margen de instalacion [0.1 dB]
+
+        /**
+          \brief Constructor de la clase
+        */
+        Link_stats();
+
+        /**
+          \brief Destructor de la clase
+        */
+        ~Link_stats();
+
+        /**
+          \brief Registra una subida
+          \param eui DevEUI, no necesita '\0'
+          \param eui_len Longitud del DevEUI
+          \param radio Metadatos de radio de la subida
+          \param modulation Modulacion de la subida
+          \param now_s Instante actual [s]
+          \return false si los metadatos no son validos
+        */
+        bool update( const char* eui, uint8_t eui_len, const Lora_radio_t& radio, const Lora_modulation_t& modulation, uint32_t now_s );
+
+        /**
+          \brief Resumen de un dispositivo
+          \param eui DevEUI terminado en '\0'
+          \param report Resumen de salida
+          \return false si el dispositivo no esta en la tabla
+        */
+        bool get_device( const char* eui, Link_device_report_t& report );
+
+        /**
+          \brief Resumen de todos los dispositivos de la tabla
+          \param reports Array de salida
+          \param max_reports Tamanyo del array
+          \return Numero de resumenes escritos
+        */
+        uint16_t get_devices( Link_device_report_t* reports, uint16_t max_reports );
+
+        /**
+          \brief SNR minimo demodulable de un SF [0.1 dB]
+          \param sf Spreading factor (7..12)
+        */
+        static int16_t required_lsnr( uint8_t sf );
+
+    private:
+
+        typedef struct {
+            uint32_t time_s;
+            int16_t rssi;
+            int16_t lsnr;
+            uint8_t sf;
+        } Link_sample_t;
+
+        typedef struct {
+            char eui[Lora_uplink_parser::prefix_max_len + 1];
+            uint32_t uplinks;
+            uint32_t last_seen_s;
+            uint8_t head;                       ///< Siguiente muestra a escribir
+            uint8_t count;
+            Link_sample_t samples[ring_len];
+            bool used;
+        } Device_link_t;
+
+        /**
+          \brief Busca un dispositivo. Con create lo registra, reemplazando el menos reciente si no hay sitio
+          \return NULL si no existe y no se crea
+        */
+        Device_link_t* lookup( const char* eui, uint8_t eui_len, bool create );
+
+        /**
+          \brief Rellena el resumen de un dispositivo
+        */
+        void summarize( const Device_link_t& device, Link_device_report_t& report );
+
+        pthread_mutex_t lock;
+        Device_link_t devices[max_devices];
+};
@@ -0,0 +1,62 @@
+#include "lora_airtime.h"
+
+// Lee un entero decimal sin signo y avanza el cursor
+static bool read_uint( const char*& p, const char* end, uint16_t& value ) {
+    const char* start = p;
+    value             = 0;
+    while ( p < end && *p >= '0' && *p <= '9' ) {
+        value = value * 10 + ( *p - '0' );
+        p++;
+    }
+    return p != start;
+}
+
+bool Lora_airtime::parse_datr( const char* datr, size_t len, Lora_modulation_t& modulation ) {
+    const char* p   = datr;
+    const char* end = datr + len;
+    uint16_t sf;
+    uint16_t bw;
+
+    if ( len < 7 || p[0] != 'S' || p[1] != 'F' ) {
+        return false;
+    }
+    p += 2;
+    if ( !read_uint( p, end, sf ) || end - p < 3 || p[0] != 'B' || p[1] != 'W' ) {
+        return false;
+    }
+    p += 2;
+    if ( !read_uint( p, end, bw ) || sf < 6 || sf > 12 || ( bw != 125 && bw != 250 && bw != 500 ) ) {
+        return false;
+    }
+
+    modulation.sf     = sf;
+    modulation.bw_khz = bw;
+    return true;
+}
+
+bool Lora_airtime::parse_codr( const char* codr, size_t len, Lora_modulation_t& modulation ) {
+    if ( len != 3 || codr[0] != '4' || codr[1] != '/' || codr[2] < '5' || codr[2] > '8' ) {
+        return false;
+    }
+    modulation.cr = codr[2] - '4';
+    return true;
+}
+
+uint32_t Lora_airtime::time_on_air_us( const Lora_modulation_t& modulation, uint16_t phy_len, bool crc ) {
+    if ( modulation.sf < 6 || modulation.sf > 12 || modulation.bw_khz == 0 ) {
+        return 0;
+    }
+
+    uint8_t cr = ( modulation.cr >= 1 && modulation.cr <= 4 ) ? modulation.cr : 1;
+    // Optimizacion de data rate bajo obligatoria con simbolos de mas de 16 ms
+    uint8_t de       = ( modulation.sf >= 11 && modulation.bw_khz == 125 ) ? 1 : 0;
+    uint32_t tsym_us = ( ( 1UL << modulation.sf ) * 1000UL ) / modulation.bw_khz;
+
+    int32_t num     = 8 * (int32_t)phy_len - 4 * modulation.sf + 28 + ( crc ? 16 : 0 );
+    int32_t den     = 4 * ( modulation.sf - 2 * de );
+    int32_t blocks  = num > 0 ? ( num + den - 1 ) / den : 0;
+    uint32_t n_symb = 8 + blocks * ( cr + 4 );
+
+    // Preambulo de ( n + 4.25 ) simbolos
+    return ( tsym_us * ( 4UL * preamble_symbols + 17 ) ) / 4 + n_symb * tsym_us;
+}
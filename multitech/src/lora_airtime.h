@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+  \brief Parametros de modulacion LoRa de una trama
+*/
+typedef struct {
+    uint8_t sf;             ///< Spreading factor (7..12), 0 si se desconoce
+    uint16_t bw_khz;        ///< Ancho de banda [kHz]
+    uint8_t cr;             ///< Coding rate 4/(4+cr), cr de 1 a 4
+} Lora_modulation_t;
+
+/**
+  \class Lora_airtime
+  \brief Calculo del tiempo en el aire de una trama LoRa (formula de la nota AN1200.13 de Semtech)
+*/
+class Lora_airtime {
+
+    public:
+
+        static const uint8_t lorawan_overhead = 13;     ///< MHDR + FHDR sin FOpts + FPort + MIC [bytes]
+        static const uint8_t preamble_symbols = 8;      ///< Preambulo de LoRaWAN
+
+        /**
+          \brief Interpreta el campo "datr" del network server, p.ej. "SF9BW125"
+          \param datr Inicio del texto, no necesita '\0'
+          \param len Longitud del texto
+          \param modulation Se rellenan sf y bw_khz
+          \return Resultado de la interpretacion
+        */
+        static bool parse_datr( const char* datr, size_t len, Lora_modulation_t& modulation );
+
+        /**
+          \brief Interpreta el campo "codr" del network server, p.ej. "4/5"
+          \param codr Inicio del texto, no necesita '\0'
+          \param len Longitud del texto
+          \param modulation Se rellena cr
+          \return Resultado de la interpretacion
+        */
+        static bool parse_codr( const char* codr, size_t len, Lora_modulation_t& modulation );
+
+        /**
+          \brief Tiempo en el aire de una trama con cabecera explicita
+          \param modulation Parametros de modulacion
+          \param phy_len Longitud del PHYPayload [bytes]
+          \param crc true en subidas (CRC de payload activo), false en bajadas
+          \return Tiempo en el aire [us], 0 si la modulacion no es valida
+        */
+        static uint32_t time_on_air_us( const Lora_modulation_t& modulation, uint16_t phy_len, bool crc );
+};
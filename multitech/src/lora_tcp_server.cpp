@@ -14,6 +14,7 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <signal.h>     // sigint
+#include <sys/epoll.h>
 #include "log.h"
 
 static void die( const char* msg ) {
@@ -23,14 +24,38 @@ static void die( const char* msg ) {
     exit( EXIT_FAILURE );
 }
 
-Lora_tcp_server::Lora_tcp_server( Fifo_pkt& fifo_lora_input_0, uint16_t max_pkt_size_0 ):
-    fifo_lora_input( fifo_lora_input_0 ),
-    max_pkt_size( max_pkt_size_0 ) {
+Lora_tcp_server::Lora_tcp_server( Pkt_ring& lora_input_0, uint16_t max_pkt_size_0, uint16_t max_connections_0 ):
+    lora_input( lora_input_0 ),
+    max_pkt_size( max_pkt_size_0 ),
+    listen_sd( -1 ),
+    epoll_fd( -1 ),
+    max_connections( max_connections_0 > 0 ? max_connections_0 : 1 ),
+    idle_wheel( max_time_no_comm + 4, now_s() ),
+    pkt( max_pkt_size_0 ),
+    admission( NULL ) {
+    layout           = Pkt_framer::layout_of( pkt, pkt_sync_lossy, pkt_sync_no_lossy );
+    connections      = new Connection_t[max_connections];
+    free_connections = new uint16_t[max_connections];
+    for ( uint16_t i = 0; i < max_connections; i++ ) {
+        connections[i].fd     = -1;
+        connections[i].framer = NULL;
+        Timer_wheel::init_node( connections[i].timer, &connections[i] );
+        free_connections[i] = max_connections - 1 - i;
+    }
+    n_free = max_connections;
+    memset( &stats, 0, sizeof( stats ) );
 }
 
 Lora_tcp_server::~Lora_tcp_server() {
-    pthread_mutex_destroy( &fifo_lock );
-    close( fds[0].fd );
+    for ( uint16_t i = 0; i < max_connections; i++ ) {
+        if ( connections[i].fd != -1 ) {
+            close_connection( connections[i] );
+        }
+    }
+    delete[] connections;
+    delete[] free_connections;
+    close( listen_sd );
+    close( epoll_fd );
 }
 
 int8_t Lora_tcp_server::init( char* tcp_port ) {
@@ -88,24 +113,30 @@ int8_t Lora_tcp_server::init( char* tcp_port ) {
 
     // Habilita el socket binded para aceptar conexiones entrantes
     // INFO: http://man7.org/linux/man-pages/man2/listen.2.html
-    if ( -1 == ( listen( listen_sd, 32 ) ) ) {
+    if ( -1 == ( listen( listen_sd, listen_backlog ) ) ) {
         die( "listen()" );
     }
 
     // Fija la condicion de nonblock al socket
     // NOTA: se podria poner async y usar signals
     // INFO: http://man7.org/linux/man-pages/man2/fcntl.2.html
-    if ( -1 == ( fcntl( listen_sd, F_SETFD, O_NONBLOCK ) ) ) {
+    // O_NONBLOCK es un flag de estado del fichero: F_SETFL, no F_SETFD
+    int flags = fcntl( listen_sd, F_GETFL, 0 );
+    if ( -1 == flags || -1 == ( fcntl( listen_sd, F_SETFL, flags | O_NONBLOCK ) ) ) {
         die( "fcntl()" );
     }
 
-    memset( fds, 0, sizeof( fds ) );
-    fds[0].fd = listen_sd;
-    fds[0].events = POLLIN;
-
-    if ( pthread_mutex_init( &fifo_lock, NULL ) != 0 ) {
-        printf( "Mutex init failed\n" );
-        return 0;
+    // El socket de escucha se registra con ptr NULL, las conexiones con su Connection_t
+    epoll_fd = epoll_create1( 0 );
+    if ( epoll_fd == -1 ) {
+        die( "epoll_create1()" );
+    }
+    struct epoll_event event;
+    memset( &event, 0, sizeof( event ) );
+    event.events   = EPOLLIN;
+    event.data.ptr = NULL;
+    if ( -1 == epoll_ctl( epoll_fd, EPOLL_CTL_ADD, listen_sd, &event ) ) {
+        die( "epoll_ctl()" );
     }
 
     if ( pthread_create( &lora_server_thread, NULL, thread_fcn, ( void* )this ) ) {
@@ -118,98 +149,139 @@ int8_t Lora_tcp_server::init( char* tcp_port ) {
 }
 
 void Lora_tcp_server::run( void ) {
+    struct epoll_event events[max_events];
 
-    while( 1 ) {
+    while ( 1 ) {
+        int nready = epoll_wait( epoll_fd, events, max_events, timeout );
+        uint32_t now = now_s();
 
-        socklen_t addr_len;           // Longitud del address
-        struct sockaddr_storage addr; // Estructura con info del address
-        int news;                     // Descriptor nuevo socket
+        for ( int i = 0; i < nready; i++ ) {
+            Connection_t* connection = (Connection_t*)events[i].data.ptr;
+            if ( connection == NULL ) {
+                accept_connections();
+            }
+            else if ( events[i].events & ( EPOLLIN | EPOLLERR | EPOLLHUP ) ) {
+                receive( *connection, now );
+            }
+        }
 
-        constexpr int max_len = 1024;
-        uint8_t data[max_pkt_size];
-        Pkt pkt( max_pkt_size );
+        idle_wheel.advance( now, on_idle, this );
+    }
+}
 
-        addr_len = sizeof( addr );
-        // printf( "Waiting for connection...\n", listen_sd );
-        news = accept( listen_sd, ( struct sockaddr* )&addr, &addr_len );
+void Lora_tcp_server::accept_connections( void ) {
+    while ( 1 ) {
+        struct sockaddr_storage addr; // Estructura con info del address
+        socklen_t addr_len = sizeof( addr );
+        int news           = accept4( listen_sd, (struct sockaddr*)&addr, &addr_len, SOCK_NONBLOCK );
 
-        if ( -1 == news  ) {
-            if ( EWOULDBLOCK != errno ) {
-                die( "accept()" );
+        if ( -1 == news ) {
+            if ( EWOULDBLOCK != errno && EAGAIN != errno && EINTR != errno && ECONNABORTED != errno ) {
+                log( (uint32_t)0, "LoRa TCP accept error %i\n", errno );
             }
+            return;
         }
-        else {
-            // printf( "Open connection fd %d\n", listen_sd );
-            struct pollfd fds_client;
-            fds_client.fd = news; // your socket handler
-            fds_client.events = POLLIN;
-            struct timespec now;
-            struct timespec last_recv;
-
-            while ( 1 ) {
-
-                // Polling
-                int nready = poll( &fds_client, 1, timeout );
-
-                if ( clock_gettime( CLOCK_REALTIME, &now ) == -1 ) {
-                    // printf( "Error de reloj interno" );
-                    break;
-                }
-
-                if ( nready < 0  ) {
-                    // printf( "Error poll\n" );
-                    break;
-                }
-                else if ( nready == 0 ) {
-                }
-                else {
-
-                    if ( fds_client.revents & POLLIN ) {
-                        fds_client.revents &= ~POLLIN;
-
-                        int read = recv( fds_client.fd, data, max_len, 0 );
-
-                        if ( !read ) {
-                            // printf( "Cnnection closed\n" );
-                            break;
-                        }
-                        if ( read < 0 ) {
-                            // printf( "Client close connection\n" );
-                            break;
-                        }
-                        if ( read > 0 ) {
-                            for ( uint_fast16_t i = 0; i < read; i++ ) {
-                                if ( pkt.parse( data[i] ) ) {
-                                    pthread_mutex_lock( &fifo_lock );
-                                    fifo_lora_input.put_pkt( pkt );
-                                    pthread_mutex_unlock( &fifo_lock );
-                                }
-                            }
-                            last_recv = now;
-                        }
-                    }
-
-                    if ( fds_client.revents & POLLOUT ) {
-                        fds_client.revents &= ~POLLOUT;
-                        // printf( "pollout\n" );
-                    }
-                    if ( fds_client.revents ) {
-                        // printf( "revents %u\n", fds[0].revents );
-                        continue;                               // Evento, pero no de lectura
-                    }
-                }
-
-                // Compruebo tiempo transcurrido desde ultima recepcion
-                if ( now.tv_sec - last_recv.tv_sec > max_time_no_comm ) {
-                    // printf( "Timeout, connection closed\n" );
-                    close( news );
-                    break;
-                }
-            }
+
+        // En el maximo se cierra en el acto: el cliente reintenta en vez de esperar en el backlog
+        if ( n_free == 0 ) {
+            close( news );
+            stats.rejected++;
+            continue;
         }
 
+        Connection_t& connection = connections[free_connections[--n_free]];
+        connection.fd            = news;
+        connection.framer        = new Pkt_framer( layout, Pkt_framer::check_with_pkt<Pkt>, &pkt );
+        connection.last_recv_s   = now_s();
+
+        stats.accepted++;
+        stats.active++;
+        if ( stats.active > stats.max_active ) {
+            stats.max_active = stats.active;
+        }
+
+        struct epoll_event event;
+        memset( &event, 0, sizeof( event ) );
+        event.events   = EPOLLIN;
+        event.data.ptr = &connection;
+        if ( -1 == epoll_ctl( epoll_fd, EPOLL_CTL_ADD, news, &event ) ) {
+            stats.closed_peer++;
+            close_connection( connection );
+            continue;
+        }
+        idle_wheel.schedule( connection.timer, connection.last_recv_s + max_time_no_comm );
     }
+}
+
+void Lora_tcp_server::receive( Connection_t& connection, uint32_t now_s ) {
+    int read = recv( connection.fd, data, max_len, 0 );
+
+    if ( read == 0 || ( read < 0 && EWOULDBLOCK != errno && EAGAIN != errno && EINTR != errno ) ) {
+        stats.closed_peer++;
+        close_connection( connection );
+        return;
+    }
+
+    // Solo se anota el instante; la rueda revisa la conexion cuando vence su timeout
+    if ( read > 0 ) {
+        connection.framer->feed( data, read, on_frame, this );
+        connection.last_recv_s = now_s;
+    }
+}
+
+void Lora_tcp_server::on_frame( const uint8_t* bytes, uint16_t len, void* server_void_ptr ) {
+    Lora_tcp_server* server = (Lora_tcp_server*)server_void_ptr;
+    server->stats.pkts++;
+    bool pushed;
+    if ( server->admission == NULL ) {
+        pushed = server->lora_input.try_push( bytes, len );
+    }
+    else {
+        pushed = server->admission->offer( server->lora_input, server->pkt.hdr->src, server->pkt.hdr->cmd, bytes, len, Pkt_admission::now_ms() ) == admission_accepted;
+    }
+    if ( !pushed ) {
+        server->stats.push_drops++;
+    }
+}
+
+void Lora_tcp_server::set_admission( Pkt_admission* admission_0 ) {
+    admission = admission_0;
+}
+
+void Lora_tcp_server::close_connection( Connection_t& connection ) {
+    idle_wheel.cancel( connection.timer );
+    // Cerrar el descriptor lo saca tambien de epoll
+    close( connection.fd );
+    connection.fd = -1;
+    delete connection.framer;
+    connection.framer = NULL;
+
+    free_connections[n_free++] = &connection - connections;
+    stats.active--;
+}
+
+void Lora_tcp_server::on_idle( Timer_node_t& node, void* arg ) {
+    Lora_tcp_server* server  = (Lora_tcp_server*)arg;
+    Connection_t& connection = *(Connection_t*)node.owner;
+    uint32_t deadline        = connection.last_recv_s + max_time_no_comm;
+
+    if ( (int32_t)( deadline - server->now_s() ) > 0 ) {
+        server->idle_wheel.schedule( node, deadline );
+    }
+    else {
+        server->stats.closed_idle++;
+        server->close_connection( connection );
+    }
+}
+
+uint32_t Lora_tcp_server::now_s( void ) {
+    struct timespec now;
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    return now.tv_sec;
+}
 
+Lora_tcp_stats_t Lora_tcp_server::get_stats( void ) const {
+    return stats;
 }
 
 void* Lora_tcp_server::thread_fcn( void* Lora_tcp_server_void_ptr ) {
@@ -2,21 +2,46 @@
 
 #include "stdint.h"   // Tipos uint8_t etc
 #include <netdb.h>    // addrinfo
-#include <sys/poll.h> // poll
-#include <list>
 #include "pthread.h"
-#include "fifo_pkt.h"
+#include "pkt.h"
+#include "pkt_ring.h"
+#include "timer_wheel.h"
+#include "pkt_framer.h"
+#include "pkt_admission.h"
 
+/**
+  \brief Estadisticas del servidor TCP
+*/
+typedef struct {
+    uint32_t accepted;          ///< Conexiones aceptadas
+    uint32_t rejected;          ///< Conexiones cerradas al llegar por estar en el maximo
+    uint32_t closed_peer;       ///< Conexiones cerradas por el cliente o por error
+    uint32_t closed_idle;       ///< Conexiones cerradas por inactividad
+    uint32_t active;            ///< Conexiones abiertas
+    uint32_t max_active;        ///< Maximo de conexiones abiertas a la vez
+    uint32_t pkts;              ///< Pkts recibidos
+    uint32_t push_drops;        ///< Pkts no encolados por cola llena o por el control de admision
+} Lora_tcp_stats_t;
+
+/**
+  \class Lora_tcp_server
+  \brief Servidor TCP de subidas con un bucle epoll propio que atiende muchas conexiones a la vez.
+  Cada conexion tiene su propio Pkt_framer, que arrastra los pkts cortados entre lecturas, y se cierra tras max_time_no_comm
+  segundos sin datos, con los timeouts gestionados por una rueda de tiempos
+*/
 class Lora_tcp_server {
 
     public:
 
+        static const uint16_t default_max_connections = 4096;
+
         /**
           \brief Constructor de la clase
-          \param fifo_lora_input_0 Pila para almacenar pkt's
+          \param lora_input_0 Cola para almacenar pkt's
           \param max_pkt_size_0 Longitud maxima del pkt
+          \param max_connections_0 Conexiones simultaneas maximas
         */
-        Lora_tcp_server( Fifo_pkt& fifo_lora_input_0, uint16_t max_pkt_size_0 );
+        Lora_tcp_server( Pkt_ring& lora_input_0, uint16_t max_pkt_size_0, uint16_t max_connections_0 = default_max_connections );
 
         /**
           \brief Destructor de la clase
@@ -35,6 +60,17 @@ class Lora_tcp_server {
         */
         void run( void );
 
+        /**
+          \brief Fija el control de admision de la cola de ingesta. Llamar antes de init
+          \param admission_0 Control de admision, NULL encola sin control
+        */
+        void set_admission( Pkt_admission* admission_0 );
+
+        /**
+          \brief Devuelve las estadisticas (copia sin bloqueo, aproximada)
+        */
+        Lora_tcp_stats_t get_stats( void ) const;
+
         /**
           \brief Funcion estatica callback del thread
           \param Lora_tcp_server_void_ptr puntero al objeto que crea el thread
@@ -44,15 +80,70 @@ class Lora_tcp_server {
 
     private:
 
-        Fifo_pkt& fifo_lora_input;
+        typedef struct {
+            int fd;                         ///< -1 si la conexion esta libre
+            Pkt_framer* framer;             ///< Estado de delimitacion propio de la conexion
+            uint32_t last_recv_s;           ///< Ultima recepcion de datos
+            Timer_node_t timer;             ///< Timeout de inactividad
+        } Connection_t;
+
+        Pkt_ring& lora_input;                             ///< Cola sin bloqueos hacia la etapa de ingesta
         pthread_t lora_server_thread;                     ///< Thread de recepcion y envio
-        pthread_mutex_t fifo_lock;                        ///< Mutex para manipulacion de la fifo
         uint16_t max_pkt_size;
         int listen_sd;                                    ///< Descriptor socket abierto para listen
-        struct pollfd fds[1];
-        static const int timeout = 60000;                 ///< [ms]
-        static const uint16_t max_time_no_comm = 60;
+        int epoll_fd;                                     ///< Instancia epoll del servidor
+        static const int timeout = 1000;                  ///< Tick de la rueda de tiempos [ms]
+        static const uint16_t max_time_no_comm = 60;      ///< [s]
+        static const uint16_t max_len = 1024;             ///< Bytes leidos por recv
+        static const uint8_t max_events = 64;             ///< Eventos atendidos por epoll_wait
+        static const int listen_backlog = 128;
 
-};
+        uint16_t max_connections;
+        Connection_t* connections;
+        uint16_t* free_connections;                       ///< Pila de conexiones libres
+        uint16_t n_free;
+        Timer_wheel idle_wheel;                           ///< Ticks de 1 s
+        uint8_t data[max_len];
+        Pkt pkt;                                          ///< Comprobacion final de los pkts delimitados
+        Pkt_layout_t layout;
+        Pkt_admission* admission;                         ///< Control de admision compartido, NULL si no hay
+        Lora_tcp_stats_t stats;
 
+        /**
+          \brief Acepta todas las conexiones pendientes
+        */
+        void accept_connections( void );
 
+        /**
+          \brief Lee de una conexion y encola los pkts completos
+          \param connection Conexion con datos
+          \param now_s Instante actual [s]
+        */
+        void receive( Connection_t& connection, uint32_t now_s );
+
+        /**
+          \brief Callback del framer: encola un pkt completo
+          \param bytes Pkt delimitado
+          \param len Longitud del pkt
+          \param server_void_ptr Puntero al servidor
+        */
+        static void on_frame( const uint8_t* bytes, uint16_t len, void* server_void_ptr );
+
+        /**
+          \brief Cierra una conexion y la devuelve a la pila de libres
+          \param connection Conexion a cerrar
+        */
+        void close_connection( Connection_t& connection );
+
+        /**
+          \brief Callback de la rueda de tiempos: cierra la conexion o la reprograma si ha recibido datos
+          \param node Nodo vencido
+          \param arg Puntero al servidor
+        */
+        static void on_idle( Timer_node_t& node, void* arg );
+
+        /**
+          \brief Instante actual con reloj monotonico [s]
+        */
+        static uint32_t now_s( void );
+};
@@ -9,12 +9,59 @@
 #include "log.h"
 #include "payload_mgr.h"
 
-Lora_udp_client::Lora_udp_client() {}
+Lora_udp_client::Lora_udp_client() : port( 0 ), max_pkt_size( 0 ), sockfd( -1 ), queue( max_queue, sizeof( Downlink_req_t ) ), duty_policy( duty_policy_defer ), max_defer_s( 300 ), deferred_head( 0 ), deferred_count( 0 ) {
+    stats.queued        = 0;
+    stats.queue_drops   = 0;
+    stats.sent          = 0;
+    stats.send_errors   = 0;
+    stats.batches       = 0;
+    stats.duty_deferred = 0;
+    stats.duty_dropped  = 0;
+    stats.duty_expired  = 0;
+}
+
+Lora_udp_client::~Lora_udp_client() {
+    if ( sockfd != -1 ) {
+        close( sockfd );
+    }
+}
+
+bool Lora_udp_client::init( uint16_t port_0, uint16_t max_pkt_size_0 ) {
+    port         = port_0;
+    max_pkt_size = max_pkt_size_0;
+
+    if ( ( sockfd = socket( AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0 ) ) < 0 ) {
+        log( (uint32_t)0, "Client socket creation failed" );
+        return false;
+    }
+
+    // Socket conectado: sendmmsg no necesita direccion por mensaje
+    struct sockaddr_in servaddr;
+    memset( &servaddr, 0, sizeof( servaddr ) );
+    servaddr.sin_family      = AF_INET;
+    servaddr.sin_port        = htons( port );
+    servaddr.sin_addr.s_addr = INADDR_ANY;
+    if ( connect( sockfd, (const struct sockaddr*)&servaddr, sizeof( servaddr ) ) < 0 ) {
+        log( (uint32_t)0, "Client socket connect failed" );
+        return false;
+    }
 
-Lora_udp_client::~Lora_udp_client() {}
+    memset( tx_msgs, 0, sizeof( tx_msgs ) );
+    for ( uint_fast8_t i = 0; i < max_batch; i++ ) {
+        tx_iovecs[i].iov_base         = tx_buffers[i];
+        tx_msgs[i].msg_hdr.msg_iov    = &tx_iovecs[i];
+        tx_msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    if ( !queue.init() ) {
+        return false;
+    }
 
-void Lora_udp_client::init( uint16_t port_0 ) {
-    port = port_0;
+    if ( pthread_create( &sender_thread, NULL, thread_fcn, (void*)this ) ) {
+        printf( "Error creating thread\n" );
+        return false;
+    }
+    return true;
 }
 
 bool Lora_udp_client::set_formatter( uint8_t sync_byte ) {
@@ -34,70 +81,211 @@ bool Lora_udp_client::set_formatter( uint8_t sync_byte ) {
     return true;
 }
 
-bool Lora_udp_client::send( char* prefix_up, Pkt& pkt_data ) {
-    set_formatter( pkt_data.hdr->sync );
-    Pkt pkt( pkt_data.get_size() );
+void Lora_udp_client::set_ack_policy( Ack_mode_t mode, uint8_t every_n, uint32_t window_s ) {
+    ack_policy.configure( mode, every_n, window_s );
+}
+
+void Lora_udp_client::set_duty_policy( Duty_policy_t policy, uint32_t max_defer_s_0 ) {
+    duty_policy = policy;
+    max_defer_s = max_defer_s_0;
+}
+
+bool Lora_udp_client::send( const char* prefix_up, const Pkt& pkt_data, const Lora_uplink_t& uplink ) {
+    Downlink_req_t req;
+    size_t prefix_len = strlen( prefix_up );
+    if ( prefix_len > prefix_max_len ) {
+        return false;
+    }
+
+    req.src        = pkt_data.hdr->src;
+    req.dst        = pkt_data.hdr->dst;
+    req.timestamp  = pkt_data.hdr->timestamp;
+    req.freq_khz   = uplink.radio.valid ? uplink.radio.freq_khz : 0;
+    req.cmd        = pkt_data.hdr->cmd;
+    req.sync       = pkt_data.hdr->sync;
+    req.modulation = uplink.modulation;
+    req.confirmed  = uplink.confirmed;
+    req.prefix_len = prefix_len;
+    memcpy( req.prefix, prefix_up, prefix_len );
+
+    if ( !queue.try_push( (const uint8_t*)&req, sizeof( req ) ) ) {
+        stats.queue_drops.fetch_add( 1, std::memory_order_relaxed );
+        return false;
+    }
+    stats.queued.fetch_add( 1, std::memory_order_relaxed );
+    return true;
+}
+
+Lora_udp_client_stats_t Lora_udp_client::get_stats( void ) const {
+    // Cada campo se lee por separado: la foto no es atomica en conjunto, pero ningun incremento se pierde
+    Lora_udp_client_stats_t snapshot;
+    snapshot.queued        = stats.queued.load( std::memory_order_relaxed );
+    snapshot.queue_drops   = stats.queue_drops.load( std::memory_order_relaxed );
+    snapshot.sent          = stats.sent.load( std::memory_order_relaxed );
+    snapshot.send_errors   = stats.send_errors.load( std::memory_order_relaxed );
+    snapshot.batches       = stats.batches.load( std::memory_order_relaxed );
+    snapshot.duty_deferred = stats.duty_deferred.load( std::memory_order_relaxed );
+    snapshot.duty_dropped  = stats.duty_dropped.load( std::memory_order_relaxed );
+    snapshot.duty_expired  = stats.duty_expired.load( std::memory_order_relaxed );
+    return snapshot;
+}
+
+Ack_policy_stats_t Lora_udp_client::get_ack_stats( void ) const {
+    return ack_policy.get_stats();
+}
+
+Duty_cycle& Lora_udp_client::get_duty_cycle( void ) {
+    return duty_cycle;
+}
+
+bool Lora_udp_client::needs_time_config( const Downlink_req_t& req ) {
+    return req.cmd == cmd_sensor_data && ( abs( (int32_t)( req.timestamp - (uint32_t)time( NULL ) ) ) > ( offset_days * 24UL * 60UL * 60UL ) );
+}
+
+uint16_t Lora_udp_client::build_response( const Downlink_req_t& req, Pkt& pkt, char* out ) {
+    static const char data_start[] = " {\"data\":\"";
+    static const char data_end[]   = "\"}";
+
+    set_formatter( req.sync );
     // Generamos el pkt de respuesta
-    if ( pkt_data.hdr->cmd == cmd_sensor_data && ( abs( (int32_t)( pkt_data.hdr->timestamp - (uint32_t)time( NULL ) ) ) > ( offset_days * 24UL * 60UL * 60UL ) ) ) {
+    if ( needs_time_config( req ) ) {
         Config_time config_time;
         Payload_mgr payload_mgr( Config_time::get_size() );
         config_time.time_from_server = (uint32_t)time( NULL );
         config_time.to_pkt_payload( &payload_mgr );
-        pkt.build( pkt_data.hdr->dst, pkt_data.hdr->src, cmd_time_conf, pkt_data.hdr->timestamp, payload_mgr.get_bytes(), payload_mgr.get_used_size() );
+        pkt.build( req.dst, req.src, cmd_time_conf, req.timestamp, payload_mgr.get_bytes(), payload_mgr.get_used_size() );
     }
     else {
-        pkt.build( pkt_data.hdr->dst, pkt_data.hdr->src, cmd_ack, pkt_data.hdr->timestamp, nullptr, 0 );
+        pkt.build( req.dst, req.src, cmd_ack, req.timestamp, nullptr, 0 );
     }
-    // Codificamos el pkt a Base64
-    size_t coded_data_len = base64.encoded_size( pkt.get_size() );
-    char out[coded_data_len];
-    if ( !base64.encode( (unsigned char*)pkt.bytes(), out, pkt.get_size() ) ) {
-        return false;
+
+    // Modificar prefix up a down: "lora/<eui>/up" -> "lora/<eui>:.../down"
+    // lora/00:80:00:00:00:00:6a:1a/down {"data":"aGVsbG8gd29ybGQ="}
+    const char* up = (const char*)memchr( req.prefix, 'u', req.prefix_len );
+    if ( up == NULL ) {
+        return 0;
+    }
+    uint16_t stem_len = up - req.prefix;
+    size_t coded_len  = base64.encoded_size( pkt.get_size() );
+    if ( stem_len + 4 + sizeof( data_start ) - 1 + coded_len + sizeof( data_end ) > tx_max_len ) {
+        return 0;
     }
 
-    // Modificar prefix up a down
-    uint8_t prefix_len = 34;
-    char prefix_down[prefix_len];
-    char* pch = strtok( prefix_up, "u" );
-    if ( pch == nullptr ) {
-        return false;
+    uint16_t pos = 0;
+    for ( uint_fast16_t i = 0; i < stem_len; i++ ) {
+        out[pos++] = req.prefix[i] == '-' ? ':' : req.prefix[i];
     }
+    memcpy( &out[pos], "down", 4 );
+    pos += 4;
+    memcpy( &out[pos], data_start, sizeof( data_start ) - 1 );
+    pos += sizeof( data_start ) - 1;
 
-    strcpy( prefix_down, pch );
-    strcat( prefix_down, "down" );
-    for ( uint_fast16_t i = 0; i < strlen( prefix_down ); i++ ) {
-        if ( prefix_down[i] == '-' ) {
-            prefix_down[i] = ':';
-        }
+    // Codificamos el pkt a Base64 directamente en la linea de salida
+    if ( !base64.encode( (unsigned char*)pkt.bytes(), &out[pos], pkt.get_size() ) ) {
+        return 0;
     }
+    pos += coded_len;
+    memcpy( &out[pos], data_end, sizeof( data_end ) );
+    pos += sizeof( data_end ) - 1;
+    return pos;
+}
 
-    // Creamos la cadena de salida con el prefijo y el json de datos codificados
-    // lora/00:80:00:00:00:00:6a:1a/down {"data":"aGVsbG8gd29ybGQ="}
-    char response[strlen( prefix_down ) + strlen( out ) + strlen( " {\"data\":\"\"}" )];
-    strcpy( response, prefix_down );
-    strcat( response, " {\"data\":\"" );
-    strcat( response, out );
-    strcat( response, "\"}" );
-
-    // Envio de datos
-    int sockfd;
-    struct sockaddr_in servaddr;
+Lora_udp_client::Prepare_result_t Lora_udp_client::prepare( const Downlink_req_t& req, Pkt& pkt, uint8_t& n_msgs, uint32_t now_s ) {
+    char* out       = tx_buffers[n_msgs];
+    uint16_t tx_len = build_response( req, pkt, out );
+    if ( tx_len == 0 ) {
+        return prepare_failed;
+    }
 
-    if ( ( sockfd = socket( AF_INET, SOCK_DGRAM, 0 ) ) < 0 ) {
-        log( (uint32_t)0, "Client socket creation failed" );
-        return false;
+    // La bajada sale en RX1 con la modulacion de la subida, se cobra su tamanyo real
+    uint32_t airtime_us = Lora_airtime::time_on_air_us( req.modulation, pkt.get_size() + Lora_airtime::lorawan_overhead, false );
+    if ( !duty_cycle.try_consume( req.freq_khz, airtime_us, now_s ) ) {
+        return prepare_no_budget;
     }
 
-    log( pkt.hdr->dst, "Respuesta:%s\n", response );
-    memset( &servaddr, 0, sizeof( servaddr ) );
+    log( pkt.hdr->dst, "Respuesta:%s\n", out );
+    tx_iovecs[n_msgs].iov_len = tx_len;
+    n_msgs++;
+    return prepare_ready;
+}
 
-    servaddr.sin_family      = AF_INET;
-    servaddr.sin_port        = htons( port );
-    servaddr.sin_addr.s_addr = INADDR_ANY;
+void Lora_udp_client::defer( const Downlink_req_t& req, uint32_t now_s ) {
+    if ( duty_policy != duty_policy_defer || deferred_count == max_deferred ) {
+        stats.duty_dropped.fetch_add( 1, std::memory_order_relaxed );
+        return;
+    }
+    Deferred_t& entry = deferred[( deferred_head + deferred_count ) % max_deferred];
+    entry.req         = req;
+    entry.since_s     = now_s;
+    deferred_count++;
+    stats.duty_deferred.fetch_add( 1, std::memory_order_relaxed );
+}
 
-    sendto( sockfd, (const char*)response, strlen( response ), MSG_CONFIRM, (const struct sockaddr*)&servaddr, sizeof( servaddr ) );
+void Lora_udp_client::retry_deferred( Pkt& pkt, uint8_t& n_msgs, uint32_t now_s ) {
+    // Una vuelta completa: lo que sigue sin caber vuelve al final en el mismo orden
+    uint8_t pending = deferred_count;
+    for ( uint8_t i = 0; i < pending; i++ ) {
+        Deferred_t entry = deferred[deferred_head];
+        deferred_head    = ( deferred_head + 1 ) % max_deferred;
+        deferred_count--;
 
-    close( sockfd );
+        if ( now_s - entry.since_s > max_defer_s ) {
+            stats.duty_expired.fetch_add( 1, std::memory_order_relaxed );
+            continue;
+        }
+        if ( n_msgs < max_batch ) {
+            Prepare_result_t result = prepare( entry.req, pkt, n_msgs, now_s );
+            if ( result != prepare_no_budget ) {
+                continue;
+            }
+        }
+        deferred[( deferred_head + deferred_count ) % max_deferred] = entry;
+        deferred_count++;
+    }
+}
 
-    return true;
-}
\ No newline at end of file
+void Lora_udp_client::run( void ) {
+    Pkt pkt( max_pkt_size );
+    Downlink_req_t req;
+    uint16_t len;
+
+    while ( 1 ) {
+        // Con respuestas aplazadas se despierta periodicamente para reintentarlas
+        queue.wait( deferred_count > 0 ? defer_poll_ms : -1 );
+        uint32_t now_s = time( NULL );
+
+        // Se construye todo lo pendiente y se envia con una sola llamada por lote. Las aplazadas van primero
+        uint8_t n_msgs = 0;
+        retry_deferred( pkt, n_msgs, now_s );
+        while ( n_msgs < max_batch && queue.try_pop( (uint8_t*)&req, sizeof( req ), len ) ) {
+            uint32_t ack_airtime_us = Lora_airtime::time_on_air_us( req.modulation, Pkt::get_pkt_overhead() + Lora_airtime::lorawan_overhead, false );
+            if ( !ack_policy.should_send( req.src, req.confirmed, needs_time_config( req ), now_s, ack_airtime_us ) ) {
+                continue;
+            }
+            if ( prepare( req, pkt, n_msgs, now_s ) == prepare_no_budget ) {
+                defer( req, now_s );
+            }
+        }
+        if ( n_msgs == 0 ) {
+            continue;
+        }
+
+        uint8_t done = 0;
+        while ( done < n_msgs ) {
+            int sent = sendmmsg( sockfd, &tx_msgs[done], n_msgs - done, 0 );
+            stats.batches.fetch_add( 1, std::memory_order_relaxed );
+            if ( sent <= 0 ) {
+                // Se descarta el resto del lote, el dispositivo reintentara
+                stats.send_errors.fetch_add( n_msgs - done, std::memory_order_relaxed );
+                break;
+            }
+            stats.sent.fetch_add( sent, std::memory_order_relaxed );
+            done += sent;
+        }
+    }
+}
+
+void* Lora_udp_client::thread_fcn( void* Lora_udp_client_void_ptr ) {
+    ( (Lora_udp_client*)Lora_udp_client_void_ptr )->run();
+    return NULL;
+}
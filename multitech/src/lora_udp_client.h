@@ -9,15 +9,37 @@
 #include <sys/socket.h> 
 #include <arpa/inet.h> 
 #include <netinet/in.h>
+#include <atomic>
+#include "pthread.h"
 #include "base64.h"
 #include "pkt.h"
+#include "pkt_ring.h"
+#include "lora_uplink_parser.h"
+#include "ack_policy.h"
+#include "duty_cycle.h"
 #include "lossy.h"
 #include "no_lossy.h"
 
+/**
+  \brief Estadisticas de envio de respuestas
+*/
+typedef struct {
+    uint32_t queued;            ///< Respuestas encoladas
+    uint32_t queue_drops;       ///< Respuestas descartadas por cola llena
+    uint32_t sent;              ///< Respuestas enviadas
+    uint32_t send_errors;       ///< Respuestas que sendmmsg no pudo enviar
+    uint32_t batches;           ///< Llamadas a sendmmsg
+    uint32_t duty_deferred;     ///< Respuestas aplazadas por falta de ciclo de trabajo
+    uint32_t duty_dropped;      ///< Respuestas descartadas por falta de ciclo de trabajo
+    uint32_t duty_expired;      ///< Respuestas aplazadas que caducaron sin poder enviarse
+} Lora_udp_client_stats_t;
+
 class Lora_udp_client {
 
     public:
 
+        static const uint8_t prefix_max_len = 63;   ///< Longitud maxima del prefijo de subida
+
         /**
           \brief Constructor de la clase
         */
@@ -29,9 +51,12 @@ class Lora_udp_client {
         ~Lora_udp_client();
 
         /**
-          \brief Inicializa el puerto de comunicacion
+          \brief Abre el socket de bajada y arranca el thread de envio
+          \param port_0 Puerto de bajada del network server
+          \param max_pkt_size_0 Longitud maxima del pkt de respuesta
+          \return Error de inicializacion
         */
-        void init( uint16_t port_0 );
+        bool init( uint16_t port_0, uint16_t max_pkt_size_0 );
 
         /**
           \brief Modifica el tipo de formato de los datos
@@ -41,17 +66,170 @@ class Lora_udp_client {
         bool set_formatter( uint8_t sync_byte );
 
         /**
-          \brief Condificacion de la respuesta y envio de datos
+          \brief Fija la politica de ACK. Llamar antes de init
+          \param mode Modo de envio
+          \param every_n Pkts por ACK en ack_mode_every_n
+          \param window_s Ventana en ack_mode_coalesce [s]
+        */
+        void set_ack_policy( Ack_mode_t mode, uint8_t every_n, uint32_t window_s );
+
+        /**
+          \brief Fija que hacer con una respuesta que no cabe en el ciclo de trabajo. Llamar antes de init
+          \param policy Politica de ciclo de trabajo
+          \param max_defer_s Tiempo maximo que una respuesta puede esperar aplazada [s]
+        */
+        void set_duty_policy( Duty_policy_t policy, uint32_t max_defer_s );
+
+        /**
+          \brief Encola la respuesta a un pkt recibido. La respuesta se decide, se construye y se
+          envia en el thread de envio, el thread de ingesta no espera
           \param prefix_up Prefijo del paquete recibido
-          \param pkt Datos a enviar
-          \return Confirmacion del envio
+          \param pkt Pkt recibido
+          \param uplink Metadatos de radio de la subida
+          \return false si la cola de respuestas esta llena
+        */
+        bool send( const char* prefix_up, const Pkt& pkt, const Lora_uplink_t& uplink );
+
+        /**
+          \brief Devuelve las estadisticas de envio (copia sin bloqueo, aproximada)
+        */
+        Lora_udp_client_stats_t get_stats( void ) const;
+
+        /**
+          \brief Devuelve las estadisticas de la politica de ACK (copia sin bloqueo, aproximada)
         */
-        bool send( char* prefix_up, Pkt& pkt );
+        Ack_policy_stats_t get_ack_stats( void ) const;
+
+        /**
+          \brief Devuelve el presupuesto de emision por sub-banda
+        */
+        Duty_cycle& get_duty_cycle( void );
+
+        /**
+          \brief Funcion estatica callback del thread de envio
+          \param Lora_udp_client_void_ptr puntero al objeto que crea el thread
+        */
+        static void* thread_fcn( void* Lora_udp_client_void_ptr );
 
     private:
+
+        /**
+          \brief Contadores de Lora_udp_client_stats_t, atomicos porque los incrementan los workers y
+          el thread de envio mientras el bucle principal los lee
+        */
+        typedef struct {
+            std::atomic<uint32_t> queued;
+            std::atomic<uint32_t> queue_drops;
+            std::atomic<uint32_t> sent;
+            std::atomic<uint32_t> send_errors;
+            std::atomic<uint32_t> batches;
+            std::atomic<uint32_t> duty_deferred;
+            std::atomic<uint32_t> duty_dropped;
+            std::atomic<uint32_t> duty_expired;
+        } Counters_t;
+
+        /**
+          \brief Datos del pkt recibido necesarios para construir su respuesta
+        */
+        typedef struct {
+            uint32_t src;
+            uint32_t dst;
+            uint32_t timestamp;
+            uint32_t freq_khz;                      ///< Frecuencia de la subida, RX1 emite en la misma
+            Lora_modulation_t modulation;
+            uint8_t cmd;
+            uint8_t sync;
+            bool confirmed;
+            uint8_t prefix_len;
+            char prefix[prefix_max_len];
+        } Downlink_req_t;
+
+        static const uint8_t max_queue = 64;        ///< Respuestas pendientes maximas
+        static const uint8_t max_batch = 16;        ///< Respuestas por llamada a sendmmsg
+        static const uint16_t tx_max_len = 512;     ///< Longitud maxima de una respuesta
+        static const uint8_t max_deferred = 64;     ///< Respuestas aplazadas maximas
+        static const int defer_poll_ms = 1000;      ///< Reintento de las aplazadas [ms]
+
+        /**
+          \brief Respuesta aplazada por falta de ciclo de trabajo
+        */
+        typedef struct {
+            Downlink_req_t req;
+            uint32_t since_s;                       ///< Instante en que se aplazo [s]
+        } Deferred_t;
+
+        /**
+          \brief Resultado de preparar una respuesta en el lote
+        */
+        typedef enum {
+            prepare_ready,                          ///< Respuesta en el lote, presupuesto cobrado
+            prepare_no_budget,                      ///< No cabe en el ciclo de trabajo
+            prepare_failed                          ///< No se pudo construir
+        } Prepare_result_t;
+
+        /**
+          \brief Bucle del thread de envio: vacia la cola en lotes
+        */
+        void run( void );
+
+        /**
+          \brief Comprueba si el timestamp del pkt se ha desviado tanto que hay que mandar la hora
+          \param req Datos del pkt recibido
+        */
+        bool needs_time_config( const Downlink_req_t& req );
+
+        /**
+          \brief Construye la linea de respuesta de un pkt recibido
+          \param req Datos del pkt recibido
+          \param pkt Pkt de trabajo para la respuesta
+          \param out Buffer de salida
+          \return Longitud de la linea, 0 si no se pudo construir
+        */
+        uint16_t build_response( const Downlink_req_t& req, Pkt& pkt, char* out );
+
+        /**
+          \brief Construye una respuesta en la posicion n_msgs del lote y cobra su tiempo en el aire
+          \param req Datos del pkt recibido
+          \param pkt Pkt de trabajo para la respuesta
+          \param n_msgs Mensajes del lote, se incrementa si la respuesta queda en el lote
+          \param now_s Instante actual [s]
+        */
+        Prepare_result_t prepare( const Downlink_req_t& req, Pkt& pkt, uint8_t& n_msgs, uint32_t now_s );
+
+        /**
+          \brief Aplaza una respuesta que no cabe, o la descarta segun la politica
+          \param req Datos del pkt recibido
+          \param now_s Instante actual [s]
+        */
+        void defer( const Downlink_req_t& req, uint32_t now_s );
+
+        /**
+          \brief Reintenta las respuestas aplazadas, por orden de llegada
+          \param pkt Pkt de trabajo para la respuesta
+          \param n_msgs Mensajes del lote
+          \param now_s Instante actual [s]
+        */
+        void retry_deferred( Pkt& pkt, uint8_t& n_msgs, uint32_t now_s );
+
         No_lossy no_lossy;
         Lossy lossy;
         uint16_t port;
+        uint16_t max_pkt_size;
         Base64 base64;
         const uint32_t offset_days = 20;
-};
\ No newline at end of file
+
+        int sockfd;                                     ///< Socket de bajada, abierto durante toda la vida del objeto
+        pthread_t sender_thread;
+        Pkt_ring queue;                                 ///< Respuestas pendientes (varios workers, un thread de envio)
+        char tx_buffers[max_batch][tx_max_len];
+        struct iovec tx_iovecs[max_batch];
+        struct mmsghdr tx_msgs[max_batch];
+        Counters_t stats;
+        Ack_policy ack_policy;                          ///< Solo se usa desde el thread de envio
+        Duty_cycle duty_cycle;
+        Duty_policy_t duty_policy;
+        uint32_t max_defer_s;
+        Deferred_t deferred[max_deferred];              ///< Cola circular, solo se usa desde el thread de envio
+        uint8_t deferred_head;
+        uint8_t deferred_count;
+};
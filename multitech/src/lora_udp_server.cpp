@@ -22,12 +22,12 @@ static void die( const char* msg ) {
     exit( EXIT_FAILURE );
 }
 
-Lora_udp_server::Lora_udp_server( Fifo_pkt& fifo_lora_input_0, uint16_t max_pkt_size_0 ) : fifo_lora_input( fifo_lora_input_0 ), max_pkt_size( max_pkt_size_0 ) {}
-
-Lora_udp_server::~Lora_udp_server() {
-    pthread_mutex_destroy( &fifo_lock );
+Lora_udp_server::Lora_udp_server( Pkt_ring& lora_input_0, uint16_t max_pkt_size_0 ) : lora_input( lora_input_0 ), max_pkt_size( max_pkt_size_0 ), batch_size( max_batch_size ), n_workers( 1 ), admission( NULL ) {
+    memset( &stats, 0, sizeof( stats ) );
 }
 
+Lora_udp_server::~Lora_udp_server() {}
+
 int8_t Lora_udp_server::init( uint16_t up_port_0, uint16_t down_port_0 ) {
     // Inicio la estructura hints
     struct addrinfo hints;
@@ -63,6 +63,10 @@ int8_t Lora_udp_server::init( uint16_t up_port_0, uint16_t down_port_0 ) {
             exit( 1 );
         }
 
+        // Si no se puede ampliar el buffer se sigue con el del sistema
+        int rcvbuf_value = rcvbuf_size;
+        setsockopt( listen_sd, SOL_SOCKET, SO_RCVBUF, &rcvbuf_value, sizeof( int ) );
+
         if ( bind( listen_sd, rp->ai_addr, rp->ai_addrlen ) == 0 ) {
             break; // Success
         }
@@ -88,11 +92,38 @@ int8_t Lora_udp_server::init( uint16_t up_port_0, uint16_t down_port_0 ) {
         die( "fcntl()" );
     }
 
-    if ( pthread_mutex_init( &fifo_lock, NULL ) != 0 ) {
-        printf( "Mutex init failed\n" );
+    // Cada entrada del lote apunta siempre a su propio buffer
+    memset( rx_msgs, 0, sizeof( rx_msgs ) );
+    for ( uint_fast8_t i = 0; i < max_batch_size; i++ ) {
+        rx_iovecs[i].iov_base            = rx_buffers[i];
+        rx_iovecs[i].iov_len             = max_len;
+        rx_msgs[i].msg_hdr.msg_iov       = &rx_iovecs[i];
+        rx_msgs[i].msg_hdr.msg_iovlen    = 1;
+    }
+
+    if ( !lora_udp_client.init( down_port, max_pkt_size ) ) {
+        printf( "Error creating downlink client\n" );
         return 0;
     }
 
+    if ( n_workers > 1 ) {
+        for ( uint_fast8_t i = 0; i < n_workers; i++ ) {
+            workers[i].server    = this;
+            workers[i].head      = 0;
+            workers[i].count     = 0;
+            workers[i].processed = 0;
+            if ( pthread_mutex_init( &workers[i].lock, NULL ) != 0 || pthread_cond_init( &workers[i].ready, NULL ) != 0 ) {
+                printf( "Mutex init failed\n" );
+                return 0;
+            }
+            if ( pthread_create( &workers[i].thread, NULL, worker_fcn, (void*)&workers[i] ) ) {
+                printf( "Error creating thread\n" );
+                return 0;
+            }
+        }
+        log( (uint32_t)0, "LoRa ingest workers created: %u\n", n_workers );
+    }
+
     if ( pthread_create( &lora_server_thread, NULL, thread_fcn, (void*)this ) ) {
         printf( "Error creating thread\n" );
         return 0;
@@ -102,85 +133,237 @@ int8_t Lora_udp_server::init( uint16_t up_port_0, uint16_t down_port_0 ) {
     return 1;
 }
 
+void Lora_udp_server::set_batch_size( uint8_t batch_size_0 ) {
+    if ( batch_size_0 == 0 ) {
+        batch_size = 1;
+    }
+    else if ( batch_size_0 > max_batch_size ) {
+        batch_size = max_batch_size;
+    }
+    else {
+        batch_size = batch_size_0;
+    }
+}
+
+void Lora_udp_server::set_workers( uint8_t n_workers_0 ) {
+    if ( n_workers_0 == 0 ) {
+        n_workers = 1;
+    }
+    else if ( n_workers_0 > max_workers ) {
+        n_workers = max_workers;
+    }
+    else {
+        n_workers = n_workers_0;
+    }
+}
+
+void Lora_udp_server::set_dedup_window( uint32_t window_s ) {
+    dedup.set_window( window_s );
+    for ( uint_fast8_t i = 0; i < max_workers; i++ ) {
+        workers[i].dedup.set_window( window_s );
+    }
+}
+
+Dedup_stats_t Lora_udp_server::get_dedup_stats( void ) const {
+    Dedup_stats_t total = dedup.get_stats();
+    for ( uint_fast8_t i = 0; i < n_workers && n_workers > 1; i++ ) {
+        Dedup_stats_t worker = workers[i].dedup.get_stats();
+        total.hits += worker.hits;
+        total.misses += worker.misses;
+        total.evictions += worker.evictions;
+    }
+    return total;
+}
+
+void Lora_udp_server::set_ack_policy( Ack_mode_t mode, uint8_t every_n, uint32_t window_s ) {
+    lora_udp_client.set_ack_policy( mode, every_n, window_s );
+}
+
+Ack_policy_stats_t Lora_udp_server::get_ack_stats( void ) const {
+    return lora_udp_client.get_ack_stats();
+}
+
+void Lora_udp_server::set_duty_policy( Duty_policy_t policy, uint32_t max_defer_s ) {
+    lora_udp_client.set_duty_policy( policy, max_defer_s );
+}
+
+Duty_cycle& Lora_udp_server::get_duty_cycle( void ) {
+    return lora_udp_client.get_duty_cycle();
+}
+
+Lora_udp_client_stats_t Lora_udp_server::get_downlink_stats( void ) const {
+    return lora_udp_client.get_stats();
+}
+
+void Lora_udp_server::set_admission( Pkt_admission* admission_0 ) {
+    admission = admission_0;
+}
+
+Link_stats& Lora_udp_server::get_link_stats( void ) {
+    return link_stats;
+}
+
+Channel_usage& Lora_udp_server::get_channel_usage( void ) {
+    return channel_usage;
+}
+
+Lora_udp_stats_t Lora_udp_server::get_stats( void ) const {
+    return stats;
+}
+
 void Lora_udp_server::run( void ) {
-    uint8_t buffer[max_len];
     Pkt pkt( max_pkt_size );
     Lora_data lora_data;
+    Pkt_framer framer( Pkt_framer::layout_of( pkt, pkt_sync_lossy, pkt_sync_no_lossy ), Pkt_framer::check_with_pkt<Pkt>, &pkt );
 
-    struct sockaddr_in cliaddr;
-    socklen_t socket_len;
-    socket_len = sizeof( cliaddr );
+    while ( 1 ) {
+        // Bloquea hasta el primer datagrama y recoge los que ya esten en cola
+        int received = recvmmsg( listen_sd, rx_msgs, batch_size, MSG_WAITFORONE, NULL );
+        if ( received <= 0 ) {
+            continue;
+        }
 
-    lora_udp_client.init( down_port );
+        stats.wakeups++;
+        stats.datagrams += received;
+        stats.last_batch = received;
+        if ( received > stats.max_batch ) {
+            stats.max_batch = received;
+        }
+        if ( received == batch_size ) {
+            stats.full_batches++;
+        }
 
-    while ( 1 ) {
-        int n = recvfrom( listen_sd, buffer, max_len, MSG_WAITALL, (struct sockaddr*)&cliaddr, &socket_len );
-
-        buffer[n] = '\0';
-        memset( lora_data.prefix, 0, prefix_len + 1 );
-        memset( lora_data.data, 0, max_len );
-        lora_data.len = 0;
-
-        if ( frame_parser( (char*)buffer, lora_data ) ) {
-            for ( uint_fast16_t i = 0; i < lora_data.len; i++ ) {
-                if ( pkt.parse( lora_data.data[i] ) ) {
-                    pthread_mutex_lock( &fifo_lock );
-                    bool pkt_intput_is_saved = fifo_lora_input.put_pkt( pkt );
-                    pthread_mutex_unlock( &fifo_lock );
-                    if ( pkt_intput_is_saved ) {
-                        lora_udp_client.send( lora_data.prefix, pkt );
-                    }
-                }
+        for ( int i = 0; i < received; i++ ) {
+            if ( rx_msgs[i].msg_hdr.msg_flags & MSG_TRUNC ) {
+                stats.truncated++;
+                continue;
+            }
+            if ( n_workers > 1 ) {
+                dispatch( (char*)rx_buffers[i], rx_msgs[i].msg_len );
+            }
+            else {
+                rx_buffers[i][rx_msgs[i].msg_len] = '\0';
+                process_datagram( (char*)rx_buffers[i], rx_msgs[i].msg_len, lora_data, pkt, framer, dedup );
             }
         }
     }
 }
 
-bool Lora_udp_server::frame_parser( char* buffer, Lora_data& lora_data ) {
-    char* pch;
-    const uint16_t encoded_data_len = 500;
-    char encoded_data[encoded_data_len];
-
-    // |------------prefix-----------| |----------------------------data in Base64-------------------------| lora/00-00-00-00-02-65-e9-e8/up
-    // {"tmst":3734965956,"time":"2021-01-05T20:42:44.962524Z","tmms":1293914582962,"chan":2,"rfch":0,"freq":868.5,"stat":1,"modu":"LORA","datr":"SF9BW125","codr":"4/5","lsnr":10.0,"rssi":-47,"opts":"","size":51,"fcnt":18,"cls":0,"port":2,"mhdr":"801dce3001801200","data":"LOjpZQJ7AAAAgggEz/RfxSsAAAAAAAAAaYukIWAYKUNMXFDe3m/BVp8cAkAgAAJAgIAZ","appeui":"00-80-00-00-00-00-e1-9c","deveui":"00-00-00-00-02-65-e9-e8","ack":false,"adr":true,"gweui":"00-80-00-00-a0-00-69-3f","seqn":18}
-    pch = strtok( buffer, " " );
-    if ( pch == nullptr ) {
-        return false;
+void Lora_udp_server::dispatch( const char* buffer, uint16_t buffer_len ) {
+    // FNV-1a del prefijo "lora/<eui>/up": el mismo DevEUI siempre va al mismo worker
+    uint32_t hash     = 2166136261UL;
+    const char* space = (const char*)memchr( buffer, ' ', buffer_len );
+    uint16_t key_len  = space != NULL ? space - buffer : 0;
+    for ( uint_fast16_t i = 0; i < key_len; i++ ) {
+        hash = ( hash ^ (uint8_t)buffer[i] ) * 16777619UL;
     }
 
-    if ( strlen( pch ) != prefix_len || strstr( pch, "lora/" ) == NULL || strstr( pch, "/up" ) == NULL ) {
-        return false;
+    Ingest_worker_t& worker = workers[hash % n_workers];
+    pthread_mutex_lock( &worker.lock );
+    if ( worker.count < worker_queue_len ) {
+        uint8_t slot = ( worker.head + worker.count ) % worker_queue_len;
+        memcpy( worker.lines[slot], buffer, buffer_len );
+        worker.lines[slot][buffer_len] = '\0';
+        worker.lens[slot]              = buffer_len;
+        worker.count++;
+        pthread_cond_signal( &worker.ready );
+    }
+    else {
+        stats.dispatch_drops++;
     }
+    pthread_mutex_unlock( &worker.lock );
+}
 
-    strncpy( lora_data.prefix, pch, strlen( pch ) );
+void Lora_udp_server::worker_run( Ingest_worker_t& worker ) {
+    Pkt pkt( max_pkt_size );
+    Lora_data lora_data;
+    Pkt_framer framer( Pkt_framer::layout_of( pkt, pkt_sync_lossy, pkt_sync_no_lossy ), Pkt_framer::check_with_pkt<Pkt>, &pkt );
 
-    pch = strtok( NULL, "\0" );
-    if ( pch == NULL ) {
-        return false;
+    while ( 1 ) {
+        pthread_mutex_lock( &worker.lock );
+        while ( worker.count == 0 ) {
+            pthread_cond_wait( &worker.ready, &worker.lock );
+        }
+        uint8_t slot = worker.head;
+        pthread_mutex_unlock( &worker.lock );
+
+        // El slot no se libera hasta terminar, el receptor no lo sobrescribe
+        process_datagram( worker.lines[slot], worker.lens[slot], lora_data, pkt, framer, worker.dedup );
+        worker.processed++;
+
+        pthread_mutex_lock( &worker.lock );
+        worker.head = ( worker.head + 1 ) % worker_queue_len;
+        worker.count--;
+        pthread_mutex_unlock( &worker.lock );
     }
+}
 
-    char* sub_pch = strstr( pch, "\"data\":\"" );
-    pch           = strtok( sub_pch, ":" );
-    if ( pch != nullptr ) {
-        pch = strtok( NULL, "\"" );
-        if ( pch != nullptr && strlen( pch ) < encoded_data_len ) {
-            strcpy( encoded_data, pch );
-        }
-        else {
-            return false;
+uint64_t Lora_udp_server::dedup_key( const Lora_uplink_t& uplink, const Pkt& pkt, uint8_t index ) {
+    uint64_t key;
+    if ( uplink.has_fcnt ) {
+        key = Dedup_cache::hash( uplink.eui, uplink.eui_len );
+        key = Dedup_cache::hash( &uplink.fcnt, sizeof( uplink.fcnt ), key );
+        key = Dedup_cache::hash( &index, sizeof( index ), key );
+    }
+    else {
+        key = Dedup_cache::hash( &pkt.hdr->src, sizeof( pkt.hdr->src ) );
+        key = Dedup_cache::hash( &pkt.hdr->cmd, sizeof( pkt.hdr->cmd ), key );
+        key = Dedup_cache::hash( &pkt.hdr->timestamp, sizeof( pkt.hdr->timestamp ), key );
+    }
+    return key;
+}
+
+void Lora_udp_server::process_datagram( char* buffer, uint16_t buffer_len, Lora_data& lora_data, Pkt& pkt, Pkt_framer& framer, Dedup_cache& dedup ) {
+    lora_data.prefix[0] = '\0';
+    lora_data.len       = 0;
+
+    if ( frame_parser( buffer, buffer_len, lora_data ) ) {
+        Frame_ctx_t ctx             = { this, &lora_data, &pkt, &dedup, (uint32_t)time( NULL ), 0 };
+        const Lora_uplink_t& uplink = lora_data.uplink;
+        if ( link_stats.update( uplink.eui, uplink.eui_len, uplink.radio, uplink.modulation, ctx.now ) ) {
+            channel_usage.add( uplink.radio.freq_khz, Lora_airtime::time_on_air_us( uplink.modulation, uplink.radio.size, true ), ctx.now );
         }
+        // Un pkt nunca continua en otro datagrama
+        framer.reset();
+        framer.feed( lora_data.data, lora_data.len, on_frame, &ctx );
+    }
+}
+
+void Lora_udp_server::on_frame( const uint8_t* bytes, uint16_t len, void* ctx_void_ptr ) {
+    Frame_ctx_t* ctx        = (Frame_ctx_t*)ctx_void_ptr;
+    Lora_udp_server* server = ctx->server;
+    const Lora_data& data   = *ctx->lora_data;
+
+    // Un duplicado significa que el dispositivo no recibio el ACK: se responde de nuevo
+    uint64_t key = dedup_key( data.uplink, *ctx->pkt, ctx->index++ );
+    if ( ctx->dedup->check( key, ctx->now ) || server->enqueue( bytes, len, *ctx->pkt ) ) {
+        server->lora_udp_client.send( data.prefix, *ctx->pkt, data.uplink );
     }
     else {
-        return false;
+        // Sin ACK el dispositivo lo repite, y el reintento no debe tomarse por un duplicado
+        ctx->dedup->forget( key );
+    }
+}
+
+bool Lora_udp_server::enqueue( const uint8_t* bytes, uint16_t len, const Pkt& pkt ) {
+    if ( admission == NULL ) {
+        return lora_input.try_push( bytes, len );
     }
+    return admission->offer( lora_input, pkt.hdr->src, pkt.hdr->cmd, bytes, len, Pkt_admission::now_ms() ) != admission_refused;
+}
 
-    size_t decoded_data_len = base64.decoded_size( encoded_data );
-    uint8_t decoded_data[decoded_data_len];
-    if ( !base64.decode( encoded_data, (unsigned char*)decoded_data, decoded_data_len ) ) {
+bool Lora_udp_server::frame_parser( char* buffer, uint16_t buffer_len, Lora_data& lora_data ) {
+    Lora_uplink_t uplink;
+
+    // El Base64 se decodifica directamente en la entrada de Pkt::parse
+    if ( !uplink_parser.parse( buffer, buffer_len, lora_data.data, max_len, uplink ) ) {
         return false;
     }
-    lora_data.len = decoded_data_len;
-    memcpy( lora_data.data, decoded_data, decoded_data_len );
+
+    memcpy( lora_data.prefix, uplink.prefix, uplink.prefix_len );
+    lora_data.prefix[uplink.prefix_len] = '\0';
+    lora_data.len                       = uplink.data_len;
+    lora_data.uplink                    = uplink;
 
     return true;
 }
@@ -189,3 +372,9 @@ void* Lora_udp_server::thread_fcn( void* Lora_udp_server_void_ptr ) {
     ( (Lora_udp_server*)Lora_udp_server_void_ptr )->run();
     return NULL;
 }
+
+void* Lora_udp_server::worker_fcn( void* worker_void_ptr ) {
+    Ingest_worker_t* worker = (Ingest_worker_t*)worker_void_ptr;
+    worker->server->worker_run( *worker );
+    return NULL;
+}
@@ -2,43 +2,165 @@
 
 #include "stdint.h"   // Tipos uint8_t etc
 #include <netdb.h>    // addrinfo
+#include <sys/socket.h> // mmsghdr
 #include <list>
 #include "pthread.h"
-#include "fifo_pkt.h"
-#include "base64.h"
+#include "pkt_ring.h"
+#include "lora_uplink_parser.h"
 #include "lora_udp_client.h"
+#include "dedup_cache.h"
+#include "link_stats.h"
+#include "channel_usage.h"
+#include "pkt_framer.h"
+#include "pkt_admission.h"
+
+/**
+  \brief Estadisticas de recepcion del servidor UDP
+*/
+typedef struct {
+    uint32_t wakeups;           ///< Llamadas a recvmmsg que devolvieron datos
+    uint32_t datagrams;         ///< Datagramas recibidos en total
+    uint32_t truncated;         ///< Datagramas descartados por exceder max_len
+    uint32_t full_batches;      ///< Lecturas que llenaron el lote completo
+    uint16_t last_batch;        ///< Datagramas atendidos en la ultima lectura
+    uint16_t max_batch;         ///< Maximo de datagramas atendidos en una lectura
+    uint32_t dispatch_drops;    ///< Datagramas descartados por cola de worker llena
+} Lora_udp_stats_t;
 
 class Lora_udp_server {
 
     private:
 
-        Fifo_pkt& fifo_lora_input;
+        Pkt_ring& lora_input;           ///< Cola sin bloqueos hacia la etapa de ingesta
         pthread_t lora_server_thread;   ///< Thread de recepcion y envio
-        pthread_mutex_t fifo_lock;      ///< Mutex para manipulacion de la fifo
         uint16_t max_pkt_size;
         int listen_sd;                  ///< Descriptor socket abierto para listen
-        Base64 base64;                  ///< Codificador/decodificador base64
+        Lora_uplink_parser uplink_parser;   ///< Parser de las lineas de subida
 
         static const uint16_t  max_len = 1024;
-        static const uint8_t prefix_len = 31;
+        static const uint8_t prefix_len = Lora_uplink_parser::prefix_max_len;
+        static const uint8_t max_batch_size = 32;       ///< Datagramas maximos por lectura
+        static const int rcvbuf_size = 256 * 1024;      ///< Buffer del socket para absorber rafagas [bytes]
+        static const uint8_t max_workers = 4;           ///< Workers de ingesta maximos
+        static const uint8_t worker_queue_len = 32;     ///< Datagramas pendientes por worker
 
         typedef struct {
             uint16_t len;
             uint8_t data[max_len];
             char prefix[prefix_len + 1];
+            Lora_uplink_t uplink;       ///< Metadatos de la subida, validos mientras se procesa
         } Lora_data;
 
-        Lora_udp_client lora_udp_client;
+        /**
+          \brief Worker de ingesta. Recibe los datagramas de los DevEUI que le corresponden
+          por hash, de modo que los pkts de un dispositivo se procesan en orden
+        */
+        typedef struct {
+            Lora_udp_server* server;
+            pthread_t thread;
+            pthread_mutex_t lock;
+            pthread_cond_t ready;
+            uint8_t head;                                       ///< Siguiente datagrama a procesar
+            uint8_t count;                                      ///< Datagramas pendientes
+            uint16_t lens[worker_queue_len];
+            char lines[worker_queue_len][max_len + 1];
+            uint32_t processed;                                 ///< Datagramas procesados
+            Dedup_cache dedup;                                  ///< Duplicados de los DevEUI de este worker
+        } Ingest_worker_t;
+
+        Lora_udp_client lora_udp_client;   ///< Respuestas asincronas, enviadas desde su propio thread
         uint16_t down_port;
 
+        uint8_t batch_size;                                 ///< Datagramas pedidos por lectura
+        uint8_t rx_buffers[max_batch_size][max_len + 1];    ///< Un buffer por datagrama del lote
+        struct iovec rx_iovecs[max_batch_size];
+        struct mmsghdr rx_msgs[max_batch_size];
+        Lora_udp_stats_t stats;
+
+        uint8_t n_workers;                                  ///< Workers de ingesta, 1 procesa en el thread de recepcion
+        Ingest_worker_t workers[max_workers];
+        Dedup_cache dedup;                                  ///< Duplicados cuando se procesa en el thread de recepcion
+        Link_stats link_stats;                              ///< Calidad de enlace por dispositivo
+        Channel_usage channel_usage;                        ///< Ocupacion de cada canal
+        Pkt_admission* admission;                           ///< Control de admision compartido, NULL si no hay
+
+        /**
+          \brief Reparte un datagrama al worker de su DevEUI
+          \param buffer Datagrama recibido
+          \param buffer_len Longitud del datagrama
+        */
+        void dispatch( const char* buffer, uint16_t buffer_len );
+
+        /**
+          \brief Bucle de un worker de ingesta
+          \param worker Worker que ejecuta el bucle
+        */
+        void worker_run( Ingest_worker_t& worker );
+
+        /**
+          \brief Funcion estatica callback de los threads worker
+          \param worker_void_ptr puntero al Ingest_worker_t
+        */
+        static void* worker_fcn( void* worker_void_ptr );
+
+        /**
+          \brief Calcula la clave de duplicados de un pkt: DevEUI + contador de trama + posicion
+          del pkt en la trama o, si la subida no trae contador, la cabecera del pkt
+          \param uplink Metadatos de la subida
+          \param pkt Pkt recibido
+          \param index Posicion del pkt dentro de la trama
+        */
+        static uint64_t dedup_key( const Lora_uplink_t& uplink, const Pkt& pkt, uint8_t index );
+
+        /**
+          \brief Contexto de un datagrama para el callback del framer
+        */
+        typedef struct {
+            Lora_udp_server* server;
+            Lora_data* lora_data;
+            Pkt* pkt;                   ///< Cargado por la comprobacion del framer
+            Dedup_cache* dedup;
+            uint32_t now;
+            uint8_t index;              ///< Posicion del pkt dentro de la trama
+        } Frame_ctx_t;
+
+        /**
+          \brief Procesa un datagrama recibido: lo parsea, guarda el pkt y responde.
+          Los duplicados se vuelven a responder pero no se guardan
+          \param buffer Datagrama terminado en '\0'
+          \param buffer_len Longitud del datagrama
+          \param lora_data Estructura de trabajo reutilizada entre datagramas
+          \param pkt Pkt de trabajo reutilizado entre datagramas
+          \param framer Framer del thread, comprueba con pkt
+          \param dedup Cache de duplicados del thread que procesa
+        */
+        void process_datagram( char* buffer, uint16_t buffer_len, Lora_data& lora_data, Pkt& pkt, Pkt_framer& framer, Dedup_cache& dedup );
+
+        /**
+          \brief Encola un pkt, pasando por el control de admision si lo hay
+          \param bytes Pkt delimitado
+          \param len Longitud del pkt
+          \param pkt Pkt cargado, del que se toman el origen y el comando
+          \return true si hay que confirmarlo: encolado o descartado a proposito
+        */
+        bool enqueue( const uint8_t* bytes, uint16_t len, const Pkt& pkt );
+
+        /**
+          \brief Callback del framer: guarda y responde un pkt completo
+          \param bytes Pkt delimitado dentro de lora_data.data
+          \param len Longitud del pkt
+          \param ctx_void_ptr Puntero al Frame_ctx_t
+        */
+        static void on_frame( const uint8_t* bytes, uint16_t len, void* ctx_void_ptr );
+
     public:
 
         /**
           \brief Constructor de la clase
-          \param fifo_lora_input_0 Pila para almacenar pkt's
+          \param lora_input_0 Cola para almacenar pkt's
           \param max_pkt_size_0 Longitud maxima del pkt
         */
-        Lora_udp_server( Fifo_pkt& fifo_lora_input_0, uint16_t max_pkt_size_0 );
+        Lora_udp_server( Pkt_ring& lora_input_0, uint16_t max_pkt_size_0 );
 
         /**
           \brief Destructor de la clase
@@ -53,6 +175,80 @@ class Lora_udp_server {
         */
         int8_t init( uint16_t up_port_0, uint16_t down_port_0 );
 
+        /**
+          \brief Fija el numero de datagramas leidos por llamada a recvmmsg. Llamar antes de init
+          \param batch_size_0 Tamanyo del lote, entre 1 y max_batch_size
+        */
+        void set_batch_size( uint8_t batch_size_0 );
+
+        /**
+          \brief Fija el numero de workers de ingesta. Llamar antes de init
+          \param n_workers_0 Numero de workers, entre 1 y max_workers. Con 1 se procesa en el thread de recepcion
+        */
+        void set_workers( uint8_t n_workers_0 );
+
+        /**
+          \brief Fija la ventana de deteccion de duplicados. Llamar antes de init
+          \param window_s Ventana [s]
+        */
+        void set_dedup_window( uint32_t window_s );
+
+        /**
+          \brief Devuelve las estadisticas de duplicados sumadas de todos los workers (aproximadas)
+        */
+        Dedup_stats_t get_dedup_stats( void ) const;
+
+        /**
+          \brief Fija la politica de ACK de las respuestas. Llamar antes de init
+          \param mode Modo de envio
+          \param every_n Pkts por ACK en ack_mode_every_n
+          \param window_s Ventana en ack_mode_coalesce [s]
+        */
+        void set_ack_policy( Ack_mode_t mode, uint8_t every_n, uint32_t window_s );
+
+        /**
+          \brief Devuelve las estadisticas de la politica de ACK (copia sin bloqueo, aproximada)
+        */
+        Ack_policy_stats_t get_ack_stats( void ) const;
+
+        /**
+          \brief Fija que hacer con una respuesta que no cabe en el ciclo de trabajo. Llamar antes de init
+          \param policy Politica de ciclo de trabajo
+          \param max_defer_s Tiempo maximo que una respuesta puede esperar aplazada [s]
+        */
+        void set_duty_policy( Duty_policy_t policy, uint32_t max_defer_s );
+
+        /**
+          \brief Presupuesto de emision por sub-banda de las respuestas, consultable desde cualquier thread
+        */
+        Duty_cycle& get_duty_cycle( void );
+
+        /**
+          \brief Devuelve las estadisticas de envio de respuestas (copia sin bloqueo, aproximada)
+        */
+        Lora_udp_client_stats_t get_downlink_stats( void ) const;
+
+        /**
+          \brief Fija el control de admision de la cola de ingesta. Llamar antes de init
+          \param admission_0 Control de admision, NULL encola sin control
+        */
+        void set_admission( Pkt_admission* admission_0 );
+
+        /**
+          \brief Tabla de calidad de enlace por dispositivo, consultable desde cualquier thread
+        */
+        Link_stats& get_link_stats( void );
+
+        /**
+          \brief Ocupacion de los canales, consultable desde cualquier thread
+        */
+        Channel_usage& get_channel_usage( void );
+
+        /**
+          \brief Devuelve las estadisticas de recepcion (copia sin bloqueo, aproximada)
+        */
+        Lora_udp_stats_t get_stats( void ) const;
+
         /**
           \brief Arranca el servidor
         */
@@ -61,10 +257,11 @@ class Lora_udp_server {
         /**
           \brief Detecta si es una trama de datos valida
           \param buffer Buffer de entrada con los datos en bruto
+          \param buffer_len Longitud de los datos de entrada
           \param lora_data Estructura con los datos de salida
           \return Deteccion correcta de la trama
         */
-        bool frame_parser( char* buffer, Lora_data& lora_data );
+        bool frame_parser( char* buffer, uint16_t buffer_len, Lora_data& lora_data );
 
         /**
           \brief Funcion estatica callback del thread
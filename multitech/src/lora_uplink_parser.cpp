@@ -0,0 +1,234 @@
+#include "lora_uplink_parser.h"
+#include <string.h>
+
+static const char prefix_start[] = "lora/";
+static const char prefix_end[]   = "/up";
+
+static const size_t prefix_start_len = sizeof( prefix_start ) - 1;
+static const size_t prefix_end_len   = sizeof( prefix_end ) - 1;
+static const size_t key_len          = 4;    // Todas las claves del network server tienen 4 letras
+
+// Avanza hasta la siguiente clave "xxxx": desde el cursor. Devuelve su valor y deja en key su nombre.
+// Los ':' dentro de valores (p.ej. "time") no van precedidos de una clave de 4 letras y se saltan
+static const char* next_key( const char* json, const char*& cursor, const char* end, const char*& key ) {
+    while ( cursor < end ) {
+        const char* colon = (const char*)memchr( cursor, ':', end - cursor );
+        if ( colon == NULL ) {
+            cursor = end;
+            return NULL;
+        }
+        cursor = colon + 1;
+        if ( colon - json > (ptrdiff_t)key_len + 1 && colon[-1] == '"' && colon[-(ptrdiff_t)key_len - 2] == '"' ) {
+            key = colon - key_len - 1;
+            return cursor;
+        }
+    }
+    return NULL;
+}
+
+// Delimita un valor de tipo cadena: "valor"
+static bool string_value( const char* value, const char* end, const char*& str, size_t& str_len ) {
+    if ( value == NULL || value >= end || *value != '"' ) {
+        return false;
+    }
+    const char* close = (const char*)memchr( value + 1, '"', end - value - 1 );
+    if ( close == NULL ) {
+        return false;
+    }
+    str     = value + 1;
+    str_len = close - str;
+    return true;
+}
+
+// Interpreta un valor numerico entero sin signo
+static bool number_value( const char* value, const char* end, uint32_t& number ) {
+    if ( value == NULL || value >= end || *value < '0' || *value > '9' ) {
+        return false;
+    }
+    number = 0;
+    while ( value < end && *value >= '0' && *value <= '9' ) {
+        number = number * 10 + ( *value - '0' );
+        value++;
+    }
+    return true;
+}
+
+// Interpreta un valor decimal con signo como entero escalado: "-7.25" con 1 decimal -> -72
+static bool fixed_value( const char* value, const char* end, uint8_t decimals, int32_t& number ) {
+    if ( value == NULL || value >= end ) {
+        return false;
+    }
+    bool negative = *value == '-';
+    if ( negative ) {
+        value++;
+    }
+    uint32_t integer;
+    if ( !number_value( value, end, integer ) ) {
+        return false;
+    }
+    while ( value < end && *value >= '0' && *value <= '9' ) {
+        value++;
+    }
+    if ( value < end && *value == '.' ) {
+        value++;
+    }
+    for ( uint8_t i = 0; i < decimals; i++ ) {
+        integer *= 10;
+        if ( value < end && *value >= '0' && *value <= '9' ) {
+            integer += *value - '0';
+            value++;
+        }
+    }
+    number = negative ? -(int32_t)integer : (int32_t)integer;
+    return true;
+}
+
+static uint8_t hex_nibble( char c ) {
+    if ( c >= '0' && c <= '9' ) {
+        return c - '0';
+    }
+    if ( c >= 'a' && c <= 'f' ) {
+        return c - 'a' + 10;
+    }
+    if ( c >= 'A' && c <= 'F' ) {
+        return c - 'A' + 10;
+    }
+    return 0;
+}
+
+Lora_uplink_parser::Lora_uplink_parser() {}
+
+Lora_uplink_parser::~Lora_uplink_parser() {}
+
+bool Lora_uplink_parser::parse( const char* line, size_t line_len, uint8_t* out, uint16_t out_max, Lora_uplink_t& uplink ) {
+    // lora/00-00-00-00-02-65-e9-e8/up {"tmst":3734965956,...,"data":"LOjpZQJ7...","appeui":...}
+    // |------------prefix-----------| |-----------------------json--------------------------|
+    if ( line == NULL || out == NULL ) {
+        return false;
+    }
+
+    const char* end   = line + line_len;
+    const char* space = (const char*)memchr( line, ' ', line_len );
+    if ( space == NULL ) {
+        return false;
+    }
+
+    size_t prefix_len = space - line;
+    if ( prefix_len > prefix_max_len || prefix_len <= prefix_start_len + prefix_end_len ) {
+        return false;
+    }
+    if ( memcmp( line, prefix_start, prefix_start_len ) != 0 || memcmp( space - prefix_end_len, prefix_end, prefix_end_len ) != 0 ) {
+        return false;
+    }
+
+    const char* json = space + 1;
+    if ( json >= end || *json != '{' ) {
+        return false;
+    }
+
+    // Una sola pasada por las claves hasta "data"; los metadatos de radio son opcionales
+    const char* cursor = json;
+    const char* data   = NULL;
+    const char* key;
+    const char* value;
+    const char* str;
+    size_t str_len;
+    memset( &uplink.modulation, 0, sizeof( uplink.modulation ) );
+    uplink.confirmed = false;
+    uplink.has_fcnt  = false;
+    memset( &uplink.radio, 0, sizeof( uplink.radio ) );
+    uint8_t radio_fields = 0;
+    int32_t fixed;
+    uint32_t number;
+
+    while ( data == NULL && ( value = next_key( json, cursor, end, key ) ) != NULL ) {
+        if ( memcmp( key, "data", key_len ) == 0 ) {
+            if ( *value != '"' ) {
+                return false;
+            }
+            data = value + 1;
+        }
+        else if ( memcmp( key, "datr", key_len ) == 0 ) {
+            if ( !string_value( value, end, str, str_len ) || !Lora_airtime::parse_datr( str, str_len, uplink.modulation ) ) {
+                uplink.modulation.sf = 0;
+            }
+        }
+        else if ( memcmp( key, "codr", key_len ) == 0 ) {
+            if ( string_value( value, end, str, str_len ) ) {
+                Lora_airtime::parse_codr( str, str_len, uplink.modulation );
+            }
+        }
+        else if ( memcmp( key, "fcnt", key_len ) == 0 ) {
+            uplink.has_fcnt = number_value( value, end, uplink.fcnt );
+        }
+        else if ( memcmp( key, "rssi", key_len ) == 0 ) {
+            if ( fixed_value( value, end, 0, fixed ) ) {
+                uplink.radio.rssi = fixed;
+                radio_fields++;
+            }
+        }
+        else if ( memcmp( key, "lsnr", key_len ) == 0 ) {
+            if ( fixed_value( value, end, 1, fixed ) ) {
+                uplink.radio.lsnr = fixed;
+                radio_fields++;
+            }
+        }
+        else if ( memcmp( key, "freq", key_len ) == 0 ) {
+            if ( fixed_value( value, end, 3, fixed ) ) {
+                uplink.radio.freq_khz = fixed;
+                radio_fields++;
+            }
+        }
+        else if ( memcmp( key, "size", key_len ) == 0 ) {
+            if ( number_value( value, end, number ) ) {
+                uplink.radio.size = number;
+            }
+        }
+        else if ( memcmp( key, "tmst", key_len ) == 0 ) {
+            number_value( value, end, uplink.radio.tmst );
+        }
+        else if ( memcmp( key, "mhdr", key_len ) == 0 ) {
+            // MType en los 3 bits altos del MHDR: 100 = confirmed data up
+            if ( string_value( value, end, str, str_len ) && str_len >= 2 ) {
+                uint8_t mhdr     = hex_nibble( str[0] ) << 4 | hex_nibble( str[1] );
+                uplink.confirmed = ( mhdr >> 5 ) == 0x04;
+            }
+        }
+    }
+    if ( data == NULL ) {
+        return false;
+    }
+    uplink.radio.valid = radio_fields == 3;
+
+    const char* data_end = (const char*)memchr( data, '"', end - data );
+    if ( data_end == NULL ) {
+        return false;
+    }
+
+    size_t encoded_len = data_end - data;
+    if ( encoded_len == 0 || encoded_len % 4 != 0 || encoded_len / 4 * 3 > (size_t)out_max + 2 ) {
+        return false;
+    }
+
+    // Decodificacion directa desde la linea, sin copiar ni terminar la cadena
+    size_t decoded_len = base64.decoded_size( data, encoded_len );
+    if ( decoded_len > out_max || !base64.decode( data, encoded_len, out, out_max ) ) {
+        return false;
+    }
+
+    // "seqn" va detras de "data", solo se busca si no habia "fcnt"
+    cursor = data_end;
+    while ( !uplink.has_fcnt && ( value = next_key( json, cursor, end, key ) ) != NULL ) {
+        if ( memcmp( key, "seqn", key_len ) == 0 ) {
+            uplink.has_fcnt = number_value( value, end, uplink.fcnt );
+            break;
+        }
+    }
+
+    uplink.prefix     = line;
+    uplink.prefix_len = prefix_len;
+    uplink.eui        = line + prefix_start_len;
+    uplink.eui_len    = prefix_len - prefix_start_len - prefix_end_len;
+    uplink.data_len   = decoded_len;
+    return true;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "base64.h"
+#include "lora_airtime.h"
+
+/**
+  \brief Metadatos de radio de una subida tal como los reporta el concentrador
+*/
+typedef struct {
+    int16_t rssi;           ///< Campo "rssi" [dBm]
+    int16_t lsnr;           ///< Campo "lsnr" [0.1 dB]
+    uint32_t freq_khz;      ///< Campo "freq" [kHz]
+    uint16_t size;          ///< Campo "size", longitud del PHYPayload [bytes]
+    uint32_t tmst;          ///< Campo "tmst", contador interno del concentrador [us]
+    bool valid;             ///< Se han encontrado "rssi", "lsnr" y "freq"
+} Lora_radio_t;
+
+/**
+  \brief Campos de una linea de subida "lora/<eui>/up {json}" localizados por offset.
+  Los punteros apuntan dentro de la linea original, no se copian
+*/
+typedef struct {
+    const char* prefix;     ///< Inicio del prefijo "lora/<eui>/up"
+    uint8_t prefix_len;     ///< Longitud del prefijo
+    const char* eui;        ///< Inicio del DevEUI dentro del prefijo
+    uint8_t eui_len;        ///< Longitud del DevEUI
+    uint16_t data_len;      ///< Bytes decodificados del campo "data"
+    Lora_modulation_t modulation;   ///< Campos "datr" y "codr", sf a 0 si no vienen
+    bool confirmed;         ///< Subida confirmada segun "mhdr": el dispositivo pide ACK
+    bool has_fcnt;          ///< Se ha encontrado "fcnt" o, en su defecto, "seqn"
+    uint32_t fcnt;          ///< Contador de trama de la subida
+    Lora_radio_t radio;     ///< Calidad del enlace y canal de la subida
+} Lora_uplink_t;
+
+/**
+  \class Lora_uplink_parser
+  \brief Parser de una sola pasada para las lineas de subida del network server de Multitech.
+  Localiza el prefijo y los campos por offset y decodifica el Base64 directamente
+  en el buffer de salida, sin copias intermedias. Las claves se recorren una sola vez,
+  saltando de ':' en ':', hasta llegar al campo "data"
+*/
+class Lora_uplink_parser {
+
+    public:
+
+        static const uint8_t prefix_max_len = 63;    ///< Longitud maxima del prefijo aceptado
+
+        /**
+          \brief Constructor de la clase
+        */
+        Lora_uplink_parser();
+
+        /**
+          \brief Destructor de la clase
+        */
+        ~Lora_uplink_parser();
+
+        /**
+          \brief Parsea una linea de subida
+          \param line Linea recibida
+          \param line_len Longitud de la linea
+          \param out Buffer donde se decodifica el campo "data"
+          \param out_max Tamanyo del buffer de salida
+          \param uplink Campos localizados en la linea
+          \return true si la linea es valida y el campo "data" se ha decodificado
+        */
+        bool parse( const char* line, size_t line_len, uint8_t* out, uint16_t out_max, Lora_uplink_t& uplink );
+
+    private:
+
+        Base64 base64;      ///< Codificador/decodificador base64
+};
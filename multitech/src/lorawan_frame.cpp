@@ -0,0 +1,64 @@
+#include "lorawan_frame.h"
+#include "aes128.h"
+#include <string.h>
+
+static uint32_t read_le( const uint8_t* p, uint8_t n ) {
+    uint32_t value = 0;
+    for ( uint8_t i = 0; i < n; i++ ) {
+        value |= (uint32_t)p[i] << ( 8 * i );
+    }
+    return value;
+}
+
+bool Lorawan_frame::parse( const uint8_t* phy, size_t len, Lorawan_frame_t& frame ) {
+    // MHDR | DevAddr(4) | FCtrl | FCnt(2) | FOpts(0..15) | [FPort | FRMPayload] | MIC(4)
+    if ( phy == NULL || len < min_len ) {
+        return false;
+    }
+
+    frame.mtype = (Lorawan_mtype_t)( phy[0] >> 5 );
+    if ( frame.mtype < mtype_unconfirmed_up || frame.mtype > mtype_confirmed_down ) {
+        return false;
+    }
+
+    frame.dev_addr  = read_le( phy + 1, 4 );
+    frame.fctrl     = phy[5];
+    frame.fcnt      = read_le( phy + 6, 2 );
+    frame.fopts_len = frame.fctrl & 0x0F;
+    frame.mic       = read_le( phy + len - 4, 4 );
+
+    size_t fhdr_end = 8 + frame.fopts_len;
+    if ( fhdr_end > len - 4 ) {
+        return false;
+    }
+
+    frame.has_fport   = fhdr_end < len - 4;
+    frame.fport       = frame.has_fport ? phy[fhdr_end] : 0;
+    frame.payload     = frame.has_fport ? phy + fhdr_end + 1 : NULL;
+    frame.payload_len = frame.has_fport ? len - 4 - fhdr_end - 1 : 0;
+    return true;
+}
+
+void Lorawan_frame::crypt_payload( const uint8_t key[16], uint32_t dev_addr, uint32_t fcnt, bool uplink, const uint8_t* in, uint8_t len, uint8_t* out ) {
+    Aes128 aes;
+    aes.set_key( key );
+
+    // A_i = 0x01 | 0x00 x4 | Dir | DevAddr | FCnt | 0x00 | i
+    uint8_t a[Aes128::block_len];
+    memset( a, 0, sizeof( a ) );
+    a[0] = 0x01;
+    a[5] = uplink ? 0 : 1;
+    for ( uint8_t i = 0; i < 4; i++ ) {
+        a[6 + i]  = dev_addr >> ( 8 * i );
+        a[10 + i] = fcnt >> ( 8 * i );
+    }
+
+    uint8_t s[Aes128::block_len];
+    for ( uint16_t offset = 0, block = 1; offset < len; offset += Aes128::block_len, block++ ) {
+        a[15] = block;
+        aes.encrypt( a, s );
+        for ( uint8_t i = 0; i < Aes128::block_len && offset + i < len; i++ ) {
+            out[offset + i] = in[offset + i] ^ s[i];
+        }
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+  \brief Tipos de mensaje LoRaWAN (MType, 3 bits altos del MHDR)
+*/
+typedef enum : uint8_t {
+    mtype_join_request = 0,
+    mtype_join_accept,
+    mtype_unconfirmed_up,
+    mtype_unconfirmed_down,
+    mtype_confirmed_up,
+    mtype_confirmed_down,
+    mtype_rejoin_request,
+    mtype_proprietary
+} Lorawan_mtype_t;
+
+/**
+  \brief Campos de una trama de datos LoRaWAN 1.0.x. Los punteros apuntan dentro del PHYPayload
+*/
+typedef struct {
+    Lorawan_mtype_t mtype;
+    uint32_t dev_addr;
+    uint8_t fctrl;
+    uint16_t fcnt;              ///< 16 bits bajos del contador de trama
+    uint8_t fopts_len;
+    bool has_fport;
+    uint8_t fport;
+    const uint8_t* payload;     ///< FRMPayload cifrado
+    uint8_t payload_len;
+    uint32_t mic;
+} Lorawan_frame_t;
+
+/**
+  \class Lorawan_frame
+  \brief Interpretacion del PHYPayload de las tramas de datos LoRaWAN y descifrado del
+  FRMPayload (AES-128 en modo contador, seccion 4.3.3 de la especificacion 1.0.x).
+  El MIC se extrae pero no se comprueba: el contenido lleva su propio checksum de Pkt
+*/
+class Lorawan_frame {
+
+    public:
+
+        static const uint8_t min_len = 12;      ///< MHDR + FHDR sin FOpts + MIC
+
+        /**
+          \brief Interpreta una trama de datos
+          \param phy PHYPayload
+          \param len Longitud del PHYPayload
+          \param frame Campos de salida
+          \return false si no es una trama de datos bien formada
+        */
+        static bool parse( const uint8_t* phy, size_t len, Lorawan_frame_t& frame );
+
+        /**
+          \brief Descifra (o cifra) el FRMPayload
+          \param key AppSKey si FPort > 0, NwkSKey si FPort = 0
+          \param dev_addr DevAddr de la trama
+          \param fcnt Contador de trama completo de 32 bits
+          \param uplink true en subidas
+          \param in Datos de entrada
+          \param len Longitud de los datos
+          \param out Salida, puede ser la misma que in
+        */
+        static void crypt_payload( const uint8_t key[16], uint32_t dev_addr, uint32_t fcnt, bool uplink, const uint8_t* in, uint8_t len, uint8_t* out );
+};
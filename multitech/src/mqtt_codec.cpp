@@ -0,0 +1,119 @@
+#include "mqtt_codec.h"
+#include <string.h>
+
+uint16_t Mqtt_codec::connect( uint8_t* out, uint16_t max_len, const char* client_id, uint16_t keepalive_s, bool clean_session ) {
+    static const uint8_t protocol[] = { 0, 4, 'M', 'Q', 'T', 'T', 4 };    // nombre y nivel 4 (3.1.1)
+
+    size_t id_len = strlen( client_id );
+    if ( id_len > UINT16_MAX ) {
+        return 0;
+    }
+    uint32_t remaining = sizeof( protocol ) + 1 + 2 + 2 + id_len;
+    uint32_t total     = fixed_header_len( remaining ) + remaining;
+    if ( total > max_len ) {
+        return 0;
+    }
+
+    uint16_t pos = fixed_header( out, mqtt_connect, 0, remaining );
+    memcpy( &out[pos], protocol, sizeof( protocol ) );
+    pos += sizeof( protocol );
+    out[pos++] = clean_session ? 0x02 : 0x00;
+    out[pos++] = keepalive_s >> 8;
+    out[pos++] = keepalive_s & 0xFF;
+    pos += put_string( &out[pos], client_id, id_len );
+    return pos;
+}
+
+uint16_t Mqtt_codec::publish_header( uint8_t* out, uint16_t max_len, const char* topic, uint16_t packet_id, uint32_t payload_len, bool dup ) {
+    size_t topic_len = strlen( topic );
+    if ( packet_id == 0 || topic_len > UINT16_MAX || payload_len > max_remaining_len - 4 - topic_len ) {
+        return 0;
+    }
+    uint32_t remaining = 2 + topic_len + 2 + payload_len;
+    uint32_t header    = fixed_header_len( remaining ) + remaining - payload_len;
+    if ( header + payload_len > max_len ) {
+        return 0;
+    }
+
+    // QoS1 en los bits 1-2; DUP en el bit 3
+    uint16_t pos = fixed_header( out, mqtt_publish, ( dup ? 0x08 : 0x00 ) | 0x02, remaining );
+    pos += put_string( &out[pos], topic, topic_len );
+    out[pos++] = packet_id >> 8;
+    out[pos++] = packet_id & 0xFF;
+    return pos;
+}
+
+uint16_t Mqtt_codec::pingreq( uint8_t* out, uint16_t max_len ) {
+    return max_len < 2 ? 0 : fixed_header( out, mqtt_pingreq, 0, 0 );
+}
+
+uint16_t Mqtt_codec::disconnect( uint8_t* out, uint16_t max_len ) {
+    return max_len < 2 ? 0 : fixed_header( out, mqtt_disconnect, 0, 0 );
+}
+
+int32_t Mqtt_codec::parse( const uint8_t* in, uint32_t len, Mqtt_frame_t& frame ) {
+    // Longitud restante: 7 bits por byte, el bit alto indica que sigue otro, como mucho 4 bytes
+    uint32_t remaining = 0;
+    uint8_t pos        = 1;
+    for ( ;; pos++ ) {
+        if ( pos > 4 ) {
+            return -1;
+        }
+        if ( pos >= len ) {
+            return 0;
+        }
+        remaining |= (uint32_t)( in[pos] & 0x7F ) << ( 7 * ( pos - 1 ) );
+        if ( ( in[pos] & 0x80 ) == 0 ) {
+            break;
+        }
+    }
+    pos++;
+    if ( len - pos < remaining ) {
+        return 0;
+    }
+
+    frame.type     = in[0] >> 4;
+    frame.flags    = in[0] & 0x0F;
+    frame.body     = &in[pos];
+    frame.body_len = remaining;
+    return pos + remaining;
+}
+
+bool Mqtt_codec::parse_connack( const Mqtt_frame_t& frame, bool& session_present, uint8_t& return_code ) {
+    if ( frame.type != mqtt_connack || frame.body_len != 2 ) {
+        return false;
+    }
+    session_present = ( frame.body[0] & 0x01 ) != 0;
+    return_code     = frame.body[1];
+    return true;
+}
+
+bool Mqtt_codec::parse_puback( const Mqtt_frame_t& frame, uint16_t& packet_id ) {
+    if ( frame.type != mqtt_puback || frame.body_len != 2 ) {
+        return false;
+    }
+    packet_id = ( (uint16_t)frame.body[0] << 8 ) | frame.body[1];
+    return packet_id != 0;
+}
+
+uint8_t Mqtt_codec::fixed_header( uint8_t* out, uint8_t type, uint8_t flags, uint32_t remaining_len ) {
+    uint8_t pos = 0;
+    out[pos++]  = ( type << 4 ) | flags;
+    do {
+        uint8_t digit = remaining_len & 0x7F;
+        remaining_len >>= 7;
+        out[pos++] = remaining_len > 0 ? digit | 0x80 : digit;
+    } while ( remaining_len > 0 );
+    return pos;
+}
+
+uint8_t Mqtt_codec::fixed_header_len( uint32_t remaining_len ) {
+    return remaining_len < 128 ? 2 : ( remaining_len < 16384 ? 3 : ( remaining_len < 2097152 ? 4 : 5 ) );
+}
+
+uint16_t Mqtt_codec::put_string( uint8_t* out, const char* str, uint16_t len ) {
+    out[0] = len >> 8;
+    out[1] = len & 0xFF;
+    memcpy( &out[2], str, len );
+    return 2 + len;
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+  \brief Tipos de paquete MQTT 3.1.1 que usa el gateway, en los 4 bits altos de la cabecera fija
+*/
+typedef enum : uint8_t {
+    mqtt_connect    = 1,
+    mqtt_connack    = 2,
+    mqtt_publish    = 3,
+    mqtt_puback     = 4,
+    mqtt_pingreq    = 12,
+    mqtt_pingresp   = 13,
+    mqtt_disconnect = 14
+} Mqtt_packet_t;
+
+/**
+  \brief Paquete MQTT recibido, apuntando al buffer de entrada
+*/
+typedef struct {
+    uint8_t type;               ///< Mqtt_packet_t, o cualquier otro tipo que envie el broker
+    uint8_t flags;              ///< 4 bits bajos de la cabecera fija
+    const uint8_t* body;        ///< Cabecera variable y payload
+    uint32_t body_len;
+} Mqtt_frame_t;
+
+/**
+  \class Mqtt_codec
+  \brief Codificacion de los paquetes MQTT 3.1.1 de un publicador QoS1: CONNECT, PUBLISH, PINGREQ y
+  DISCONNECT de salida, CONNACK, PUBACK y PINGRESP de entrada. Escribe en un buffer de tamanyo
+  conocido y devuelve 0 si el paquete no cabe, sin dejar nada a medias que se vaya a enviar
+*/
+class Mqtt_codec {
+
+    public:
+
+        static const uint32_t max_remaining_len = 268435455;   ///< 4 bytes de longitud restante
+
+        /**
+          \brief Escribe un CONNECT sin usuario, clave ni mensaje de ultima voluntad
+          \param out Buffer de salida
+          \param max_len Tamanyo del buffer
+          \param client_id Identificador del cliente, clave de la sesion persistente en el broker
+          \param keepalive_s Silencio maximo del cliente antes de que el broker cierre [s]
+          \param clean_session false para conservar la sesion y los QoS1 sin confirmar al reconectar
+          \return Longitud del paquete, 0 si no cabe
+        */
+        static uint16_t connect( uint8_t* out, uint16_t max_len, const char* client_id, uint16_t keepalive_s, bool clean_session );
+
+        /**
+          \brief Escribe la cabecera de un PUBLISH QoS1; el llamante escribe despues payload_len bytes
+          \param out Buffer de salida
+          \param max_len Tamanyo del buffer, tambien para el payload
+          \param topic Topic de publicacion
+          \param packet_id Identificador del paquete, de 1 a 65535
+          \param payload_len Longitud del payload
+          \param dup true si es un reenvio tras reconectar
+          \return Longitud de la cabecera, 0 si el paquete completo no cabe
+        */
+        static uint16_t publish_header( uint8_t* out, uint16_t max_len, const char* topic, uint16_t packet_id, uint32_t payload_len, bool dup );
+
+        /**
+          \brief Escribe un PINGREQ
+          \return Longitud del paquete, 0 si no cabe
+        */
+        static uint16_t pingreq( uint8_t* out, uint16_t max_len );
+
+        /**
+          \brief Escribe un DISCONNECT
+          \return Longitud del paquete, 0 si no cabe
+        */
+        static uint16_t disconnect( uint8_t* out, uint16_t max_len );
+
+        /**
+          \brief Extrae el primer paquete completo de los bytes recibidos
+          \param in Bytes recibidos
+          \param len Numero de bytes
+          \param frame Paquete extraido
+          \return Bytes del paquete, 0 si aun no esta completo, -1 si la longitud restante es invalida
+        */
+        static int32_t parse( const uint8_t* in, uint32_t len, Mqtt_frame_t& frame );
+
+        /**
+          \brief Interpreta un CONNACK
+          \param frame Paquete recibido
+          \param session_present true si el broker conservaba la sesion
+          \param return_code 0 si acepta la conexion
+          \return false si no es un CONNACK valido
+        */
+        static bool parse_connack( const Mqtt_frame_t& frame, bool& session_present, uint8_t& return_code );
+
+        /**
+          \brief Interpreta un PUBACK
+          \param frame Paquete recibido
+          \param packet_id Identificador del PUBLISH confirmado
+          \return false si no es un PUBACK valido
+        */
+        static bool parse_puback( const Mqtt_frame_t& frame, uint16_t& packet_id );
+
+    private:
+
+        /**
+          \brief Escribe la cabecera fija: tipo, flags y longitud restante en base 128
+          \return Longitud de la cabecera
+        */
+        static uint8_t fixed_header( uint8_t* out, uint8_t type, uint8_t flags, uint32_t remaining_len );
+
+        /**
+          \brief Longitud de la cabecera fija para una longitud restante
+        */
+        static uint8_t fixed_header_len( uint32_t remaining_len );
+
+        /**
+          \brief Escribe una cadena MQTT: longitud en 2 bytes big endian y los caracteres
+          \return Bytes escritos
+        */
+        static uint16_t put_string( uint8_t* out, const char* str, uint16_t len );
+};
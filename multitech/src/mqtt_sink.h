@@ -0,0 +1,861 @@
+#pragma once
+
+#include <stdint.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "pkt_log.h"
+#include "upload_sink.h"
+#include "pkt_encoder.h"
+#include "mqtt_codec.h"
+#include "event_loop.h"
+#include "timer_fd.h"
+
+/**
+  \brief Estadisticas de la conexion de un Mqtt_sink con el broker
+*/
+typedef struct {
+    bool connected;             ///< Conexion aceptada por el broker y abierta
+    uint32_t connects;          ///< Conexiones aceptadas por el broker
+    uint32_t resumed;           ///< Conexiones en las que el broker conservaba la sesion
+    uint32_t lost;              ///< Conexiones caidas, rechazadas o sin respuesta a tiempo
+    uint32_t pings;             ///< PINGREQ enviados por inactividad
+    uint64_t bytes_out;         ///< Bytes escritos en el socket
+    uint64_t bytes_in;          ///< Bytes leidos del socket
+} Mqtt_link_stats_t;
+
+/**
+  \brief Cambios de la conexion de un Mqtt_sink con el broker
+*/
+typedef enum : uint8_t {
+    mqtt_event_connect_failed,  ///< Fallo la conexion TCP. detail: errno
+    mqtt_event_not_resolved,    ///< No se resolvio el nombre del broker
+    mqtt_event_refused,         ///< CONNACK con error o fuera de lugar. detail: codigo de retorno
+    mqtt_event_connected,       ///< Sesion abierta. detail: 1 si el broker conservaba la sesion
+    mqtt_event_lost,            ///< Se cayo una sesion abierta
+    mqtt_event_connect_timeout, ///< Sin CONNACK a tiempo
+    mqtt_event_puback_timeout,  ///< Sin PUBACK a tiempo. detail: espera [ms]
+    mqtt_event_pingresp_timeout ///< Sin PINGRESP a tiempo
+} Mqtt_event_t;
+
+/**
+  \brief Callback de un cambio de la conexion, desde el bucle de eventos
+  \param arg Argumento registrado junto al callback
+  \param event Cambio de la conexion
+  \param detail Dato del cambio, segun Mqtt_event_t
+*/
+typedef void ( *Mqtt_event_cb_t )( void* arg, Mqtt_event_t event, uint32_t detail );
+
+/**
+  \class Mqtt_sink
+  \brief Destino de subida MQTT 3.1.1: publica cada pkt de su lector de un Pkt_log con QoS1 en
+  "<prefijo>/<mobile_id>" sobre una conexion TCP persistente registrada en el bucle de eventos.
+  Hasta window PUBLISH esperan su PUBACK a la vez; los pkts siguen pendientes en el log hasta el
+  PUBACK y se confirman en orden. Con lotes (set_batch) los PUBLISH se agrupan y salen en una sola
+  escritura. La sesion es persistente (clean session a 0 y client id fijo): al reconectar se
+  reenvian con DUP los PUBLISH sin confirmar, con los mismos identificadores. Sink_health espacia
+  las reconexiones, abre el cortocircuito y adapta el timeout de CONNACK, PUBACK y PINGRESP a la
+  latencia medida; sin respuesta a tiempo se da la conexion por perdida. Perder una conexion de
+  prueba durante un corte no gasta intentos de los pkts. La resolucion del nombre
+  del broker bloquea: solo se repite tras un fallo al conectar. Solo se usa desde el thread del bucle.
+  El payload es bytes() de get_size() bytes del elemento T
+*/
+template <typename T>
+class Mqtt_sink : public Upload_sink<T> {
+
+    public:
+
+        static const uint8_t max_window            = 32;   ///< PUBLISH sin PUBACK
+        static const uint8_t max_batch             = 16;   ///< PUBLISH por escritura
+        static const uint16_t tx_max_len           = 4096; ///< Caben max_batch pkts de 200 bytes sin codificar
+        static const uint16_t rx_max_len           = 256;
+        static const uint8_t default_max_attempts  = 10;
+        static const uint16_t default_keepalive_s  = 60;
+
+        /**
+          \brief Constructor de la clase
+          \param queue_0 Lector del log de pkts a subir
+          \param host_0 Nombre o direccion del broker
+          \param port_0 Puerto TCP del broker
+          \param mobile_id_0 Identificador del gateway: client id y ultimo nivel del topic
+          \param topic_prefix_0 Prefijo del topic de publicacion
+          \param window_0 PUBLISH sin confirmar maximos, de 1 a max_window
+          \param seed Semilla del jitter de las reconexiones, distinta por destino
+        */
+        Mqtt_sink( Pkt_log_reader<T>& queue_0, const char* host_0, uint16_t port_0, const char* mobile_id_0,
+                   const char* topic_prefix_0, uint8_t window_0, uint32_t seed ) :
+            queue( queue_0 ),
+            host( host_0 ),
+            port( port_0 ),
+            mobile_id( mobile_id_0 ),
+            topic_prefix( topic_prefix_0 ),
+            window( window_0 == 0 ? 1 : ( window_0 > max_window ? max_window : window_0 ) ),
+            max_attempts( default_max_attempts ),
+            encoding( pkt_encoding_raw ),
+            keepalive_s( default_keepalive_s ),
+            loop( NULL ),
+            result_cb( NULL ),
+            result_arg( NULL ),
+            event_cb( NULL ),
+            event_arg( NULL ),
+            batch_pkts( 1 ),
+            batch_age_ms( 0 ),
+            lingering( false ),
+            linger_expired( false ),
+            health( seed ),
+            fd( -1 ),
+            state( link_down ),
+            resolved( false ),
+            addr_len( 0 ),
+            connect_failures( 0 ),
+            next_connect_ms( 0 ),
+            connect_ms( 0 ),
+            last_tx_ms( 0 ),
+            ping_ms( 0 ),
+            ping_pending( false ),
+            want_out( false ),
+            probe_link( false ),
+            started( 0 ),
+            written( 0 ),
+            popped( 0 ),
+            tx_len( 0 ),
+            tx_sent( 0 ),
+            rx_len( 0 ) {
+            memset( &addr, 0, sizeof( addr ) );
+            memset( client_id, 0, sizeof( client_id ) );
+            memset( topic, 0, sizeof( topic ) );
+            memset( flights, 0, sizeof( flights ) );
+            memset( &stats, 0, sizeof( stats ) );
+            memset( &link, 0, sizeof( link ) );
+        }
+
+        /**
+          \brief Destructor de la clase
+        */
+        ~Mqtt_sink() {
+            if ( fd != -1 ) {
+                close( fd );
+            }
+        }
+
+        Mqtt_sink( const Mqtt_sink& )            = delete;
+        Mqtt_sink& operator=( const Mqtt_sink& ) = delete;
+
+        /**
+          \brief Registra los temporizadores en el bucle. La conexion se abre con el primer pkt
+          \param loop_0 Bucle de eventos del gateway
+          \return Error de inicializacion
+        */
+        bool init( Event_loop& loop_0 ) {
+            loop = &loop_0;
+            return linger_timer.init() && loop->add( linger_timer.get_fd(), EPOLLIN, on_linger, this ) &&
+                   timer.init() && loop->add( timer.get_fd(), EPOLLIN, on_timer, this );
+        }
+
+        /**
+          \brief Fija la codificacion del payload; por defecto el pkt sin codificar
+        */
+        void set_encoding( Pkt_encoding_t encoding_0 ) {
+            encoding = encoding_0;
+        }
+
+        /**
+          \brief Fija el keepalive del CONNECT. Antes de la primera conexion
+          \param keepalive_s Silencio maximo antes de enviar un PINGREQ [s]
+        */
+        void set_keepalive( uint16_t keepalive_s_0 ) {
+            keepalive_s = keepalive_s_0;
+        }
+
+        /**
+          \brief Fija los limites del timeout adaptativo de CONNACK, PUBACK y PINGRESP
+          \param min_ms Timeout minimo [ms]
+          \param max_ms Timeout maximo, el de la primera conexion [ms]
+        */
+        void set_timeouts( uint32_t min_ms, uint32_t max_ms ) {
+            health.set_timeout_bounds( min_ms, max_ms );
+        }
+
+        /**
+          \brief Fija el callback de los cambios de la conexion; sin callback no se avisa
+        */
+        void set_event_cb( Mqtt_event_cb_t cb, void* arg ) {
+            event_cb  = cb;
+            event_arg = arg;
+        }
+
+        /**
+          \brief Activa los lotes: hasta max_pkts PUBLISH en una escritura
+          \param max_pkts PUBLISH maximos por escritura, de 1 a max_batch
+          \param max_age_ms Espera maxima de un lote incompleto [ms]
+        */
+        void set_batch( uint8_t max_pkts, uint32_t max_age_ms ) override {
+            batch_pkts   = max_pkts == 0 ? 1 : ( max_pkts > max_batch ? max_batch : max_pkts );
+            batch_age_ms = max_age_ms;
+        }
+
+        /**
+          \brief Fija las esperas entre reconexiones y los envios de un pkt antes de abandonarlo
+          \param base_ms Primera espera [ms]
+          \param max_ms Espera maxima [ms]
+          \param max_attempts Conexiones perdidas sin el PUBACK de un pkt antes de abandonarlo. No
+          cuentan las conexiones de prueba tras abrirse el cortocircuito hasta que confirman un PUBLISH
+        */
+        void set_retry( uint32_t base_ms, uint32_t max_ms, uint8_t max_attempts_0 ) override {
+            health.set_backoff( base_ms, max_ms );
+            max_attempts = max_attempts_0 == 0 ? 1 : max_attempts_0;
+        }
+
+        /**
+          \brief Fija el callback de pkts terminados. Un pkt falla cada vez que se pierde la conexion
+          sin su PUBACK; sin callback se reenvia al reconectar
+        */
+        void set_result_cb( Upload_result_cb_t<T> cb, void* arg ) override {
+            result_cb  = cb;
+            result_arg = arg;
+        }
+
+        /**
+          \brief Abre la conexion si hay pkts y ha pasado la espera, o publica los pendientes
+          mientras quepan en la ventana
+        */
+        void pump( void ) override {
+            if ( loop == NULL ) {
+                return;
+            }
+            uint32_t now = now_ms();
+
+            if ( state == link_down ) {
+                if ( ( started > 0 || queue.available() > 0 ) && (int32_t)( now - next_connect_ms ) >= 0 && health.allow( now ) ) {
+                    open( now );
+                }
+                arm_timer( now );
+                return;
+            }
+
+            // Con una escritura a medias se sigue con EPOLLOUT
+            while ( state == link_up && tx_len == 0 ) {
+                uint8_t n = 0;
+                while ( n < batch_pkts && written < queue.available() && written < window ) {
+                    // Un PUBACK fuera de orden deja confirmados detras de pendientes: no se reenvian
+                    if ( written < started && flights[( popped + written ) % max_window].done ) {
+                        written++;
+                        continue;
+                    }
+                    if ( written >= started && n == 0 && !linger_expired ) {
+                        // Lote incompleto: se espera a que llegue mas o a que caduque
+                        uint16_t unsent = queue.available() - started;
+                        if ( unsent < batch_pkts && unsent < window - started ) {
+                            if ( !lingering ) {
+                                lingering = true;
+                                linger_timer.start( batch_age_ms );
+                            }
+                            break;
+                        }
+                    }
+                    if ( !write_publish( written, now ) ) {
+                        break;
+                    }
+                    written++;
+                    n++;
+                }
+                if ( n == 0 ) {
+                    break;
+                }
+
+                stats.started++;
+                linger_expired = false;
+                if ( lingering ) {
+                    linger_timer.stop();
+                    lingering = false;
+                }
+                if ( !flush( now ) ) {
+                    drop( now );
+                    break;
+                }
+            }
+            queue.set_in_use( started );
+            arm_timer( now );
+        }
+
+        /**
+          \brief Devuelve las estadisticas del destino
+        */
+        Upload_sink_stats_t get_stats( void ) const override {
+            Upload_sink_stats_t current = stats;
+            for ( uint16_t i = 0; i < started; i++ ) {
+                if ( flights[( popped + i ) % max_window].done ) {
+                    continue;
+                }
+                if ( i < written ) {
+                    current.in_flight++;
+                }
+                else {
+                    current.retry_lane++;
+                }
+            }
+            return current;
+        }
+
+        /**
+          \brief Devuelve la salud del destino
+        */
+        Sink_health_report_t get_health( void ) const override {
+            return health.get_report();
+        }
+
+        /**
+          \brief Devuelve las estadisticas de la conexion con el broker
+        */
+        Mqtt_link_stats_t get_link_stats( void ) const {
+            Mqtt_link_stats_t current = link;
+            current.connected         = state == link_up;
+            return current;
+        }
+
+    private:
+
+        typedef enum : uint8_t {
+            link_down,                  ///< Sin conexion, esperando para reconectar
+            link_connecting,            ///< Conexion TCP en curso
+            link_wait_connack,          ///< CONNECT enviado
+            link_up                     ///< Sesion abierta
+        } Link_state_t;
+
+        /**
+          \brief PUBLISH de uno de los started pkts de cabeza, indexado por posicion absoluta % max_window
+        */
+        typedef struct {
+            uint32_t sent_ms;           ///< Ultimo envio [ms]
+            uint8_t attempts;           ///< Conexiones perdidas sin su PUBACK que cuentan como intento
+            bool done;                  ///< Confirmado o descartado, sale al llegar a la cabeza
+        } Flight_t;
+
+        static const uint8_t client_id_max_len = 24;   ///< 23 caracteres, lo que todo broker 3.1.1 acepta
+        static const uint8_t topic_max_len     = 128;
+
+        static void on_socket( void* arg, uint32_t events ) {
+            Mqtt_sink* sink = (Mqtt_sink*)arg;
+            uint32_t now    = now_ms();
+
+            if ( sink->state == link_connecting ) {
+                int error     = 0;
+                socklen_t len = sizeof( error );
+                if ( getsockopt( sink->fd, SOL_SOCKET, SO_ERROR, &error, &len ) != 0 || error != 0 ) {
+                    sink->notify( mqtt_event_connect_failed, error );
+                    sink->drop( now );
+                    sink->pump();
+                    return;
+                }
+                if ( ( events & EPOLLOUT ) == 0 ) {
+                    return;
+                }
+                // Sesion persistente: el broker guarda los QoS1 sin confirmar hasta que volvamos
+                sink->tx_len = Mqtt_codec::connect( sink->tx, tx_max_len, sink->client_id, sink->keepalive_s, false );
+                sink->state  = link_wait_connack;
+            }
+
+            bool alive = true;
+            if ( ( events & ( EPOLLIN | EPOLLERR | EPOLLHUP ) ) != 0 ) {
+                alive = sink->receive( now );
+            }
+            if ( alive && sink->tx_sent < sink->tx_len && !sink->flush( now ) ) {
+                sink->drop( now );
+            }
+            sink->pump();
+        }
+
+        static void on_linger( void* arg, uint32_t events ) {
+            (void)events;
+            Mqtt_sink* sink = (Mqtt_sink*)arg;
+            sink->linger_timer.consume();
+            sink->lingering      = false;
+            sink->linger_expired = true;
+            sink->pump();
+        }
+
+        static void on_timer( void* arg, uint32_t events ) {
+            (void)events;
+            Mqtt_sink* sink = (Mqtt_sink*)arg;
+            sink->timer.consume();
+            sink->check_timeouts( now_ms() );
+            sink->pump();
+        }
+
+        static uint32_t now_ms( void ) {
+            struct timespec now;
+            clock_gettime( CLOCK_MONOTONIC, &now );
+            return (uint32_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+        }
+
+        /**
+          \brief Espera hasta un instante, 0 si ya paso [ms]
+        */
+        static uint32_t until( uint32_t now, uint32_t deadline ) {
+            // Un plazo vencido se atiende en el siguiente disparo
+            return (int32_t)( deadline - now ) > 0 ? deadline - now : 0;
+        }
+
+        /**
+          \brief Identificador MQTT del pkt de una posicion absoluta, de 1 a 65535
+        */
+        static uint16_t packet_id( uint32_t seq ) {
+            // El 0 no es un identificador valido
+            return seq % UINT16_MAX + 1;
+        }
+
+        /**
+          \brief Avisa de un cambio de la conexion si hay callback
+        */
+        void notify( Mqtt_event_t event, uint32_t detail ) {
+            if ( event_cb != NULL ) {
+                event_cb( event_arg, event, detail );
+            }
+        }
+
+        /**
+          \brief Arranca la conexion no bloqueante con el broker
+        */
+        void open( uint32_t now ) {
+            probe_link = health.get_state() == breaker_half_open;
+            health.on_start();
+            connect_ms = now;
+            if ( client_id[0] == '\0' ) {
+                snprintf( client_id, sizeof( client_id ), "%s", mobile_id );
+                snprintf( topic, sizeof( topic ), "%s/%s", topic_prefix, mobile_id );
+            }
+
+            if ( !resolved ) {
+                char service[8];
+                snprintf( service, sizeof( service ), "%u", port );
+                struct addrinfo hints;
+                struct addrinfo* result = NULL;
+                memset( &hints, 0, sizeof( hints ) );
+                hints.ai_family   = AF_UNSPEC;
+                hints.ai_socktype = SOCK_STREAM;
+                if ( getaddrinfo( host, service, &hints, &result ) != 0 || result == NULL ) {
+                    notify( mqtt_event_not_resolved, 0 );
+                    drop( now );
+                    return;
+                }
+                memcpy( &addr, result->ai_addr, result->ai_addrlen );
+                addr_len = result->ai_addrlen;
+                resolved = true;
+                freeaddrinfo( result );
+            }
+
+            fd = socket( addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0 );
+            if ( fd == -1 ) {
+                drop( now );
+                return;
+            }
+            // Los PUBLISH ya salen agrupados: Nagle solo retrasaria el lote
+            int one = 1;
+            setsockopt( fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof( one ) );
+            if ( connect( fd, (const struct sockaddr*)&addr, addr_len ) != 0 && errno != EINPROGRESS ) {
+                drop( now );
+                return;
+            }
+            if ( !loop->add( fd, EPOLLIN | EPOLLOUT, on_socket, this ) ) {
+                drop( now );
+                return;
+            }
+            want_out = true;
+            state    = link_connecting;
+        }
+
+        /**
+          \brief Cierra la conexion tras un fallo. Los pkts enviados por ella sin PUBACK fallan: salen
+          por el veredicto o por agotar los intentos, o se reenvian al reconectar
+        */
+        void drop( uint32_t now ) {
+            if ( fd != -1 ) {
+                loop->remove( fd );
+                close( fd );
+                fd = -1;
+            }
+            if ( state == link_up ) {
+                notify( mqtt_event_lost, 0 );
+            }
+            else {
+                // Puede haber cambiado la direccion del broker
+                resolved = false;
+            }
+            state        = link_down;
+            tx_len       = 0;
+            tx_sent      = 0;
+            rx_len       = 0;
+            ping_pending = false;
+            link.lost++;
+            health.on_failure( now );
+            if ( connect_failures < UINT8_MAX ) {
+                connect_failures++;
+            }
+            next_connect_ms = now + health.retry_delay_ms( connect_failures );
+
+            // Solo fallan los pkts enviados por esta conexion; el resto sigue esperando su turno. Una conexion
+            // de prueba que no llego a confirmar nada cae con el destino, no por sus pkts: no gasta intentos
+            for ( uint16_t i = 0; i < written; i++ ) {
+                Flight_t& flight = flights[( popped + i ) % max_window];
+                if ( flight.done || i >= started ) {
+                    continue;
+                }
+                stats.failed++;
+                if ( !probe_link && flight.attempts < UINT8_MAX ) {
+                    flight.attempts++;
+                }
+                if ( result_cb != NULL && result_cb( result_arg, queue.peek( i ), false, 0 ) == upload_drop ) {
+                    stats.dropped++;
+                    flight.done = true;
+                }
+                else if ( flight.attempts >= max_attempts ) {
+                    stats.abandoned++;
+                    flight.done = true;
+                }
+            }
+            written = 0;
+            pop_done();
+        }
+
+        /**
+          \brief Escribe lo pendiente de tx sin bloquear y vigila EPOLLOUT si queda algo
+          \return false si el socket fallo
+        */
+        bool flush( uint32_t now ) {
+            while ( tx_sent < tx_len ) {
+                ssize_t sent = send( fd, &tx[tx_sent], tx_len - tx_sent, MSG_NOSIGNAL );
+                if ( sent > 0 ) {
+                    tx_sent += sent;
+                    link.bytes_out += sent;
+                    last_tx_ms = now;
+                }
+                else if ( errno == EAGAIN || errno == EWOULDBLOCK ) {
+                    break;
+                }
+                else if ( errno != EINTR ) {
+                    return false;
+                }
+            }
+            if ( tx_sent == tx_len ) {
+                tx_len  = 0;
+                tx_sent = 0;
+            }
+
+            bool out = tx_len > 0;
+            if ( out != want_out ) {
+                want_out = out;
+                loop->modify( fd, out ? EPOLLIN | EPOLLOUT : EPOLLIN );
+            }
+            return true;
+        }
+
+        /**
+          \brief Lee del socket y procesa los paquetes completos
+          \return false si se perdio la conexion
+        */
+        bool receive( uint32_t now ) {
+            for ( ;; ) {
+                ssize_t len = recv( fd, &rx[rx_len], rx_max_len - rx_len, 0 );
+                if ( len == 0 || ( len < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR ) ) {
+                    drop( now );
+                    return false;
+                }
+                if ( len < 0 ) {
+                    if ( errno == EINTR ) {
+                        continue;
+                    }
+                    break;
+                }
+                rx_len += len;
+                link.bytes_in += len;
+
+                uint16_t pos = 0;
+                for ( ;; ) {
+                    Mqtt_frame_t frame;
+                    int32_t used = Mqtt_codec::parse( &rx[pos], rx_len - pos, frame );
+                    if ( used < 0 ) {
+                        drop( now );
+                        return false;
+                    }
+                    if ( used == 0 ) {
+                        break;
+                    }
+                    if ( !handle( frame, now ) ) {
+                        return false;
+                    }
+                    pos += used;
+                }
+                memmove( rx, &rx[pos], rx_len - pos );
+                rx_len -= pos;
+
+                // Un paquete que no cabe en rx no es de un publicador: el broker no habla nuestro protocolo
+                if ( rx_len == rx_max_len ) {
+                    drop( now );
+                    return false;
+                }
+            }
+            pop_done();
+            return true;
+        }
+
+        /**
+          \brief Procesa un paquete del broker
+          \return false si se perdio la conexion
+        */
+        bool handle( const Mqtt_frame_t& frame, uint32_t now ) {
+            switch ( frame.type ) {
+                case mqtt_connack: {
+                    bool session_present = false;
+                    uint8_t return_code  = 0;
+                    if ( state != link_wait_connack || !Mqtt_codec::parse_connack( frame, session_present, return_code ) || return_code != 0 ) {
+                        notify( mqtt_event_refused, return_code );
+                        drop( now );
+                        return false;
+                    }
+                    notify( mqtt_event_connected, session_present );
+                    state            = link_up;
+                    connect_failures = 0;
+                    health.on_success( now - connect_ms );
+                    link.connects++;
+                    if ( session_present ) {
+                        link.resumed++;
+                    }
+                    break;
+                }
+                case mqtt_puback: {
+                    uint16_t id = 0;
+                    if ( !Mqtt_codec::parse_puback( frame, id ) ) {
+                        break;
+                    }
+                    for ( uint16_t i = 0; i < written && i < started; i++ ) {
+                        Flight_t& flight = flights[( popped + i ) % max_window];
+                        if ( flight.done || packet_id( popped + i ) != id ) {
+                            continue;
+                        }
+                        flight.done = true;
+                        probe_link  = false;
+                        health.on_success( now - flight.sent_ms );
+                        stats.delivered++;
+                        if ( result_cb != NULL ) {
+                            result_cb( result_arg, queue.peek( i ), true, 0 );
+                        }
+                        break;
+                    }
+                    break;
+                }
+                case mqtt_pingresp:
+                    ping_pending = false;
+                    break;
+                default:
+                    // Un publicador no se suscribe: cualquier otro paquete se ignora
+                    break;
+            }
+            return true;
+        }
+
+        /**
+          \brief Anyade a tx el PUBLISH del pkt i-esimo de la cola, nuevo o reenvio
+          \return false si no cabe
+        */
+        bool write_publish( uint16_t i, uint32_t now ) {
+            const T& pkt     = *queue.peek( i );
+            uint32_t seq     = popped + i;
+            bool dup         = i < started;
+            uint16_t room    = tx_max_len - tx_len;
+            uint32_t payload = encoding == pkt_encoding_raw ? pkt.get_size() : Pkt_encoder::encoded_len( encoding, pkt.bytes(), pkt.get_size() );
+
+            // Las codificaciones de texto escriben un '\0' detras del payload que no se envia
+            uint16_t reserve = encoding == pkt_encoding_raw ? 0 : 1;
+            uint16_t header  = Mqtt_codec::publish_header( &tx[tx_len], room - reserve, topic, packet_id( seq ), payload, dup );
+            if ( header == 0 ) {
+                return false;
+            }
+            if ( encoding == pkt_encoding_raw ) {
+                memcpy( &tx[tx_len + header], pkt.bytes(), payload );
+            }
+            else {
+                Pkt_encoder::encode( encoding, pkt.bytes(), pkt.get_size(), (char*)&tx[tx_len + header], room - header );
+            }
+            tx_len += header + payload;
+
+            Flight_t& flight = flights[seq % max_window];
+            if ( dup ) {
+                stats.retried++;
+            }
+            else {
+                flight.done     = false;
+                flight.attempts = 0;
+                started++;
+            }
+            flight.sent_ms = now;
+            stats.batched++;
+            return true;
+        }
+
+        /**
+          \brief Da la conexion por perdida si vencio la espera de CONNACK, PUBACK o PINGRESP y envia
+          un PINGREQ si toca
+          \return false si se perdio la conexion
+        */
+        bool check_timeouts( uint32_t now ) {
+            if ( state == link_down ) {
+                return true;
+            }
+            uint32_t timeout = health.get_timeout_ms();
+            if ( state != link_up ) {
+                if ( now - connect_ms >= timeout ) {
+                    notify( mqtt_event_connect_timeout, 0 );
+                    drop( now );
+                    return false;
+                }
+                return true;
+            }
+
+            // Los PUBLISH de una conexion salen en orden: el primero sin confirmar es el mas antiguo
+            for ( uint16_t i = 0; i < written && i < started; i++ ) {
+                const Flight_t& flight = flights[( popped + i ) % max_window];
+                if ( flight.done ) {
+                    continue;
+                }
+                if ( now - flight.sent_ms >= timeout ) {
+                    notify( mqtt_event_puback_timeout, now - flight.sent_ms );
+                    drop( now );
+                    return false;
+                }
+                break;
+            }
+            if ( ping_pending && now - ping_ms >= timeout ) {
+                notify( mqtt_event_pingresp_timeout, 0 );
+                drop( now );
+                return false;
+            }
+
+            // Sin nada que enviar en keepalive_s el broker cerraria la conexion
+            if ( !ping_pending && tx_len == 0 && keepalive_s > 0 && now - last_tx_ms >= keepalive_s * 1000UL ) {
+                tx_len       = Mqtt_codec::pingreq( tx, tx_max_len );
+                ping_pending = true;
+                ping_ms      = now;
+                link.pings++;
+                if ( !flush( now ) ) {
+                    drop( now );
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /**
+          \brief Arma timer para la siguiente reconexion, timeout o PINGREQ
+        */
+        void arm_timer( uint32_t now ) {
+            uint32_t wait    = UINT32_MAX;
+            uint32_t timeout = health.get_timeout_ms();
+            switch ( state ) {
+                case link_down:
+                    if ( started > 0 || queue.available() > 0 ) {
+                        wait = health.wait_ms( now );
+                        if ( (int32_t)( next_connect_ms - now ) > (int32_t)wait ) {
+                            wait = next_connect_ms - now;
+                        }
+                    }
+                    break;
+                case link_connecting:
+                case link_wait_connack:
+                    wait = until( now, connect_ms + timeout );
+                    break;
+                case link_up:
+                    for ( uint16_t i = 0; i < written && i < started; i++ ) {
+                        const Flight_t& flight = flights[( popped + i ) % max_window];
+                        if ( !flight.done ) {
+                            wait = until( now, flight.sent_ms + timeout );
+                            break;
+                        }
+                    }
+                    if ( ping_pending && until( now, ping_ms + timeout ) < wait ) {
+                        wait = until( now, ping_ms + timeout );
+                    }
+                    if ( !ping_pending && keepalive_s > 0 && until( now, last_tx_ms + keepalive_s * 1000UL ) < wait ) {
+                        wait = until( now, last_tx_ms + keepalive_s * 1000UL );
+                    }
+                    break;
+            }
+            if ( wait == UINT32_MAX ) {
+                timer.stop();
+            }
+            else {
+                timer.start( wait );
+            }
+        }
+
+        /**
+          \brief Saca de la cola los pkts terminados contiguos desde la cabeza
+        */
+        void pop_done( void ) {
+            while ( started > 0 && flights[popped % max_window].done ) {
+                queue.pop();
+                popped++;
+                started--;
+                if ( written > 0 ) {
+                    written--;
+                }
+            }
+            queue.set_in_use( started );
+        }
+
+        Pkt_log_reader<T>& queue;
+        const char* host;
+        uint16_t port;
+        const char* mobile_id;
+        const char* topic_prefix;
+        uint8_t window;
+        uint8_t max_attempts;
+        Pkt_encoding_t encoding;
+        uint16_t keepalive_s;
+        Event_loop* loop;
+        Upload_result_cb_t<T> result_cb;
+        void* result_arg;
+        Mqtt_event_cb_t event_cb;
+        void* event_arg;
+        uint8_t batch_pkts;
+        uint32_t batch_age_ms;
+        Timer_fd linger_timer;              ///< Espera de un lote incompleto
+        bool lingering;                     ///< linger_timer armado
+        bool linger_expired;                ///< El lote incompleto ya espero batch_age_ms
+        Timer_fd timer;                     ///< Reconexion, timeouts y keepalive
+        Sink_health health;
+
+        int fd;
+        Link_state_t state;
+        bool resolved;                      ///< addr valida
+        struct sockaddr_storage addr;
+        socklen_t addr_len;
+        char client_id[client_id_max_len];
+        char topic[topic_max_len];
+        uint8_t connect_failures;           ///< Conexiones fallidas seguidas
+        uint32_t next_connect_ms;           ///< Instante de la siguiente conexion [ms]
+        uint32_t connect_ms;                ///< Inicio de la conexion en curso [ms]
+        uint32_t last_tx_ms;                ///< Ultima escritura en el socket [ms]
+        uint32_t ping_ms;                   ///< Envio del PINGREQ sin respuesta [ms]
+        bool ping_pending;
+        bool want_out;                      ///< EPOLLOUT vigilado
+        bool probe_link;                    ///< Conexion de prueba del cortocircuito, hasta su primer PUBACK
+
+        Flight_t flights[max_window];
+        uint16_t started;                   ///< Pkts de cabeza de cola publicados alguna vez, confirmados o no
+        uint16_t written;                   ///< Pkts de cabeza de cola publicados por la conexion actual
+        uint32_t popped;                    ///< Pkts sacados de la cola desde el arranque
+        uint8_t tx[tx_max_len];
+        uint16_t tx_len;
+        uint16_t tx_sent;
+        uint8_t rx[rx_max_len];
+        uint16_t rx_len;
+        Upload_sink_stats_t stats;
+        Mqtt_link_stats_t link;
+};
@@ -0,0 +1,188 @@
+#include "pkt_admission.h"
+#include <string.h>
+#include <time.h>
+
+static const uint32_t token = 1000;     // Un token en milesimas
+
+Pkt_admission::Pkt_admission() : per_minute( 0 ), burst( 0 ) {
+    pthread_mutex_init( &lock, NULL );
+    for ( uint16_t i = 0; i < 256; i++ ) {
+        classes[i] = admission_unclassified;
+    }
+    watermarks[admission_alarm]        = 100;
+    watermarks[admission_position]     = 90;
+    watermarks[admission_periodic]     = 75;
+    watermarks[admission_unclassified] = 100;
+    memset( stats, 0, sizeof( stats ) );
+    memset( devices, 0, sizeof( devices ) );
+}
+
+Pkt_admission::~Pkt_admission() {
+    pthread_mutex_destroy( &lock );
+}
+
+void Pkt_admission::set_class( uint8_t cmd, Admission_class_t cls ) {
+    if ( cls < n_admission_classes ) {
+        pthread_mutex_lock( &lock );
+        classes[cmd] = cls;
+        pthread_mutex_unlock( &lock );
+    }
+}
+
+void Pkt_admission::set_watermark( Admission_class_t cls, uint8_t percent ) {
+    if ( cls < n_admission_classes ) {
+        pthread_mutex_lock( &lock );
+        watermarks[cls] = percent == 0 ? 1 : percent > 100 ? 100 : percent;
+        pthread_mutex_unlock( &lock );
+    }
+}
+
+void Pkt_admission::set_rate( uint16_t per_minute_0, uint16_t burst_0 ) {
+    pthread_mutex_lock( &lock );
+    per_minute = per_minute_0;
+    burst      = burst_0 > 0 ? burst_0 : 1;
+    // Los cubos empiezan llenos con el nuevo tamanyo
+    for ( uint16_t i = 0; i < max_devices; i++ ) {
+        devices[i].tokens = (uint32_t)burst * token;
+    }
+    pthread_mutex_unlock( &lock );
+}
+
+Pkt_admission::Device_admission_t* Pkt_admission::lookup( uint32_t device, uint32_t now_ms ) {
+    uint32_t hash = 2166136261UL;
+    for ( uint8_t i = 0; i < sizeof( device ); i++ ) {
+        hash = ( hash ^ (uint8_t)( device >> ( 8 * i ) ) ) * 16777619UL;
+    }
+
+    uint16_t start  = hash % max_devices;
+    uint16_t oldest = start;
+    for ( uint16_t i = 0; i < max_devices; i++ ) {
+        uint16_t pos              = ( start + i ) % max_devices;
+        Device_admission_t& entry = devices[pos];
+        if ( entry.used && entry.device == device ) {
+            return &entry;
+        }
+        if ( !entry.used ) {
+            oldest = pos;
+            break;
+        }
+        if ( (int32_t)( entry.last_seen_ms - devices[oldest].last_seen_ms ) < 0 ) {
+            oldest = pos;
+        }
+    }
+
+    Device_admission_t& entry = devices[oldest];
+    memset( &entry, 0, sizeof( entry ) );
+    entry.device         = device;
+    entry.tokens         = (uint32_t)burst * token;
+    entry.last_refill_ms = now_ms;
+    entry.used           = true;
+    return &entry;
+}
+
+bool Pkt_admission::take_token( Device_admission_t& entry, uint32_t now_ms ) {
+    if ( per_minute == 0 ) {
+        return true;
+    }
+
+    // per_minute tokens cada 60000 ms: per_minute / 60 milesimas de token por ms
+    uint32_t elapsed_ms = now_ms - entry.last_refill_ms;
+    uint64_t refill     = (uint64_t)elapsed_ms * per_minute / 60;
+    uint32_t capacity   = (uint32_t)burst * token;
+    entry.tokens        = entry.tokens + refill > capacity ? capacity : entry.tokens + refill;
+    // Solo se avanza el instante por lo repuesto, para no perder las fracciones
+    entry.last_refill_ms += (uint32_t)( refill * 60 / per_minute );
+
+    if ( entry.tokens < token ) {
+        return false;
+    }
+    entry.tokens -= token;
+    return true;
+}
+
+Admission_result_t Pkt_admission::admit( uint32_t device, uint8_t cmd, uint16_t occupancy, uint16_t capacity, uint32_t now_ms ) {
+    pthread_mutex_lock( &lock );
+    Admission_class_t cls            = classes[cmd];
+    Admission_class_stats_t& counter = stats[cls];
+    Device_admission_t& entry        = *lookup( device, now_ms );
+    entry.last_seen_ms               = now_ms;
+
+    Admission_result_t result = admission_accepted;
+    if ( (uint32_t)occupancy * 100 >= (uint32_t)capacity * watermarks[cls] ) {
+        // La clase mas baja se descarta; las demas se reintentan
+        result = cls == admission_periodic ? admission_shed : admission_refused;
+        if ( result == admission_shed ) {
+            counter.shed++;
+        }
+        else {
+            counter.refused++;
+        }
+    }
+    else if ( cls != admission_alarm && cls != admission_unclassified && !take_token( entry, now_ms ) ) {
+        result = admission_shed;
+        counter.rate_limited++;
+    }
+    else {
+        counter.accepted++;
+    }
+
+    if ( result == admission_accepted ) {
+        entry.accepted++;
+    }
+    else {
+        entry.dropped++;
+    }
+    pthread_mutex_unlock( &lock );
+    return result;
+}
+
+Admission_result_t Pkt_admission::offer( Pkt_ring& ring, uint32_t device, uint8_t cmd, const uint8_t* data, uint16_t len, uint32_t now_ms ) {
+    Admission_result_t result = admit( device, cmd, ring.occupancy(), ring.get_slots(), now_ms );
+    if ( result != admission_accepted || ring.try_push( data, len ) ) {
+        return result;
+    }
+
+    // Otro productor ha llenado la cola tras la admision
+    pthread_mutex_lock( &lock );
+    Admission_class_stats_t& counter = stats[classes[cmd]];
+    counter.accepted--;
+    counter.refused++;
+    Device_admission_t& entry = *lookup( device, now_ms );
+    entry.accepted--;
+    entry.dropped++;
+    pthread_mutex_unlock( &lock );
+    return admission_refused;
+}
+
+Admission_class_stats_t Pkt_admission::get_class_stats( Admission_class_t cls ) {
+    Admission_class_stats_t copy;
+    memset( &copy, 0, sizeof( copy ) );
+    if ( cls < n_admission_classes ) {
+        pthread_mutex_lock( &lock );
+        copy = stats[cls];
+        pthread_mutex_unlock( &lock );
+    }
+    return copy;
+}
+
+uint16_t Pkt_admission::get_devices( Admission_device_report_t* reports, uint16_t max_reports ) {
+    uint16_t n = 0;
+    pthread_mutex_lock( &lock );
+    for ( uint16_t i = 0; i < max_devices && n < max_reports; i++ ) {
+        if ( devices[i].used ) {
+            reports[n].device       = devices[i].device;
+            reports[n].accepted     = devices[i].accepted;
+            reports[n].dropped      = devices[i].dropped;
+            reports[n].last_seen_ms = devices[i].last_seen_ms;
+            n++;
+        }
+    }
+    pthread_mutex_unlock( &lock );
+    return n;
+}
+
+uint32_t Pkt_admission::now_ms( void ) {
+    struct timespec now;
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    return (uint32_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
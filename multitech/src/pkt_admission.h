@@ -0,0 +1,166 @@
+#pragma once
+
+#include <stdint.h>
+#include "pthread.h"
+#include "pkt_ring.h"
+
+/**
+  \brief Clases de prioridad de los pkts de subida, de mayor a menor
+*/
+typedef enum : uint8_t {
+    admission_alarm = 0,    ///< Alarmas y cambios de estado de alimentacion
+    admission_position,     ///< Posiciones
+    admission_periodic,     ///< Lecturas periodicas
+    admission_unclassified, ///< Comando sin clase asignada: hasta llenar la cola, sin limite de ritmo y sin descartes
+    n_admission_classes
+} Admission_class_t;
+
+/**
+  \brief Resultado de la admision de un pkt
+*/
+typedef enum : uint8_t {
+    admission_accepted = 0,     ///< Encolado
+    admission_shed,             ///< Descartado a proposito: se confirma para que el dispositivo no lo repita
+    admission_refused           ///< Sin sitio: no se confirma y el dispositivo lo reintenta
+} Admission_result_t;
+
+/**
+  \brief Contadores de una clase de prioridad
+*/
+typedef struct {
+    uint32_t accepted;
+    uint32_t shed;              ///< Descartados por superar la marca de ocupacion de la clase
+    uint32_t rate_limited;      ///< Descartados por agotar el cubo de su dispositivo
+    uint32_t refused;           ///< Rechazados sin confirmar
+} Admission_class_stats_t;
+
+/**
+  \brief Contadores de un dispositivo
+*/
+typedef struct {
+    uint32_t device;            ///< Origen del pkt (src de la cabecera)
+    uint32_t accepted;
+    uint32_t dropped;           ///< Descartados o rechazados
+    uint32_t last_seen_ms;
+} Admission_device_report_t;
+
+/**
+  \class Pkt_admission
+  \brief Control de admision de la cola de ingesta por clases de prioridad. Cada clase solo
+  puede ocupar la cola hasta su marca (por defecto 100 % alarmas, 90 % posiciones y 75 % lecturas
+  periodicas), de modo que bajo presion se descartan antes las clases bajas y queda sitio para las
+  altas. Ademas cada dispositivo tiene un cubo de tokens que limita su ritmo salvo en las alarmas.
+  Las lecturas periodicas y los pkts limitados se descartan pero se confirman, porque reintentarlos
+  solo anyade tiempo en el aire a una celda ya saturada; las alarmas y posiciones sin sitio se
+  rechazan para que el dispositivo las repita. Un comando sin clase asignada puede llevar una alarma,
+  asi que nunca se descarta: como sin control de admision, solo se rechaza con la cola llena. Segura
+  entre threads
+*/
+class Pkt_admission {
+
+    public:
+
+        static const uint16_t max_devices = 256;
+
+        /**
+          \brief Constructor de la clase. Ningun comando tiene clase y no hay limite de ritmo
+        */
+        Pkt_admission();
+
+        /**
+          \brief Destructor de la clase
+        */
+        ~Pkt_admission();
+
+        /**
+          \brief Asigna la clase de un comando
+          \param cmd Comando de la cabecera del pkt
+          \param cls Clase de prioridad
+        */
+        void set_class( uint8_t cmd, Admission_class_t cls );
+
+        /**
+          \brief Fija la ocupacion maxima de la cola hasta la que se admite una clase
+          \param cls Clase de prioridad
+          \param percent Porcentaje de la cola (1..100)
+        */
+        void set_watermark( Admission_class_t cls, uint8_t percent );
+
+        /**
+          \brief Fija el cubo de tokens de cada dispositivo
+          \param per_minute Pkts por minuto repuestos, 0 desactiva el limite
+          \param burst Pkts seguidos admitidos con el cubo lleno
+        */
+        void set_rate( uint16_t per_minute, uint16_t burst );
+
+        /**
+          \brief Decide si se admite un pkt y actualiza los contadores
+          \param device Origen del pkt
+          \param cmd Comando del pkt
+          \param occupancy Elementos en la cola
+          \param capacity Capacidad de la cola
+          \param now_ms Instante actual [ms]
+          \return admission_accepted si se puede encolar
+        */
+        Admission_result_t admit( uint32_t device, uint8_t cmd, uint16_t occupancy, uint16_t capacity, uint32_t now_ms );
+
+        /**
+          \brief Admite y encola un pkt. Si la cola se llena entre la admision y el encolado, se rechaza
+          \param ring Cola de ingesta
+          \param device Origen del pkt
+          \param cmd Comando del pkt
+          \param data Pkt
+          \param len Longitud del pkt
+          \param now_ms Instante actual [ms]
+        */
+        Admission_result_t offer( Pkt_ring& ring, uint32_t device, uint8_t cmd, const uint8_t* data, uint16_t len, uint32_t now_ms );
+
+        /**
+          \brief Devuelve los contadores de una clase
+        */
+        Admission_class_stats_t get_class_stats( Admission_class_t cls );
+
+        /**
+          \brief Contadores de todos los dispositivos de la tabla
+          \param reports Array de salida
+          \param max_reports Tamanyo del array
+          \return Numero de dispositivos escritos
+        */
+        uint16_t get_devices( Admission_device_report_t* reports, uint16_t max_reports );
+
+        /**
+          \brief Instante actual con reloj monotonico [ms]
+        */
+        static uint32_t now_ms( void );
+
+    private:
+
+        typedef struct {
+            uint32_t device;
+            uint32_t tokens;            ///< Milesimas de token
+            uint32_t last_refill_ms;
+            uint32_t last_seen_ms;
+            uint32_t accepted;
+            uint32_t dropped;
+            bool used;
+        } Device_admission_t;
+
+        /**
+          \brief Busca un dispositivo y lo registra si no existe, reemplazando el menos reciente si no hay sitio
+        */
+        Device_admission_t* lookup( uint32_t device, uint32_t now_ms );
+
+        /**
+          \brief Repone el cubo de un dispositivo y consume un token si hay
+          \return false si el cubo esta vacio
+        */
+        bool take_token( Device_admission_t& entry, uint32_t now_ms );
+
+        pthread_mutex_t lock;
+        Admission_class_t classes[256];                     ///< Clase de cada comando
+        uint8_t watermarks[n_admission_classes];            ///< [%]
+        uint16_t per_minute;
+        uint16_t burst;
+        Admission_class_stats_t stats[n_admission_classes];
+        Device_admission_t devices[max_devices];
+};
@@ -0,0 +1,136 @@
+#include "pkt_encoder.h"
+#include "base64.h"
+#include <string.h>
+
+static const char hex_digits[] = "0123456789abcdef";
+
+// Caracteres base64 que x-www-form-urlencoded no deja pasar tal cual: '+' se leeria como espacio
+static const char* escape_of( char c ) {
+    return c == '+' ? "%2B" : ( c == '/' ? "%2F" : ( c == '=' ? "%3D" : NULL ) );
+}
+
+// Caracteres '+' (62) y '/' (63) entre los n_chars primeros de un grupo de 24 bits
+static uint8_t escaped_in( uint32_t v, uint8_t n_chars ) {
+    uint8_t n = 0;
+    for ( uint8_t k = 0; k < n_chars; k++ ) {
+        n += ( ( v >> ( 18 - 6 * k ) ) & 0x3F ) >= 62;
+    }
+    return n;
+}
+
+static uint16_t encode_csv( const uint8_t* bytes, uint16_t len, char* out ) {
+    uint16_t pos = 0;
+    for ( uint16_t i = 0; i < len; i++ ) {
+        uint8_t value = bytes[i];
+        if ( value >= 100 ) {
+            out[pos++] = '0' + value / 100;
+        }
+        if ( value >= 10 ) {
+            out[pos++] = '0' + value / 10 % 10;
+        }
+        out[pos++] = '0' + value % 10;
+        if ( i + 1 < len ) {
+            out[pos++] = ',';
+        }
+    }
+    return pos;
+}
+
+static uint16_t encode_hex( const uint8_t* bytes, uint16_t len, char* out ) {
+    for ( uint16_t i = 0; i < len; i++ ) {
+        out[2 * i]     = hex_digits[bytes[i] >> 4];
+        out[2 * i + 1] = hex_digits[bytes[i] & 0x0F];
+    }
+    return 2 * len;
+}
+
+static uint16_t encode_base64( const uint8_t* bytes, uint16_t len, char* out, uint16_t escaped_len ) {
+    static Base64 base64;
+    uint16_t plain_len = base64.encoded_size( len );
+    base64.encode( (unsigned char*)bytes, out, len );
+
+    // Escapado en el mismo buffer desde el final: cada caracter se mueve una sola vez
+    uint16_t to = escaped_len;
+    for ( uint16_t from = plain_len; from-- > 0; ) {
+        const char* escape = escape_of( out[from] );
+        if ( escape != NULL ) {
+            to -= 3;
+            memcpy( &out[to], escape, 3 );
+        }
+        else {
+            out[--to] = out[from];
+        }
+    }
+    return escaped_len;
+}
+
+uint32_t Pkt_encoder::encoded_len( Pkt_encoding_t encoding, const uint8_t* bytes, uint16_t len ) {
+    uint32_t needed = 0;
+    switch ( encoding ) {
+        case pkt_encoding_csv:
+            needed = len > 0 ? len - 1 : 0;
+            for ( uint16_t i = 0; i < len; i++ ) {
+                needed += bytes[i] >= 100 ? 3 : ( bytes[i] >= 10 ? 2 : 1 );
+            }
+            break;
+
+        case pkt_encoding_base64: {
+            // Cada '+', '/' o '=' pasa de 1 a 3 caracteres; el relleno son ( 3 - len % 3 ) % 3 '='
+            uint16_t padding = ( 3 - len % 3 ) % 3;
+            uint16_t escaped = padding;
+            for ( uint16_t i = 0; i < len; i += 3 ) {
+                uint32_t v = (uint32_t)bytes[i] << 16;
+                v |= i + 1 < len ? (uint32_t)bytes[i + 1] << 8 : 0;
+                v |= i + 2 < len ? bytes[i + 2] : 0;
+                escaped += escaped_in( v, i + 2 < len ? 4 : ( i + 1 < len ? 3 : 2 ) );
+            }
+            needed = ( len + padding ) / 3 * 4 + 2 * escaped;
+            break;
+        }
+
+        case pkt_encoding_hex:
+            needed = 2 * len;
+            break;
+
+        case pkt_encoding_raw:
+            needed = len;
+            break;
+    }
+    return needed;
+}
+
+uint16_t Pkt_encoder::encode( Pkt_encoding_t encoding, const uint8_t* bytes, uint16_t len, char* out, uint16_t max_len ) {
+    uint32_t needed = encoded_len( encoding, bytes, len );
+    bool text       = encoding != pkt_encoding_raw;
+    if ( len == 0 || needed + text > max_len ) {
+        return 0;
+    }
+
+    uint16_t written = 0;
+    switch ( encoding ) {
+        case pkt_encoding_csv:
+            written = encode_csv( bytes, len, out );
+            break;
+
+        case pkt_encoding_base64:
+            written = encode_base64( bytes, len, out, needed );
+            break;
+
+        case pkt_encoding_hex:
+            written = encode_hex( bytes, len, out );
+            break;
+
+        case pkt_encoding_raw:
+            memcpy( out, bytes, len );
+            written = len;
+            break;
+    }
+    if ( text ) {
+        out[written] = '\0';
+    }
+    return written;
+}
+
+const char* Pkt_encoder::content_type( Pkt_encoding_t encoding ) {
+    return encoding == pkt_encoding_raw ? "application/octet-stream" : "application/x-www-form-urlencoded";
+}
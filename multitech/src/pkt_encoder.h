@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+  \brief Codificacion de los bytes de un pkt en el cuerpo de una peticion
+*/
+typedef enum {
+    pkt_encoding_csv,           ///< Decimal separado por comas "1,23,255", el formato historico de la API
+    pkt_encoding_base64,        ///< Base64 estandar con '+', '/' y '=' escapados para x-www-form-urlencoded
+    pkt_encoding_hex,           ///< Hexadecimal en minusculas, dos caracteres por byte
+    pkt_encoding_raw            ///< Bytes sin codificar, cuerpo application/octet-stream
+} Pkt_encoding_t;
+
+/**
+  \class Pkt_encoder
+  \brief Codificadores de pkts para los cuerpos de las peticiones. Escriben en un buffer de tamanyo
+  conocido sin printf: comprueban antes lo que ocupa el resultado y no dejan nada a medias si no cabe
+*/
+class Pkt_encoder {
+
+    public:
+
+        /**
+          \brief Longitud exacta de los bytes codificados, sin '\0'
+          \param encoding Codificacion
+          \param bytes Bytes a codificar
+          \param len Numero de bytes
+        */
+        static uint32_t encoded_len( Pkt_encoding_t encoding, const uint8_t* bytes, uint16_t len );
+
+        /**
+          \brief Codifica bytes en out. Las codificaciones de texto terminan en '\0'
+          \param encoding Codificacion
+          \param bytes Bytes a codificar
+          \param len Numero de bytes
+          \param out Buffer de salida
+          \param max_len Tamanyo del buffer, incluido el '\0'
+          \return Longitud escrita sin '\0', 0 si no cabe
+        */
+        static uint16_t encode( Pkt_encoding_t encoding, const uint8_t* bytes, uint16_t len, char* out, uint16_t max_len );
+
+        /**
+          \brief Cabecera Content-Type del cuerpo con esta codificacion
+        */
+        static const char* content_type( Pkt_encoding_t encoding );
+};
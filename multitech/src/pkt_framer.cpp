@@ -0,0 +1,158 @@
+#include "pkt_framer.h"
+#include <string.h>
+
+Pkt_framer::Pkt_framer( const Pkt_layout_t& layout_0, Pkt_check_cb_t check_0, void* check_arg_0 ) : layout( layout_0 ), check( check_0 ), check_arg( check_arg_0 ), carry_idx( 0 ), carry_len( 0 ) {
+    if ( layout.n_sync < 1 || layout.n_sync > 2 ) {
+        layout.n_sync = 1;
+    }
+    max_pkt_len = layout.header_len + layout.max_msg_len + layout.trailer_len;
+    carry[0]    = new uint8_t[max_pkt_len];
+    carry[1]    = new uint8_t[max_pkt_len];
+    memset( &stats, 0, sizeof( stats ) );
+}
+
+Pkt_framer::~Pkt_framer() {
+    delete[] carry[0];
+    delete[] carry[1];
+}
+
+void Pkt_framer::reset( void ) {
+    carry_len = 0;
+}
+
+uint16_t Pkt_framer::pending( void ) const {
+    return carry_len;
+}
+
+Pkt_framer_stats_t Pkt_framer::get_stats( void ) const {
+    return stats;
+}
+
+const uint8_t* Pkt_framer::find_sync( const uint8_t* p, const uint8_t* end, const uint8_t* next[2] ) {
+    // Cada sincronismo solo se vuelve a buscar cuando su ultima aparicion queda atras
+    const uint8_t* found = end;
+    for ( uint8_t i = 0; i < layout.n_sync; i++ ) {
+        if ( next[i] == NULL || next[i] < p ) {
+            next[i] = (const uint8_t*)memchr( p, layout.sync[i], end - p );
+            if ( next[i] == NULL ) {
+                next[i] = end;
+            }
+        }
+        if ( next[i] < found ) {
+            found = next[i];
+        }
+    }
+    return found != end ? found : NULL;
+}
+
+Pkt_framer::Frame_result_t Pkt_framer::frame( const uint8_t* p, size_t avail, uint16_t& total ) {
+    if ( avail < (size_t)layout.len_offset + layout.len_size ) {
+        return frame_partial;
+    }
+
+    uint16_t msg_len = 0;
+    if ( layout.len_size == 1 ) {
+        msg_len = p[layout.len_offset];
+    }
+    else {
+        memcpy( &msg_len, p + layout.len_offset, sizeof( msg_len ) );
+    }
+    if ( msg_len > layout.max_msg_len ) {
+        stats.bad_len++;
+        return frame_invalid;
+    }
+
+    total = layout.header_len + msg_len + layout.trailer_len;
+    return avail >= total ? frame_complete : frame_partial;
+}
+
+bool Pkt_framer::deliver( const uint8_t* p, uint16_t total, Pkt_frame_cb_t cb, void* arg ) {
+    if ( check != NULL && !check( p, total, check_arg ) ) {
+        stats.check_fails++;
+        return false;
+    }
+    stats.pkts++;
+    cb( p, total, arg );
+    return true;
+}
+
+uint16_t Pkt_framer::scan( const uint8_t* p, const uint8_t* end, uint8_t save_idx, Pkt_frame_cb_t cb, void* arg ) {
+    uint16_t delivered      = 0;
+    const uint8_t* next[2] = { NULL, NULL };
+    while ( p < end ) {
+        const uint8_t* start = find_sync( p, end, next );
+        if ( start == NULL ) {
+            stats.skipped += end - p;
+            return delivered;
+        }
+        stats.skipped += start - p;
+
+        uint16_t total = 0;
+        switch ( frame( start, end - start, total ) ) {
+            case frame_complete:
+                if ( deliver( start, total, cb, arg ) ) {
+                    delivered++;
+                    p = start + total;
+                }
+                else {
+                    p = start + 1;
+                }
+                break;
+            case frame_partial:
+                // Siempre cabe: un parcial es mas corto que el pkt maximo
+                memcpy( carry[save_idx], start, end - start );
+                carry_len = end - start;
+                carry_idx = save_idx;
+                return delivered;
+            default:
+                p = start + 1;
+                break;
+        }
+    }
+    return delivered;
+}
+
+uint16_t Pkt_framer::feed( const uint8_t* data, size_t len, Pkt_frame_cb_t cb, void* arg ) {
+    const uint8_t* end = data + len;
+    uint16_t delivered = 0;
+
+    // Primero se completa el pkt arrastrado con los bytes justos de esta lectura
+    while ( carry_len > 0 && data < end ) {
+        uint8_t* buf          = carry[carry_idx];
+        uint16_t total        = 0;
+        Frame_result_t result = frame( buf, carry_len, total );
+        bool rescan           = result == frame_invalid;
+
+        if ( !rescan ) {
+            uint16_t need = result == frame_partial && carry_len < (size_t)layout.len_offset + layout.len_size ? layout.len_offset + layout.len_size : total;
+            size_t take   = need - carry_len;
+            if ( take > (size_t)( end - data ) ) {
+                take = end - data;
+            }
+            memcpy( buf + carry_len, data, take );
+            carry_len += take;
+            data += take;
+            if ( carry_len < need || need != total ) {
+                continue;
+            }
+            if ( deliver( buf, total, cb, arg ) ) {
+                stats.carried++;
+                delivered++;
+                carry_len = 0;
+                carry_idx ^= 1;
+                break;
+            }
+            rescan = true;
+        }
+
+        // Candidato falso: se busca otro sincronismo en lo arrastrado, sin el primer byte
+        uint16_t old_len = carry_len;
+        carry_len        = 0;
+        delivered += scan( buf + 1, buf + old_len, carry_idx ^ 1, cb, arg );
+    }
+
+    if ( carry_len == 0 ) {
+        delivered += scan( data, end, carry_idx, cb, arg );
+    }
+    return delivered;
+}
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+static const uint8_t pkt_sync_lossy    = 0x2C;    ///< Sincronismo de los pkts con formato lossy
+static const uint8_t pkt_sync_no_lossy = 0x2D;    ///< Sincronismo de los pkts con formato no lossy
+
+/**
+  \brief Disposicion de un pkt en el flujo de bytes: sincronismo, cabecera con longitud,
+  mensaje y cola (checksum)
+*/
+typedef struct {
+    uint8_t sync[2];            ///< Bytes de sincronismo aceptados
+    uint8_t n_sync;             ///< Bytes de sincronismo usados (1 o 2)
+    uint8_t len_offset;         ///< Offset del campo longitud del mensaje dentro de la cabecera
+    uint8_t len_size;           ///< Tamanyo del campo longitud (1 o 2 bytes, orden del host)
+    uint8_t header_len;         ///< Bytes de cabecera, incluido el sincronismo
+    uint8_t trailer_len;        ///< Bytes tras el mensaje
+    uint16_t max_msg_len;       ///< Longitud maxima del mensaje
+} Pkt_layout_t;
+
+/**
+  \brief Comprobacion final de un pkt delimitado (p.ej. checksum)
+  \param pkt Inicio del pkt
+  \param len Longitud del pkt
+  \param arg Argumento registrado
+  \return true si el pkt es valido
+*/
+typedef bool ( *Pkt_check_cb_t )( const uint8_t* pkt, uint16_t len, void* arg );
+
+/**
+  \brief Entrega de un pkt completo y valido. La vista solo es valida durante la llamada
+  \param pkt Inicio del pkt, dentro del buffer de entrada o del buffer de arrastre
+  \param len Longitud del pkt
+  \param arg Argumento pasado a feed
+*/
+typedef void ( *Pkt_frame_cb_t )( const uint8_t* pkt, uint16_t len, void* arg );
+
+/**
+  \brief Estadisticas del framer
+*/
+typedef struct {
+    uint32_t pkts;              ///< Pkts entregados
+    uint32_t skipped;           ///< Bytes descartados buscando sincronismo
+    uint32_t bad_len;           ///< Candidatos descartados por longitud fuera de rango
+    uint32_t check_fails;       ///< Candidatos descartados por la comprobacion final
+    uint32_t carried;           ///< Pkts completados con bytes de varias lecturas
+} Pkt_framer_stats_t;
+
+/**
+  \class Pkt_framer
+  \brief Delimitador de pkts por bloques: recibe el buffer completo de una lectura, salta hasta
+  el siguiente byte de sincronismo con memchr, valida la longitud de la cabecera y entrega
+  cada pkt completo como una vista sobre el propio buffer, sin copiarlo. Un pkt cortado entre
+  dos lecturas se arrastra a un buffer interno y se completa en la siguiente llamada
+*/
+class Pkt_framer {
+
+    public:
+
+        /**
+          \brief Constructor de la clase
+          \param layout_0 Disposicion de los pkts
+          \param check_0 Comprobacion final de cada candidato, NULL para aceptar solo por estructura
+          \param check_arg_0 Argumento de la comprobacion
+        */
+        Pkt_framer( const Pkt_layout_t& layout_0, Pkt_check_cb_t check_0 = NULL, void* check_arg_0 = NULL );
+
+        /**
+          \brief Destructor de la clase
+        */
+        ~Pkt_framer();
+
+        /**
+          \brief Procesa los bytes de una lectura
+          \param data Bytes leidos
+          \param len Numero de bytes
+          \param cb Callback de cada pkt completo
+          \param arg Argumento del callback
+          \return Pkts entregados
+        */
+        uint16_t feed( const uint8_t* data, size_t len, Pkt_frame_cb_t cb, void* arg );
+
+        /**
+          \brief Descarta el pkt parcial arrastrado (p.ej. al empezar un datagrama nuevo)
+        */
+        void reset( void );
+
+        /**
+          \brief Bytes de un pkt parcial pendientes de completar
+        */
+        uint16_t pending( void ) const;
+
+        /**
+          \brief Devuelve las estadisticas
+        */
+        Pkt_framer_stats_t get_stats( void ) const;
+
+        /**
+          \brief Obtiene la disposicion de un Pkt de la libreria a partir de su propia cabecera,
+          de modo que el framer sigue el formato real aunque cambie
+          \param pkt Pkt de referencia
+          \param sync_0 Primer byte de sincronismo
+          \param sync_1 Segundo byte de sincronismo
+        */
+        template <class Pkt_t>
+        static Pkt_layout_t layout_of( Pkt_t& pkt, uint8_t sync_0, uint8_t sync_1 ) {
+            Pkt_layout_t layout;
+            const uint8_t* base = (const uint8_t*)pkt.bytes();
+            layout.sync[0]      = sync_0;
+            layout.sync[1]      = sync_1;
+            layout.n_sync       = 2;
+            layout.len_offset   = (const uint8_t*)&pkt.hdr->len - base;
+            layout.len_size     = sizeof( pkt.hdr->len );
+            layout.header_len   = (const uint8_t*)pkt.msg - base;
+            layout.trailer_len  = Pkt_t::get_pkt_overhead() - layout.header_len;
+            layout.max_msg_len  = pkt.get_msg_len();
+            return layout;
+        }
+
+        /**
+          \brief Comprobacion final con un Pkt de la libreria, que es quien conoce el checksum.
+          El candidato ya delimitado se pasa por Pkt::parse y el Pkt queda cargado con el.
+          Recorre otra vez cada byte del candidato: la longitud y el checksum solo se validan
+          en una pasada con una comprobacion propia del checksum, que la libreria no expone
+          \param p Inicio del candidato
+          \param len Longitud del candidato
+          \param pkt_void_ptr Puntero al Pkt_t
+        */
+        template <class Pkt_t>
+        static bool check_with_pkt( const uint8_t* p, uint16_t len, void* pkt_void_ptr ) {
+            Pkt_t* pkt = (Pkt_t*)pkt_void_ptr;
+            for ( uint16_t i = 0; i + 1 < len; i++ ) {
+                if ( pkt->parse( p[i] ) ) {
+                    return false; // Termina antes de tiempo: no coincide con la longitud de la cabecera
+                }
+            }
+            return len > 0 && pkt->parse( p[len - 1] );
+        }
+
+    private:
+
+        typedef enum : uint8_t {
+            frame_complete = 0,
+            frame_partial,
+            frame_invalid
+        } Frame_result_t;
+
+        /**
+          \brief Analiza un candidato que empieza en un byte de sincronismo
+          \param p Inicio del candidato
+          \param avail Bytes disponibles desde p
+          \param total Longitud total del pkt si la cabecera esta completa y es valida
+        */
+        Frame_result_t frame( const uint8_t* p, size_t avail, uint16_t& total );
+
+        /**
+          \brief Busca el siguiente byte de sincronismo
+          \param p Inicio de la busqueda
+          \param end Fin del bloque
+          \param next Proxima aparicion conocida de cada sincronismo en el bloque (end si no hay,
+          NULL si no se ha buscado), para no volver a recorrer los mismos bytes
+          \return NULL si no hay ninguno
+        */
+        const uint8_t* find_sync( const uint8_t* p, const uint8_t* end, const uint8_t* next[2] );
+
+        /**
+          \brief Entrega un candidato completo si pasa la comprobacion final
+          \return true si se ha entregado
+        */
+        bool deliver( const uint8_t* p, uint16_t total, Pkt_frame_cb_t cb, void* arg );
+
+        /**
+          \brief Entrega los pkts completos de un bloque contiguo y guarda el parcial final
+          \param p Inicio del bloque
+          \param end Fin del bloque
+          \param save_idx Buffer de arrastre donde guardar el parcial final
+          \return Pkts entregados
+        */
+        uint16_t scan( const uint8_t* p, const uint8_t* end, uint8_t save_idx, Pkt_frame_cb_t cb, void* arg );
+
+        Pkt_layout_t layout;
+        Pkt_check_cb_t check;
+        void* check_arg;
+        uint16_t max_pkt_len;
+        uint8_t* carry[2];              ///< Arrastre alterno: al reescanear un arrastre el parcial nuevo va al otro
+        uint8_t carry_idx;
+        uint16_t carry_len;
+        Pkt_framer_stats_t stats;
+};
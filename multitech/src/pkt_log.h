@@ -0,0 +1,317 @@
+#pragma once
+
+#include <stdint.h>
+#include "pkt_pool.h"
+
+/**
+  \brief Estadisticas de un lector de un Pkt_log
+*/
+typedef struct {
+    uint16_t pending;           ///< Pkts por leer o en curso
+    uint16_t max_pending;       ///< Maximo de pkts pendientes a la vez
+    uint32_t consumed;          ///< Pkts confirmados con pop()
+    uint32_t overrun;           ///< Pkts perdidos por ir retrasado con el log lleno
+} Pkt_log_reader_stats_t;
+
+/**
+  \brief Estadisticas de un Pkt_log
+*/
+typedef struct {
+    uint16_t capacity;
+    uint16_t used;              ///< Entradas entre la mas antigua retenida y la ultima
+    uint16_t high_water;        ///< Maximo de entradas usadas a la vez
+    uint32_t pushed;            ///< Pkts publicados
+    uint32_t refused;           ///< Pkts rechazados con el log lleno y sin poder adelantar a nadie
+    uint8_t laggard;            ///< Lector que retiene la entrada mas antigua, max_readers si el log esta vacio
+} Pkt_log_stats_t;
+
+/**
+  \class Pkt_log
+  \brief Log acotado de Pkt_handle compartido por varios lectores (los destinos de subida). Cada
+  pkt se guarda una sola vez con la mascara de lectores que lo tienen que leer; cada lector tiene
+  su cursor y confirma en orden con pop(), y la entrada se suelta cuando la han confirmado todos.
+  Con el log lleno se adelanta al lector retrasado que retiene la entrada mas antigua, perdiendo
+  ese pkt para el, salvo que la este usando (set_in_use); en ese caso se rechaza el pkt nuevo.
+  Un destino mas cuesta un cursor, no otra cola. No es segura entre threads
+*/
+template <typename T>
+class Pkt_log {
+
+    public:
+
+        static const uint8_t max_readers = 8;
+
+        /**
+          \brief Constructor de la clase
+          \param capacity_0 Entradas maximas del log
+        */
+        Pkt_log( uint16_t capacity_0 ) : capacity( capacity_0 > 0 ? capacity_0 : 1 ), head( 0 ), tail( 0 ), n_readers( 0 ) {
+            items          = new Pkt_handle<T>[capacity];
+            pending        = new uint8_t[capacity];
+            stats          = Pkt_log_stats_t();
+            stats.capacity = capacity;
+            stats.laggard  = max_readers;
+        }
+
+        /**
+          \brief Destructor de la clase. Suelta las referencias pendientes
+        */
+        ~Pkt_log() {
+            delete[] items;
+            delete[] pending;
+        }
+
+        Pkt_log( const Pkt_log& )            = delete;
+        Pkt_log& operator=( const Pkt_log& ) = delete;
+
+        /**
+          \brief Da de alta un lector. Solo antes de publicar el primer pkt y como mucho max_readers
+          \return Identificador del lector, max_readers si no quedan
+        */
+        uint8_t subscribe( void ) {
+            if ( n_readers == max_readers ) {
+                return max_readers;
+            }
+            Reader_t& reader = readers[n_readers];
+            reader.cursor    = tail;
+            reader.in_use    = 0;
+            reader.stats     = Pkt_log_reader_stats_t();
+            return n_readers++;
+        }
+
+        /**
+          \brief Mascara de todos los lectores dados de alta
+        */
+        uint8_t all_readers( void ) const {
+            return (uint8_t)( ( 1U << n_readers ) - 1 );
+        }
+
+        /**
+          \brief Publica un pkt para los lectores de la mascara
+          \param handle Referencia a publicar. Si se rechaza se queda en el llamante
+          \param mask Bit i activo para el lector i
+          \return false si el log esta lleno o ningun lector de la mascara esta dado de alta
+        */
+        bool push( Pkt_handle<T>&& handle, uint8_t mask ) {
+            mask &= all_readers();
+            if ( !handle || mask == 0 ) {
+                return false;
+            }
+            while ( tail - head == capacity ) {
+                if ( !overrun_head() ) {
+                    stats.refused++;
+                    return false;
+                }
+            }
+
+            items[tail % capacity]   = static_cast<Pkt_handle<T>&&>( handle );
+            pending[tail % capacity] = mask;
+            for ( uint8_t r = 0; r < n_readers; r++ ) {
+                Reader_t& reader = readers[r];
+                if ( ( mask & ( 1U << r ) ) == 0 ) {
+                    continue;
+                }
+                if ( reader.stats.pending == 0 ) {
+                    reader.cursor = tail;
+                }
+                reader.stats.pending++;
+                if ( reader.stats.pending > reader.stats.max_pending ) {
+                    reader.stats.max_pending = reader.stats.pending;
+                }
+            }
+            tail++;
+            stats.pushed++;
+            if ( tail - head > stats.high_water ) {
+                stats.high_water = tail - head;
+            }
+            return true;
+        }
+
+        /**
+          \brief Pkts pendientes de un lector
+        */
+        uint16_t available( uint8_t r ) const {
+            return readers[r].stats.pending;
+        }
+
+        /**
+          \brief Referencia i-esima pendiente de un lector, contando desde la mas antigua
+          \param r Lector
+          \param i Posicion, menor que available( r )
+        */
+        const Pkt_handle<T>& peek( uint8_t r, uint16_t i ) const {
+            // Se saltan las entradas de otros lectores; casi siempre no hay ninguna
+            uint32_t seq = readers[r].cursor;
+            for ( ;; seq++ ) {
+                if ( ( pending[seq % capacity] & ( 1U << r ) ) != 0 ) {
+                    if ( i == 0 ) {
+                        break;
+                    }
+                    i--;
+                }
+            }
+            return items[seq % capacity];
+        }
+
+        /**
+          \brief Confirma el pkt mas antiguo de un lector. La entrada se suelta si era el ultimo
+        */
+        void pop( uint8_t r ) {
+            Reader_t& reader = readers[r];
+            if ( reader.stats.pending == 0 ) {
+                return;
+            }
+            pending[reader.cursor % capacity] &= ~( 1U << r );
+            reader.stats.pending--;
+            reader.stats.consumed++;
+            advance( r );
+            trim();
+        }
+
+        /**
+          \brief Fija cuantos pkts de cabeza esta usando un lector (peticiones en curso); no se le
+          adelanta mientras sea mayor que 0
+        */
+        void set_in_use( uint8_t r, uint16_t n ) {
+            readers[r].in_use = n;
+        }
+
+        /**
+          \brief Devuelve las estadisticas de un lector
+        */
+        Pkt_log_reader_stats_t get_reader_stats( uint8_t r ) const {
+            return readers[r].stats;
+        }
+
+        /**
+          \brief Devuelve las estadisticas del log
+        */
+        Pkt_log_stats_t get_stats( void ) const {
+            Pkt_log_stats_t current = stats;
+            current.used            = tail - head;
+            current.laggard         = max_readers;
+            for ( uint8_t r = 0; r < n_readers && head != tail; r++ ) {
+                if ( ( pending[head % capacity] & ( 1U << r ) ) != 0 ) {
+                    current.laggard = r;
+                    break;
+                }
+            }
+            return current;
+        }
+
+    private:
+
+        typedef struct {
+            uint32_t cursor;            ///< Primera entrada pendiente del lector, tail si no tiene
+            uint16_t in_use;
+            Pkt_log_reader_stats_t stats;
+        } Reader_t;
+
+        /**
+          \brief Lleva el cursor de un lector a su siguiente entrada pendiente
+        */
+        void advance( uint8_t r ) {
+            Reader_t& reader = readers[r];
+            if ( reader.stats.pending == 0 ) {
+                reader.cursor = tail;
+                return;
+            }
+            while ( ( pending[reader.cursor % capacity] & ( 1U << r ) ) == 0 ) {
+                reader.cursor++;
+            }
+        }
+
+        /**
+          \brief Suelta las entradas de cabeza que ya no tiene pendientes ningun lector
+        */
+        void trim( void ) {
+            while ( head != tail && pending[head % capacity] == 0 ) {
+                items[head % capacity].reset();
+                head++;
+            }
+        }
+
+        /**
+          \brief Quita la entrada mas antigua a los lectores que la tienen pendiente
+          \return false si alguno de ellos la esta usando
+        */
+        bool overrun_head( void ) {
+            uint8_t mask = pending[head % capacity];
+            for ( uint8_t r = 0; r < n_readers; r++ ) {
+                if ( ( mask & ( 1U << r ) ) != 0 && readers[r].in_use > 0 ) {
+                    return false;
+                }
+            }
+            for ( uint8_t r = 0; r < n_readers; r++ ) {
+                if ( ( mask & ( 1U << r ) ) != 0 ) {
+                    readers[r].stats.pending--;
+                    readers[r].stats.overrun++;
+                }
+            }
+            pending[head % capacity] = 0;
+            for ( uint8_t r = 0; r < n_readers; r++ ) {
+                if ( ( mask & ( 1U << r ) ) != 0 ) {
+                    advance( r );
+                }
+            }
+            trim();
+            return true;
+        }
+
+        uint16_t capacity;
+        Pkt_handle<T>* items;
+        uint8_t* pending;           ///< Lectores que aun no han confirmado cada entrada
+        uint32_t head;              ///< Entrada mas antigua retenida, absoluta
+        uint32_t tail;              ///< Siguiente entrada a escribir, absoluta
+        Reader_t readers[max_readers];
+        uint8_t n_readers;
+        Pkt_log_stats_t stats;
+};
+
+/**
+  \class Pkt_log_reader
+  \brief Vista de un lector de un Pkt_log con la interfaz de una cola: lo que ve un destino
+*/
+template <typename T>
+class Pkt_log_reader {
+
+    public:
+
+        /**
+          \brief Constructor de la clase. Da de alta el lector en el log
+          \param log_0 Log del que lee
+        */
+        Pkt_log_reader( Pkt_log<T>& log_0 ) : log( log_0 ), id( log_0.subscribe() ) {}
+
+        /**
+          \brief Bit del lector para la mascara de Pkt_log::push
+        */
+        uint8_t mask( void ) const {
+            return (uint8_t)( 1U << id );
+        }
+
+        uint16_t available( void ) const {
+            return log.available( id );
+        }
+
+        const Pkt_handle<T>& peek( uint16_t i ) const {
+            return log.peek( id, i );
+        }
+
+        void pop( void ) {
+            log.pop( id );
+        }
+
+        void set_in_use( uint16_t n ) {
+            log.set_in_use( id, n );
+        }
+
+        Pkt_log_reader_stats_t get_stats( void ) const {
+            return log.get_reader_stats( id );
+        }
+
+    private:
+
+        Pkt_log<T>& log;
+        uint8_t id;
+};
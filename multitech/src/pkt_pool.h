@@ -0,0 +1,291 @@
+#pragma once
+
+#include <stdint.h>
+#include <new>
+#include "pthread.h"
+
+/**
+  \brief Estadisticas de un Pkt_pool
+*/
+typedef struct {
+    uint16_t slots;             ///< Elementos del pool
+    uint16_t in_use;            ///< Elementos con alguna referencia
+    uint16_t high_water;        ///< Maximo de elementos en uso a la vez
+    uint32_t acquired;          ///< Elementos entregados
+    uint32_t exhausted;         ///< Peticiones sin elementos libres
+} Pkt_pool_stats_t;
+
+template <typename T> class Pkt_pool;
+
+/**
+  \class Pkt_handle
+  \brief Referencia a un elemento de un Pkt_pool. Solo se puede mover entre etapas; share() da
+  otra referencia al mismo elemento para una etapa mas, y el elemento vuelve al pool cuando se
+  libera la ultima
+*/
+template <typename T>
+class Pkt_handle {
+
+    public:
+
+        Pkt_handle() : pool( NULL ), index( 0 ) {}
+
+        Pkt_handle( Pkt_handle&& other ) : pool( other.pool ), index( other.index ) {
+            other.pool = NULL;
+        }
+
+        Pkt_handle& operator=( Pkt_handle&& other ) {
+            if ( this != &other ) {
+                reset();
+                pool       = other.pool;
+                index      = other.index;
+                other.pool = NULL;
+            }
+            return *this;
+        }
+
+        Pkt_handle( const Pkt_handle& )            = delete;
+        Pkt_handle& operator=( const Pkt_handle& ) = delete;
+
+        ~Pkt_handle() {
+            reset();
+        }
+
+        /**
+          \brief Crea otra referencia al mismo elemento
+          \return Referencia vacia si esta lo esta
+        */
+        Pkt_handle share( void ) const {
+            if ( pool == NULL ) {
+                return Pkt_handle();
+            }
+            pool->retain( index );
+            return Pkt_handle( pool, index );
+        }
+
+        /**
+          \brief Suelta la referencia. Si era la ultima el elemento vuelve al pool
+        */
+        void reset( void ) {
+            if ( pool != NULL ) {
+                pool->release( index );
+                pool = NULL;
+            }
+        }
+
+        explicit operator bool( void ) const {
+            return pool != NULL;
+        }
+
+        T& operator*( void ) const {
+            return pool->at( index );
+        }
+
+        T* operator->( void ) const {
+            return &pool->at( index );
+        }
+
+    private:
+
+        friend class Pkt_pool<T>;
+
+        Pkt_handle( Pkt_pool<T>* pool_0, uint16_t index_0 ) : pool( pool_0 ), index( index_0 ) {}
+
+        Pkt_pool<T>* pool;          ///< NULL si la referencia esta vacia
+        uint16_t index;
+};
+
+/**
+  \class Pkt_pool
+  \brief Slab de tamanyo fijo de objetos construidos una sola vez al arrancar (p.ej. Pkt con su
+  buffer). En regimen estacionario un pkt se toma del pool al ingerirlo, pasa por las etapas
+  como Pkt_handle sin copiarse y vuelve al pool cuando la ultima etapa lo suelta. Segura entre threads
+*/
+template <typename T>
+class Pkt_pool {
+
+    public:
+
+        /**
+          \brief Constructor de la clase
+          \param slots_0 Numero de elementos
+          \param arg Argumento del constructor de cada elemento (p.ej. el tamanyo maximo del pkt)
+        */
+        template <typename Arg>
+        Pkt_pool( uint16_t slots_0, Arg arg ) : slots( slots_0 > 0 ? slots_0 : 1 ), n_free( slots ) {
+            storage    = static_cast<T*>( ::operator new( sizeof( T ) * slots ) );
+            refs       = new uint16_t[slots];
+            free_slots = new uint16_t[slots];
+            for ( uint16_t i = 0; i < slots; i++ ) {
+                new ( &storage[i] ) T( arg );
+                refs[i]       = 0;
+                free_slots[i] = slots - 1 - i;
+            }
+            stats       = Pkt_pool_stats_t();
+            stats.slots = slots;
+            pthread_mutex_init( &lock, NULL );
+        }
+
+        /**
+          \brief Destructor de la clase. No debe quedar ningun Pkt_handle vivo
+        */
+        ~Pkt_pool() {
+            for ( uint16_t i = 0; i < slots; i++ ) {
+                storage[i].~T();
+            }
+            ::operator delete( storage );
+            delete[] refs;
+            delete[] free_slots;
+            pthread_mutex_destroy( &lock );
+        }
+
+        Pkt_pool( const Pkt_pool& )            = delete;
+        Pkt_pool& operator=( const Pkt_pool& ) = delete;
+
+        /**
+          \brief Toma un elemento libre. Conserva el contenido de su uso anterior
+          \return Referencia vacia si el pool esta agotado
+        */
+        Pkt_handle<T> acquire( void ) {
+            pthread_mutex_lock( &lock );
+            if ( n_free == 0 ) {
+                stats.exhausted++;
+                pthread_mutex_unlock( &lock );
+                return Pkt_handle<T>();
+            }
+            uint16_t index = free_slots[--n_free];
+            refs[index]    = 1;
+            stats.acquired++;
+            stats.in_use++;
+            if ( stats.in_use > stats.high_water ) {
+                stats.high_water = stats.in_use;
+            }
+            pthread_mutex_unlock( &lock );
+            return Pkt_handle<T>( this, index );
+        }
+
+        /**
+          \brief Devuelve las estadisticas
+        */
+        Pkt_pool_stats_t get_stats( void ) {
+            pthread_mutex_lock( &lock );
+            Pkt_pool_stats_t copy = stats;
+            pthread_mutex_unlock( &lock );
+            return copy;
+        }
+
+    private:
+
+        friend class Pkt_handle<T>;
+
+        void retain( uint16_t index ) {
+            pthread_mutex_lock( &lock );
+            refs[index]++;
+            pthread_mutex_unlock( &lock );
+        }
+
+        void release( uint16_t index ) {
+            pthread_mutex_lock( &lock );
+            if ( --refs[index] == 0 ) {
+                free_slots[n_free++] = index;
+                stats.in_use--;
+            }
+            pthread_mutex_unlock( &lock );
+        }
+
+        T& at( uint16_t index ) {
+            return storage[index];
+        }
+
+        uint16_t slots;
+        T* storage;
+        uint16_t* refs;                 ///< Referencias vivas de cada elemento
+        uint16_t* free_slots;           ///< Pila de elementos libres
+        uint16_t n_free;
+        pthread_mutex_t lock;
+        Pkt_pool_stats_t stats;
+};
+
+/**
+  \class Pkt_queue
+  \brief Cola FIFO acotada de Pkt_handle entre etapas del bucle de eventos. Guarda referencias,
+  no copias del pkt. No es segura entre threads
+*/
+template <typename T>
+class Pkt_queue {
+
+    public:
+
+        /**
+          \brief Constructor de la clase
+          \param capacity_0 Referencias maximas en la cola
+        */
+        Pkt_queue( uint16_t capacity_0 ) : capacity( capacity_0 > 0 ? capacity_0 : 1 ), head( 0 ), count( 0 ) {
+            items = new Pkt_handle<T>[capacity];
+        }
+
+        /**
+          \brief Destructor de la clase. Suelta las referencias pendientes
+        */
+        ~Pkt_queue() {
+            delete[] items;
+        }
+
+        Pkt_queue( const Pkt_queue& )            = delete;
+        Pkt_queue& operator=( const Pkt_queue& ) = delete;
+
+        /**
+          \brief Encola una referencia
+          \param handle Referencia a encolar. Si la cola esta llena se queda en el llamante
+          \return false si la cola esta llena o la referencia esta vacia
+        */
+        bool push( Pkt_handle<T>&& handle ) {
+            if ( count == capacity || !handle ) {
+                return false;
+            }
+            items[( head + count ) % capacity] = static_cast<Pkt_handle<T>&&>( handle );
+            count++;
+            return true;
+        }
+
+        /**
+          \brief Elemento mas antiguo, sin sacarlo de la cola
+          \return NULL si la cola esta vacia
+        */
+        T* front( void ) {
+            return count > 0 ? &*items[head] : NULL;
+        }
+
+        /**
+          \brief Referencia i-esima contando desde la mas antigua, sin sacarla de la cola
+          \param i Posicion, menor que available()
+        */
+        const Pkt_handle<T>& peek( uint16_t i ) const {
+            return items[( head + i ) % capacity];
+        }
+
+        /**
+          \brief Saca el elemento mas antiguo y suelta su referencia
+        */
+        void pop( void ) {
+            if ( count > 0 ) {
+                items[head].reset();
+                head = ( head + 1 ) % capacity;
+                count--;
+            }
+        }
+
+        /**
+          \brief Numero de referencias en la cola
+        */
+        uint16_t available( void ) const {
+            return count;
+        }
+
+    private:
+
+        uint16_t capacity;
+        Pkt_handle<T>* items;
+        uint16_t head;
+        uint16_t count;
+};
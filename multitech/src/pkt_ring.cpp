@@ -0,0 +1,154 @@
+#include "pkt_ring.h"
+#include <poll.h>
+#include <string.h>
+
+static uint16_t round_up_pow2( uint16_t value ) {
+    uint16_t pow2 = 1;
+    while ( pow2 < value && pow2 < 0x8000 ) {
+        pow2 <<= 1;
+    }
+    return pow2;
+}
+
+Pkt_ring::Pkt_ring( uint16_t slots_0, uint16_t slot_size_0 ) :
+    slots( round_up_pow2( slots_0 ) ),
+    slot_size( slot_size_0 ),
+    mask( slots - 1 ),
+    cells( new Cell_t[slots] ),
+    storage( new uint8_t[(uint32_t)slots * slot_size] ),
+    enqueue_pos( 0 ),
+    dequeue_pos( 0 ),
+    waiting( false ),
+    push_fails( 0 ) {
+    for ( uint32_t i = 0; i < slots; i++ ) {
+        cells[i].seq.store( i, std::memory_order_relaxed );
+        cells[i].len = 0;
+    }
+}
+
+Pkt_ring::~Pkt_ring() {
+    delete[] cells;
+    delete[] storage;
+}
+
+bool Pkt_ring::init( void ) {
+    return event.init();
+}
+
+bool Pkt_ring::try_push( const uint8_t* data, uint16_t len ) {
+    if ( len > slot_size ) {
+        push_fails.fetch_add( 1, std::memory_order_relaxed );
+        return false;
+    }
+
+    Cell_t* cell;
+    uint32_t pos = enqueue_pos.load( std::memory_order_relaxed );
+    while ( 1 ) {
+        cell         = &cells[pos & mask];
+        uint32_t seq = cell->seq.load( std::memory_order_acquire );
+        int32_t dif  = (int32_t)( seq - pos );
+        if ( dif == 0 ) {
+            // Slot libre en esta vuelta: se reserva avanzando la posicion de escritura
+            if ( enqueue_pos.compare_exchange_weak( pos, pos + 1, std::memory_order_relaxed ) ) {
+                break;
+            }
+        }
+        else if ( dif < 0 ) {
+            // El consumidor aun no ha liberado el slot de la vuelta anterior: cola llena
+            push_fails.fetch_add( 1, std::memory_order_relaxed );
+            return false;
+        }
+        else {
+            // Otro productor se ha adelantado
+            pos = enqueue_pos.load( std::memory_order_relaxed );
+        }
+    }
+
+    memcpy( &storage[( pos & mask ) * slot_size], data, len );
+    cell->len = len;
+    cell->seq.store( pos + 1, std::memory_order_release );
+
+    wake();
+    return true;
+}
+
+bool Pkt_ring::try_pop( uint8_t* data, uint16_t max_len, uint16_t& len ) {
+    uint32_t pos = dequeue_pos.load( std::memory_order_relaxed );
+    Cell_t* cell = &cells[pos & mask];
+    uint32_t seq = cell->seq.load( std::memory_order_acquire );
+    if ( (int32_t)( seq - ( pos + 1 ) ) < 0 ) {
+        return false;
+    }
+    if ( cell->len > max_len ) {
+        return false;
+    }
+
+    len = cell->len;
+    memcpy( data, &storage[( pos & mask ) * slot_size], len );
+    // Libera el slot para la siguiente vuelta de los productores
+    cell->seq.store( pos + slots, std::memory_order_release );
+    dequeue_pos.store( pos + 1, std::memory_order_relaxed );
+    return true;
+}
+
+bool Pkt_ring::arm_wait( void ) {
+    waiting.store( true, std::memory_order_seq_cst );
+    // Un productor puede haber encolado antes de ver waiting: se vuelve a mirar la cola
+    uint32_t pos = dequeue_pos.load( std::memory_order_relaxed );
+    uint32_t seq = cells[pos & mask].seq.load( std::memory_order_seq_cst );
+    if ( (int32_t)( seq - ( pos + 1 ) ) >= 0 ) {
+        waiting.store( false, std::memory_order_relaxed );
+        return false;
+    }
+    return true;
+}
+
+void Pkt_ring::consume_wakeup( void ) {
+    event.consume();
+    waiting.store( false, std::memory_order_relaxed );
+}
+
+bool Pkt_ring::wait( int timeout_ms ) {
+    if ( !arm_wait() ) {
+        return true;
+    }
+
+    struct pollfd pfd;
+    pfd.fd     = event.get_fd();
+    pfd.events = POLLIN;
+    int nready = poll( &pfd, 1, timeout_ms );
+    consume_wakeup();
+    return nready > 0;
+}
+
+int Pkt_ring::get_fd( void ) const {
+    return event.get_fd();
+}
+
+uint16_t Pkt_ring::available( void ) const {
+    return enqueue_pos.load( std::memory_order_relaxed ) - dequeue_pos.load( std::memory_order_relaxed );
+}
+
+uint16_t Pkt_ring::occupancy( void ) const {
+    // Se lee primero la posicion de lectura: asi la resta nunca es negativa
+    uint32_t dequeued = dequeue_pos.load( std::memory_order_relaxed );
+    uint32_t used     = enqueue_pos.load( std::memory_order_relaxed ) - dequeued;
+    return used > slots ? slots : used;
+}
+
+uint16_t Pkt_ring::get_slots( void ) const {
+    return slots;
+}
+
+uint32_t Pkt_ring::get_push_fails( void ) const {
+    return push_fails.load( std::memory_order_relaxed );
+}
+
+void Pkt_ring::wake( void ) {
+    // Solo hay syscall si el consumidor se ha dormido. La barrera ordena la publicacion
+    // del slot antes de leer waiting, en espejo con arm_wait
+    std::atomic_thread_fence( std::memory_order_seq_cst );
+    if ( waiting.load( std::memory_order_seq_cst ) && waiting.exchange( false, std::memory_order_seq_cst ) ) {
+        event.notify();
+    }
+}
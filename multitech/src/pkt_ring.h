@@ -0,0 +1,121 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include "event_fd.h"
+
+/**
+  \class Pkt_ring
+  \brief Cola circular sin bloqueos de varios productores y un consumidor (MPSC) con slots
+  de tamanyo fijo. Los threads de recepcion encolan con try_push sin mutex y el consumidor
+  extrae con try_pop. Cuando el consumidor se queda sin datos duerme en un eventfd, que
+  los productores solo notifican si hay alguien esperando.
+
+  Basada en la cola acotada de D. Vyukov: cada slot lleva un numero de secuencia que indica
+  si esta libre para el productor de la vuelta actual o listo para el consumidor
+*/
+class Pkt_ring {
+
+    public:
+
+        /**
+          \brief Constructor de la clase
+          \param slots_0 Numero de slots, se redondea a la siguiente potencia de 2
+          \param slot_size_0 Tamanyo maximo de cada elemento
+        */
+        Pkt_ring( uint16_t slots_0, uint16_t slot_size_0 );
+
+        /**
+          \brief Destructor de la clase
+        */
+        ~Pkt_ring();
+
+        /**
+          \brief Crea el eventfd de espera del consumidor
+          \return Error de inicializacion
+        */
+        bool init( void );
+
+        /**
+          \brief Encola un elemento. Seguro desde varios threads a la vez
+          \param data Datos a encolar
+          \param len Longitud de los datos
+          \return false si la cola esta llena o el elemento no cabe en un slot
+        */
+        bool try_push( const uint8_t* data, uint16_t len );
+
+        /**
+          \brief Extrae el elemento mas antiguo. Solo desde el thread consumidor
+          \param data Buffer de salida
+          \param max_len Tamanyo del buffer de salida
+          \param len Longitud del elemento extraido
+          \return false si la cola esta vacia o el elemento no cabe en el buffer
+        */
+        bool try_pop( uint8_t* data, uint16_t max_len, uint16_t& len );
+
+        /**
+          \brief Prepara al consumidor para dormir en get_fd(). Solo desde el thread consumidor
+          \return true si la cola sigue vacia y se puede dormir, false si hay datos que extraer
+        */
+        bool arm_wait( void );
+
+        /**
+          \brief Limpia la notificacion del eventfd tras despertar en get_fd(). Solo desde el thread consumidor
+        */
+        void consume_wakeup( void );
+
+        /**
+          \brief Bloquea al consumidor hasta que haya datos
+          \param timeout_ms Tiempo maximo de espera, -1 espera indefinida [ms]
+          \return true si hay datos disponibles
+        */
+        bool wait( int timeout_ms );
+
+        /**
+          \brief Devuelve el descriptor que se notifica al encolar con el consumidor dormido
+        */
+        int get_fd( void ) const;
+
+        /**
+          \brief Numero aproximado de elementos en la cola. Solo desde el thread consumidor
+        */
+        uint16_t available( void ) const;
+
+        /**
+          \brief Numero aproximado de elementos en la cola. Seguro desde cualquier thread
+        */
+        uint16_t occupancy( void ) const;
+
+        /**
+          \brief Numero de slots de la cola
+        */
+        uint16_t get_slots( void ) const;
+
+        /**
+          \brief Numero de elementos descartados por cola llena
+        */
+        uint32_t get_push_fails( void ) const;
+
+    private:
+
+        typedef struct {
+            std::atomic<uint32_t> seq;     ///< Secuencia: pos libre para escribir, pos + 1 listo para leer
+            uint16_t len;
+        } Cell_t;
+
+        uint16_t slots;
+        uint16_t slot_size;
+        uint32_t mask;
+        Cell_t* cells;
+        uint8_t* storage;                               ///< slots * slot_size bytes
+        std::atomic<uint32_t> enqueue_pos;              ///< Compartido entre productores
+        std::atomic<uint32_t> dequeue_pos;              ///< Solo la escribe el consumidor
+        std::atomic<bool> waiting;                      ///< El consumidor duerme en el eventfd
+        std::atomic<uint32_t> push_fails;
+        Event_fd event;
+
+        /**
+          \brief Despierta al consumidor si esta dormido
+        */
+        void wake( void );
+};
@@ -0,0 +1,76 @@
+#include "replay_scheduler.h"
+
+Replay_scheduler::Replay_scheduler() : active( false ), total( 0 ), start_ms( 0 ), end_ms( 0 ), replays( 0 ) {
+    set_share( default_live_share );
+    vtime[lane_live]    = 0;
+    vtime[lane_backlog] = 0;
+    bytes[lane_live]    = 0;
+    bytes[lane_backlog] = 0;
+}
+
+void Replay_scheduler::set_share( uint8_t live_pct ) {
+    live_pct             = live_pct == 0 ? 1 : ( live_pct > 99 ? 99 : live_pct );
+    shares[lane_live]    = live_pct;
+    shares[lane_backlog] = 100 - live_pct;
+}
+
+void Replay_scheduler::start( uint32_t total_0, uint32_t now_ms ) {
+    active              = true;
+    total               = total_0;
+    start_ms            = now_ms;
+    end_ms              = now_ms;
+    vtime[lane_live]    = 0;
+    vtime[lane_backlog] = 0;
+    replays++;
+}
+
+void Replay_scheduler::finish( uint32_t now_ms ) {
+    if ( active ) {
+        active = false;
+        end_ms = now_ms;
+    }
+}
+
+bool Replay_scheduler::is_active( void ) const {
+    return active;
+}
+
+Replay_lane_t Replay_scheduler::pick( bool live_ready, bool backlog_ready ) {
+    // Una via parada se pone al dia: no puede volver con rafagas a cuenta del tiempo que no envio
+    if ( !live_ready && vtime[lane_live] < vtime[lane_backlog] ) {
+        vtime[lane_live] = vtime[lane_backlog];
+    }
+    if ( !backlog_ready && vtime[lane_backlog] < vtime[lane_live] ) {
+        vtime[lane_backlog] = vtime[lane_live];
+    }
+    if ( !live_ready || !backlog_ready ) {
+        return live_ready ? lane_live : lane_backlog;
+    }
+    // Empate a favor de los nuevos
+    return vtime[lane_live] <= vtime[lane_backlog] ? lane_live : lane_backlog;
+}
+
+void Replay_scheduler::on_sent( Replay_lane_t lane, uint32_t sent_bytes ) {
+    vtime[lane] += (uint64_t)sent_bytes * 100 / shares[lane];
+    if ( active ) {
+        bytes[lane] += sent_bytes;
+    }
+}
+
+Replay_report_t Replay_scheduler::get_report( uint32_t left, uint32_t now_ms ) const {
+    Replay_report_t report;
+    uint32_t elapsed_ms  = ( active ? now_ms : end_ms ) - start_ms;
+    uint32_t done        = left < total ? total - left : 0;
+    report.active        = active;
+    report.total         = total;
+    report.left          = active ? left : 0;
+    report.elapsed_s     = elapsed_ms / 1000;
+    report.replays       = replays;
+    report.live_bytes    = bytes[lane_live];
+    report.backlog_bytes = bytes[lane_backlog];
+
+    // Ritmo medio desde el principio: la reposicion va a toda velocidad, sin rafagas que suavizar
+    report.rate_ppm = elapsed_ms > 0 ? (uint32_t)( (uint64_t)done * 60000 / elapsed_ms ) : 0;
+    report.eta_s    = active && report.rate_ppm > 0 ? (uint32_t)( (uint64_t)left * 60 / report.rate_ppm ) : 0;
+    return report;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+  \brief Via de envio de un destino durante la reposicion de un atraso
+*/
+typedef enum : uint8_t {
+    lane_live,                  ///< Pkts llegados despues de empezar la reposicion
+    lane_backlog                ///< Pkts acumulados durante el corte
+} Replay_lane_t;
+
+/**
+  \brief Progreso de la reposicion para el informe
+*/
+typedef struct {
+    bool active;                ///< Reposicion en curso
+    uint32_t total;             ///< Pkts del atraso al empezar
+    uint32_t left;              ///< Pkts del atraso sin terminar
+    uint32_t rate_ppm;          ///< Pkts del atraso terminados por minuto, 0 sin medida
+    uint32_t eta_s;             ///< Tiempo estimado hasta vaciar el atraso, 0 sin medida [s]
+    uint32_t elapsed_s;         ///< Duracion de la reposicion en curso o de la ultima [s]
+    uint32_t replays;           ///< Reposiciones empezadas
+    uint64_t live_bytes;        ///< Bytes enviados por la via de nuevos durante las reposiciones
+    uint64_t backlog_bytes;     ///< Bytes enviados por la via del atraso
+} Replay_report_t;
+
+/**
+  \class Replay_scheduler
+  \brief Reparto del envio entre la via de pkts nuevos y la del atraso mientras se repone lo
+  acumulado durante un corte. Cada via avanza un tiempo virtual en bytes / cuota y se sirve la que
+  va por detras; una via sin nada que enviar no acumula credito, de modo que el atraso usa todo el
+  ancho de banda mientras no llegan pkts nuevos. Tambien mide el progreso de la reposicion y estima
+  lo que falta. Los instantes son de un reloj monotono en ms. No es segura entre threads
+*/
+class Replay_scheduler {
+
+    public:
+
+        static const uint8_t default_live_share = 80;
+
+        /**
+          \brief Constructor de la clase
+        */
+        Replay_scheduler();
+
+        /**
+          \brief Fija la cuota de la via de nuevos; el atraso se queda el resto
+          \param live_pct Porcentaje, de 1 a 99
+        */
+        void set_share( uint8_t live_pct );
+
+        /**
+          \brief Empieza una reposicion
+          \param total Pkts del atraso
+          \param now_ms Instante actual [ms]
+        */
+        void start( uint32_t total, uint32_t now_ms );
+
+        /**
+          \brief Termina la reposicion en curso
+          \param now_ms Instante actual [ms]
+        */
+        void finish( uint32_t now_ms );
+
+        /**
+          \brief Indica si hay una reposicion en curso
+        */
+        bool is_active( void ) const;
+
+        /**
+          \brief Elige la via del siguiente envio. Al menos una debe estar lista
+          \param live_ready La via de nuevos tiene pkts que enviar
+          \param backlog_ready La via del atraso tiene pkts que enviar
+        */
+        Replay_lane_t pick( bool live_ready, bool backlog_ready );
+
+        /**
+          \brief Anota un envio
+          \param lane Via del envio
+          \param bytes Bytes de los pkts enviados
+        */
+        void on_sent( Replay_lane_t lane, uint32_t bytes );
+
+        /**
+          \brief Devuelve el progreso de la reposicion
+          \param left Pkts del atraso sin terminar
+          \param now_ms Instante actual [ms]
+        */
+        Replay_report_t get_report( uint32_t left, uint32_t now_ms ) const;
+
+    private:
+
+        uint8_t shares[2];          ///< Porcentaje de cada via, indexado por Replay_lane_t
+        uint64_t vtime[2];          ///< Bytes enviados por cada via escalados por 100 / cuota
+        bool active;
+        uint32_t total;
+        uint32_t start_ms;
+        uint32_t end_ms;
+        uint32_t replays;
+        uint64_t bytes[2];
+};
@@ -0,0 +1,137 @@
+#include "sink_health.h"
+#include <stdlib.h>
+
+Sink_health::Sink_health( uint32_t seed_0 ) :
+    seed( seed_0 ),
+    failures_to_open( default_failures_to_open ),
+    base_ms( default_base_ms ),
+    max_ms( default_max_ms ),
+    min_timeout_ms( default_min_timeout_ms ),
+    max_timeout_ms( default_max_timeout_ms ),
+    state( breaker_closed ),
+    probing( false ),
+    failures( 0 ),
+    opens( 0 ),
+    opened( 0 ),
+    retry_at_ms( 0 ),
+    srtt_ms( 0 ),
+    rttvar_ms( 0 ),
+    timeout_ms( default_max_timeout_ms ) {
+}
+
+void Sink_health::set_backoff( uint32_t base_ms_0, uint32_t max_ms_0 ) {
+    base_ms = base_ms_0 == 0 ? 1 : base_ms_0;
+    max_ms  = max_ms_0 < base_ms ? base_ms : max_ms_0;
+}
+
+void Sink_health::set_failures_to_open( uint8_t failures_0 ) {
+    failures_to_open = failures_0 == 0 ? 1 : failures_0;
+}
+
+void Sink_health::set_timeout_bounds( uint32_t min_ms, uint32_t max_ms_0 ) {
+    min_timeout_ms = min_ms;
+    max_timeout_ms = max_ms_0 < min_ms ? min_ms : max_ms_0;
+    timeout_ms     = srtt_ms == 0 ? max_timeout_ms : timeout_ms;
+}
+
+bool Sink_health::allow( uint32_t now_ms ) {
+    if ( state == breaker_open && (int32_t)( now_ms - retry_at_ms ) >= 0 ) {
+        state   = breaker_half_open;
+        probing = false;
+    }
+    return state == breaker_closed || ( state == breaker_half_open && !probing );
+}
+
+void Sink_health::on_start( void ) {
+    if ( state == breaker_half_open ) {
+        probing = true;
+    }
+}
+
+void Sink_health::on_success( uint32_t latency_ms ) {
+    // Cualquier respuesta, tambien la de una peticion arrancada antes de abrir, demuestra que el destino vive
+    state    = breaker_closed;
+    probing  = false;
+    failures = 0;
+    opens    = 0;
+
+    // Estimador de Jacobson/Karels con enteros: rttvar += ( |err| - rttvar ) / 4, srtt += err / 8
+    if ( srtt_ms == 0 ) {
+        srtt_ms   = latency_ms == 0 ? 1 : latency_ms;
+        rttvar_ms = srtt_ms / 2;
+    }
+    else {
+        int32_t err = (int32_t)latency_ms - (int32_t)srtt_ms;
+        rttvar_ms   = ( 3 * rttvar_ms + (uint32_t)abs( err ) ) / 4;
+        srtt_ms     = (uint32_t)( (int32_t)srtt_ms + err / 8 );
+    }
+    uint32_t rto = srtt_ms + 4 * rttvar_ms;
+    timeout_ms   = rto < min_timeout_ms ? min_timeout_ms : ( rto > max_timeout_ms ? max_timeout_ms : rto );
+}
+
+void Sink_health::on_failure( uint32_t now_ms ) {
+    // Un timeout puede ser solo un destino lento: se da mas margen a la siguiente peticion
+    timeout_ms = timeout_ms > max_timeout_ms / 2 ? max_timeout_ms : 2 * timeout_ms;
+
+    if ( failures < UINT8_MAX ) {
+        failures++;
+    }
+    if ( state == breaker_open ) {
+        return;
+    }
+    if ( state == breaker_half_open || failures >= failures_to_open ) {
+        state       = breaker_open;
+        probing     = false;
+        retry_at_ms = now_ms + jittered( opens );
+        opened++;
+        if ( opens < UINT8_MAX ) {
+            opens++;
+        }
+    }
+}
+
+uint32_t Sink_health::wait_ms( uint32_t now_ms ) const {
+    if ( state != breaker_open || (int32_t)( now_ms - retry_at_ms ) >= 0 ) {
+        return 0;
+    }
+    return retry_at_ms - now_ms;
+}
+
+uint32_t Sink_health::retry_delay_ms( uint8_t attempts ) {
+    return jittered( attempts == 0 ? 0 : attempts - 1 );
+}
+
+uint32_t Sink_health::get_timeout_ms( void ) const {
+    return timeout_ms;
+}
+
+Breaker_state_t Sink_health::get_state( void ) const {
+    return state;
+}
+
+Sink_health_report_t Sink_health::get_report( void ) const {
+    Sink_health_report_t report;
+    report.state      = state;
+    report.failures   = failures;
+    report.opened     = opened;
+    report.backoff_ms = backoff( opens );
+    report.srtt_ms    = srtt_ms;
+    report.timeout_ms = timeout_ms;
+    return report;
+}
+
+uint32_t Sink_health::backoff( uint8_t n ) const {
+    // Se dobla hasta max_ms sin desbordar
+    uint32_t delay = base_ms;
+    for ( uint8_t i = 0; i < n && delay < max_ms; i++ ) {
+        delay = delay > max_ms / 2 ? max_ms : 2 * delay;
+    }
+    return delay;
+}
+
+uint32_t Sink_health::jittered( uint8_t n ) {
+    // La mitad fija evita reintentos inmediatos; la aleatoria separa a los destinos y a los pkts
+    uint32_t delay = backoff( n );
+    uint32_t half  = delay / 2;
+    return delay - half + (uint32_t)rand_r( &seed ) % ( half + 1 );
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+  \brief Estado del cortocircuito de un destino
+*/
+typedef enum : uint8_t {
+    breaker_closed,             ///< Destino sano: se arrancan peticiones
+    breaker_open,               ///< Demasiados fallos seguidos: no se arranca nada hasta que pase la espera
+    breaker_half_open           ///< Pasada la espera: una sola peticion de prueba decide si se cierra
+} Breaker_state_t;
+
+/**
+  \brief Estado de salud de un destino para el informe
+*/
+typedef struct {
+    Breaker_state_t state;
+    uint8_t failures;           ///< Fallos seguidos del destino
+    uint32_t opened;            ///< Veces que se abrio el cortocircuito
+    uint32_t backoff_ms;        ///< Espera de la proxima apertura, sin jitter [ms]
+    uint32_t srtt_ms;           ///< Latencia suavizada de las peticiones, 0 sin medidas [ms]
+    uint32_t timeout_ms;        ///< Timeout de las proximas peticiones [ms]
+} Sink_health_report_t;
+
+/**
+  \class Sink_health
+  \brief Salud de un destino de subida: cortocircuito cerrado/abierto/semiabierto, esperas
+  exponenciales con jitter y timeout adaptado a la latencia medida (srtt + 4 rttvar, como el RTO
+  de TCP, duplicado tras cada fallo). Solo cuentan como fallos del destino los de transporte, 5xx
+  y 429; un 4xx es un pkt rechazado por un destino sano. Los instantes son de un reloj monotono en
+  ms y pueden dar la vuelta. No es segura entre threads
+*/
+class Sink_health {
+
+    public:
+
+        static const uint8_t default_failures_to_open = 3;
+        static const uint32_t default_base_ms         = 1000;
+        static const uint32_t default_max_ms          = 300000;
+        static const uint32_t default_min_timeout_ms  = 2000;
+        static const uint32_t default_max_timeout_ms  = 30000;
+
+        /**
+          \brief Constructor de la clase
+          \param seed Semilla del jitter, distinta por destino para que no reintenten a la vez
+        */
+        Sink_health( uint32_t seed );
+
+        /**
+          \brief Fija las esperas exponenciales: base * 2^n hasta max_ms, con jitter en la mitad superior
+          \param base_ms Primera espera [ms]
+          \param max_ms Espera maxima [ms]
+        */
+        void set_backoff( uint32_t base_ms, uint32_t max_ms );
+
+        /**
+          \brief Fija los fallos seguidos que abren el cortocircuito
+        */
+        void set_failures_to_open( uint8_t failures );
+
+        /**
+          \brief Fija los limites del timeout adaptativo. Sin medidas se usa max_ms
+          \param min_ms Timeout minimo [ms]
+          \param max_ms Timeout maximo [ms]
+        */
+        void set_timeout_bounds( uint32_t min_ms, uint32_t max_ms );
+
+        /**
+          \brief Indica si se puede arrancar una peticion. Pasada la espera, pasa de abierto a semiabierto
+          \param now_ms Instante actual [ms]
+        */
+        bool allow( uint32_t now_ms );
+
+        /**
+          \brief Anota una peticion arrancada; en semiabierto es la prueba y no se permiten mas
+        */
+        void on_start( void );
+
+        /**
+          \brief Anota una peticion a la que el destino respondio
+          \param latency_ms Duracion de la peticion [ms]
+        */
+        void on_success( uint32_t latency_ms );
+
+        /**
+          \brief Anota un fallo del destino
+          \param now_ms Instante actual [ms]
+        */
+        void on_failure( uint32_t now_ms );
+
+        /**
+          \brief Tiempo hasta que allow() puede volver a dar paso
+          \param now_ms Instante actual [ms]
+          \return 0 si ya lo da o si solo falta que termine la prueba [ms]
+        */
+        uint32_t wait_ms( uint32_t now_ms ) const;
+
+        /**
+          \brief Espera con jitter antes de reenviar un pkt fallido
+          \param attempts Intentos fallidos del pkt, desde 1
+          \return Espera [ms]
+        */
+        uint32_t retry_delay_ms( uint8_t attempts );
+
+        /**
+          \brief Devuelve el timeout de las proximas peticiones [ms]
+        */
+        uint32_t get_timeout_ms( void ) const;
+
+        /**
+          \brief Devuelve el estado del cortocircuito
+        */
+        Breaker_state_t get_state( void ) const;
+
+        /**
+          \brief Devuelve el estado de salud para el informe
+        */
+        Sink_health_report_t get_report( void ) const;
+
+    private:
+
+        /**
+          \brief Espera exponencial del intento n, sin jitter: base_ms * 2^n hasta max_ms
+          \param n Intento, desde 0
+        */
+        uint32_t backoff( uint8_t n ) const;
+
+        /**
+          \brief Espera del intento n con jitter: entre la mitad y el total de backoff( n )
+        */
+        uint32_t jittered( uint8_t n );
+
+        uint32_t seed;
+        uint8_t failures_to_open;
+        uint32_t base_ms;
+        uint32_t max_ms;
+        uint32_t min_timeout_ms;
+        uint32_t max_timeout_ms;
+        Breaker_state_t state;
+        bool probing;               ///< Prueba del semiabierto en curso
+        uint8_t failures;
+        uint8_t opens;              ///< Aperturas seguidas sin cerrar, exponente de la espera
+        uint32_t opened;
+        uint32_t retry_at_ms;       ///< Fin de la espera del abierto
+        uint32_t srtt_ms;
+        uint32_t rttvar_ms;
+        uint32_t timeout_ms;
+};
@@ -0,0 +1,49 @@
+#include "timer_fd.h"
+#include <sys/timerfd.h>
+#include <string.h>
+#include <unistd.h>
+
+static void ms_to_timespec( uint32_t ms, struct timespec& ts ) {
+    ts.tv_sec  = ms / 1000;
+    ts.tv_nsec = ( ms % 1000 ) * 1000000L;
+}
+
+Timer_fd::Timer_fd() : fd( -1 ) {}
+
+Timer_fd::~Timer_fd() {
+    if ( fd != -1 ) {
+        close( fd );
+    }
+}
+
+bool Timer_fd::init( void ) {
+    fd = timerfd_create( CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC );
+    return fd != -1;
+}
+
+bool Timer_fd::start( uint32_t first_ms, uint32_t period_ms ) {
+    struct itimerspec spec;
+    memset( &spec, 0, sizeof( spec ) );
+    // Un it_value a cero desarmaria el temporizador
+    ms_to_timespec( first_ms > 0 ? first_ms : 1, spec.it_value );
+    ms_to_timespec( period_ms, spec.it_interval );
+    return timerfd_settime( fd, 0, &spec, NULL ) == 0;
+}
+
+void Timer_fd::stop( void ) {
+    struct itimerspec spec;
+    memset( &spec, 0, sizeof( spec ) );
+    timerfd_settime( fd, 0, &spec, NULL );
+}
+
+uint64_t Timer_fd::consume( void ) {
+    uint64_t expirations = 0;
+    if ( read( fd, &expirations, sizeof( expirations ) ) != sizeof( expirations ) ) {
+        return 0;
+    }
+    return expirations;
+}
+
+int Timer_fd::get_fd( void ) const {
+    return fd;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+  \class Timer_fd
+  \brief Envoltorio de timerfd (CLOCK_MONOTONIC) para etapas periodicas del gateway
+*/
+class Timer_fd {
+
+    public:
+
+        /**
+          \brief Constructor de la clase
+        */
+        Timer_fd();
+
+        /**
+          \brief Destructor de la clase
+        */
+        ~Timer_fd();
+
+        /**
+          \brief Crea el descriptor timerfd no bloqueante
+          \return Error de inicializacion
+        */
+        bool init( void );
+
+        /**
+          \brief Arma el temporizador
+          \param first_ms Tiempo hasta el primer disparo [ms]
+          \param period_ms Periodo de los disparos siguientes, 0 para disparo unico [ms]
+          \return Resultado de la operacion
+        */
+        bool start( uint32_t first_ms, uint32_t period_ms = 0 );
+
+        /**
+          \brief Desarma el temporizador
+        */
+        void stop( void );
+
+        /**
+          \brief Lee el numero de expiraciones desde la ultima lectura
+          \return Numero de expiraciones
+        */
+        uint64_t consume( void );
+
+        /**
+          \brief Devuelve el descriptor para registrarlo en el bucle de eventos
+        */
+        int get_fd( void ) const;
+
+    private:
+
+        int fd;     ///< Descriptor timerfd
+};
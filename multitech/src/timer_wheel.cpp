@@ -0,0 +1,94 @@
+#include "timer_wheel.h"
+#include <string.h>
+
+Timer_wheel::Timer_wheel( uint16_t slots_0, uint32_t now ) : current( now ), count( 0 ) {
+    slots = 1;
+    while ( slots < slots_0 && slots < 0x8000 ) {
+        slots <<= 1;
+    }
+    mask  = slots - 1;
+    heads = new Timer_node_t*[slots];
+    memset( heads, 0, slots * sizeof( Timer_node_t* ) );
+}
+
+Timer_wheel::~Timer_wheel() {
+    delete[] heads;
+}
+
+void Timer_wheel::init_node( Timer_node_t& node, void* owner ) {
+    node.prev      = NULL;
+    node.next      = NULL;
+    node.deadline  = 0;
+    node.scheduled = false;
+    node.owner     = owner;
+}
+
+void Timer_wheel::schedule( Timer_node_t& node, uint32_t deadline ) {
+    cancel( node );
+
+    // Lo ya vencido cae en la casilla del siguiente tick
+    if ( (int32_t)( deadline - current ) <= 0 ) {
+        deadline = current + 1;
+    }
+    Timer_node_t*& head = heads[deadline & mask];
+    node.deadline       = deadline;
+    node.prev           = NULL;
+    node.next           = head;
+    if ( head != NULL ) {
+        head->prev = &node;
+    }
+    head           = &node;
+    node.scheduled = true;
+    count++;
+}
+
+void Timer_wheel::cancel( Timer_node_t& node ) {
+    if ( !node.scheduled ) {
+        return;
+    }
+    if ( node.prev != NULL ) {
+        node.prev->next = node.next;
+    }
+    else {
+        heads[node.deadline & mask] = node.next;
+    }
+    if ( node.next != NULL ) {
+        node.next->prev = node.prev;
+    }
+    node.prev      = NULL;
+    node.next      = NULL;
+    node.scheduled = false;
+    count--;
+}
+
+uint32_t Timer_wheel::advance( uint32_t now, Timer_wheel_cb_t cb, void* arg ) {
+    uint32_t expired = 0;
+
+    // Tras un salto de mas de una vuelta basta con recorrer cada casilla una vez
+    uint32_t ticks = now - current;
+    if ( (int32_t)ticks <= 0 ) {
+        return 0;
+    }
+    if ( ticks > slots ) {
+        current = now - slots;
+    }
+
+    while ( current != now ) {
+        current++;
+        Timer_node_t* node = heads[current & mask];
+        while ( node != NULL ) {
+            Timer_node_t* next = node->next;
+            if ( (int32_t)( node->deadline - now ) <= 0 ) {
+                cancel( *node );
+                expired++;
+                cb( *node, arg );
+            }
+            node = next;
+        }
+    }
+    return expired;
+}
+
+uint32_t Timer_wheel::size( void ) const {
+    return count;
+}
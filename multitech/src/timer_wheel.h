@@ -0,0 +1,88 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+  \brief Nodo intrusivo de la rueda de tiempos. Se incrusta en el objeto a temporizar
+*/
+typedef struct Timer_node {
+    struct Timer_node* prev;
+    struct Timer_node* next;
+    uint32_t deadline;          ///< Tick de vencimiento
+    bool scheduled;             ///< Esta en la rueda
+    void* owner;                ///< Objeto al que pertenece el nodo
+} Timer_node_t;
+
+/**
+  \brief Callback de un nodo vencido. El nodo ya esta fuera de la rueda y se puede volver a
+  programar desde el propio callback. No debe cancelar otros nodos
+  \param node Nodo vencido
+  \param arg Argumento pasado a advance
+*/
+typedef void ( *Timer_wheel_cb_t )( Timer_node_t& node, void* arg );
+
+/**
+  \class Timer_wheel
+  \brief Rueda de tiempos de un nivel para miles de temporizadores: programar, cancelar y
+  avanzar un tick cuestan O(1) por nodo. Los vencimientos mas alla de una vuelta se dejan en
+  su casilla y se saltan hasta la vuelta en que vencen. Para timeouts de inactividad conviene no
+  reprogramar con cada actividad: se guarda el instante de la actividad y se decide en el callback
+*/
+class Timer_wheel {
+
+    public:
+
+        /**
+          \brief Constructor de la clase
+          \param slots_0 Casillas de la rueda, se redondea a la siguiente potencia de 2
+          \param now Tick inicial
+        */
+        Timer_wheel( uint16_t slots_0, uint32_t now );
+
+        /**
+          \brief Destructor de la clase
+        */
+        ~Timer_wheel();
+
+        /**
+          \brief Inicializa un nodo antes de usarlo
+          \param node Nodo a inicializar
+          \param owner Objeto al que pertenece
+        */
+        static void init_node( Timer_node_t& node, void* owner );
+
+        /**
+          \brief Programa un nodo, si ya estaba programado se mueve
+          \param node Nodo a programar
+          \param deadline Tick de vencimiento, si ya ha pasado vence en el siguiente avance
+        */
+        void schedule( Timer_node_t& node, uint32_t deadline );
+
+        /**
+          \brief Saca un nodo de la rueda, si estaba programado
+          \param node Nodo a cancelar
+        */
+        void cancel( Timer_node_t& node );
+
+        /**
+          \brief Avanza hasta el tick indicado ejecutando los vencidos
+          \param now Tick actual
+          \param cb Callback de los nodos vencidos
+          \param arg Argumento del callback
+          \return Nodos vencidos
+        */
+        uint32_t advance( uint32_t now, Timer_wheel_cb_t cb, void* arg );
+
+        /**
+          \brief Nodos programados
+        */
+        uint32_t size( void ) const;
+
+    private:
+
+        uint16_t slots;
+        uint16_t mask;
+        uint32_t current;               ///< Ultimo tick procesado
+        uint32_t count;
+        Timer_node_t** heads;           ///< Lista de cada casilla
+};
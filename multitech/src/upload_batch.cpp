@@ -0,0 +1,86 @@
+#include "upload_batch.h"
+#include <string.h>
+
+uint16_t Upload_batch::begin( char* body, uint16_t max_len, const char* mobile_id ) {
+    static const char id_field[] = "MobileID=";
+    static const char project[]  = "&project=boluda";
+    size_t id_len                = strlen( mobile_id );
+    size_t len                   = sizeof( id_field ) - 1 + id_len + sizeof( project ) - 1;
+    if ( len >= max_len ) {
+        return 0;
+    }
+
+    uint16_t pos = 0;
+    memcpy( &body[pos], id_field, sizeof( id_field ) - 1 );
+    pos += sizeof( id_field ) - 1;
+    memcpy( &body[pos], mobile_id, id_len );
+    pos += id_len;
+    memcpy( &body[pos], project, sizeof( project ) - 1 );
+    pos += sizeof( project ) - 1;
+    body[pos] = '\0';
+    return pos;
+}
+
+uint16_t Upload_batch::append_pkt( char* body, uint16_t pos, uint16_t max_len, const uint8_t* bytes, uint16_t len,
+                                   Pkt_encoding_t encoding ) {
+    static const char field[] = "&pkt[]=";
+
+    // Los bytes sin codificar no se pueden separar en campos
+    if ( encoding == pkt_encoding_raw || pos + sizeof( field ) - 1 >= max_len ) {
+        return 0;
+    }
+
+    // Si el pkt no cabe el campo se sobrescribe y se restaura el '\0' de antes
+    memcpy( &body[pos], field, sizeof( field ) - 1 );
+    uint16_t value_pos = pos + sizeof( field ) - 1;
+    uint16_t value_len = Pkt_encoder::encode( encoding, bytes, len, &body[value_pos], max_len - value_pos );
+    if ( value_len == 0 ) {
+        body[pos] = '\0';
+        return 0;
+    }
+    return value_pos + value_len;
+}
+
+bool Upload_batch::parse_failed( const char* response, uint16_t len, uint8_t n_pkts, uint32_t& failed_mask ) {
+    static const char key[] = "\"failed\"";
+
+    failed_mask     = 0;
+    const char* end = response + len;
+    const char* p   = response;
+    while ( p + sizeof( key ) - 1 <= end && memcmp( p, key, sizeof( key ) - 1 ) != 0 ) {
+        p++;
+    }
+    if ( p + sizeof( key ) - 1 > end ) {
+        return false;
+    }
+    p += sizeof( key ) - 1;
+    while ( p < end && ( *p == ' ' || *p == ':' ) ) {
+        p++;
+    }
+    if ( p == end || *p != '[' ) {
+        return false;
+    }
+    p++;
+
+    while ( p < end ) {
+        if ( *p == ']' ) {
+            return true;
+        }
+        if ( *p == ' ' || *p == ',' ) {
+            p++;
+            continue;
+        }
+        if ( *p < '0' || *p > '9' ) {
+            return false;
+        }
+        uint16_t index = 0;
+        while ( p < end && *p >= '0' && *p <= '9' && index < n_pkts ) {
+            index = index * 10 + ( *p++ - '0' );
+        }
+        if ( index >= n_pkts ) {
+            return false;
+        }
+        failed_mask |= 1UL << index;
+    }
+    return false;
+}
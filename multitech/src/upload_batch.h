@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdint.h>
+#include "pkt_encoder.h"
+
+/**
+  \class Upload_batch
+  \brief Formato de las subidas por lotes a la API: un cuerpo con la cabecera del gateway y un campo
+  "pkt[]" repetido por cada pkt, p.ej. "MobileID=01&project=boluda&pkt[]=1,2&pkt[]=3,4". La API
+  responde 2xx si acepta todos los pkts o 207 con los indices de los rechazados: {"failed":[1]}
+*/
+class Upload_batch {
+
+    public:
+
+        static const uint8_t max_pkts = 16;     ///< Pkts maximos por lote, un bit por pkt en failed_mask
+
+        /**
+          \brief Escribe la cabecera del cuerpo de un lote
+          \param body Buffer de salida
+          \param max_len Tamanyo del buffer, incluido el '\0'
+          \param mobile_id Identificador del gateway
+          \return Longitud escrita, 0 si no cabe
+        */
+        static uint16_t begin( char* body, uint16_t max_len, const char* mobile_id );
+
+        /**
+          \brief Anyade un pkt al cuerpo como campo "&pkt[]=b0,b1,..."
+          \param body Cuerpo del lote
+          \param pos Longitud actual del cuerpo
+          \param max_len Tamanyo del buffer, incluido el '\0'
+          \param bytes Bytes del pkt
+          \param len Longitud del pkt
+          \param encoding Codificacion del campo, de texto: csv, base64 o hex
+          \return Nueva longitud del cuerpo, 0 si el pkt no cabe y el cuerpo queda como estaba
+        */
+        static uint16_t append_pkt( char* body, uint16_t pos, uint16_t max_len, const uint8_t* bytes, uint16_t len,
+                                    Pkt_encoding_t encoding = pkt_encoding_csv );
+
+        /**
+          \brief Interpreta la respuesta 207 de un lote
+          \param response Cuerpo de la respuesta, no necesita '\0'
+          \param len Longitud de la respuesta
+          \param n_pkts Pkts del lote
+          \param failed_mask Bit i activo si el pkt i del lote fue rechazado
+          \return false si la respuesta no tiene la lista "failed" o un indice esta fuera del lote
+        */
+        static bool parse_failed( const char* response, uint16_t len, uint8_t n_pkts, uint32_t& failed_mask );
+};
@@ -0,0 +1,144 @@
+#include "upload_engine.h"
+#include <sys/epoll.h>
+#include <string.h>
+#include "log.h"
+
+Upload_engine::Upload_engine() : multi( NULL ), loop( NULL ), running( 0 ) {
+    for ( uint8_t i = 0; i < max_sockets; i++ ) {
+        sockets[i].engine = this;
+        sockets[i].fd     = CURL_SOCKET_BAD;
+    }
+    memset( transfers, 0, sizeof( transfers ) );
+}
+
+Upload_engine::~Upload_engine() {
+    if ( multi != NULL ) {
+        curl_multi_cleanup( multi );
+    }
+}
+
+bool Upload_engine::init( Event_loop& loop_0 ) {
+    loop = &loop_0;
+    curl_global_init( CURL_GLOBAL_DEFAULT );
+    multi = curl_multi_init();
+    if ( multi == NULL || !timer.init() ) {
+        return false;
+    }
+    curl_multi_setopt( multi, CURLMOPT_SOCKETFUNCTION, socket_fcn );
+    curl_multi_setopt( multi, CURLMOPT_SOCKETDATA, this );
+    curl_multi_setopt( multi, CURLMOPT_TIMERFUNCTION, timer_fcn );
+    curl_multi_setopt( multi, CURLMOPT_TIMERDATA, this );
+    return loop->add( timer.get_fd(), EPOLLIN, on_timer, this );
+}
+
+bool Upload_engine::start( CURL* easy, Upload_done_cb_t cb, void* arg ) {
+    for ( uint8_t i = 0; i < max_transfers; i++ ) {
+        Transfer_t& transfer = transfers[i];
+        if ( transfer.easy != NULL ) {
+            continue;
+        }
+        if ( curl_multi_add_handle( multi, easy ) != CURLM_OK ) {
+            return false;
+        }
+        transfer.easy = easy;
+        transfer.cb   = cb;
+        transfer.arg  = arg;
+        return true;
+    }
+    return false;
+}
+
+uint16_t Upload_engine::get_running( void ) const {
+    return running;
+}
+
+int Upload_engine::socket_fcn( CURL* easy, curl_socket_t fd, int what, void* user_ptr, void* socket_ptr ) {
+    (void)easy;
+    Upload_engine* engine = (Upload_engine*)user_ptr;
+    Socket_entry_t* entry = (Socket_entry_t*)socket_ptr;
+
+    if ( what == CURL_POLL_REMOVE ) {
+        if ( entry != NULL ) {
+            engine->loop->remove( fd );
+            entry->fd = CURL_SOCKET_BAD;
+        }
+        return 0;
+    }
+
+    uint32_t events = ( what & CURL_POLL_IN ? (uint32_t)EPOLLIN : 0 ) | ( what & CURL_POLL_OUT ? (uint32_t)EPOLLOUT : 0 );
+    if ( entry != NULL ) {
+        engine->loop->modify( fd, events );
+        return 0;
+    }
+
+    // Socket nuevo: se registra en el bucle y se asocia su entrada para los siguientes avisos
+    for ( uint8_t i = 0; i < max_sockets; i++ ) {
+        if ( engine->sockets[i].fd == CURL_SOCKET_BAD ) {
+            entry     = &engine->sockets[i];
+            entry->fd = fd;
+            if ( !engine->loop->add( fd, events, on_socket, entry ) ) {
+                entry->fd = CURL_SOCKET_BAD;
+                break;
+            }
+            curl_multi_assign( engine->multi, fd, entry );
+            return 0;
+        }
+    }
+    log( (uint32_t)0, "Upload engine: no room for socket %d\n", fd );
+    return -1;
+}
+
+int Upload_engine::timer_fcn( CURLM* multi, long timeout_ms, void* user_ptr ) {
+    (void)multi;
+    Upload_engine* engine = (Upload_engine*)user_ptr;
+    if ( timeout_ms < 0 ) {
+        engine->timer.stop();
+    }
+    else {
+        engine->timer.start( timeout_ms );
+    }
+    return 0;
+}
+
+void Upload_engine::on_socket( void* arg, uint32_t events ) {
+    Socket_entry_t* entry = (Socket_entry_t*)arg;
+    int ev_bitmask        = ( events & EPOLLIN ? CURL_CSELECT_IN : 0 ) | ( events & EPOLLOUT ? CURL_CSELECT_OUT : 0 ) | ( events & ( EPOLLERR | EPOLLHUP ) ? CURL_CSELECT_ERR : 0 );
+    entry->engine->drive( entry->fd, ev_bitmask );
+}
+
+void Upload_engine::on_timer( void* arg, uint32_t events ) {
+    (void)events;
+    Upload_engine* engine = (Upload_engine*)arg;
+    engine->timer.consume();
+    engine->drive( CURL_SOCKET_TIMEOUT, 0 );
+}
+
+void Upload_engine::drive( curl_socket_t fd, int ev_bitmask ) {
+    curl_multi_socket_action( multi, fd, ev_bitmask, &running );
+    check_done();
+}
+
+void Upload_engine::check_done( void ) {
+    CURLMsg* msg;
+    int pending;
+
+    while ( ( msg = curl_multi_info_read( multi, &pending ) ) != NULL ) {
+        if ( msg->msg != CURLMSG_DONE ) {
+            continue;
+        }
+        CURL* easy      = msg->easy_handle;
+        CURLcode result = msg->data.result;
+        curl_multi_remove_handle( multi, easy );
+
+        for ( uint8_t i = 0; i < max_transfers; i++ ) {
+            Transfer_t& transfer = transfers[i];
+            if ( transfer.easy == easy ) {
+                // Se libera antes del callback: puede arrancar otra transferencia con el mismo handle
+                Transfer_t done = transfer;
+                transfer.easy   = NULL;
+                done.cb( done.arg, easy, result );
+                break;
+            }
+        }
+    }
+}
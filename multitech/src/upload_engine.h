@@ -0,0 +1,101 @@
+#pragma once
+
+#include <stdint.h>
+#include <curl/curl.h>
+#include "event_loop.h"
+#include "timer_fd.h"
+
+/**
+  \brief Callback de una transferencia terminada
+  \param arg Argumento registrado junto a la transferencia
+  \param easy Handle de la transferencia, ya fuera del multi
+  \param result Resultado de transporte de curl
+*/
+typedef void ( *Upload_done_cb_t )( void* arg, CURL* easy, CURLcode result );
+
+/**
+  \class Upload_engine
+  \brief Transferencias HTTP concurrentes con curl_multi sobre el bucle de eventos del gateway.
+  Los sockets de curl y su temporizador se registran en el Event_loop, de modo que ninguna
+  peticion bloquea el bucle. Solo se usa desde el thread del bucle
+*/
+class Upload_engine {
+
+    public:
+
+        static const uint8_t max_sockets = 16;     ///< Sockets de curl vigilados a la vez
+
+        /**
+          \brief Constructor de la clase
+        */
+        Upload_engine();
+
+        /**
+          \brief Destructor de la clase
+        */
+        ~Upload_engine();
+
+        /**
+          \brief Crea el multi y registra su temporizador en el bucle
+          \param loop Bucle de eventos del gateway
+          \return Error de inicializacion
+        */
+        bool init( Event_loop& loop );
+
+        /**
+          \brief Arranca una transferencia. El handle ya debe estar configurado
+          \param easy Handle de la transferencia
+          \param cb Callback al terminar, desde el bucle
+          \param arg Argumento del callback
+          \return false si curl no acepta el handle
+        */
+        bool start( CURL* easy, Upload_done_cb_t cb, void* arg );
+
+        /**
+          \brief Transferencias en curso
+        */
+        uint16_t get_running( void ) const;
+
+    private:
+
+        /**
+          \brief Socket de curl registrado en el bucle
+        */
+        typedef struct {
+            Upload_engine* engine;
+            curl_socket_t fd;                   ///< CURL_SOCKET_BAD si la entrada esta libre
+        } Socket_entry_t;
+
+        /**
+          \brief Transferencia en curso
+        */
+        typedef struct {
+            CURL* easy;                         ///< NULL si la entrada esta libre
+            Upload_done_cb_t cb;
+            void* arg;
+        } Transfer_t;
+
+        static const uint8_t max_transfers = 32;
+
+        static int socket_fcn( CURL* easy, curl_socket_t fd, int what, void* user_ptr, void* socket_ptr );
+        static int timer_fcn( CURLM* multi, long timeout_ms, void* user_ptr );
+        static void on_socket( void* arg, uint32_t events );
+        static void on_timer( void* arg, uint32_t events );
+
+        /**
+          \brief Avanza curl sobre un socket, o sobre los temporizadores con CURL_SOCKET_TIMEOUT
+        */
+        void drive( curl_socket_t fd, int ev_bitmask );
+
+        /**
+          \brief Saca del multi las transferencias terminadas y ejecuta sus callbacks
+        */
+        void check_done( void );
+
+        CURLM* multi;
+        Event_loop* loop;
+        Timer_fd timer;
+        int running;
+        Socket_entry_t sockets[max_sockets];
+        Transfer_t transfers[max_transfers];
+};
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <stdint.h>
+#include "pkt_pool.h"
+#include "sink_health.h"
+
+/**
+  \brief Que hacer con un pkt cuyo envio ha fallado
+*/
+typedef enum {
+    upload_keep,                ///< Se reenvia tras una espera
+    upload_drop                 ///< Se saca de la cola sin entregar (p.ej. pasa a otra via)
+} Upload_verdict_t;
+
+/**
+  \brief Callback de un pkt terminado, desde el bucle de eventos
+  \param arg Argumento registrado junto al callback
+  \param pkt Referencia al pkt, aun en la cola
+  \param ok true si el destino acepto el pkt; el pkt sale de la cola y se ignora el veredicto
+  \param response_code Codigo HTTP de la peticion o codigo de retorno del CONNACK, 0 si fallo el transporte
+  \return Veredicto para un pkt fallido
+*/
+template <typename T>
+using Upload_result_cb_t = Upload_verdict_t ( * )( void* arg, const Pkt_handle<T>& pkt, bool ok, long response_code );
+
+/**
+  \brief Estadisticas de un destino de subida
+*/
+typedef struct {
+    uint32_t started;           ///< Envios arrancados: peticiones HTTP o escrituras de PUBLISH agrupados
+    uint32_t batched;           ///< Pkts enviados en esos envios
+    uint32_t delivered;         ///< Pkts aceptados por el destino
+    uint32_t failed;            ///< Pkts fallidos, por transporte, por codigo HTTP o en un 207
+    uint32_t dropped;           ///< Pkts fallidos sacados de la cola por el veredicto
+    uint32_t retried;           ///< Pkts reenviados
+    uint32_t abandoned;         ///< Pkts descartados por agotar los intentos
+    uint16_t retry_lane;        ///< Pkts esperando reenvio
+    uint8_t in_flight;          ///< Peticiones HTTP o PUBLISH sin confirmar en curso
+} Upload_sink_stats_t;
+
+/**
+  \class Upload_sink
+  \brief Interfaz de un destino de subida: vacia su lector de un Pkt_log hacia un servicio remoto
+  desde el bucle de eventos. Cada transporte (Http_sink, Mqtt_sink) se inicializa con lo suyo;
+  lo comun (lotes, reintentos, resultados, estadisticas) se configura y se consulta por aqui. T es
+  el elemento del log, Pkt en el gateway
+*/
+template <typename T>
+class Upload_sink {
+
+    public:
+
+        virtual ~Upload_sink() {}
+
+        /**
+          \brief Activa los lotes: hasta max_pkts pkts salen juntos y un lote incompleto espera como
+          mucho max_age_ms a llenarse
+          \param max_pkts Pkts maximos por envio
+          \param max_age_ms Espera maxima de un lote incompleto [ms]
+        */
+        virtual void set_batch( uint8_t max_pkts, uint32_t max_age_ms ) = 0;
+
+        /**
+          \brief Fija las esperas de reintento y los intentos por pkt
+          \param base_ms Primera espera [ms]
+          \param max_ms Espera maxima [ms]
+          \param max_attempts Fallos de un pkt con el destino sano antes de abandonarlo; los fallos
+          durante un corte no cuentan
+        */
+        virtual void set_retry( uint32_t base_ms, uint32_t max_ms, uint8_t max_attempts ) = 0;
+
+        /**
+          \brief Fija el callback de pkts terminados. Sin callback los fallidos se reintentan
+        */
+        virtual void set_result_cb( Upload_result_cb_t<T> cb, void* arg ) = 0;
+
+        /**
+          \brief Envia los pkts pendientes que permitan la ventana y la salud del destino
+        */
+        virtual void pump( void ) = 0;
+
+        /**
+          \brief Devuelve las estadisticas del destino
+        */
+        virtual Upload_sink_stats_t get_stats( void ) const = 0;
+
+        /**
+          \brief Devuelve la salud del destino
+        */
+        virtual Sink_health_report_t get_health( void ) const = 0;
+};
@@ -0,0 +1,383 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include "pkt_log.h"
+#include "upload_sink.h"
+#include "upload_batch.h"
+#include "sink_health.h"
+#include "replay_scheduler.h"
+
+/**
+  \brief Pkts de una peticion arrancada por un Upload_window
+*/
+typedef struct {
+    bool from_lane;             ///< Entradas de la via de reintentos
+    uint8_t n_pkts;
+    uint32_t ids[Upload_batch::max_pkts];   ///< Posicion absoluta en la cola (popped + posicion) o entrada de la via
+} Upload_window_batch_t;
+
+/**
+  \class Upload_window
+  \brief Contabilidad de los pkts de un destino de subida con varias peticiones en curso, sin nada
+  del transporte. Los pkts arrancados siguen en el lector del log hasta que terminan todos los de
+  delante y se identifican por su posicion absoluta, que sobrevive a los pops y a los pkts que el
+  log quita al lector por ir retrasado (resync). Un pkt fallido pasa a una via de reintentos con su
+  propia espera y sale de la cola. Durante la reposicion de un atraso la cola tiene dos cursores, el
+  del atraso desde la cabeza y el de los nuevos desde backlog_end; los nuevos terminados esperan a
+  que termine el atraso y entonces pasan a ser la cabeza. No es segura entre threads
+*/
+template <typename T>
+class Upload_window {
+
+    public:
+
+        static const uint8_t max_batches          = 8;     ///< Peticiones en curso maximas
+        static const uint16_t max_entries         = 256;   ///< Posiciones de cola desde la cabeza con estado
+        static const uint8_t max_lane             = max_batches * Upload_batch::max_pkts;  ///< Caben todos los pkts en curso
+        static const uint8_t default_max_attempts = 10;
+
+        /**
+          \brief Constructor de la clase
+          \param queue_0 Lector del log de pkts a subir
+        */
+        Upload_window( Pkt_log_reader<T>& queue_0 ) :
+            queue( queue_0 ),
+            max_attempts( default_max_attempts ),
+            result_cb( NULL ),
+            result_arg( NULL ),
+            started( 0 ),
+            live_started( 0 ),
+            backlog( false ),
+            backlog_end( 0 ),
+            overrun_seen( 0 ),
+            queue_pending( 0 ),
+            popped( 0 ),
+            lane_used( 0 ) {
+            memset( states, 0, sizeof( states ) );
+            memset( &stats, 0, sizeof( stats ) );
+            for ( uint8_t i = 0; i < max_lane; i++ ) {
+                lane[i].attempts = 0;
+                lane[i].next_ms  = 0;
+                lane[i].busy     = false;
+            }
+        }
+
+        Upload_window( const Upload_window& )            = delete;
+        Upload_window& operator=( const Upload_window& ) = delete;
+
+        /**
+          \brief Fija los fallos que cuentan como intento antes de abandonar un pkt
+        */
+        void set_max_attempts( uint8_t max_attempts_0 ) {
+            max_attempts = max_attempts_0 == 0 ? 1 : max_attempts_0;
+        }
+
+        /**
+          \brief Fija el callback de pkts terminados. Sin callback los fallidos se reintentan
+        */
+        void set_result_cb( Upload_result_cb_t<T> cb, void* arg ) {
+            result_cb  = cb;
+            result_arg = arg;
+        }
+
+        /**
+          \brief Recorre popped con los pkts que el log quito al lector por ir retrasado, para que
+          las posiciones absolutas sigan apuntando a los mismos pkts
+        */
+        void resync( void ) {
+            // Solo pasa sin pkts de la cola en curso (set_in_use): ninguna posicion guardada queda apuntando mal
+            uint32_t overrun = queue.get_stats().overrun;
+            popped += overrun - overrun_seen;
+            overrun_seen = overrun;
+        }
+
+        /**
+          \brief Empieza una reposicion: lo que hay en la cola es el atraso y lo que llegue va por la
+          via de nuevos
+          \return Pkts del atraso
+        */
+        uint16_t start_backlog( void ) {
+            backlog      = true;
+            backlog_end  = popped + queue.available();
+            live_started = 0;
+            return queue.available();
+        }
+
+        /**
+          \brief Indica si hay una reposicion en curso
+        */
+        bool in_backlog( void ) const {
+            return backlog;
+        }
+
+        /**
+          \brief Pkts del atraso sin terminar, 0 sin reposicion
+        */
+        uint32_t backlog_left( void ) const {
+            return backlog ? backlog_end - popped : 0;
+        }
+
+        /**
+          \brief Pkts de una via sin arrancar. Sin reposicion toda la cola es la via de cabeza
+          (lane_backlog) y la de nuevos esta vacia
+        */
+        uint16_t unsent( Replay_lane_t lane_0 ) const {
+            uint16_t live_base = backlog ? backlog_end - popped : queue.available();
+            return lane_0 == lane_live ? queue.available() - live_base - live_started : live_base - started;
+        }
+
+        /**
+          \brief Siguientes pkts sin arrancar de una via. Se limitan a los que caben en la via de
+          reintentos si fallan todos los pkts de la cola en curso
+          \param lane_0 Via de la cola
+          \param max_n Pkts maximos
+          \param offsets Posiciones en la cola de los pkts
+          \return Numero de pkts
+        */
+        uint8_t next( Replay_lane_t lane_0, uint8_t max_n, uint16_t* offsets ) const {
+            uint16_t live_base = backlog ? backlog_end - popped : queue.available();
+            uint16_t first     = lane_0 == lane_live ? live_base + live_started : started;
+            uint16_t left      = unsent( lane_0 );
+            uint16_t room      = max_lane - lane_used - queue_pending;
+            uint8_t n          = 0;
+            while ( n < max_n && n < left && n < room && first + n < max_entries ) {
+                offsets[n] = first + n;
+                n++;
+            }
+            return n;
+        }
+
+        /**
+          \brief Entradas vencidas y sin peticion de la via de reintentos
+          \param ids Entradas de la via
+          \param max_n Entradas maximas
+          \param now Instante actual [ms]
+          \return Numero de entradas
+        */
+        uint8_t lane_due( uint16_t* ids, uint8_t max_n, uint32_t now ) const {
+            uint8_t n = 0;
+            for ( uint8_t i = 0; i < max_lane && n < max_n; i++ ) {
+                const Lane_entry_t& entry = lane[i];
+                if ( entry.pkt && !entry.busy && (int32_t)( now - entry.next_ms ) >= 0 ) {
+                    ids[n++] = i;
+                }
+            }
+            return n;
+        }
+
+        /**
+          \brief Espera hasta el siguiente reintento, sin contar los vencidos
+          \return UINT32_MAX si no hay ninguno [ms]
+        */
+        uint32_t lane_wait_ms( uint32_t now ) const {
+            uint32_t wait = UINT32_MAX;
+            for ( uint8_t i = 0; i < max_lane; i++ ) {
+                const Lane_entry_t& entry = lane[i];
+                if ( entry.pkt && !entry.busy && (int32_t)( entry.next_ms - now ) > 0 && entry.next_ms - now < wait ) {
+                    wait = entry.next_ms - now;
+                }
+            }
+            return wait;
+        }
+
+        /**
+          \brief Pkt de una posicion de la cola o de una entrada de la via, antes de arrancarlo
+        */
+        const Pkt_handle<T>& peek( uint16_t id, bool from_lane ) const {
+            return from_lane ? lane[id].pkt : queue.peek( id );
+        }
+
+        /**
+          \brief Pkt i-esimo de una peticion arrancada
+        */
+        const Pkt_handle<T>& peek( const Upload_window_batch_t& batch, uint8_t i ) const {
+            return batch.from_lane ? lane[batch.ids[i]].pkt : queue.peek( batch.ids[i] - popped );
+        }
+
+        /**
+          \brief Anota una peticion arrancada. Los pkts de la cola avanzan su via con advance()
+          \param batch Peticion a rellenar
+          \param ids Posiciones en la cola o entradas de la via
+          \param n Numero de pkts
+          \param from_lane true si son entradas de la via
+        */
+        void on_start( Upload_window_batch_t& batch, const uint16_t* ids, uint8_t n, bool from_lane ) {
+            batch.from_lane = from_lane;
+            batch.n_pkts    = n;
+            for ( uint8_t i = 0; i < n; i++ ) {
+                if ( from_lane ) {
+                    batch.ids[i]      = ids[i];
+                    lane[ids[i]].busy = true;
+                    stats.retried++;
+                }
+                else {
+                    batch.ids[i]                       = popped + ids[i];
+                    states[batch.ids[i] % max_entries] = entry_pending;
+                    queue_pending++;
+                }
+            }
+        }
+
+        /**
+          \brief Avanza el cursor de una via de la cola con los pkts arrancados
+        */
+        void advance( Replay_lane_t lane_0, uint8_t n ) {
+            if ( backlog && lane_0 == lane_live ) {
+                live_started += n;
+            }
+            else {
+                started += n;
+            }
+            queue.set_in_use( started + live_started );
+        }
+
+        /**
+          \brief Anota el resultado de una peticion terminada: los pkts aceptados y los descartados
+          terminan, y los fallidos pasan a la via de reintentos o siguen en ella con una espera mayor
+          \param batch Peticion terminada
+          \param failed_mask Bit i activo si fallo el pkt i
+          \param response_code Codigo de respuesta para el callback
+          \param charge El fallo cuenta como intento de los pkts
+          \param health Salud del destino, para la espera de cada pkt
+          \param now Instante actual [ms]
+          \return true si ha terminado el atraso
+        */
+        bool complete( const Upload_window_batch_t& batch, uint32_t failed_mask, long response_code, bool charge,
+                       Sink_health& health, uint32_t now ) {
+            for ( uint8_t i = 0; i < batch.n_pkts; i++ ) {
+                const Pkt_handle<T>& pkt = peek( batch, i );
+                if ( ( failed_mask & ( 1UL << i ) ) == 0 ) {
+                    stats.delivered++;
+                    if ( result_cb != NULL ) {
+                        result_cb( result_arg, pkt, true, response_code );
+                    }
+                    finish( batch, i );
+                    continue;
+                }
+
+                stats.failed++;
+                if ( result_cb != NULL && result_cb( result_arg, pkt, false, response_code ) == upload_drop ) {
+                    stats.dropped++;
+                    finish( batch, i );
+                }
+                else if ( !defer( batch, i, charge, health, now ) ) {
+                    stats.abandoned++;
+                    finish( batch, i );
+                }
+            }
+            return pop_done();
+        }
+
+        /**
+          \brief Saca de la cola los pkts terminados contiguos desde la cabeza
+          \return true si ha terminado el atraso
+        */
+        bool pop_done( void ) {
+            bool finished = false;
+            for ( ;; ) {
+                // Repuesto el atraso, los nuevos ya arrancados pasan a ser la cabeza de la cola
+                if ( backlog && (int32_t)( popped - backlog_end ) >= 0 ) {
+                    started      = live_started;
+                    live_started = 0;
+                    backlog      = false;
+                    finished     = true;
+                }
+                if ( started == 0 || states[popped % max_entries] != entry_done ) {
+                    break;
+                }
+                queue.pop();
+                popped++;
+                started--;
+            }
+            queue.set_in_use( started + live_started );
+            return finished;
+        }
+
+        /**
+          \brief Devuelve los resultados de los pkts y el tamanyo de la via de reintentos
+        */
+        Upload_sink_stats_t get_stats( void ) const {
+            Upload_sink_stats_t current = stats;
+            current.retry_lane          = lane_used;
+            return current;
+        }
+
+    private:
+
+        typedef enum : uint8_t {
+            entry_pending,              ///< Peticion en curso
+            entry_done                  ///< Terminado, sale al llegar a la cabeza
+        } Entry_state_t;
+
+        /**
+          \brief Pkt de la via de reintentos. Es una referencia compartida: el pkt ya salio de la cola
+        */
+        typedef struct {
+            Pkt_handle<T> pkt;          ///< Vacio si la entrada esta libre
+            uint8_t attempts;           ///< Fallos que cuentan como intento
+            uint32_t next_ms;           ///< Instante del siguiente envio [ms]
+            bool busy;                  ///< Reenvio en curso
+        } Lane_entry_t;
+
+        /**
+          \brief Pasa un pkt fallido a la via de reintentos o lo deja en ella con una espera mayor
+          \return false si agoto los intentos
+        */
+        bool defer( const Upload_window_batch_t& batch, uint8_t i, bool charge, Sink_health& health, uint32_t now ) {
+            uint8_t attempts = ( batch.from_lane ? lane[batch.ids[i]].attempts : 0 ) + ( charge ? 1 : 0 );
+            if ( attempts >= max_attempts ) {
+                return false;
+            }
+
+            Lane_entry_t* entry = NULL;
+            if ( batch.from_lane ) {
+                entry = &lane[batch.ids[i]];
+            }
+            else {
+                // Hay sitio: next() no da pkts de la cola que no quepan en la via
+                for ( uint8_t k = 0; k < max_lane && entry == NULL; k++ ) {
+                    entry = lane[k].pkt ? NULL : &lane[k];
+                }
+                entry->pkt = queue.peek( batch.ids[i] - popped ).share();
+                lane_used++;
+                finish( batch, i );
+            }
+            entry->attempts = attempts;
+            entry->next_ms  = now + health.retry_delay_ms( attempts == 0 ? 1 : attempts );
+            entry->busy     = false;
+            return true;
+        }
+
+        /**
+          \brief Termina un pkt de una peticion: sale de la via o queda listo para salir de la cola
+        */
+        void finish( const Upload_window_batch_t& batch, uint8_t i ) {
+            if ( batch.from_lane ) {
+                Lane_entry_t& entry = lane[batch.ids[i]];
+                entry.pkt.reset();
+                entry.busy = false;
+                lane_used--;
+            }
+            else if ( states[batch.ids[i] % max_entries] == entry_pending ) {
+                states[batch.ids[i] % max_entries] = entry_done;
+                queue_pending--;
+            }
+        }
+
+        Pkt_log_reader<T>& queue;
+        uint8_t max_attempts;
+        Upload_result_cb_t<T> result_cb;
+        void* result_arg;
+        Entry_state_t states[max_entries];  ///< Estado de los pkts arrancados, indexado por seq % max_entries
+        uint16_t started;                   ///< Pkts de cabeza de cola con peticion arrancada o terminada
+        uint16_t live_started;              ///< Igual desde backlog_end, durante una reposicion
+        bool backlog;                       ///< Reposicion en curso
+        uint32_t backlog_end;               ///< Posicion absoluta del primer pkt nuevo de la reposicion
+        uint32_t overrun_seen;              ///< Pkts quitados por el log ya sumados a popped
+        uint16_t queue_pending;             ///< Pkts de la cola en curso: al fallar necesitan sitio en la via
+        uint32_t popped;                    ///< Pkts sacados de la cola desde el arranque
+        Lane_entry_t lane[max_lane];
+        uint8_t lane_used;
+        Upload_sink_stats_t stats;
+};
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdint.h>
+#include <utility>
+#include "pkt_log.h"
+
+/**
+  \class Log_pkt
+  \brief Sustituto de Pkt con solo el origen, para las pruebas del log y de sus lectores
+*/
+class Log_pkt {
+  public:
+    Log_pkt( uint16_t size ) : src( size ) {}
+    uint32_t src;
+};
+
+/**
+  \brief Guarda en el log un pkt nuevo del pool
+  \param src Origen del pkt
+  \param mask Lectores que deben consumirlo
+*/
+inline void publish( Pkt_pool<Log_pkt>& pool, Pkt_log<Log_pkt>& log, uint32_t src, uint8_t mask ) {
+    Pkt_handle<Log_pkt> pkt = pool.acquire();
+    pkt->src                = src;
+    log.push( std::move( pkt ), mask );
+}
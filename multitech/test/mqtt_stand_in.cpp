@@ -0,0 +1,200 @@
+#include "mqtt_stand_in.h"
+#include "mqtt_codec.h"
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+Mqtt_stand_in::Mqtt_stand_in() :
+    loop( NULL ),
+    listen_fd( -1 ),
+    client_fd( -1 ),
+    port( 0 ),
+    connack_code( 0 ),
+    session_present( false ),
+    puback( true ),
+    connects( 0 ),
+    reads( 0 ),
+    clean_session( false ),
+    n_publishes( 0 ),
+    rx_len( 0 ) {
+    memset( client_id, 0, sizeof( client_id ) );
+    memset( publishes, 0, sizeof( publishes ) );
+}
+
+Mqtt_stand_in::~Mqtt_stand_in() {
+    drop_connection();
+    if ( listen_fd != -1 ) {
+        loop->remove( listen_fd );
+        close( listen_fd );
+    }
+}
+
+bool Mqtt_stand_in::init( Event_loop& loop_0 ) {
+    loop      = &loop_0;
+    listen_fd = socket( AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0 );
+    if ( listen_fd == -1 ) {
+        return false;
+    }
+
+    // Puerto 0: el kernel elige uno libre
+    struct sockaddr_in addr;
+    memset( &addr, 0, sizeof( addr ) );
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+    socklen_t len        = sizeof( addr );
+    if ( bind( listen_fd, (const struct sockaddr*)&addr, len ) != 0 || listen( listen_fd, 4 ) != 0 ||
+         getsockname( listen_fd, (struct sockaddr*)&addr, &len ) != 0 ) {
+        return false;
+    }
+    port = ntohs( addr.sin_port );
+    return loop->add( listen_fd, EPOLLIN, on_listen, this );
+}
+
+uint16_t Mqtt_stand_in::get_port( void ) const {
+    return port;
+}
+
+void Mqtt_stand_in::set_connack( uint8_t return_code, bool session_present_0 ) {
+    connack_code    = return_code;
+    session_present = session_present_0;
+}
+
+void Mqtt_stand_in::set_puback( bool puback_0 ) {
+    puback = puback_0;
+}
+
+void Mqtt_stand_in::drop_connection( void ) {
+    if ( client_fd != -1 ) {
+        loop->remove( client_fd );
+        close( client_fd );
+        client_fd = -1;
+    }
+    rx_len = 0;
+}
+
+uint32_t Mqtt_stand_in::get_connects( void ) const {
+    return connects;
+}
+
+bool Mqtt_stand_in::get_clean_session( void ) const {
+    return clean_session;
+}
+
+const char* Mqtt_stand_in::get_client_id( void ) const {
+    return client_id;
+}
+
+uint8_t Mqtt_stand_in::get_publishes( void ) const {
+    return n_publishes;
+}
+
+const Mqtt_stand_in_publish_t& Mqtt_stand_in::get_publish( uint8_t i ) const {
+    return publishes[i];
+}
+
+void Mqtt_stand_in::on_listen( void* arg, uint32_t events ) {
+    (void)events;
+    Mqtt_stand_in* broker = (Mqtt_stand_in*)arg;
+    int fd                = accept4( broker->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC );
+    if ( fd == -1 ) {
+        return;
+    }
+    // Un cliente nuevo sustituye al anterior, como un broker con el mismo client id
+    broker->drop_connection();
+    broker->client_fd = fd;
+    broker->loop->add( fd, EPOLLIN, on_client, broker );
+}
+
+void Mqtt_stand_in::on_client( void* arg, uint32_t events ) {
+    (void)events;
+    Mqtt_stand_in* broker = (Mqtt_stand_in*)arg;
+    ssize_t len           = recv( broker->client_fd, &broker->rx[broker->rx_len], rx_max_len - broker->rx_len, 0 );
+    if ( len == 0 || ( len < 0 && errno != EAGAIN && errno != EINTR ) ) {
+        broker->drop_connection();
+        return;
+    }
+    if ( len < 0 ) {
+        return;
+    }
+    broker->rx_len += len;
+    broker->reads++;
+    broker->handle();
+}
+
+bool Mqtt_stand_in::handle( void ) {
+    uint16_t pos = 0;
+    for ( ;; ) {
+        Mqtt_frame_t frame;
+        int32_t used = Mqtt_codec::parse( &rx[pos], rx_len - pos, frame );
+        if ( used < 0 ) {
+            drop_connection();
+            return false;
+        }
+        if ( used == 0 ) {
+            break;
+        }
+        pos += used;
+
+        switch ( frame.type ) {
+            case mqtt_connect: {
+                // "MQTT", nivel, flags, keepalive y client id con su longitud
+                if ( frame.body_len < 12 ) {
+                    drop_connection();
+                    return false;
+                }
+                connects++;
+                clean_session    = ( frame.body[7] & 0x02 ) != 0;
+                uint16_t id_len  = ( frame.body[10] << 8 ) | frame.body[11];
+                id_len           = id_len < client_id_max_len - 1 ? id_len : client_id_max_len - 1;
+                memcpy( client_id, &frame.body[12], id_len );
+                client_id[id_len] = '\0';
+
+                const uint8_t connack[] = { mqtt_connack << 4, 2, (uint8_t)( session_present ? 1 : 0 ), connack_code };
+                reply( connack, sizeof( connack ) );
+                if ( connack_code != 0 ) {
+                    drop_connection();
+                    return false;
+                }
+                break;
+            }
+            case mqtt_publish: {
+                uint16_t topic_len = ( frame.body[0] << 8 ) | frame.body[1];
+                uint16_t id        = ( frame.body[2 + topic_len] << 8 ) | frame.body[3 + topic_len];
+                if ( n_publishes < max_publishes ) {
+                    Mqtt_stand_in_publish_t& publish = publishes[n_publishes++];
+                    publish.packet_id                = id;
+                    publish.dup                      = ( frame.flags & 0x08 ) != 0;
+                    publish.connection               = connects;
+                    publish.read                     = reads;
+                    publish.payload_len              = frame.body_len - 4 - topic_len;
+                }
+                if ( puback ) {
+                    const uint8_t ack[] = { mqtt_puback << 4, 2, (uint8_t)( id >> 8 ), (uint8_t)id };
+                    reply( ack, sizeof( ack ) );
+                }
+                break;
+            }
+            case mqtt_pingreq: {
+                const uint8_t pong[] = { mqtt_pingresp << 4, 0 };
+                reply( pong, sizeof( pong ) );
+                break;
+            }
+            default:
+                break;
+        }
+    }
+    memmove( rx, &rx[pos], rx_len - pos );
+    rx_len -= pos;
+    return true;
+}
+
+void Mqtt_stand_in::reply( const uint8_t* out, uint16_t len ) {
+    // Respuestas de pocos bytes en un socket local: caben siempre en el buffer de envio
+    if ( client_fd != -1 && send( client_fd, out, len, MSG_NOSIGNAL ) != len ) {
+        drop_connection();
+    }
+}
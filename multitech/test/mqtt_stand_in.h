@@ -0,0 +1,123 @@
+#pragma once
+
+#include <stdint.h>
+#include "event_loop.h"
+
+/**
+  \brief PUBLISH recibido por el Mqtt_stand_in
+*/
+typedef struct {
+    uint16_t packet_id;
+    bool dup;
+    uint32_t connection;        ///< CONNECT tras el que llego, desde 1
+    uint32_t read;              ///< Lectura del socket en la que llego, desde 1
+    uint32_t payload_len;
+} Mqtt_stand_in_publish_t;
+
+/**
+  \class Mqtt_stand_in
+  \brief Broker MQTT 3.1.1 minimo en 127.0.0.1 para probar Mqtt_sink contra un socket real, como
+  haria mosquitto: responde CONNECT con un CONNACK configurable, PUBLISH QoS1 con PUBACK si se
+  pide y PINGREQ con PINGRESP, y anota lo recibido. Un solo cliente a la vez, atendido desde el
+  mismo bucle de eventos que el destino
+*/
+class Mqtt_stand_in {
+
+    public:
+
+        static const uint8_t max_publishes     = 64;
+        static const uint16_t rx_max_len       = 4096;
+        static const uint8_t client_id_max_len = 32;
+
+        /**
+          \brief Constructor de la clase. Acepta conexiones, sin sesion previa, y confirma los PUBLISH
+        */
+        Mqtt_stand_in();
+
+        /**
+          \brief Destructor de la clase
+        */
+        ~Mqtt_stand_in();
+
+        /**
+          \brief Escucha en un puerto libre de 127.0.0.1 y se registra en el bucle
+          \return Error de inicializacion
+        */
+        bool init( Event_loop& loop_0 );
+
+        /**
+          \brief Devuelve el puerto de escucha
+        */
+        uint16_t get_port( void ) const;
+
+        /**
+          \brief Fija la respuesta a los siguientes CONNECT
+          \param return_code 0 acepta; cualquier otro rechaza y cierra la conexion
+          \param session_present Sesion conservada de una conexion anterior
+        */
+        void set_connack( uint8_t return_code, bool session_present );
+
+        /**
+          \brief Fija si se responde con PUBACK a los siguientes PUBLISH
+        */
+        void set_puback( bool puback_0 );
+
+        /**
+          \brief Cierra la conexion del cliente sin DISCONNECT, como un corte de la red
+        */
+        void drop_connection( void );
+
+        /**
+          \brief CONNECT recibidos
+        */
+        uint32_t get_connects( void ) const;
+
+        /**
+          \brief Bit clean session del ultimo CONNECT
+        */
+        bool get_clean_session( void ) const;
+
+        /**
+          \brief Client id del ultimo CONNECT
+        */
+        const char* get_client_id( void ) const;
+
+        /**
+          \brief PUBLISH recibidos, hasta max_publishes
+        */
+        uint8_t get_publishes( void ) const;
+
+        /**
+          \brief Devuelve el PUBLISH i-esimo en orden de llegada
+        */
+        const Mqtt_stand_in_publish_t& get_publish( uint8_t i ) const;
+
+    private:
+
+        static void on_listen( void* arg, uint32_t events );
+        static void on_client( void* arg, uint32_t events );
+
+        /**
+          \brief Procesa los paquetes completos de rx
+          \return false si se cerro la conexion
+        */
+        bool handle( void );
+
+        void reply( const uint8_t* out, uint16_t len );
+
+        Event_loop* loop;
+        int listen_fd;
+        int client_fd;
+        uint16_t port;
+        uint8_t connack_code;
+        bool session_present;
+        bool puback;
+        uint32_t connects;
+        uint32_t reads;
+        bool clean_session;
+        char client_id[client_id_max_len];
+        Mqtt_stand_in_publish_t publishes[max_publishes];
+        uint8_t n_publishes;
+        uint8_t rx[rx_max_len];
+        uint16_t rx_len;
+};
@@ -0,0 +1,84 @@
+#include "gtest/gtest.h"
+
+#include "ack_policy.h"
+
+static const uint32_t device_a    = 0x0265E9E8;
+static const uint32_t device_b    = 0x0265E9E9;
+static const uint32_t ack_airtime = 46336;
+
+TEST( GivenAnAckPolicy, WhenModeIsAll_ThenEveryPktIsAcked ) {
+    // ARRANGE
+    Ack_policy policy;
+
+    // ACT & ASSERT
+    for ( uint8_t i = 0; i < 5; i++ ) {
+        EXPECT_TRUE( policy.should_send( device_a, false, false, 1000 + i, ack_airtime ) );
+    }
+    EXPECT_EQ( 5u, policy.get_stats().acks_sent );
+    EXPECT_EQ( 0u, policy.get_stats().acks_suppressed );
+};
+
+TEST( GivenAnAckPolicy, WhenModeIsEveryN_ThenOnePktInNIsAckedPerDevice ) {
+    // ARRANGE
+    Ack_policy policy( ack_mode_every_n, 3 );
+    uint8_t sent_a = 0;
+    uint8_t sent_b = 0;
+
+    // ACT
+    for ( uint8_t i = 0; i < 9; i++ ) {
+        sent_a += policy.should_send( device_a, false, false, 1000 + i, ack_airtime );
+        sent_b += policy.should_send( device_b, false, false, 1000 + i, ack_airtime );
+    }
+
+    // ASSERT
+    EXPECT_EQ( 3, sent_a );
+    EXPECT_EQ( 3, sent_b );
+    EXPECT_EQ( 12u, policy.get_stats().acks_suppressed );
+    EXPECT_EQ( 12ull * ack_airtime, policy.get_stats().airtime_saved_us );
+};
+
+TEST( GivenAnAckPolicy, WhenModeIsOnRequest_ThenOnlyConfirmedUplinksAreAcked ) {
+    // ARRANGE
+    Ack_policy policy( ack_mode_on_request );
+
+    // ACT & ASSERT
+    EXPECT_FALSE( policy.should_send( device_a, false, false, 1000, ack_airtime ) );
+    EXPECT_TRUE( policy.should_send( device_a, true, false, 1001, ack_airtime ) );
+};
+
+TEST( GivenAnAckPolicy, WhenModeIsCoalesce_ThenOneAckPerWindowIsSent ) {
+    // ARRANGE
+    Ack_policy policy( ack_mode_coalesce, 1, 600 );
+
+    // ACT & ASSERT
+    EXPECT_TRUE( policy.should_send( device_a, false, false, 1000, ack_airtime ) );
+    EXPECT_FALSE( policy.should_send( device_a, false, false, 1300, ack_airtime ) );
+    EXPECT_FALSE( policy.should_send( device_a, false, false, 1599, ack_airtime ) );
+    EXPECT_TRUE( policy.should_send( device_a, false, false, 1600, ack_airtime ) );
+};
+
+TEST( GivenAnAckPolicy, WhenReplyIsTimeConfig_ThenItIsAlwaysSent ) {
+    // ARRANGE
+    Ack_policy policy( ack_mode_on_request );
+
+    // ACT
+    bool result = policy.should_send( device_a, false, true, 1000, ack_airtime );
+
+    // ASSERT
+    EXPECT_TRUE( result );
+    EXPECT_EQ( 1u, policy.get_stats().time_conf_forced );
+};
+
+TEST( GivenAnAckPolicy, WhenTableIsFull_ThenLeastRecentDeviceIsReplaced ) {
+    // ARRANGE
+    Ack_policy policy( ack_mode_every_n, 2 );
+
+    // ACT
+    for ( uint32_t i = 0; i < 300; i++ ) {
+        policy.should_send( i, false, false, 1000 + i, ack_airtime );
+    }
+    bool result = policy.should_send( 299, false, false, 2000, ack_airtime );
+
+    // ASSERT
+    EXPECT_TRUE( result );
+};
@@ -0,0 +1,147 @@
+#include "gtest/gtest.h"
+
+#include "base64.h"
+
+static const size_t max_test_len = 300;
+
+// Codificador escalar de referencia, igual que la implementacion original
+static void reference_encode( const unsigned char* in, size_t len, char* out ) {
+    static const char chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    size_t j = 0;
+    for ( size_t i = 0; i < len; i += 3, j += 4 ) {
+        uint32_t v = in[i];
+        v          = i + 1 < len ? v << 8 | in[i + 1] : v << 8;
+        v          = i + 2 < len ? v << 8 | in[i + 2] : v << 8;
+        out[j]     = chars[( v >> 18 ) & 0x3F];
+        out[j + 1] = chars[( v >> 12 ) & 0x3F];
+        out[j + 2] = i + 1 < len ? chars[( v >> 6 ) & 0x3F] : '=';
+        out[j + 3] = i + 2 < len ? chars[v & 0x3F] : '=';
+    }
+    out[j] = '\0';
+}
+
+static void fill_pseudo_random( unsigned char* data, size_t len, uint32_t seed ) {
+    for ( size_t i = 0; i < len; i++ ) {
+        seed    = seed * 1103515245 + 12345;
+        data[i] = seed >> 16;
+    }
+}
+
+TEST( GivenABase64, WhenEncodingRfc4648Vectors_ThenOutputMatches ) {
+    // ARRANGE
+    Base64 base64;
+    const char* plain[]   = { "f", "fo", "foo", "foob", "fooba", "foobar" };
+    const char* encoded[] = { "Zg==", "Zm8=", "Zm9v", "Zm9vYg==", "Zm9vYmE=", "Zm9vYmFy" };
+    char out[16];
+
+    for ( uint8_t i = 0; i < 6; i++ ) {
+        // ACT
+        bool result = base64.encode( (unsigned char*)plain[i], out, strlen( plain[i] ) );
+
+        // ASSERT
+        EXPECT_TRUE( result );
+        EXPECT_STREQ( encoded[i], out );
+    }
+};
+
+TEST( GivenABase64, WhenEncodingAnyLength_ThenOutputMatchesReferenceByteForByte ) {
+    // ARRANGE
+    Base64 base64;
+    unsigned char in[max_test_len];
+    char out[max_test_len * 2];
+    char expected[max_test_len * 2];
+
+    for ( size_t len = 1; len < max_test_len; len++ ) {
+        fill_pseudo_random( in, len, len );
+        reference_encode( in, len, expected );
+
+        // ACT
+        base64.encode( in, out, len );
+
+        // ASSERT
+        ASSERT_STREQ( expected, out ) << "len " << len;
+    }
+};
+
+TEST( GivenABase64, WhenDecodingAnyLength_ThenOriginalDataIsRecovered ) {
+    // ARRANGE
+    Base64 base64;
+    unsigned char in[max_test_len];
+    char encoded[max_test_len * 2];
+    unsigned char out[max_test_len];
+
+    for ( size_t len = 1; len < max_test_len; len++ ) {
+        fill_pseudo_random( in, len, len * 7 );
+        reference_encode( in, len, encoded );
+        memset( out, 0, sizeof( out ) );
+
+        // ACT
+        bool result = base64.decode( encoded, strlen( encoded ), out, sizeof( out ) );
+
+        // ASSERT
+        ASSERT_TRUE( result ) << "len " << len;
+        ASSERT_EQ( len, base64.decoded_size( encoded ) );
+        ASSERT_EQ( 0, memcmp( in, out, len ) ) << "len " << len;
+    }
+};
+
+TEST( GivenABase64, WhenDecodingWithLength_ThenNoTerminatorIsNeeded ) {
+    // ARRANGE
+    Base64 base64;
+    const char in[] = "aGVsbG8=\"}";
+    unsigned char out[8];
+
+    // ACT
+    bool result = base64.decode( in, 8, out, sizeof( out ) );
+
+    // ASSERT
+    EXPECT_TRUE( result );
+    EXPECT_EQ( 5u, base64.decoded_size( in, 8 ) );
+    EXPECT_EQ( 0, memcmp( "hello", out, 5 ) );
+};
+
+TEST( GivenABase64, WhenAnInvalidCharIsAnywhere_ThenDecodeFails ) {
+    // ARRANGE
+    Base64 base64;
+    unsigned char in[120];
+    char encoded[200];
+    unsigned char out[200];
+    fill_pseudo_random( in, sizeof( in ), 3 );
+    reference_encode( in, sizeof( in ), encoded );
+    size_t len = strlen( encoded );
+
+    for ( size_t pos = 0; pos < len; pos++ ) {
+        char saved   = encoded[pos];
+        encoded[pos] = ( pos % 2 ) ? '*' : (char)0xC3;
+
+        // ACT
+        bool result = base64.decode( encoded, len, out, sizeof( out ) );
+
+        // ASSERT
+        EXPECT_FALSE( result ) << "pos " << pos;
+        encoded[pos] = saved;
+    }
+};
+
+TEST( GivenABase64, WhenPaddingIsNotAtTheEnd_ThenDecodeFails ) {
+    // ARRANGE
+    Base64 base64;
+    unsigned char out[16];
+
+    // ACT & ASSERT
+    EXPECT_FALSE( base64.decode( "Zg==Zm9v", out, sizeof( out ) ) );
+    EXPECT_FALSE( base64.decode( "Zm=v", out, sizeof( out ) ) );
+    EXPECT_FALSE( base64.decode( "Zm9", out, sizeof( out ) ) );
+};
+
+TEST( GivenABase64, WhenOutputIsTooSmall_ThenDecodeFails ) {
+    // ARRANGE
+    Base64 base64;
+    unsigned char out[5];
+
+    // ACT
+    bool result = base64.decode( "Zm9vYmFy", out, sizeof( out ) );
+
+    // ASSERT
+    EXPECT_FALSE( result );
+};
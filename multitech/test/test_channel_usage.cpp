@@ -0,0 +1,56 @@
+#include "gtest/gtest.h"
+
+#include "channel_usage.h"
+
+static const uint32_t now_s = 100000;
+
+TEST( GivenChannelUsage, WhenUplinksAreAdded_ThenAirtimeIsAccumulatedPerChannel ) {
+    // ARRANGE
+    Channel_usage usage;
+    Channel_report_t reports[Channel_usage::max_channels];
+
+    // ACT
+    usage.add( 868100, 300000, now_s );
+    usage.add( 868100, 300000, now_s + 1 );
+    usage.add( 868300, 60000, now_s + 2 );
+    uint8_t n = usage.get_channels( reports, Channel_usage::max_channels, now_s + 2 );
+
+    // ASSERT
+    ASSERT_EQ( 2, n );
+    EXPECT_EQ( 868100u, reports[0].freq_khz );
+    EXPECT_EQ( 2u, reports[0].uplinks );
+    EXPECT_EQ( 600000u, reports[0].airtime_us );
+    EXPECT_EQ( 1, reports[0].utilization ); // 0.6 s en 600 s
+    EXPECT_EQ( 868300u, reports[1].freq_khz );
+    EXPECT_EQ( 1u, reports[1].uplinks );
+};
+
+TEST( GivenChannelUsage, WhenWindowHasPassed_ThenOldAirtimeIsForgotten ) {
+    // ARRANGE
+    Channel_usage usage;
+    Channel_report_t report;
+    uint32_t window_s = Channel_usage::n_buckets * Channel_usage::bucket_s;
+    usage.add( 868100, 300000, now_s );
+
+    // ACT
+    usage.add( 868100, 100000, now_s + window_s );
+    usage.get_channels( &report, 1, now_s + window_s );
+
+    // ASSERT
+    EXPECT_EQ( 1u, report.uplinks );
+    EXPECT_EQ( 100000u, report.airtime_us );
+};
+
+TEST( GivenChannelUsage, WhenAllChannelsAreInUse_ThenNewChannelIsRejected ) {
+    // ARRANGE
+    Channel_usage usage;
+
+    // ACT
+    for ( uint8_t i = 0; i < Channel_usage::max_channels; i++ ) {
+        ASSERT_TRUE( usage.add( 867100 + i * 200, 1000, now_s ) );
+    }
+    bool result = usage.add( 870000, 1000, now_s );
+
+    // ASSERT
+    EXPECT_FALSE( result );
+};
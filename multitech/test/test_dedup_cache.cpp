@@ -0,0 +1,81 @@
+#include "gtest/gtest.h"
+
+#include "dedup_cache.h"
+
+static const uint32_t window_s = 120;
+
+TEST( GivenADedupCache, WhenKeyIsRepeatedWithinWindow_ThenItIsADuplicate ) {
+    // ARRANGE
+    Dedup_cache cache( window_s );
+
+    // ACT
+    bool first  = cache.check( 1234, 1000 );
+    bool second = cache.check( 1234, 1010 );
+
+    // ASSERT
+    EXPECT_FALSE( first );
+    EXPECT_TRUE( second );
+    EXPECT_EQ( 1u, cache.get_stats().hits );
+    EXPECT_EQ( 1u, cache.get_stats().misses );
+};
+
+TEST( GivenADedupCache, WhenWindowHasExpired_ThenKeyIsNew ) {
+    // ARRANGE
+    Dedup_cache cache( window_s );
+    cache.check( 1234, 1000 );
+
+    // ACT
+    bool result = cache.check( 1234, 1000 + window_s );
+
+    // ASSERT
+    EXPECT_FALSE( result );
+    EXPECT_EQ( 2u, cache.get_stats().misses );
+};
+
+TEST( GivenADedupCache, WhenKeysDiffer_ThenNoneIsADuplicate ) {
+    // ARRANGE
+    Dedup_cache cache( window_s );
+    const char eui[] = "00-00-00-00-02-65-e9-e8";
+    uint32_t fcnt    = 18;
+    uint64_t base    = Dedup_cache::hash( eui, sizeof( eui ) - 1 );
+
+    // ACT
+    bool first  = cache.check( Dedup_cache::hash( &fcnt, sizeof( fcnt ), base ), 1000 );
+    fcnt++;
+    bool second = cache.check( Dedup_cache::hash( &fcnt, sizeof( fcnt ), base ), 1000 );
+
+    // ASSERT
+    EXPECT_FALSE( first );
+    EXPECT_FALSE( second );
+};
+
+TEST( GivenADedupCache, WhenTableIsFull_ThenOldestEntriesAreEvicted ) {
+    // ARRANGE
+    Dedup_cache cache( window_s );
+
+    // ACT
+    for ( uint32_t i = 0; i < 5000; i++ ) {
+        cache.check( Dedup_cache::hash( &i, sizeof( i ) ), 1000 + i / 100 );
+    }
+    uint32_t last = 4999;
+    bool result   = cache.check( Dedup_cache::hash( &last, sizeof( last ) ), 1050 );
+
+    // ASSERT
+    EXPECT_TRUE( result );
+    EXPECT_GT( cache.get_stats().evictions, 0u );
+};
+
+TEST( GivenARegisteredKey, WhenItIsForgotten_ThenItsRetryIsNotADuplicate ) {
+    // ARRANGE
+    Dedup_cache cache( window_s );
+    cache.check( 1234, 1000 );
+
+    // ACT
+    cache.forget( 1234 );
+    bool retry = cache.check( 1234, 1005 );
+    bool again = cache.check( 1234, 1010 );
+
+    // ASSERT
+    EXPECT_FALSE( retry );
+    EXPECT_TRUE( again );
+};
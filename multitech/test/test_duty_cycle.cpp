@@ -0,0 +1,75 @@
+#include "gtest/gtest.h"
+
+#include "duty_cycle.h"
+
+static const uint32_t now_s = 100020;
+
+TEST( GivenDutyCycle, WhenFrequencyIsChecked_ThenItsSubBandIsFound ) {
+    // ARRANGE
+    // ACT
+    // ASSERT
+    EXPECT_EQ( 0, Duty_cycle::band_of( 867100 ) );
+    EXPECT_EQ( 1, Duty_cycle::band_of( 868100 ) );
+    EXPECT_EQ( 1, Duty_cycle::band_of( 0 ) );
+    EXPECT_EQ( 2, Duty_cycle::band_of( 868800 ) );
+    EXPECT_EQ( 3, Duty_cycle::band_of( 869525 ) );
+    EXPECT_EQ( -1, Duty_cycle::band_of( 869300 ) );
+    EXPECT_EQ( -1, Duty_cycle::band_of( 915000 ) );
+};
+
+TEST( GivenDutyCycle, WhenBudgetIsExhausted_ThenTransmissionIsRefused ) {
+    // ARRANGE
+    Duty_cycle duty_cycle;
+    Duty_band_report_t reports[Duty_cycle::max_bands];
+
+    // ACT
+    bool first  = duty_cycle.try_consume( 868100, 35000000, now_s );
+    bool second = duty_cycle.try_consume( 868300, 1000000, now_s + 1 );
+    bool third  = duty_cycle.try_consume( 868500, 1, now_s + 2 );
+    bool other  = duty_cycle.try_consume( 869525, 1000000, now_s + 2 );
+    duty_cycle.get_bands( reports, Duty_cycle::max_bands, now_s + 2 );
+
+    // ASSERT
+    EXPECT_TRUE( first );
+    EXPECT_TRUE( second );
+    EXPECT_FALSE( third );
+    EXPECT_TRUE( other );
+    EXPECT_EQ( 36000000u, reports[1].budget_us ); // 1 % de una hora
+    EXPECT_EQ( 36000000u, reports[1].used_us );
+    EXPECT_EQ( 1000, reports[1].usage );
+    EXPECT_EQ( 1u, reports[1].refused );
+    EXPECT_EQ( 360000000u, reports[3].budget_us );
+    EXPECT_EQ( 2, reports[3].usage );
+};
+
+TEST( GivenDutyCycle, WhenFrequencyIsOutsideTheBands_ThenTransmissionIsRefused ) {
+    // ARRANGE
+    Duty_cycle duty_cycle;
+
+    // ACT
+    bool consumed = duty_cycle.try_consume( 869300, 1000, now_s );
+
+    // ASSERT
+    EXPECT_FALSE( consumed );
+    EXPECT_EQ( UINT32_MAX, duty_cycle.wait_s( 869300, 1000, now_s ) );
+};
+
+TEST( GivenExhaustedBudget, WhenWaitIsAsked_ThenItEndsWhenTheOldestAirtimeLeavesTheWindow ) {
+    // ARRANGE
+    Duty_cycle duty_cycle;
+    uint32_t window_s = Duty_cycle::n_buckets * Duty_cycle::bucket_s;
+    duty_cycle.try_consume( 868800, 1000000, now_s );
+    duty_cycle.try_consume( 868800, 2600000, now_s + 600 );
+
+    // ACT
+    uint32_t wait_small = duty_cycle.wait_s( 868800, 500000, now_s + 700 );
+    uint32_t wait_large = duty_cycle.wait_s( 868800, 1500000, now_s + 700 );
+    uint32_t wait_never = duty_cycle.wait_s( 868800, 4000000, now_s + 700 );
+
+    // ASSERT
+    EXPECT_EQ( window_s - 700, wait_small );
+    EXPECT_EQ( window_s - 100, wait_large );
+    EXPECT_EQ( UINT32_MAX, wait_never );
+    EXPECT_FALSE( duty_cycle.try_consume( 868800, 500000, now_s + 700 ) );
+    EXPECT_TRUE( duty_cycle.try_consume( 868800, 500000, now_s + 700 + wait_small ) );
+};
@@ -0,0 +1,130 @@
+#include "gtest/gtest.h"
+
+#include "gwmp_parser.h"
+#include <string.h>
+
+typedef struct {
+    uint8_t count;
+    Gwmp_rxpk_t rxpk[4];
+} Packets_t;
+
+static void collect( const Gwmp_rxpk_t& rxpk, void* arg ) {
+    Packets_t* packets              = (Packets_t*)arg;
+    packets->rxpk[packets->count++] = rxpk;
+}
+
+// Captura de un PUSH_DATA con dos paquetes, el segundo con "rsig" anidado y CRC erroneo
+static const char push_json[] =
+    "{\"rxpk\":[{\"tmst\":3512348611,\"chan\":2,\"rfch\":0,\"freq\":868.500000,\"stat\":1,\"modu\":\"LORA\","
+    "\"datr\":\"SF9BW125\",\"codr\":\"4/5\",\"rssi\":-47,\"lsnr\":10.2,\"size\":4,\"data\":\"gNobASY=\"},"
+    "{\"tmst\":3512348700,\"freq\":867.1,\"stat\":-1,\"modu\":\"LORA\",\"datr\":\"SF12BW125\",\"codr\":\"4/6\","
+    "\"rsig\":[{\"ant\":0,\"chan\":7,\"rssic\":-120,\"lsnr\":-13.5}],\"rssi\":-118,\"lsnr\":-12.5,\"size\":1,\"data\":\"AA==\"}],"
+    "\"stat\":{\"time\":\"2021-01-05 20:42:44 GMT\",\"rxnb\":2}}";
+
+TEST( GivenAPushDataDatagram, WhenParsingHeader_ThenTokenEuiAndJsonAreLocated ) {
+    // ARRANGE
+    uint8_t datagram[12 + sizeof( push_json )] = { 0x02, 0x12, 0x34, 0x00, 0x00, 0x80, 0x00, 0x00, 0xA0, 0x00, 0x69, 0x3F };
+    memcpy( datagram + 12, push_json, sizeof( push_json ) - 1 );
+    Gwmp_header_t header;
+
+    // ACT
+    bool result = Gwmp_parser::parse_header( datagram, sizeof( datagram ) - 1, header );
+
+    // ASSERT
+    EXPECT_TRUE( result );
+    EXPECT_EQ( gwmp_push_data, header.ident );
+    EXPECT_EQ( 0x1234, header.token );
+    EXPECT_EQ( 0x00800000A000693FULL, header.gateway_eui );
+    EXPECT_EQ( (const char*)datagram + 12, header.json );
+    EXPECT_EQ( sizeof( push_json ) - 1, header.json_len );
+};
+
+TEST( GivenAnOldProtocolVersion, WhenParsingHeader_ThenItIsRejected ) {
+    // ARRANGE
+    const uint8_t datagram[] = { 0x01, 0x12, 0x34, 0x02, 0, 0, 0, 0, 0, 0, 0, 0 };
+    Gwmp_header_t header;
+
+    // ACT
+    bool result = Gwmp_parser::parse_header( datagram, sizeof( datagram ), header );
+
+    // ASSERT
+    EXPECT_FALSE( result );
+};
+
+TEST( GivenAnRxpkArray, WhenParsing_ThenEveryPacketIsReportedWithItsTopLevelFields ) {
+    // ARRANGE
+    Packets_t packets;
+    memset( &packets, 0, sizeof( packets ) );
+
+    // ACT
+    int16_t count = Gwmp_parser::parse_rxpk( push_json, sizeof( push_json ) - 1, collect, &packets );
+
+    // ASSERT
+    ASSERT_EQ( 2, count );
+    ASSERT_EQ( 2, packets.count );
+    EXPECT_EQ( 1, packets.rxpk[0].stat );
+    EXPECT_EQ( 9, packets.rxpk[0].modulation.sf );
+    EXPECT_EQ( 125, packets.rxpk[0].modulation.bw_khz );
+    EXPECT_EQ( 1, packets.rxpk[0].modulation.cr );
+    EXPECT_EQ( 868500u, packets.rxpk[0].radio.freq_khz );
+    EXPECT_EQ( -47, packets.rxpk[0].radio.rssi );
+    EXPECT_EQ( 102, packets.rxpk[0].radio.lsnr );
+    EXPECT_EQ( 3512348611u, packets.rxpk[0].radio.tmst );
+    EXPECT_TRUE( packets.rxpk[0].radio.valid );
+    EXPECT_EQ( 0, strncmp( "gNobASY=", packets.rxpk[0].data, packets.rxpk[0].data_len ) );
+    EXPECT_EQ( 8u, packets.rxpk[0].data_len );
+
+    // El "lsnr" de "rsig" no sustituye al del paquete
+    EXPECT_EQ( -1, packets.rxpk[1].stat );
+    EXPECT_EQ( 12, packets.rxpk[1].modulation.sf );
+    EXPECT_EQ( -125, packets.rxpk[1].radio.lsnr );
+    EXPECT_EQ( -118, packets.rxpk[1].radio.rssi );
+    EXPECT_EQ( 4u, packets.rxpk[1].data_len );
+};
+
+TEST( GivenATruncatedRxpkArray, WhenParsing_ThenItIsMalformed ) {
+    // ARRANGE
+    const char json[] = "{\"rxpk\":[{\"stat\":1,\"data\":\"AA==\"},{\"stat\":1,\"data\":\"AA";
+    Packets_t packets;
+    memset( &packets, 0, sizeof( packets ) );
+
+    // ACT
+    int16_t count = Gwmp_parser::parse_rxpk( json, sizeof( json ) - 1, collect, &packets );
+
+    // ASSERT
+    EXPECT_EQ( -1, count );
+};
+
+TEST( GivenAPullData, WhenBuildingAck_ThenItIsAPullAckWithTheSameToken ) {
+    // ARRANGE
+    const uint8_t datagram[] = { 0x02, 0xAB, 0xCD, 0x02, 0, 0x80, 0, 0, 0xA0, 0, 0x69, 0x3F };
+    Gwmp_header_t header;
+    Gwmp_parser::parse_header( datagram, sizeof( datagram ), header );
+    uint8_t ack[Gwmp_parser::header_len];
+
+    // ACT
+    uint8_t len = Gwmp_parser::build_ack( header, ack );
+
+    // ASSERT
+    ASSERT_EQ( +Gwmp_parser::header_len, len );
+    EXPECT_EQ( 0x02, ack[0] );
+    EXPECT_EQ( 0xAB, ack[1] );
+    EXPECT_EQ( 0xCD, ack[2] );
+    EXPECT_EQ( gwmp_pull_ack, ack[3] );
+};
+
+TEST( GivenATxpk, WhenBuildingPullResp_ThenJsonFollowsTheHeader ) {
+    // ARRANGE
+    const char txpk[] = "{\"txpk\":{\"imme\":true}}";
+    uint8_t out[64];
+
+    // ACT
+    size_t len     = Gwmp_parser::build_pull_resp( 7, txpk, sizeof( txpk ) - 1, out, sizeof( out ) );
+    size_t too_big = Gwmp_parser::build_pull_resp( 7, txpk, sizeof( txpk ) - 1, out, 8 );
+
+    // ASSERT
+    EXPECT_EQ( Gwmp_parser::header_len + sizeof( txpk ) - 1, len );
+    EXPECT_EQ( gwmp_pull_resp, out[3] );
+    EXPECT_EQ( 0, memcmp( txpk, out + Gwmp_parser::header_len, sizeof( txpk ) - 1 ) );
+    EXPECT_EQ( 0u, too_big );
+};
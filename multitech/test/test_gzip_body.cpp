@@ -0,0 +1,83 @@
+#include "gtest/gtest.h"
+
+#include "gzip_body.h"
+#include <string.h>
+#include <zlib.h>
+
+// Descomprime un cuerpo gzip como lo haria el servidor
+static uint32_t gunzip( const uint8_t* in, uint32_t len, uint8_t* out, uint32_t max_len ) {
+    z_stream stream;
+    memset( &stream, 0, sizeof( stream ) );
+    inflateInit2( &stream, 15 + 16 );
+    stream.next_in   = (Bytef*)in;
+    stream.avail_in  = len;
+    stream.next_out  = out;
+    stream.avail_out = max_len;
+    int result       = inflate( &stream, Z_FINISH );
+    uint32_t out_len = stream.total_out;
+    inflateEnd( &stream );
+    return result == Z_STREAM_END ? out_len : 0;
+}
+
+TEST( GivenAGzipBody, WhenACsvBatchIsCompressed_ThenItShrinksAndRoundTrips ) {
+    // ARRANGE
+    Gzip_body gzip;
+    char body[2048];
+    uint16_t len = snprintf( body, sizeof( body ), "MobileID=01&project=boluda" );
+    while ( len < 1500 ) {
+        len += snprintf( &body[len], sizeof( body ) - len, "&pkt[]=44,1,2,3,0,0,16,%u,200,17,0,3,99", len % 200 );
+    }
+    uint8_t packed[2048];
+    uint8_t unpacked[2048];
+    ASSERT_TRUE( gzip.init( 6 ) );
+
+    // ACT
+    uint32_t packed_len   = gzip.compress( (const uint8_t*)body, len, packed, sizeof( packed ) );
+    uint32_t unpacked_len = gunzip( packed, packed_len, unpacked, sizeof( unpacked ) );
+
+    // ASSERT
+    EXPECT_GT( packed_len, 0u );
+    EXPECT_LT( packed_len, len / 3u );
+    ASSERT_EQ( len, unpacked_len );
+    EXPECT_EQ( 0, memcmp( body, unpacked, len ) );
+};
+
+TEST( GivenAGzipBody, WhenCompressionDoesNotShrinkTheBody_ThenItIsSkipped ) {
+    // ARRANGE
+    Gzip_body gzip;
+    uint8_t noise[64];
+    uint32_t seed = 1;
+    for ( uint8_t i = 0; i < sizeof( noise ); i++ ) {
+        seed     = seed * 1103515245 + 12345;
+        noise[i] = seed >> 16;
+    }
+    uint8_t packed[256];
+    gzip.init( 6 );
+
+    // ACT
+    uint32_t packed_len = gzip.compress( noise, sizeof( noise ), packed, sizeof( packed ) );
+    uint32_t empty_len  = gzip.compress( noise, 0, packed, sizeof( packed ) );
+
+    // ASSERT
+    EXPECT_EQ( 0u, packed_len );
+    EXPECT_EQ( 0u, empty_len );
+};
+
+TEST( GivenAGzipBody, WhenReusedForSeveralBodies_ThenEachOneIsIndependent ) {
+    // ARRANGE
+    Gzip_body gzip;
+    const char first[]  = "pkt[]=1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1";
+    const char second[] = "pkt[]=2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2";
+    uint8_t packed[128];
+    uint8_t unpacked[128];
+    gzip.init( 1 );
+    gzip.compress( (const uint8_t*)first, strlen( first ), packed, sizeof( packed ) );
+
+    // ACT
+    uint32_t packed_len   = gzip.compress( (const uint8_t*)second, strlen( second ), packed, sizeof( packed ) );
+    uint32_t unpacked_len = gunzip( packed, packed_len, unpacked, sizeof( unpacked ) );
+
+    // ASSERT
+    ASSERT_EQ( strlen( second ), unpacked_len );
+    EXPECT_EQ( 0, memcmp( second, unpacked, unpacked_len ) );
+};
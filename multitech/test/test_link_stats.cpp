@@ -0,0 +1,111 @@
+#include "gtest/gtest.h"
+
+#include "link_stats.h"
+
+static const char eui_a[] = "00-00-00-00-02-65-e9-e8";
+static const char eui_b[] = "00-00-00-00-02-65-e9-e9";
+
+static Lora_radio_t radio( int16_t rssi, int16_t lsnr ) {
+    Lora_radio_t r;
+    memset( &r, 0, sizeof( r ) );
+    r.rssi     = rssi;
+    r.lsnr     = lsnr;
+    r.freq_khz = 868500;
+    r.size     = 51;
+    r.valid    = true;
+    return r;
+}
+
+static Lora_modulation_t modulation( uint8_t sf ) {
+    Lora_modulation_t mod;
+    mod.sf     = sf;
+    mod.bw_khz = 125;
+    mod.cr     = 1;
+    return mod;
+}
+
+TEST( GivenLinkStats, WhenUplinksAreAdded_ThenReportSummarizesThem ) {
+    // ARRANGE
+    Link_stats stats;
+    Link_device_report_t report;
+
+    // ACT
+    stats.update( eui_a, sizeof( eui_a ) - 1, radio( -50, 20 ), modulation( 12 ), 1000 );
+    stats.update( eui_a, sizeof( eui_a ) - 1, radio( -60, -40 ), modulation( 12 ), 1010 );
+    stats.update( eui_b, sizeof( eui_b ) - 1, radio( -110, -150 ), modulation( 10 ), 1020 );
+    bool found = stats.get_device( eui_a, report );
+
+    // ASSERT
+    EXPECT_TRUE( found );
+    EXPECT_STREQ( eui_a, report.eui );
+    EXPECT_EQ( 2u, report.uplinks );
+    EXPECT_EQ( 2, report.samples );
+    EXPECT_EQ( -55, report.rssi_avg );
+    EXPECT_EQ( -10, report.lsnr_avg );
+    EXPECT_EQ( -40, report.lsnr_min );
+    EXPECT_EQ( 20, report.lsnr_max );
+    EXPECT_EQ( 1010u, report.last_seen_s );
+};
+
+TEST( GivenLinkStats, WhenMoreUplinksThanRing_ThenOnlyLatestAreSummarized ) {
+    // ARRANGE
+    Link_stats stats;
+    Link_device_report_t report;
+
+    // ACT
+    for ( uint8_t i = 0; i < Link_stats::ring_len; i++ ) {
+        stats.update( eui_a, sizeof( eui_a ) - 1, radio( -120, -200 ), modulation( 12 ), 1000 + i );
+    }
+    for ( uint8_t i = 0; i < Link_stats::ring_len; i++ ) {
+        stats.update( eui_a, sizeof( eui_a ) - 1, radio( -40, 80 ), modulation( 12 ), 2000 + i );
+    }
+    stats.get_device( eui_a, report );
+
+    // ASSERT
+    EXPECT_EQ( 2u * Link_stats::ring_len, report.uplinks );
+    EXPECT_EQ( +Link_stats::ring_len, report.samples );
+    EXPECT_EQ( -40, report.rssi_avg );
+    EXPECT_EQ( 80, report.lsnr_min );
+};
+
+TEST( GivenLinkStats, WhenSnrHasMargin_ThenFasterSfIsSuggested ) {
+    // ARRANGE
+    Link_stats stats;
+    Link_device_report_t report;
+
+    // ACT: SF12 necesita -20 dB, con 0 dB hay 20 dB - 10 dB de instalacion = 3 pasos
+    stats.update( eui_a, sizeof( eui_a ) - 1, radio( -90, 0 ), modulation( 12 ), 1000 );
+    stats.get_device( eui_a, report );
+
+    // ASSERT
+    EXPECT_EQ( 12, report.sf );
+    EXPECT_EQ( 9, report.suggested_sf );
+};
+
+TEST( GivenLinkStats, WhenSnrIsLow_ThenSfIsKept ) {
+    // ARRANGE
+    Link_stats stats;
+    Link_device_report_t report;
+
+    // ACT
+    stats.update( eui_a, sizeof( eui_a ) - 1, radio( -118, -150 ), modulation( 10 ), 1000 );
+    stats.get_device( eui_a, report );
+
+    // ASSERT
+    EXPECT_EQ( 10, report.suggested_sf );
+};
+
+TEST( GivenLinkStats, WhenRadioIsNotValid_ThenUplinkIsIgnored ) {
+    // ARRANGE
+    Link_stats stats;
+    Link_device_report_t report;
+    Lora_radio_t invalid = radio( -50, 20 );
+    invalid.valid        = false;
+
+    // ACT
+    bool result = stats.update( eui_a, sizeof( eui_a ) - 1, invalid, modulation( 7 ), 1000 );
+
+    // ASSERT
+    EXPECT_FALSE( result );
+    EXPECT_FALSE( stats.get_device( eui_a, report ) );
+};
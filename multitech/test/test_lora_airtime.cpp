@@ -0,0 +1,53 @@
+#include "gtest/gtest.h"
+
+#include "lora_airtime.h"
+#include <string.h>
+
+static Lora_modulation_t modulation( uint8_t sf, uint16_t bw_khz ) {
+    Lora_modulation_t mod;
+    mod.sf     = sf;
+    mod.bw_khz = bw_khz;
+    mod.cr     = 1;
+    return mod;
+}
+
+TEST( GivenLoraAirtime, WhenDatrAndCodrAreValid_ThenModulationIsParsed ) {
+    // ARRANGE
+    Lora_modulation_t mod;
+    memset( &mod, 0, sizeof( mod ) );
+
+    // ACT
+    bool datr = Lora_airtime::parse_datr( "SF12BW125", 9, mod );
+    bool codr = Lora_airtime::parse_codr( "4/7", 3, mod );
+
+    // ASSERT
+    EXPECT_TRUE( datr );
+    EXPECT_TRUE( codr );
+    EXPECT_EQ( 12, mod.sf );
+    EXPECT_EQ( 125, mod.bw_khz );
+    EXPECT_EQ( 3, mod.cr );
+};
+
+TEST( GivenLoraAirtime, WhenDatrIsNotLora_ThenParseFails ) {
+    // ARRANGE
+    Lora_modulation_t mod;
+    memset( &mod, 0, sizeof( mod ) );
+
+    // ACT & ASSERT
+    EXPECT_FALSE( Lora_airtime::parse_datr( "50000", 5, mod ) );
+    EXPECT_FALSE( Lora_airtime::parse_datr( "SF13BW125", 9, mod ) );
+};
+
+TEST( GivenLoraAirtime, WhenModulationIsKnown_ThenTimeOnAirMatchesReference ) {
+    // ACT & ASSERT
+    EXPECT_EQ( 46336u, Lora_airtime::time_on_air_us( modulation( 7, 125 ), 13, true ) );
+    EXPECT_EQ( 23168u, Lora_airtime::time_on_air_us( modulation( 7, 250 ), 13, true ) );
+    EXPECT_EQ( 328704u, Lora_airtime::time_on_air_us( modulation( 9, 125 ), 51, true ) );
+    EXPECT_EQ( 2465792u, Lora_airtime::time_on_air_us( modulation( 12, 125 ), 51, true ) );
+    EXPECT_EQ( 1318912u, Lora_airtime::time_on_air_us( modulation( 12, 125 ), 20, false ) );
+};
+
+TEST( GivenLoraAirtime, WhenModulationIsUnknown_ThenTimeOnAirIsZero ) {
+    // ACT & ASSERT
+    EXPECT_EQ( 0u, Lora_airtime::time_on_air_us( modulation( 0, 125 ), 13, true ) );
+};
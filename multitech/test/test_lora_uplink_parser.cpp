@@ -0,0 +1,205 @@
+#include "gtest/gtest.h"
+
+#include "lora_uplink_parser.h"
+
+static const char uplink_line[] =
+    "lora/00-00-00-00-02-65-e9-e8/up {\"tmst\":3734965956,\"time\":\"2021-01-05T20:42:44.962524Z\",\"chan\":2,\"rfch\":0,"
+    "\"freq\":868.5,\"stat\":1,\"modu\":\"LORA\",\"datr\":\"SF9BW125\",\"codr\":\"4/5\",\"lsnr\":10.0,\"rssi\":-47,\"size\":51,"
+    "\"fcnt\":18,\"port\":2,\"mhdr\":\"801dce3001801200\",\"data\":\"LOjpZQJ7AAAAgggEz/RfxSsAAAAAAAAAaYukIWAYKUNMXFDe3m/BVp8cAkAgAAJAgIAZ\","
+    "\"appeui\":\"00-80-00-00-00-00-e1-9c\",\"deveui\":\"00-00-00-00-02-65-e9-e8\",\"ack\":false,\"seqn\":18}";
+
+class Fixture_lora_uplink_parser: public ::testing::Test {
+  protected:
+    void SetUp() override {
+        strcpy( line, uplink_line );
+        memset( out, 0, sizeof( out ) );
+    }
+
+    bool parse( void ) {
+        return parser.parse( line, strlen( line ), out, sizeof( out ), uplink );
+    }
+
+    Lora_uplink_parser parser;
+    Lora_uplink_t uplink;
+    char line[sizeof( uplink_line ) + 32];
+    uint8_t out[100];
+};
+
+TEST_F( Fixture_lora_uplink_parser, WhenLineIsValid_ThenPrefixAndDataAreLocated ) {
+    // ACT
+    bool result = parse();
+
+    // ASSERT
+    EXPECT_TRUE( result );
+    EXPECT_EQ( 31, uplink.prefix_len );
+    EXPECT_EQ( 0, strncmp( "lora/00-00-00-00-02-65-e9-e8/up", uplink.prefix, uplink.prefix_len ) );
+    EXPECT_EQ( 23, uplink.eui_len );
+    EXPECT_EQ( 0, strncmp( "00-00-00-00-02-65-e9-e8", uplink.eui, uplink.eui_len ) );
+    EXPECT_EQ( 51, uplink.data_len );
+    EXPECT_EQ( 0x2C, out[0] );
+    EXPECT_EQ( 0xE8, out[1] );
+    EXPECT_EQ( 0x19, out[50] );
+};
+
+TEST_F( Fixture_lora_uplink_parser, WhenLineIsParsed_ThenLineIsNotModified ) {
+    // ACT
+    parse();
+
+    // ASSERT
+    EXPECT_STREQ( uplink_line, line );
+};
+
+TEST_F( Fixture_lora_uplink_parser, WhenPrefixHasOtherLength_ThenLineIsAccepted ) {
+    // ARRANGE
+    strcpy( line, "lora/00-80-00-00-a0-00-69-3f-01/up {\"data\":\"aGVsbG8=\"}" );
+
+    // ACT
+    bool result = parse();
+
+    // ASSERT
+    EXPECT_TRUE( result );
+    EXPECT_EQ( 34, uplink.prefix_len );
+    EXPECT_EQ( 5, uplink.data_len );
+    EXPECT_EQ( 0, memcmp( "hello", out, 5 ) );
+};
+
+TEST_F( Fixture_lora_uplink_parser, WhenPrefixIsNotUplink_ThenLineIsRejected ) {
+    // ARRANGE
+    strcpy( line, "lora/00-00-00-00-02-65-e9-e8/down {\"data\":\"aGVsbG8=\"}" );
+
+    // ACT
+    bool result = parse();
+
+    // ASSERT
+    EXPECT_FALSE( result );
+};
+
+TEST_F( Fixture_lora_uplink_parser, WhenThereIsNoJson_ThenLineIsRejected ) {
+    // ARRANGE
+    strcpy( line, "lora/00-00-00-00-02-65-e9-e8/up" );
+
+    // ACT
+    bool result = parse();
+
+    // ASSERT
+    EXPECT_FALSE( result );
+};
+
+TEST_F( Fixture_lora_uplink_parser, WhenDataFieldIsMissing_ThenLineIsRejected ) {
+    // ARRANGE
+    strcpy( line, "lora/00-00-00-00-02-65-e9-e8/up {\"tmst\":3734965956,\"size\":51}" );
+
+    // ACT
+    bool result = parse();
+
+    // ASSERT
+    EXPECT_FALSE( result );
+};
+
+TEST_F( Fixture_lora_uplink_parser, WhenDataIsNotClosed_ThenLineIsRejected ) {
+    // ARRANGE
+    strcpy( line, "lora/00-00-00-00-02-65-e9-e8/up {\"data\":\"aGVsbG8=" );
+
+    // ACT
+    bool result = parse();
+
+    // ASSERT
+    EXPECT_FALSE( result );
+};
+
+TEST_F( Fixture_lora_uplink_parser, WhenDataIsNotBase64_ThenLineIsRejected ) {
+    // ARRANGE
+    strcpy( line, "lora/00-00-00-00-02-65-e9-e8/up {\"data\":\"aGV*bG8=\"}" );
+
+    // ACT
+    bool result = parse();
+
+    // ASSERT
+    EXPECT_FALSE( result );
+};
+
+TEST_F( Fixture_lora_uplink_parser, WhenDataDoesNotFitInOutput_ThenLineIsRejected ) {
+    // ACT
+    bool result = parser.parse( line, strlen( line ), out, 50, uplink );
+
+    // ASSERT
+    EXPECT_FALSE( result );
+};
+
+TEST_F( Fixture_lora_uplink_parser, WhenLineHasRadioMetadata_ThenModulationAndConfirmedAreParsed ) {
+    // ACT
+    bool result = parse();
+
+    // ASSERT
+    EXPECT_TRUE( result );
+    EXPECT_EQ( 9, uplink.modulation.sf );
+    EXPECT_EQ( 125, uplink.modulation.bw_khz );
+    EXPECT_EQ( 1, uplink.modulation.cr );
+    EXPECT_TRUE( uplink.confirmed );
+};
+
+TEST_F( Fixture_lora_uplink_parser, WhenMhdrIsUnconfirmed_ThenConfirmedIsFalse ) {
+    // ARRANGE
+    char* mhdr = strstr( line, "\"mhdr\":\"80" );
+    mhdr[8]    = '4';
+
+    // ACT
+    bool result = parse();
+
+    // ASSERT
+    EXPECT_TRUE( result );
+    EXPECT_FALSE( uplink.confirmed );
+};
+
+TEST_F( Fixture_lora_uplink_parser, WhenLineHasFcnt_ThenFrameCounterIsParsed ) {
+    // ACT
+    bool result = parse();
+
+    // ASSERT
+    EXPECT_TRUE( result );
+    EXPECT_TRUE( uplink.has_fcnt );
+    EXPECT_EQ( 18u, uplink.fcnt );
+};
+
+TEST_F( Fixture_lora_uplink_parser, WhenFcntIsMissing_ThenSeqnIsUsed ) {
+    // ARRANGE
+    char* fcnt = strstr( line, "\"fcnt\"" );
+    fcnt[1]    = 'x';
+    char* seqn = strstr( line, "\"seqn\":18" );
+    seqn[7]    = '7';
+
+    // ACT
+    bool result = parse();
+
+    // ASSERT
+    EXPECT_TRUE( result );
+    EXPECT_TRUE( uplink.has_fcnt );
+    EXPECT_EQ( 78u, uplink.fcnt );
+};
+
+TEST_F( Fixture_lora_uplink_parser, WhenLineHasRadioFields_ThenLinkMetadataIsParsed ) {
+    // ACT
+    bool result = parse();
+
+    // ASSERT
+    EXPECT_TRUE( result );
+    EXPECT_TRUE( uplink.radio.valid );
+    EXPECT_EQ( -47, uplink.radio.rssi );
+    EXPECT_EQ( 100, uplink.radio.lsnr );
+    EXPECT_EQ( 868500u, uplink.radio.freq_khz );
+    EXPECT_EQ( 51, uplink.radio.size );
+    EXPECT_EQ( 3734965956u, uplink.radio.tmst );
+};
+
+TEST_F( Fixture_lora_uplink_parser, WhenSnrIsNegative_ThenItIsParsedInTenthsOfDb ) {
+    // ARRANGE
+    char* lsnr = strstr( line, "\"lsnr\":10.0" );
+    memcpy( lsnr + 7, "-7.5", 4 );
+
+    // ACT
+    bool result = parse();
+
+    // ASSERT
+    EXPECT_TRUE( result );
+    EXPECT_EQ( -75, uplink.radio.lsnr );
+};
@@ -0,0 +1,93 @@
+#include "gtest/gtest.h"
+
+#include "aes128.h"
+#include "lorawan_frame.h"
+#include <string.h>
+
+static const uint8_t app_s_key[16] = { 0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6, 0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C };
+static const uint32_t dev_addr     = 0x26011BDA;
+
+TEST( GivenAnAes128Key, WhenEncryptingTheFips197Vector_ThenCiphertextMatches ) {
+    // ARRANGE
+    const uint8_t key[16]      = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F };
+    const uint8_t plain[16]    = { 0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF };
+    const uint8_t expected[16] = { 0x69, 0xC4, 0xE0, 0xD8, 0x6A, 0x7B, 0x04, 0x30, 0xD8, 0xCD, 0xB7, 0x80, 0x70, 0xB4, 0xC5, 0x5A };
+    Aes128 aes;
+    uint8_t cipher[16];
+
+    // ACT
+    aes.set_key( key );
+    aes.encrypt( plain, cipher );
+
+    // ASSERT
+    EXPECT_EQ( 0, memcmp( expected, cipher, sizeof( expected ) ) );
+};
+
+TEST( GivenAnUplinkFrame, WhenParsing_ThenHeaderFieldsAndPayloadAreLocated ) {
+    // ARRANGE
+    // MHDR confirmed up | DevAddr LE | FCtrl con 1 byte de FOpts | FCnt LE | FOpts | FPort | FRMPayload | MIC
+    const uint8_t phy[] = { 0x80, 0xDA, 0x1B, 0x01, 0x26, 0x81, 0x45, 0x23, 0x02, 0x02, 0xAA, 0xBB, 0xCC, 0x11, 0x22, 0x33, 0x44 };
+    Lorawan_frame_t frame;
+
+    // ACT
+    bool result = Lorawan_frame::parse( phy, sizeof( phy ), frame );
+
+    // ASSERT
+    EXPECT_TRUE( result );
+    EXPECT_EQ( mtype_confirmed_up, frame.mtype );
+    EXPECT_EQ( dev_addr, frame.dev_addr );
+    EXPECT_EQ( 0x2345, frame.fcnt );
+    EXPECT_EQ( 1, frame.fopts_len );
+    EXPECT_TRUE( frame.has_fport );
+    EXPECT_EQ( 2, frame.fport );
+    EXPECT_EQ( phy + 10, frame.payload );
+    EXPECT_EQ( 3, frame.payload_len );
+    EXPECT_EQ( 0x44332211u, frame.mic );
+};
+
+TEST( GivenAJoinRequest, WhenParsing_ThenItIsNotADataFrame ) {
+    // ARRANGE
+    uint8_t phy[23];
+    memset( phy, 0, sizeof( phy ) );
+    Lorawan_frame_t frame;
+
+    // ACT
+    bool result = Lorawan_frame::parse( phy, sizeof( phy ), frame );
+
+    // ASSERT
+    EXPECT_FALSE( result );
+};
+
+TEST( GivenAnEncryptedPayload, WhenDecrypting_ThenMatchesReferenceKeystream ) {
+    // ARRANGE
+    // Referencia generada con AES-128-ECB sobre los bloques A_1 y A_2 de la especificacion
+    const uint8_t cipher[20] = { 0x24, 0x96, 0x38, 0x2E, 0xAB, 0xC3, 0x9C, 0x47, 0xF5, 0x1B, 0x5A, 0xF5, 0xBC, 0x33, 0x0A, 0xB7, 0xAA, 0xFF, 0x44, 0xBF };
+    uint8_t plain[20];
+
+    // ACT
+    Lorawan_frame::crypt_payload( app_s_key, dev_addr, 0x00012345, true, cipher, sizeof( cipher ), plain );
+
+    // ASSERT
+    for ( uint8_t i = 0; i < sizeof( plain ); i++ ) {
+        EXPECT_EQ( 0x2C + i, plain[i] );
+    }
+};
+
+TEST( GivenAPayload, WhenEncryptingAndDecryptingInPlace_ThenOriginalIsRecovered ) {
+    // ARRANGE
+    uint8_t data[40];
+    for ( uint8_t i = 0; i < sizeof( data ); i++ ) {
+        data[i] = i * 7;
+    }
+
+    // ACT
+    Lorawan_frame::crypt_payload( app_s_key, dev_addr, 99, true, data, sizeof( data ), data );
+    bool changed = data[0] != 0 || data[1] != 7;
+    Lorawan_frame::crypt_payload( app_s_key, dev_addr, 99, true, data, sizeof( data ), data );
+
+    // ASSERT
+    EXPECT_TRUE( changed );
+    for ( uint8_t i = 0; i < sizeof( data ); i++ ) {
+        EXPECT_EQ( (uint8_t)( i * 7 ), data[i] );
+    }
+};
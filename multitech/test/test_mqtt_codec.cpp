@@ -0,0 +1,66 @@
+#include "gtest/gtest.h"
+
+#include "mqtt_codec.h"
+#include <string.h>
+
+TEST( GivenAPersistentSession, WhenConnectIsWritten_ThenCleanSessionIsOff ) {
+    // ARRANGE
+    uint8_t out[64];
+    const uint8_t expected[] = { 0x10, 16, 0, 4, 'M', 'Q', 'T', 'T', 4, 0x00, 0, 60, 0, 4, 'g', 'w', '0', '1' };
+
+    // ACT
+    uint16_t len      = Mqtt_codec::connect( out, sizeof( out ), "gw01", 60, false );
+    uint16_t overflow = Mqtt_codec::connect( out, sizeof( expected ) - 1, "gw01", 60, false );
+
+    // ASSERT
+    ASSERT_EQ( sizeof( expected ), len );
+    EXPECT_EQ( 0, memcmp( expected, out, len ) );
+    EXPECT_EQ( 0, overflow );
+};
+
+TEST( GivenAQos1Publish, WhenTheHeaderIsWritten_ThenItCarriesTopicIdAndDup ) {
+    // ARRANGE
+    uint8_t out[300];
+    const uint8_t expected[] = { 0x3A, 0x81, 0x01, 0, 3, 'g', 'w', '1', 0x12, 0x34 };
+
+    // ACT: 3 + 2 + 2 + 122 = 129 bytes restantes, dos bytes de longitud
+    uint16_t len      = Mqtt_codec::publish_header( out, sizeof( out ), "gw1", 0x1234, 122, true );
+    uint16_t overflow = Mqtt_codec::publish_header( out, len + 121, "gw1", 0x1234, 122, true );
+    uint16_t no_id    = Mqtt_codec::publish_header( out, sizeof( out ), "gw1", 0, 122, false );
+
+    // ASSERT
+    ASSERT_EQ( sizeof( expected ), len );
+    EXPECT_EQ( 0, memcmp( expected, out, len ) );
+    EXPECT_EQ( 0, overflow );
+    EXPECT_EQ( 0, no_id );
+};
+
+TEST( GivenReceivedBytes, WhenParsed_ThenOnlyCompletePacketsAreExtracted ) {
+    // ARRANGE: CONNACK con sesion presente y un PUBACK partido por la mitad
+    const uint8_t in[]     = { 0x20, 2, 0x01, 0x00, 0x40, 2, 0x12 };
+    const uint8_t puback[] = { 0x40, 2, 0x12, 0x34 };
+    const uint8_t bad[]    = { 0x30, 0x80, 0x80, 0x80, 0x80, 0x01 };
+    Mqtt_frame_t frame;
+    bool session_present = false;
+    uint8_t return_code  = 0xFF;
+    uint16_t packet_id   = 0;
+
+    // ACT
+    int32_t first     = Mqtt_codec::parse( in, sizeof( in ), frame );
+    bool connack      = Mqtt_codec::parse_connack( frame, session_present, return_code );
+    int32_t partial   = Mqtt_codec::parse( &in[first], sizeof( in ) - first, frame );
+    int32_t complete  = Mqtt_codec::parse( puback, sizeof( puback ), frame );
+    bool acked        = Mqtt_codec::parse_puback( frame, packet_id );
+    int32_t malformed = Mqtt_codec::parse( bad, sizeof( bad ), frame );
+
+    // ASSERT
+    EXPECT_EQ( 4, first );
+    EXPECT_TRUE( connack );
+    EXPECT_TRUE( session_present );
+    EXPECT_EQ( 0, return_code );
+    EXPECT_EQ( 0, partial );
+    EXPECT_EQ( 4, complete );
+    EXPECT_TRUE( acked );
+    EXPECT_EQ( 0x1234, packet_id );
+    EXPECT_EQ( -1, malformed );
+};
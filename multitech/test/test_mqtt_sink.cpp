@@ -0,0 +1,204 @@
+#include "gtest/gtest.h"
+
+#include "mqtt_sink.h"
+#include "mqtt_stand_in.h"
+#include <functional>
+#include <string.h>
+#include <time.h>
+#include <utility>
+
+// Sustituto de Pkt: el payload que publica el destino
+class Mqtt_pkt {
+  public:
+    Mqtt_pkt( uint8_t len_0 ) : len( len_0 ) {
+        memset( data, 0xA5, sizeof( data ) );
+    }
+    const uint8_t* bytes() const {
+        return data;
+    }
+    uint16_t get_size() const {
+        return len;
+    }
+    uint8_t data[32];
+    uint8_t len;
+};
+
+static uint32_t elapsed_ms( const struct timespec& start ) {
+    struct timespec now;
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    return ( now.tv_sec - start.tv_sec ) * 1000 + ( now.tv_nsec - start.tv_nsec ) / 1000000;
+}
+
+// Atiende el bucle hasta que se cumple la condicion o pasan max_ms
+static bool spin( Event_loop& loop, std::function<bool( void )> done, uint32_t max_ms ) {
+    struct timespec start;
+    clock_gettime( CLOCK_MONOTONIC, &start );
+    while ( !done() ) {
+        if ( elapsed_ms( start ) >= max_ms ) {
+            return false;
+        }
+        loop.run_once( 5 );
+    }
+    return true;
+}
+
+// Broker local, log con un lector y el destino conectado a ambos
+class Mqtt_fixture {
+  public:
+    Mqtt_fixture( uint8_t window ) :
+        pool( 16, 20 ), log( 16 ), reader( log ), sink( reader, "127.0.0.1", listen(), "gw01", "test", window, 1 ) {
+        sink.init( loop );
+        sink.set_retry( 10, 50, 5 );
+    }
+    uint16_t listen( void ) {
+        loop.init();
+        broker.init( loop );
+        return broker.get_port();
+    }
+    void publish( uint8_t n ) {
+        for ( uint8_t i = 0; i < n; i++ ) {
+            log.push( pool.acquire(), log.all_readers() );
+        }
+        sink.pump();
+    }
+    Event_loop loop;
+    Mqtt_stand_in broker;
+    Pkt_pool<Mqtt_pkt> pool;
+    Pkt_log<Mqtt_pkt> log;
+    Pkt_log_reader<Mqtt_pkt> reader;
+    Mqtt_sink<Mqtt_pkt> sink;
+};
+
+TEST( GivenABrokerWithTheSession, WhenTheSinkConnects_ThenItKeepsTheSessionAndCountsItAsResumed ) {
+    // ARRANGE
+    Mqtt_fixture f( 4 );
+    f.broker.set_connack( 0, true );
+
+    // ACT
+    f.publish( 1 );
+    bool delivered = spin( f.loop, [&]() { return f.sink.get_stats().delivered == 1; }, 2000 );
+
+    // ASSERT
+    ASSERT_TRUE( delivered );
+    Mqtt_link_stats_t link = f.sink.get_link_stats();
+    EXPECT_FALSE( f.broker.get_clean_session() );
+    EXPECT_STREQ( "gw01", f.broker.get_client_id() );
+    EXPECT_TRUE( link.connected );
+    EXPECT_EQ( 1u, link.connects );
+    EXPECT_EQ( 1u, link.resumed );
+    ASSERT_EQ( 1, f.broker.get_publishes() );
+    EXPECT_FALSE( f.broker.get_publish( 0 ).dup );
+    EXPECT_EQ( 20u, f.broker.get_publish( 0 ).payload_len );
+    EXPECT_EQ( 0, f.reader.available() );
+};
+
+TEST( GivenABrokerThatDoesNotAck, WhenMorePktsThanTheWindowArePending_ThenOnlyTheWindowIsPublished ) {
+    // ARRANGE
+    Mqtt_fixture f( 3 );
+    f.broker.set_puback( false );
+
+    // ACT
+    f.publish( 6 );
+    spin( f.loop, [&]() { return f.broker.get_publishes() >= 3; }, 2000 );
+    spin( f.loop, [&]() { return false; }, 100 );
+
+    // ASSERT
+    Upload_sink_stats_t stats = f.sink.get_stats();
+    EXPECT_EQ( 3, f.broker.get_publishes() );
+    EXPECT_EQ( 3, stats.in_flight );
+    EXPECT_EQ( 6, f.reader.available() );
+};
+
+TEST( GivenABatchOfThree, WhenOnlyTwoPktsArePending_ThenTheyWaitForTheThirdAndLeaveInOneWrite ) {
+    // ARRANGE
+    Mqtt_fixture f( 8 );
+    f.sink.set_batch( 3, 10000 );
+    f.publish( 2 );
+    spin( f.loop, [&]() { return f.sink.get_link_stats().connected; }, 2000 );
+    spin( f.loop, [&]() { return false; }, 100 );
+    uint8_t before = f.broker.get_publishes();
+
+    // ACT
+    f.publish( 1 );
+    bool delivered = spin( f.loop, [&]() { return f.sink.get_stats().delivered == 3; }, 2000 );
+
+    // ASSERT
+    ASSERT_TRUE( delivered );
+    Upload_sink_stats_t stats = f.sink.get_stats();
+    EXPECT_EQ( 0, before );
+    ASSERT_EQ( 3, f.broker.get_publishes() );
+    EXPECT_EQ( f.broker.get_publish( 0 ).read, f.broker.get_publish( 2 ).read );
+    EXPECT_EQ( 1u, stats.started );
+    EXPECT_EQ( 3u, stats.batched );
+};
+
+TEST( GivenUnackedPublishes, WhenTheConnectionDrops_ThenTheyAreResentWithDupAndTheSameIds ) {
+    // ARRANGE
+    Mqtt_fixture f( 4 );
+    f.broker.set_puback( false );
+    f.publish( 2 );
+    spin( f.loop, [&]() { return f.broker.get_publishes() == 2; }, 2000 );
+
+    // ACT
+    f.broker.set_connack( 0, true );
+    f.broker.set_puback( true );
+    f.broker.drop_connection();
+    bool delivered = spin( f.loop, [&]() { return f.sink.get_stats().delivered == 2; }, 2000 );
+
+    // ASSERT
+    ASSERT_TRUE( delivered );
+    Upload_sink_stats_t stats = f.sink.get_stats();
+    ASSERT_EQ( 4, f.broker.get_publishes() );
+    for ( uint8_t i = 0; i < 2; i++ ) {
+        const Mqtt_stand_in_publish_t& first  = f.broker.get_publish( i );
+        const Mqtt_stand_in_publish_t& resent = f.broker.get_publish( i + 2 );
+        EXPECT_FALSE( first.dup );
+        EXPECT_TRUE( resent.dup );
+        EXPECT_EQ( first.packet_id, resent.packet_id );
+        EXPECT_EQ( 2u, resent.connection );
+    }
+    EXPECT_EQ( 2u, stats.retried );
+    EXPECT_EQ( 1u, f.sink.get_link_stats().resumed );
+    EXPECT_EQ( 0, f.reader.available() );
+};
+
+TEST( GivenABrokerThatStopsAcking, WhenThePubackTimesOut_ThenTheSinkReconnectsAndResends ) {
+    // ARRANGE
+    Mqtt_fixture f( 4 );
+    f.sink.set_timeouts( 50, 100 );
+    f.broker.set_puback( false );
+    f.publish( 1 );
+
+    // ACT
+    bool reconnected = spin( f.loop, [&]() { return f.broker.get_connects() == 2; }, 2000 );
+    f.broker.set_puback( true );
+    bool delivered = spin( f.loop, [&]() { return f.sink.get_stats().delivered == 1; }, 2000 );
+
+    // ASSERT
+    ASSERT_TRUE( reconnected );
+    ASSERT_TRUE( delivered );
+    Mqtt_link_stats_t link = f.sink.get_link_stats();
+    EXPECT_EQ( 2u, link.connects );
+    EXPECT_EQ( 1u, link.lost );
+    EXPECT_EQ( 1u, f.sink.get_stats().failed );
+    EXPECT_TRUE( f.broker.get_publish( f.broker.get_publishes() - 1 ).dup );
+};
+
+TEST( GivenABrokerThatRefusesTheConnection, WhenTheSinkKeepsRetrying_ThenTheBreakerOpensWithoutPublishing ) {
+    // ARRANGE
+    Mqtt_fixture f( 4 );
+    f.broker.set_connack( 5, false ); // no autorizado
+
+    // ACT
+    f.publish( 1 );
+    bool opened = spin( f.loop, [&]() { return f.sink.get_health().opened >= 1; }, 2000 );
+
+    // ASSERT
+    ASSERT_TRUE( opened );
+    Mqtt_link_stats_t link = f.sink.get_link_stats();
+    EXPECT_EQ( 3u, f.broker.get_connects() );
+    EXPECT_EQ( 0, f.broker.get_publishes() );
+    EXPECT_EQ( 0u, link.connects );
+    EXPECT_EQ( 3u, link.lost );
+    EXPECT_EQ( 1, f.reader.available() );
+};
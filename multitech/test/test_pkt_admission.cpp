@@ -0,0 +1,167 @@
+#include "gtest/gtest.h"
+
+#include "pkt_admission.h"
+
+static const uint8_t cmd_alarm    = 10;
+static const uint8_t cmd_position = 11;
+static const uint8_t cmd_reading  = 2;
+static const uint8_t cmd_other    = 20;
+static const uint16_t capacity    = 100;
+static const uint32_t device      = 123456;
+
+class Fixture_pkt_admission: public ::testing::Test {
+  protected:
+    void SetUp() override {
+        admission.set_class( cmd_alarm, admission_alarm );
+        admission.set_class( cmd_position, admission_position );
+        admission.set_class( cmd_reading, admission_periodic );
+    }
+    Pkt_admission admission;
+};
+
+TEST_F( Fixture_pkt_admission, WhenQueueHasRoom_ThenEveryClassIsAccepted ) {
+    // ARRANGE
+
+    // ACT
+    Admission_result_t alarm    = admission.admit( device, cmd_alarm, 10, capacity, 0 );
+    Admission_result_t position = admission.admit( device, cmd_position, 10, capacity, 0 );
+    Admission_result_t reading  = admission.admit( device, cmd_reading, 10, capacity, 0 );
+
+    // ASSERT
+    EXPECT_EQ( admission_accepted, alarm );
+    EXPECT_EQ( admission_accepted, position );
+    EXPECT_EQ( admission_accepted, reading );
+};
+
+TEST_F( Fixture_pkt_admission, WhenQueueIsUnderPressure_ThenLowerClassesGoFirst ) {
+    // ARRANGE
+    // Marcas por defecto: lecturas hasta el 75 %, posiciones hasta el 90 %, alarmas hasta el 100 %
+
+    // ACT
+    Admission_result_t reading  = admission.admit( device, cmd_reading, 80, capacity, 0 );
+    Admission_result_t position = admission.admit( device, cmd_position, 80, capacity, 0 );
+    Admission_result_t late     = admission.admit( device, cmd_position, 95, capacity, 0 );
+    Admission_result_t alarm    = admission.admit( device, cmd_alarm, 95, capacity, 0 );
+    Admission_result_t full     = admission.admit( device, cmd_alarm, 100, capacity, 0 );
+
+    // ASSERT
+    EXPECT_EQ( admission_shed, reading );
+    EXPECT_EQ( admission_accepted, position );
+    EXPECT_EQ( admission_refused, late );
+    EXPECT_EQ( admission_accepted, alarm );
+    EXPECT_EQ( admission_refused, full );
+    EXPECT_EQ( 1u, admission.get_class_stats( admission_periodic ).shed );
+    EXPECT_EQ( 1u, admission.get_class_stats( admission_position ).refused );
+    EXPECT_EQ( 1u, admission.get_class_stats( admission_alarm ).refused );
+};
+
+TEST_F( Fixture_pkt_admission, WhenDeviceExceedsItsRate_ThenItIsShedUntilTheBucketRefills ) {
+    // ARRANGE
+    admission.set_rate( 6, 2 );     // un token cada 10 s, cubo de 2
+
+    // ACT
+    Admission_result_t first  = admission.admit( device, cmd_reading, 0, capacity, 1000 );
+    Admission_result_t second = admission.admit( device, cmd_reading, 0, capacity, 1000 );
+    Admission_result_t third  = admission.admit( device, cmd_reading, 0, capacity, 1000 );
+    Admission_result_t alarm  = admission.admit( device, cmd_alarm, 0, capacity, 1000 );
+    Admission_result_t other  = admission.admit( device + 1, cmd_reading, 0, capacity, 1000 );
+    Admission_result_t early  = admission.admit( device, cmd_reading, 0, capacity, 6000 );
+    Admission_result_t later  = admission.admit( device, cmd_reading, 0, capacity, 11000 );
+
+    // ASSERT
+    EXPECT_EQ( admission_accepted, first );
+    EXPECT_EQ( admission_accepted, second );
+    EXPECT_EQ( admission_shed, third );
+    EXPECT_EQ( admission_accepted, alarm );
+    EXPECT_EQ( admission_accepted, other );
+    EXPECT_EQ( admission_shed, early );
+    EXPECT_EQ( admission_accepted, later );
+    EXPECT_EQ( 2u, admission.get_class_stats( admission_periodic ).rate_limited );
+};
+
+TEST_F( Fixture_pkt_admission, WhenPktsAreDropped_ThenTheyAreCountedPerDevice ) {
+    // ARRANGE
+    admission.admit( device, cmd_reading, 0, capacity, 0 );
+    admission.admit( device, cmd_reading, 90, capacity, 0 );
+    admission.admit( device + 1, cmd_alarm, 0, capacity, 0 );
+    Admission_device_report_t reports[Pkt_admission::max_devices];
+
+    // ACT
+    uint16_t n = admission.get_devices( reports, Pkt_admission::max_devices );
+
+    // ASSERT
+    ASSERT_EQ( 2, n );
+    for ( uint16_t i = 0; i < n; i++ ) {
+        if ( reports[i].device == device ) {
+            EXPECT_EQ( 1u, reports[i].accepted );
+            EXPECT_EQ( 1u, reports[i].dropped );
+        }
+        else {
+            EXPECT_EQ( device + 1, reports[i].device );
+            EXPECT_EQ( 0u, reports[i].dropped );
+        }
+    }
+};
+
+TEST_F( Fixture_pkt_admission, WhenOfferingToARing_ThenAcceptedPktsAreQueuedAndWatermarksUseItsOccupancy ) {
+    // ARRANGE
+    Pkt_ring ring( 4, 8 );
+    uint8_t data[2] = { 0x2C, 0x01 };
+
+    // ACT
+    // Con 4 slots las lecturas llegan hasta 3 (75 %) y las alarmas llenan la cola
+    Admission_result_t results[5];
+    results[0] = admission.offer( ring, device, cmd_reading, data, sizeof( data ), 0 );
+    results[1] = admission.offer( ring, device, cmd_reading, data, sizeof( data ), 0 );
+    results[2] = admission.offer( ring, device, cmd_reading, data, sizeof( data ), 0 );
+    results[3] = admission.offer( ring, device, cmd_reading, data, sizeof( data ), 0 );
+    results[4] = admission.offer( ring, device, cmd_alarm, data, sizeof( data ), 0 );
+
+    // ASSERT
+    EXPECT_EQ( admission_accepted, results[0] );
+    EXPECT_EQ( admission_accepted, results[1] );
+    EXPECT_EQ( admission_accepted, results[2] );
+    EXPECT_EQ( admission_shed, results[3] );
+    EXPECT_EQ( admission_accepted, results[4] );
+    EXPECT_EQ( 4, ring.occupancy() );
+};
+
+TEST_F( Fixture_pkt_admission, WhenPeriodicReadingsAreShed_ThenAlarmsAndUnclassifiedCommandsAreStillQueued ) {
+    // ARRANGE
+    admission.set_rate( 6, 1 );
+    Pkt_ring ring( 4, 8 );
+    uint8_t data[2] = { 0x2C, 0x01 };
+    for ( uint8_t i = 0; i < 3; i++ ) {
+        admission.offer( ring, device + i, cmd_reading, data, sizeof( data ), 0 );
+    }
+
+    // ACT
+    Admission_result_t reading = admission.offer( ring, device + 3, cmd_reading, data, sizeof( data ), 0 );
+    Admission_result_t alarm   = admission.offer( ring, device, cmd_alarm, data, sizeof( data ), 0 );
+    Admission_result_t other   = admission.offer( ring, device, cmd_other, data, sizeof( data ), 0 );
+
+    // ASSERT
+    // El comando sin clase no se descarta confirmado: con la cola llena se rechaza y el dispositivo lo repite
+    EXPECT_EQ( admission_shed, reading );
+    EXPECT_EQ( admission_accepted, alarm );
+    EXPECT_EQ( admission_refused, other );
+    EXPECT_EQ( 0u, admission.get_class_stats( admission_unclassified ).shed );
+    EXPECT_EQ( 0u, admission.get_class_stats( admission_unclassified ).rate_limited );
+};
+
+TEST_F( Fixture_pkt_admission, WhenACommandHasNoClass_ThenItIsNeverShedNorRateLimited ) {
+    // ARRANGE
+    admission.set_rate( 6, 1 );
+
+    // ACT
+    Admission_result_t first  = admission.admit( device, cmd_other, 0, capacity, 0 );
+    Admission_result_t second = admission.admit( device, cmd_other, 0, capacity, 0 );
+    Admission_result_t busy   = admission.admit( device, cmd_other, 99, capacity, 0 );
+    Admission_result_t full   = admission.admit( device, cmd_other, 100, capacity, 0 );
+
+    // ASSERT
+    EXPECT_EQ( admission_accepted, first );
+    EXPECT_EQ( admission_accepted, second );
+    EXPECT_EQ( admission_accepted, busy );
+    EXPECT_EQ( admission_refused, full );
+};
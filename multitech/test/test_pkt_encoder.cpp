@@ -0,0 +1,86 @@
+#include "gtest/gtest.h"
+
+#include "pkt_encoder.h"
+#include "base64.h"
+#include <string.h>
+
+// Deshace el escapado de x-www-form-urlencoded como lo haria el servidor
+static size_t url_decode( const char* in, char* out ) {
+    size_t j = 0;
+    for ( size_t i = 0; in[i] != '\0'; i++, j++ ) {
+        if ( in[i] == '%' ) {
+            char hex[3] = { in[i + 1], in[i + 2], '\0' };
+            out[j]      = (char)strtol( hex, NULL, 16 );
+            i += 2;
+        }
+        else {
+            out[j] = in[i];
+        }
+    }
+    out[j] = '\0';
+    return j;
+}
+
+TEST( GivenAPktEncoder, WhenEncodingTheSameBytes_ThenEachEncodingMatchesItsFormat ) {
+    // ARRANGE
+    const uint8_t pkt[] = { 0, 9, 10, 255, 0xFB, 0xFF };
+    char out[64];
+
+    // ACT & ASSERT
+    EXPECT_EQ( 18, Pkt_encoder::encode( pkt_encoding_csv, pkt, sizeof( pkt ), out, sizeof( out ) ) );
+    EXPECT_STREQ( "0,9,10,255,251,255", out );
+    EXPECT_EQ( 12, Pkt_encoder::encode( pkt_encoding_hex, pkt, sizeof( pkt ), out, sizeof( out ) ) );
+    EXPECT_STREQ( "00090afffbff", out );
+    EXPECT_EQ( 14, Pkt_encoder::encode( pkt_encoding_base64, pkt, sizeof( pkt ), out, sizeof( out ) ) );
+    EXPECT_STREQ( "AAkK%2F%2Fv%2F", out ); // "AAkK//v/" con '/' escapado
+    EXPECT_EQ( sizeof( pkt ), Pkt_encoder::encode( pkt_encoding_raw, pkt, sizeof( pkt ), out, sizeof( out ) ) );
+    EXPECT_EQ( 0, memcmp( pkt, out, sizeof( pkt ) ) );
+};
+
+TEST( GivenBase64Pkts, WhenEncodedWithEveryPaddingLength_ThenTheLengthIsExactAndTheyRoundTrip ) {
+    // ARRANGE
+    Base64 base64;
+    uint8_t pkt[64];
+    uint32_t seed = 7;
+    for ( uint16_t i = 0; i < sizeof( pkt ); i++ ) {
+        seed   = seed * 1103515245 + 12345;
+        pkt[i] = i % 5 == 0 ? 0xFF : seed >> 16; // muchos '/' y '+' que escapar
+    }
+
+    for ( uint16_t len = 1; len <= sizeof( pkt ); len++ ) {
+        char out[512];
+        char plain[512];
+        uint8_t decoded[64];
+
+        // ACT
+        uint16_t out_len = Pkt_encoder::encode( pkt_encoding_base64, pkt, len, out, sizeof( out ) );
+        size_t plain_len = url_decode( out, plain );
+
+        // ASSERT
+        ASSERT_EQ( strlen( out ), out_len ) << "len " << len;
+        ASSERT_EQ( Pkt_encoder::encoded_len( pkt_encoding_base64, pkt, len ), out_len ) << "len " << len;
+        ASSERT_TRUE( base64.decode( plain, plain_len, decoded, sizeof( decoded ) ) ) << "len " << len;
+        ASSERT_EQ( 0, memcmp( pkt, decoded, len ) ) << "len " << len;
+    }
+};
+
+TEST( GivenAShortBuffer, WhenThePktDoesNotFit_ThenNothingIsWritten ) {
+    // ARRANGE
+    const uint8_t pkt[] = { 100, 200, 0xFF };
+    char out[32];
+    memset( out, 'x', sizeof( out ) );
+
+    // ACT
+    uint16_t csv_fits        = Pkt_encoder::encode( pkt_encoding_csv, pkt, sizeof( pkt ), out, 12 );
+    uint16_t csv_overflow    = Pkt_encoder::encode( pkt_encoding_csv, pkt, sizeof( pkt ), &out[16], 11 );
+    uint16_t raw_fits        = Pkt_encoder::encode( pkt_encoding_raw, pkt, sizeof( pkt ), &out[28], 3 );
+    uint16_t base64_overflow = Pkt_encoder::encode( pkt_encoding_base64, pkt, sizeof( pkt ), &out[16], 6 );
+
+    // ASSERT
+    EXPECT_EQ( 11, csv_fits ); // "100,200,255" y el '\0' justo en el ultimo byte
+    EXPECT_STREQ( "100,200,255", out );
+    EXPECT_EQ( 0, csv_overflow );
+    EXPECT_EQ( 0, base64_overflow ); // "ZMj%2F" cabe pero el escapado no
+    EXPECT_EQ( 'x', out[16] );
+    EXPECT_EQ( 3, raw_fits );
+};
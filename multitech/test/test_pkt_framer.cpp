@@ -0,0 +1,207 @@
+#include "gtest/gtest.h"
+
+#include "pkt_framer.h"
+#include <string.h>
+
+// Misma disposicion que la cabecera de Pkt: sync, src, dst, cmd, timestamp, len, msg, crc
+static const uint8_t header_len  = 16;
+static const uint8_t trailer_len = 2;
+static const Pkt_layout_t layout = { { 0x2C, 0x2D }, 2, 14, 2, header_len, trailer_len, 64 };
+
+typedef struct {
+    uint16_t count;
+    const uint8_t* views[16];
+    uint16_t lens[16];
+    uint8_t copies[16][128];
+} Frames_t;
+
+static void collect( const uint8_t* pkt, uint16_t len, void* arg ) {
+    Frames_t* frames                 = (Frames_t*)arg;
+    frames->views[frames->count]     = pkt;
+    frames->lens[frames->count]      = len;
+    memcpy( frames->copies[frames->count], pkt, len );
+    frames->count++;
+}
+
+static uint16_t checksum( const uint8_t* data, uint16_t len ) {
+    uint16_t sum = 0;
+    for ( uint16_t i = 0; i < len; i++ ) {
+        sum += data[i];
+    }
+    return sum;
+}
+
+static bool check_sum( const uint8_t* pkt, uint16_t len, void* arg ) {
+    (void)arg;
+    uint16_t sum;
+    memcpy( &sum, pkt + len - trailer_len, sizeof( sum ) );
+    return sum == checksum( pkt, len - trailer_len );
+}
+
+// Construye un pkt con un mensaje de msg_len bytes y devuelve su longitud
+static uint16_t build( uint8_t* out, uint8_t sync, uint8_t cmd, uint16_t msg_len ) {
+    memset( out, 0, header_len );
+    out[0] = sync;
+    out[1] = 0xE8;
+    out[9] = cmd;
+    memcpy( out + 14, &msg_len, sizeof( msg_len ) );
+    for ( uint16_t i = 0; i < msg_len; i++ ) {
+        out[header_len + i] = (uint8_t)( cmd + i );
+    }
+    uint16_t sum = checksum( out, header_len + msg_len );
+    memcpy( out + header_len + msg_len, &sum, sizeof( sum ) );
+    return header_len + msg_len + trailer_len;
+}
+
+class Fixture_pkt_framer: public ::testing::Test {
+  protected:
+    void SetUp() override {
+        memset( &frames, 0, sizeof( frames ) );
+        memset( stream, 0, sizeof( stream ) );
+    }
+
+    Frames_t frames;
+    uint8_t stream[512];
+};
+
+TEST_F( Fixture_pkt_framer, WhenBufferHoldsSeveralPkts_ThenAllAreDeliveredWithoutCopy ) {
+    // ARRANGE
+    Pkt_framer framer( layout );
+    uint16_t len = build( stream, 0x2C, 1, 10 );
+    len += build( stream + len, 0x2D, 2, 0 );
+    len += build( stream + len, 0x2C, 3, 40 );
+
+    // ACT
+    uint16_t delivered = framer.feed( stream, len, collect, &frames );
+
+    // ASSERT
+    EXPECT_EQ( 3, delivered );
+    EXPECT_EQ( stream, frames.views[0] );
+    EXPECT_EQ( 28, frames.lens[0] );
+    EXPECT_EQ( stream + 28, frames.views[1] );
+    EXPECT_EQ( 18, frames.lens[1] );
+    EXPECT_EQ( 58, frames.lens[2] );
+    EXPECT_EQ( 0, framer.pending() );
+};
+
+TEST_F( Fixture_pkt_framer, WhenThereIsNoiseBetweenPkts_ThenItIsSkipped ) {
+    // ARRANGE
+    Pkt_framer framer( layout, check_sum );
+    memset( stream, 0x55, 7 );
+    uint16_t len = 7 + build( stream + 7, 0x2C, 1, 4 );
+    memset( stream + len, 0x77, 5 );
+    len += 5;
+    len += build( stream + len, 0x2D, 2, 4 );
+
+    // ACT
+    uint16_t delivered = framer.feed( stream, len, collect, &frames );
+
+    // ASSERT
+    EXPECT_EQ( 2, delivered );
+    EXPECT_EQ( 12u, framer.get_stats().skipped );
+};
+
+TEST_F( Fixture_pkt_framer, WhenPktIsSplitAcrossReads_ThenItIsCarriedOver ) {
+    // ARRANGE
+    uint8_t pkt[128];
+    uint16_t pkt_len = build( pkt, 0x2C, 9, 20 );
+
+    for ( uint16_t split = 1; split < pkt_len; split++ ) {
+        Pkt_framer framer( layout, check_sum );
+        memset( &frames, 0, sizeof( frames ) );
+
+        // ACT
+        uint16_t first  = framer.feed( pkt, split, collect, &frames );
+        uint16_t second = framer.feed( pkt + split, pkt_len - split, collect, &frames );
+
+        // ASSERT
+        EXPECT_EQ( 0, first ) << "split " << split;
+        EXPECT_EQ( 1, second ) << "split " << split;
+        EXPECT_EQ( pkt_len, frames.lens[0] );
+        EXPECT_EQ( 0, memcmp( pkt, frames.copies[0], pkt_len ) );
+        EXPECT_EQ( 1u, framer.get_stats().carried );
+    }
+};
+
+TEST_F( Fixture_pkt_framer, WhenPktArrivesByteByByte_ThenItIsDeliveredOnce ) {
+    // ARRANGE
+    Pkt_framer framer( layout, check_sum );
+    uint16_t len       = build( stream, 0x2D, 5, 12 );
+    uint16_t delivered = 0;
+
+    // ACT
+    for ( uint16_t i = 0; i < len; i++ ) {
+        delivered += framer.feed( stream + i, 1, collect, &frames );
+    }
+
+    // ASSERT
+    EXPECT_EQ( 1, delivered );
+    EXPECT_EQ( 0, memcmp( stream, frames.copies[0], len ) );
+};
+
+TEST_F( Fixture_pkt_framer, WhenLengthIsOutOfRange_ThenCandidateIsDiscarded ) {
+    // ARRANGE
+    Pkt_framer framer( layout );
+    uint16_t len     = build( stream, 0x2C, 1, 4 );
+    uint16_t too_big = 1000;
+    memcpy( stream + 14, &too_big, sizeof( too_big ) );
+    uint16_t offset = len;
+    len += build( stream + len, 0x2C, 2, 4 );
+
+    // ACT
+    uint16_t delivered = framer.feed( stream, len, collect, &frames );
+
+    // ASSERT
+    EXPECT_EQ( 1, delivered );
+    EXPECT_EQ( stream + offset, frames.views[0] );
+    EXPECT_EQ( 1u, framer.get_stats().bad_len );
+};
+
+TEST_F( Fixture_pkt_framer, WhenChecksumFails_ThenFramerResynchronizes ) {
+    // ARRANGE
+    Pkt_framer framer( layout, check_sum );
+    uint16_t len = build( stream, 0x2C, 1, 4 );
+    stream[len - 1] ^= 0xFF;
+    uint16_t offset = len;
+    len += build( stream + len, 0x2D, 2, 4 );
+
+    // ACT
+    uint16_t delivered = framer.feed( stream, len, collect, &frames );
+
+    // ASSERT
+    EXPECT_EQ( 1, delivered );
+    EXPECT_EQ( stream + offset, frames.views[0] );
+    EXPECT_EQ( 1u, framer.get_stats().check_fails );
+};
+
+TEST_F( Fixture_pkt_framer, WhenCarriedCandidateIsFalse_ThenRealPktInsideItIsFound ) {
+    // ARRANGE: un byte 0x2D suelto justo antes de un pkt cortado entre dos lecturas
+    Pkt_framer framer( layout, check_sum );
+    stream[0]    = 0x2D;
+    uint16_t len = 1 + build( stream + 1, 0x2C, 7, 8 );
+
+    // ACT
+    uint16_t first  = framer.feed( stream, 6, collect, &frames );
+    uint16_t second = framer.feed( stream + 6, len - 6, collect, &frames );
+
+    // ASSERT
+    EXPECT_EQ( 0, first );
+    EXPECT_EQ( 1, second );
+    EXPECT_EQ( len - 1, frames.lens[0] );
+    EXPECT_EQ( 0, memcmp( stream + 1, frames.copies[0], len - 1 ) );
+};
+
+TEST_F( Fixture_pkt_framer, WhenResetIsCalled_ThenPartialPktIsDropped ) {
+    // ARRANGE
+    Pkt_framer framer( layout );
+    uint16_t len = build( stream, 0x2C, 1, 4 );
+    framer.feed( stream, len - 3, collect, &frames );
+
+    // ACT
+    framer.reset();
+    uint16_t delivered = framer.feed( stream + len - 3, 3, collect, &frames );
+
+    // ASSERT
+    EXPECT_EQ( 0, delivered );
+    EXPECT_EQ( 0, framer.pending() );
+};
@@ -0,0 +1,78 @@
+#include "gtest/gtest.h"
+
+#include "log_pkt.h"
+
+TEST( GivenTwoReaders, WhenBothConsumeAPkt_ThenItIsStoredOnceAndReleasedAfterTheLast ) {
+    // ARRANGE
+    Pkt_pool<Log_pkt> pool( 4, 0 );
+    Pkt_log<Log_pkt> log( 4 );
+    Pkt_log_reader<Log_pkt> cloud( log );
+    Pkt_log_reader<Log_pkt> local( log );
+    publish( pool, log, 1, log.all_readers() );
+    publish( pool, log, 2, cloud.mask() ); // solo para cloud, como la posicion
+    publish( pool, log, 3, log.all_readers() );
+
+    // ACT
+    uint16_t in_use       = pool.get_stats().in_use;
+    uint32_t local_second = local.peek( 1 )->src;
+    cloud.pop();
+    uint16_t after_cloud = pool.get_stats().in_use;
+    local.pop();
+    uint16_t after_both = pool.get_stats().in_use;
+
+    // ASSERT
+    EXPECT_EQ( 3, in_use );
+    EXPECT_EQ( 3u, local_second );      // se salta el pkt que no es suyo
+    EXPECT_EQ( 3, after_cloud );
+    EXPECT_EQ( 2, after_both );
+    EXPECT_EQ( 2, cloud.available() );
+    EXPECT_EQ( 1, local.available() );
+    EXPECT_EQ( 2u, cloud.peek( 0 )->src );
+    EXPECT_EQ( 3u, local.peek( 0 )->src );
+};
+
+TEST( GivenALaggingReader, WhenTheLogIsFull_ThenItIsOverrunAndTheOtherKeepsFlowing ) {
+    // ARRANGE
+    Pkt_pool<Log_pkt> pool( 8, 0 );
+    Pkt_log<Log_pkt> log( 3 );
+    Pkt_log_reader<Log_pkt> cloud( log );
+    Pkt_log_reader<Log_pkt> local( log );
+
+    // ACT
+    for ( uint32_t src = 1; src <= 5; src++ ) {
+        publish( pool, log, src, log.all_readers() );
+        cloud.pop();
+    }
+    Pkt_log_stats_t stats = log.get_stats();
+
+    // ASSERT
+    EXPECT_EQ( 0, cloud.available() );
+    EXPECT_EQ( 5u, cloud.get_stats().consumed );
+    EXPECT_EQ( 3, local.available() );
+    EXPECT_EQ( 2u, local.get_stats().overrun );
+    EXPECT_EQ( 3u, local.peek( 0 )->src );
+    EXPECT_EQ( 1, stats.laggard );
+    EXPECT_EQ( 3, stats.used );
+    EXPECT_EQ( 3, pool.get_stats().in_use );
+};
+
+TEST( GivenAReaderUsingTheOldestPkt, WhenTheLogIsFull_ThenTheNewPktIsRefused ) {
+    // ARRANGE
+    Pkt_pool<Log_pkt> pool( 4, 0 );
+    Pkt_log<Log_pkt> log( 2 );
+    Pkt_log_reader<Log_pkt> cloud( log );
+    publish( pool, log, 1, cloud.mask() );
+    publish( pool, log, 2, cloud.mask() );
+    cloud.set_in_use( 1 );
+    Pkt_handle<Log_pkt> pkt = pool.acquire();
+
+    // ACT
+    bool pushed = log.push( std::move( pkt ), cloud.mask() );
+
+    // ASSERT
+    EXPECT_FALSE( pushed );
+    EXPECT_TRUE( pkt );
+    EXPECT_EQ( 1u, log.get_stats().refused );
+    EXPECT_EQ( 0u, cloud.get_stats().overrun );
+    EXPECT_EQ( 1u, cloud.peek( 0 )->src );
+};
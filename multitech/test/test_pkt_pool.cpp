@@ -0,0 +1,133 @@
+#include "gtest/gtest.h"
+
+#include "pkt_pool.h"
+#include <utility>
+
+// Sustituto de Pkt: se construye con el tamanyo maximo y cuenta construcciones y destrucciones
+static uint16_t constructed = 0;
+static uint16_t destroyed   = 0;
+
+class Fake_pkt {
+  public:
+    Fake_pkt( uint16_t size_0 ) : size( size_0 ), src( 0 ) {
+        constructed++;
+    }
+    ~Fake_pkt() {
+        destroyed++;
+    }
+    uint16_t size;
+    uint32_t src;
+};
+
+static const uint16_t pool_slots = 4;
+static const uint16_t pkt_size   = 200;
+
+TEST( GivenAPktPool, WhenCreated_ThenEveryElementIsBuiltOnceWithItsArgument ) {
+    // ARRANGE
+    constructed = 0;
+    destroyed   = 0;
+
+    // ACT
+    {
+        Pkt_pool<Fake_pkt> pool( pool_slots, pkt_size );
+        Pkt_handle<Fake_pkt> pkt = pool.acquire();
+        EXPECT_EQ( pkt_size, pkt->size );
+        pkt.reset();
+        pkt = pool.acquire();
+    }
+
+    // ASSERT
+    EXPECT_EQ( pool_slots, constructed );
+    EXPECT_EQ( pool_slots, destroyed );
+};
+
+TEST( GivenAPktPool, WhenAllElementsAreInUse_ThenAcquireFailsAndIsCounted ) {
+    // ARRANGE
+    Pkt_pool<Fake_pkt> pool( pool_slots, pkt_size );
+    Pkt_handle<Fake_pkt> pkts[pool_slots];
+    for ( uint16_t i = 0; i < pool_slots; i++ ) {
+        pkts[i] = pool.acquire();
+    }
+
+    // ACT
+    Pkt_handle<Fake_pkt> extra = pool.acquire();
+    pkts[0].reset();
+    Pkt_handle<Fake_pkt> again = pool.acquire();
+
+    // ASSERT
+    EXPECT_FALSE( extra );
+    EXPECT_TRUE( again );
+    Pkt_pool_stats_t stats = pool.get_stats();
+    EXPECT_EQ( 1u, stats.exhausted );
+    EXPECT_EQ( pool_slots, stats.high_water );
+    EXPECT_EQ( pool_slots, stats.in_use );
+    EXPECT_EQ( pool_slots + 1u, stats.acquired );
+};
+
+TEST( GivenASharedElement, WhenReleasedByEveryStage_ThenItReturnsToThePoolOnce ) {
+    // ARRANGE
+    Pkt_pool<Fake_pkt> pool( pool_slots, pkt_size );
+    Pkt_queue<Fake_pkt> cloud( 8 );
+    Pkt_queue<Fake_pkt> local( 8 );
+    Pkt_handle<Fake_pkt> pkt = pool.acquire();
+    pkt->src                 = 42;
+
+    // ACT
+    local.push( pkt.share() );
+    cloud.push( std::move( pkt ) );
+    bool moved_out       = !pkt;
+    Fake_pkt* cloud_head = cloud.front();
+    Fake_pkt* local_head = local.front();
+    local.pop();
+    uint16_t in_use_after_local = pool.get_stats().in_use;
+    cloud.pop();
+
+    // ASSERT
+    EXPECT_TRUE( moved_out );
+    EXPECT_EQ( cloud_head, local_head );
+    EXPECT_EQ( 42u, cloud_head->src );
+    EXPECT_EQ( 1, in_use_after_local );
+    EXPECT_EQ( 0, pool.get_stats().in_use );
+    EXPECT_EQ( NULL, cloud.front() );
+};
+
+TEST( GivenAFullPktQueue, WhenPushing_ThenTheHandleStaysWithTheCaller ) {
+    // ARRANGE
+    Pkt_pool<Fake_pkt> pool( pool_slots, pkt_size );
+    Pkt_queue<Fake_pkt> queue( 1 );
+    queue.push( pool.acquire() );
+    Pkt_handle<Fake_pkt> pkt = pool.acquire();
+
+    // ACT
+    bool result = queue.push( std::move( pkt ) );
+
+    // ASSERT
+    EXPECT_FALSE( result );
+    EXPECT_TRUE( pkt );
+    EXPECT_EQ( 1, queue.available() );
+    EXPECT_EQ( 2, pool.get_stats().in_use );
+};
+
+TEST( GivenAPktQueueThatWrapped, WhenPeeking_ThenHandlesAreSeenInArrivalOrder ) {
+    // ARRANGE
+    Pkt_pool<Fake_pkt> pool( pool_slots, pkt_size );
+    Pkt_queue<Fake_pkt> queue( 3 );
+    for ( uint32_t src = 1; src <= 4; src++ ) {
+        Pkt_handle<Fake_pkt> pkt = pool.acquire();
+        pkt->src                 = src;
+        queue.push( std::move( pkt ) );
+        if ( src == 2 ) {
+            queue.pop();
+        }
+    }
+
+    // ACT
+    Pkt_handle<Fake_pkt> shared = queue.peek( 1 ).share();
+
+    // ASSERT
+    ASSERT_EQ( 3, queue.available() );
+    EXPECT_EQ( 2u, queue.peek( 0 )->src );
+    EXPECT_EQ( 3u, shared->src );
+    EXPECT_EQ( 4u, queue.peek( 2 )->src );
+    EXPECT_EQ( 3, pool.get_stats().in_use );
+};
@@ -0,0 +1,182 @@
+#include "gtest/gtest.h"
+
+#include "pkt_ring.h"
+#include <pthread.h>
+
+static const uint16_t ring_slots     = 8;
+static const uint16_t ring_slot_size = 16;
+
+TEST( GivenAPktRing, WhenElementsArePushed_ThenTheyArePoppedInOrder ) {
+    // ARRANGE
+    Pkt_ring ring( ring_slots, ring_slot_size );
+    uint8_t out[ring_slot_size];
+    uint16_t len = 0;
+
+    // ACT
+    for ( uint8_t i = 0; i < 3; i++ ) {
+        uint8_t data[2] = { i, (uint8_t)( i + 100 ) };
+        ring.try_push( data, sizeof( data ) );
+    }
+
+    // ASSERT
+    EXPECT_EQ( 3, ring.available() );
+    for ( uint8_t i = 0; i < 3; i++ ) {
+        EXPECT_TRUE( ring.try_pop( out, sizeof( out ), len ) );
+        EXPECT_EQ( 2, len );
+        EXPECT_EQ( i, out[0] );
+        EXPECT_EQ( i + 100, out[1] );
+    }
+    EXPECT_FALSE( ring.try_pop( out, sizeof( out ), len ) );
+};
+
+TEST( GivenAPktRing, WhenRingIsFull_ThenPushFailsAndIsCounted ) {
+    // ARRANGE
+    Pkt_ring ring( ring_slots, ring_slot_size );
+    uint8_t data[4] = { 1, 2, 3, 4 };
+
+    // ACT
+    for ( uint8_t i = 0; i < ring_slots; i++ ) {
+        ASSERT_TRUE( ring.try_push( data, sizeof( data ) ) );
+    }
+    bool result = ring.try_push( data, sizeof( data ) );
+
+    // ASSERT
+    EXPECT_FALSE( result );
+    EXPECT_EQ( 1u, ring.get_push_fails() );
+};
+
+TEST( GivenAPktRing, WhenElementsArePushedAndPopped_ThenOccupancyFollows ) {
+    // ARRANGE
+    Pkt_ring ring( ring_slots, ring_slot_size );
+    uint8_t data[4] = { 1, 2, 3, 4 };
+    uint8_t out[ring_slot_size];
+    uint16_t len = 0;
+
+    // ACT
+    ring.try_push( data, sizeof( data ) );
+    ring.try_push( data, sizeof( data ) );
+    ring.try_push( data, sizeof( data ) );
+    uint16_t after_push = ring.occupancy();
+    ring.try_pop( out, sizeof( out ), len );
+    uint16_t after_pop = ring.occupancy();
+
+    // ASSERT
+    EXPECT_EQ( 3, after_push );
+    EXPECT_EQ( 2, after_pop );
+    EXPECT_EQ( ring_slots, ring.get_slots() );
+};
+
+TEST( GivenAPktRing, WhenSlotsIsNotPowerOfTwo_ThenCapacityIsRoundedUp ) {
+    // ARRANGE
+    Pkt_ring ring( 100, ring_slot_size );
+    uint8_t data[1] = { 0 };
+    uint16_t pushed = 0;
+
+    // ACT
+    while ( ring.try_push( data, sizeof( data ) ) ) {
+        pushed++;
+    }
+
+    // ASSERT
+    EXPECT_EQ( 128, pushed );
+};
+
+TEST( GivenAPktRing, WhenElementIsBiggerThanSlot_ThenPushFails ) {
+    // ARRANGE
+    Pkt_ring ring( ring_slots, ring_slot_size );
+    uint8_t data[ring_slot_size + 1] = { 0 };
+
+    // ACT
+    bool result = ring.try_push( data, sizeof( data ) );
+
+    // ASSERT
+    EXPECT_FALSE( result );
+};
+
+TEST( GivenAPktRing, WhenRingWrapsAround_ThenDataIsPreserved ) {
+    // ARRANGE
+    Pkt_ring ring( ring_slots, ring_slot_size );
+    uint8_t out[ring_slot_size];
+    uint16_t len = 0;
+
+    for ( uint16_t i = 0; i < ring_slots * 5; i++ ) {
+        uint8_t data[1] = { (uint8_t)i };
+
+        // ACT
+        ASSERT_TRUE( ring.try_push( data, sizeof( data ) ) );
+        ASSERT_TRUE( ring.try_pop( out, sizeof( out ), len ) );
+
+        // ASSERT
+        EXPECT_EQ( (uint8_t)i, out[0] );
+    }
+};
+
+TEST( GivenAPktRing, WhenRingHasData_ThenConsumerCannotArmWait ) {
+    // ARRANGE
+    Pkt_ring ring( ring_slots, ring_slot_size );
+    ASSERT_TRUE( ring.init() );
+    uint8_t data[1] = { 0 };
+
+    // ACT & ASSERT
+    EXPECT_TRUE( ring.arm_wait() );
+    ring.try_push( data, sizeof( data ) );
+    EXPECT_FALSE( ring.arm_wait() );
+    EXPECT_TRUE( ring.wait( 0 ) );
+};
+
+typedef struct {
+    Pkt_ring* ring;
+    uint8_t id;
+    uint32_t count;
+} Producer_args_t;
+
+static void* producer_fcn( void* arg ) {
+    Producer_args_t* args = (Producer_args_t*)arg;
+    for ( uint32_t seq = 0; seq < args->count; ) {
+        uint8_t data[5] = { args->id, (uint8_t)seq, (uint8_t)( seq >> 8 ), (uint8_t)( seq >> 16 ), 0 };
+        if ( args->ring->try_push( data, sizeof( data ) ) ) {
+            seq++;
+        }
+    }
+    return NULL;
+}
+
+TEST( GivenAPktRing, WhenSeveralProducersPush_ThenConsumerSeesEveryProducerInOrder ) {
+    // ARRANGE
+    static const uint8_t n_producers = 4;
+    static const uint32_t per_producer = 20000;
+    Pkt_ring ring( 64, ring_slot_size );
+    ASSERT_TRUE( ring.init() );
+    pthread_t threads[n_producers];
+    Producer_args_t args[n_producers];
+    uint32_t next_seq[n_producers] = { 0 };
+    uint8_t out[ring_slot_size];
+    uint16_t len = 0;
+
+    // ACT
+    for ( uint8_t i = 0; i < n_producers; i++ ) {
+        args[i] = { &ring, i, per_producer };
+        pthread_create( &threads[i], NULL, producer_fcn, &args[i] );
+    }
+    uint32_t popped = 0;
+    while ( popped < n_producers * per_producer ) {
+        if ( !ring.try_pop( out, sizeof( out ), len ) ) {
+            ring.wait( 10 );
+            continue;
+        }
+        uint32_t seq = out[1] | (uint32_t)out[2] << 8 | (uint32_t)out[3] << 16;
+        ASSERT_LT( out[0], n_producers );
+        ASSERT_EQ( next_seq[out[0]], seq );
+        next_seq[out[0]]++;
+        popped++;
+    }
+    for ( uint8_t i = 0; i < n_producers; i++ ) {
+        pthread_join( threads[i], NULL );
+    }
+
+    // ASSERT
+    for ( uint8_t i = 0; i < n_producers; i++ ) {
+        EXPECT_EQ( per_producer, next_seq[i] );
+    }
+    EXPECT_FALSE( ring.try_pop( out, sizeof( out ), len ) );
+};
@@ -0,0 +1,66 @@
+#include "gtest/gtest.h"
+
+#include "replay_scheduler.h"
+
+TEST( GivenBothLanesBusy, WhenScheduled_ThenBytesFollowTheShares ) {
+    // ARRANGE
+    Replay_scheduler scheduler;
+    scheduler.set_share( 80 );
+    scheduler.start( 1000, 0 );
+    uint32_t sent[2] = { 0, 0 };
+
+    // ACT: la via de nuevos envia pkts sueltos y el atraso lotes grandes
+    for ( uint16_t i = 0; i < 1000; i++ ) {
+        Replay_lane_t lane = scheduler.pick( true, true );
+        uint32_t bytes     = lane == lane_live ? 50 : 800;
+        scheduler.on_sent( lane, bytes );
+        sent[lane] += bytes;
+    }
+
+    // ASSERT
+    uint32_t live_pct = sent[lane_live] * 100 / ( sent[lane_live] + sent[lane_backlog] );
+    EXPECT_GE( live_pct, 78u );
+    EXPECT_LE( live_pct, 82u );
+};
+
+TEST( GivenAnIdleLiveLane, WhenItWakesUp_ThenItGetsNoBurstFromTheIdleTime ) {
+    // ARRANGE: el atraso envia solo mucho tiempo
+    Replay_scheduler scheduler;
+    scheduler.set_share( 50 );
+    scheduler.start( 1000, 0 );
+    for ( uint16_t i = 0; i < 100; i++ ) {
+        EXPECT_EQ( lane_backlog, scheduler.pick( false, true ) );
+        scheduler.on_sent( lane_backlog, 100 );
+    }
+
+    // ACT
+    uint8_t live_in_a_row = 0;
+    while ( scheduler.pick( true, true ) == lane_live && live_in_a_row < 100 ) {
+        scheduler.on_sent( lane_live, 100 );
+        live_in_a_row++;
+    }
+
+    // ASSERT: alterna enseguida (el ultimo envio del atraso le da uno de ventaja) en lugar de recuperar los 100
+    EXPECT_LE( live_in_a_row, 2 );
+};
+
+TEST( GivenAReplayInProgress, WhenReported_ThenRateAndEtaComeFromTheDrainedPkts ) {
+    // ARRANGE
+    Replay_scheduler scheduler;
+    scheduler.start( 600, 1000 );
+
+    // ACT: 200 de 600 en 2 minutos
+    Replay_report_t running = scheduler.get_report( 400, 1000 + 120000 );
+    scheduler.finish( 1000 + 360000 );
+    Replay_report_t done    = scheduler.get_report( 0, 1000 + 400000 );
+
+    // ASSERT
+    EXPECT_TRUE( running.active );
+    EXPECT_EQ( 100u, running.rate_ppm );
+    EXPECT_EQ( 240u, running.eta_s );
+    EXPECT_EQ( 120u, running.elapsed_s );
+    EXPECT_FALSE( done.active );
+    EXPECT_EQ( 0u, done.left );
+    EXPECT_EQ( 360u, done.elapsed_s );
+    EXPECT_EQ( 1u, done.replays );
+};
@@ -0,0 +1,75 @@
+#include "gtest/gtest.h"
+
+#include "sink_health.h"
+
+TEST( GivenAClosedBreaker, WhenTheSinkKeepsFailing_ThenItOpensAndOneProbeClosesIt ) {
+    // ARRANGE
+    Sink_health health( 1 );
+    health.set_backoff( 1000, 60000 );
+    health.set_failures_to_open( 3 );
+
+    // ACT
+    health.on_failure( 0 );
+    health.on_failure( 0 );
+    bool before_open = health.allow( 0 );
+    health.on_failure( 0 );
+    uint32_t wait = health.wait_ms( 0 );
+
+    // ASSERT
+    EXPECT_TRUE( before_open );
+    EXPECT_EQ( breaker_open, health.get_state() );
+    EXPECT_GE( wait, 500u );
+    EXPECT_LE( wait, 1000u );
+    EXPECT_FALSE( health.allow( wait - 1 ) );
+    EXPECT_TRUE( health.allow( wait ) );
+    EXPECT_EQ( breaker_half_open, health.get_state() );
+    health.on_start();
+    EXPECT_FALSE( health.allow( wait ) ); // una sola prueba
+    health.on_success( 100 );
+    EXPECT_EQ( breaker_closed, health.get_state() );
+    EXPECT_TRUE( health.allow( wait ) );
+};
+
+TEST( GivenAHalfOpenBreaker, WhenTheProbeFails_ThenItReopensWithALongerWait ) {
+    // ARRANGE
+    Sink_health health( 7 );
+    health.set_backoff( 1000, 4000 );
+    health.set_failures_to_open( 1 );
+    uint32_t now = 0xFFFFFF00; // la espera cruza la vuelta del reloj
+
+    // ACT & ASSERT
+    for ( uint32_t backoff = 1000; backoff <= 8000; backoff *= 2 ) {
+        health.on_failure( now );
+        uint32_t wait     = health.wait_ms( now );
+        uint32_t expected = backoff > 4000 ? 4000 : backoff;
+        EXPECT_GE( wait, expected / 2 );
+        EXPECT_LE( wait, expected );
+        now += wait;
+        ASSERT_TRUE( health.allow( now ) );
+        health.on_start();
+    }
+    EXPECT_EQ( 4u, health.get_report().opened );
+    EXPECT_EQ( 4000u, health.get_report().backoff_ms ); // la proxima apertura ya esta en el maximo
+};
+
+TEST( GivenMeasuredLatencies, WhenTheSinkAnswers_ThenTheTimeoutFollowsThem ) {
+    // ARRANGE
+    Sink_health health( 3 );
+    health.set_timeout_bounds( 500, 20000 );
+    uint32_t initial = health.get_timeout_ms();
+
+    // ACT
+    for ( uint8_t i = 0; i < 50; i++ ) {
+        health.on_success( 200 );
+    }
+    uint32_t steady = health.get_timeout_ms();
+    health.on_failure( 0 );
+    uint32_t after_failure = health.get_timeout_ms();
+
+    // ASSERT
+    EXPECT_EQ( 20000u, initial );               // sin medidas, el maximo
+    EXPECT_EQ( 200u, health.get_report().srtt_ms );
+    EXPECT_GE( steady, 500u );                  // srtt + 4 rttvar, acotado por abajo
+    EXPECT_LT( steady, 1000u );
+    EXPECT_EQ( 2 * steady, after_failure );
+};
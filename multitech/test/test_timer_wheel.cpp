@@ -0,0 +1,104 @@
+#include "gtest/gtest.h"
+
+#include "timer_wheel.h"
+
+static void count_expired( Timer_node_t& node, void* arg ) {
+    (void)node;
+    ( *(uint32_t*)arg )++;
+}
+
+static void reschedule_once( Timer_node_t& node, void* arg ) {
+    Timer_wheel* wheel = (Timer_wheel*)arg;
+    if ( node.owner == NULL ) {
+        node.owner = &node;
+        wheel->schedule( node, node.deadline + 10 );
+    }
+}
+
+TEST( GivenATimerWheel, WhenDeadlineIsReached_ThenNodeExpiresOnce ) {
+    // ARRANGE
+    Timer_wheel wheel( 16, 100 );
+    Timer_node_t node;
+    Timer_wheel::init_node( node, NULL );
+    uint32_t expired = 0;
+    wheel.schedule( node, 105 );
+
+    // ACT & ASSERT
+    EXPECT_EQ( 0u, wheel.advance( 104, count_expired, &expired ) );
+    EXPECT_EQ( 1u, wheel.advance( 105, count_expired, &expired ) );
+    EXPECT_EQ( 0u, wheel.advance( 200, count_expired, &expired ) );
+    EXPECT_EQ( 1u, expired );
+    EXPECT_FALSE( node.scheduled );
+    EXPECT_EQ( 0u, wheel.size() );
+};
+
+TEST( GivenATimerWheel, WhenDeadlineIsBeyondOneTurn_ThenNodeWaitsForItsTurn ) {
+    // ARRANGE
+    Timer_wheel wheel( 16, 0 );
+    Timer_node_t node;
+    Timer_wheel::init_node( node, NULL );
+    uint32_t expired = 0;
+    wheel.schedule( node, 40 );
+
+    // ACT
+    for ( uint32_t now = 1; now < 40; now++ ) {
+        wheel.advance( now, count_expired, &expired );
+    }
+    uint32_t before = expired;
+    wheel.advance( 40, count_expired, &expired );
+
+    // ASSERT
+    EXPECT_EQ( 0u, before );
+    EXPECT_EQ( 1u, expired );
+};
+
+TEST( GivenATimerWheel, WhenNodeIsCancelled_ThenItDoesNotExpire ) {
+    // ARRANGE
+    Timer_wheel wheel( 16, 0 );
+    Timer_node_t nodes[3];
+    uint32_t expired = 0;
+    for ( uint8_t i = 0; i < 3; i++ ) {
+        Timer_wheel::init_node( nodes[i], NULL );
+        wheel.schedule( nodes[i], 5 );
+    }
+
+    // ACT
+    wheel.cancel( nodes[1] );
+    wheel.advance( 5, count_expired, &expired );
+
+    // ASSERT
+    EXPECT_EQ( 2u, expired );
+};
+
+TEST( GivenATimerWheel, WhenClockJumpsSeveralTurns_ThenAllDueNodesExpire ) {
+    // ARRANGE
+    Timer_wheel wheel( 8, 0 );
+    Timer_node_t nodes[20];
+    uint32_t expired = 0;
+    for ( uint8_t i = 0; i < 20; i++ ) {
+        Timer_wheel::init_node( nodes[i], NULL );
+        wheel.schedule( nodes[i], i + 1 );
+    }
+
+    // ACT
+    wheel.advance( 1000, count_expired, &expired );
+
+    // ASSERT
+    EXPECT_EQ( 20u, expired );
+};
+
+TEST( GivenATimerWheel, WhenCallbackReschedules_ThenNodeExpiresAgainLater ) {
+    // ARRANGE
+    Timer_wheel wheel( 16, 0 );
+    Timer_node_t node;
+    Timer_wheel::init_node( node, NULL );
+    wheel.schedule( node, 5 );
+
+    // ACT
+    wheel.advance( 5, reschedule_once, &wheel );
+
+    // ASSERT
+    EXPECT_TRUE( node.scheduled );
+    EXPECT_EQ( 15u, node.deadline );
+    EXPECT_EQ( 1u, wheel.advance( 15, reschedule_once, &wheel ) );
+};
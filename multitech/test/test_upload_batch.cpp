@@ -0,0 +1,80 @@
+#include "gtest/gtest.h"
+
+#include "upload_batch.h"
+#include <string.h>
+
+TEST( GivenAnUploadBatch, WhenPktsAreAppended_ThenEachOneIsARepeatedField ) {
+    // ARRANGE
+    char body[100];
+    const uint8_t first[]  = { 1, 23, 255 };
+    const uint8_t second[] = { 0 };
+
+    // ACT
+    uint16_t len = Upload_batch::begin( body, sizeof( body ), "01" );
+    len          = Upload_batch::append_pkt( body, len, sizeof( body ), first, sizeof( first ) );
+    len          = Upload_batch::append_pkt( body, len, sizeof( body ), second, sizeof( second ) );
+
+    // ASSERT
+    EXPECT_STREQ( "MobileID=01&project=boluda&pkt[]=1,23,255&pkt[]=0", body );
+    EXPECT_EQ( strlen( body ), len );
+};
+
+TEST( GivenAnAlmostFullBody, WhenAPktDoesNotFit_ThenTheBodyIsLeftUntouched ) {
+    // ARRANGE
+    char body[60];
+    const uint8_t pkt[] = { 100, 200 };
+    uint16_t len        = Upload_batch::begin( body, sizeof( body ), "01" );
+
+    // ACT
+    uint16_t fits     = Upload_batch::append_pkt( body, len, len + 15, pkt, sizeof( pkt ) );
+    uint16_t overflow = Upload_batch::append_pkt( body, fits, fits + 14, pkt, sizeof( pkt ) );
+
+    // ASSERT
+    EXPECT_EQ( len + 14, fits ); // "&pkt[]=100,200" y el '\0' justo en el ultimo byte
+    EXPECT_EQ( 0, overflow );
+    EXPECT_STREQ( "MobileID=01&project=boluda&pkt[]=100,200", body );
+};
+
+TEST( GivenAShortBody, WhenTheHeaderDoesNotFit_ThenTheBatchIsNotStarted ) {
+    // ARRANGE
+    char body[40];
+
+    // ACT
+    uint16_t too_short = Upload_batch::begin( body, 26, "01" );
+    uint16_t exact     = Upload_batch::begin( body, 27, "01" );
+
+    // ASSERT
+    EXPECT_EQ( 0, too_short );
+    EXPECT_EQ( 26, exact ); // "MobileID=01&project=boluda" y el '\0' en el ultimo byte
+    EXPECT_STREQ( "MobileID=01&project=boluda", body );
+};
+
+TEST( GivenAMultiStatusResponse, WhenParsed_ThenFailedPktsAreMarked ) {
+    // ARRANGE
+    const char response[] = "{\"failed\": [0, 2,5]}";
+    uint32_t failed_mask  = 0;
+
+    // ACT
+    bool result = Upload_batch::parse_failed( response, strlen( response ), 6, failed_mask );
+
+    // ASSERT
+    EXPECT_TRUE( result );
+    EXPECT_EQ( 0x25u, failed_mask );
+};
+
+TEST( GivenAMultiStatusResponse, WhenMalformedOrOutOfTheBatch_ThenItIsRejected ) {
+    // ARRANGE
+    const char out_of_batch[] = "{\"failed\":[1,6]}";
+    const char unterminated[] = "{\"failed\":[1";
+    const char no_list[]      = "{\"ok\":true}";
+    const char empty[]        = "{\"failed\":[]}";
+    uint32_t failed_mask      = 0;
+
+    // ACT
+    // ASSERT
+    EXPECT_FALSE( Upload_batch::parse_failed( out_of_batch, strlen( out_of_batch ), 6, failed_mask ) );
+    EXPECT_FALSE( Upload_batch::parse_failed( unterminated, strlen( unterminated ), 6, failed_mask ) );
+    EXPECT_FALSE( Upload_batch::parse_failed( no_list, strlen( no_list ), 6, failed_mask ) );
+    EXPECT_TRUE( Upload_batch::parse_failed( empty, strlen( empty ), 6, failed_mask ) );
+    EXPECT_EQ( 0u, failed_mask );
+};
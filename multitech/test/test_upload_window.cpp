@@ -0,0 +1,122 @@
+#include "gtest/gtest.h"
+
+#include "upload_window.h"
+#include "log_pkt.h"
+
+// Arranca los siguientes pkts de una via de la cola
+static uint8_t start( Upload_window<Log_pkt>& window, Upload_window_batch_t& batch, Replay_lane_t lane, uint8_t max_n ) {
+    uint16_t offsets[Upload_batch::max_pkts];
+    uint8_t n = window.next( lane, max_n, offsets );
+    window.on_start( batch, offsets, n, false );
+    window.advance( lane, n );
+    return n;
+}
+
+TEST( GivenABacklogBeingReplayed, WhenALivePktCompletesFirst_ThenItStaysInTheQueueUntilTheBacklogEnds ) {
+    // ARRANGE
+    Pkt_pool<Log_pkt> pool( 8, 0 );
+    Pkt_log<Log_pkt> log( 8 );
+    Pkt_log_reader<Log_pkt> reader( log );
+    Upload_window<Log_pkt> window( reader );
+    Sink_health health( 1 );
+    Upload_window_batch_t backlog;
+    Upload_window_batch_t live;
+    for ( uint32_t src = 1; src <= 3; src++ ) {
+        publish( pool, log, src, log.all_readers() );
+    }
+    uint16_t total = window.start_backlog();
+    publish( pool, log, 4, log.all_readers() );
+    uint8_t backlog_n = start( window, backlog, lane_backlog, 16 );
+    uint8_t live_n    = start( window, live, lane_live, 16 );
+
+    // ACT
+    bool live_ended        = window.complete( live, 0, 200, true, health, 0 );
+    uint16_t after_live    = reader.available();
+    bool backlog_ended     = window.complete( backlog, 0, 200, true, health, 0 );
+    uint16_t after_backlog = reader.available();
+
+    // ASSERT
+    EXPECT_EQ( 3, total );
+    EXPECT_EQ( 3, backlog_n );
+    EXPECT_EQ( 1, live_n );
+    EXPECT_EQ( 3u, live.ids[0] - backlog.ids[0] ); // posicion absoluta del nuevo, detras del atraso
+    EXPECT_FALSE( live_ended );
+    EXPECT_EQ( 4, after_live );
+    EXPECT_TRUE( backlog_ended );
+    EXPECT_FALSE( window.in_backlog() );
+    EXPECT_EQ( 0, after_backlog );
+    EXPECT_EQ( 4u, window.get_stats().delivered );
+};
+
+TEST( GivenAnIdleReplay, WhenTheLogOverrunsTheBacklog_ThenBothLanesStillStartAtTheRightPkts ) {
+    // ARRANGE: atraso de tres pkts y uno nuevo, nada en curso
+    Pkt_pool<Log_pkt> pool( 8, 0 );
+    Pkt_log<Log_pkt> log( 4 );
+    Pkt_log_reader<Log_pkt> reader( log );
+    Upload_window<Log_pkt> window( reader );
+    Sink_health health( 1 );
+    Upload_window_batch_t backlog;
+    Upload_window_batch_t live;
+    for ( uint32_t src = 1; src <= 3; src++ ) {
+        publish( pool, log, src, log.all_readers() );
+    }
+    window.start_backlog();
+    publish( pool, log, 4, log.all_readers() );
+
+    // ACT: el log lleno quita al lector el pkt 1
+    publish( pool, log, 5, log.all_readers() );
+    window.resync();
+    uint32_t left     = window.backlog_left();
+    uint8_t backlog_n = start( window, backlog, lane_backlog, 16 );
+    uint8_t live_n    = start( window, live, lane_live, 16 );
+    bool ended        = window.complete( backlog, 0, 200, true, health, 0 );
+
+    // ASSERT
+    EXPECT_EQ( 1u, reader.get_stats().overrun );
+    EXPECT_EQ( 2u, left );
+    ASSERT_EQ( 2, backlog_n );
+    ASSERT_EQ( 2, live_n );
+    EXPECT_EQ( 4u, window.peek( live, 0 )->src );
+    EXPECT_EQ( 5u, window.peek( live, 1 )->src );
+    EXPECT_TRUE( ended );
+    EXPECT_EQ( 2, reader.available() );
+    EXPECT_EQ( 4u, reader.peek( 0 )->src );
+};
+
+TEST( GivenABatchOfFive, WhenA207RejectsTheSecondAndFourth_ThenOnlyThoseAreRetried ) {
+    // ARRANGE
+    Pkt_pool<Log_pkt> pool( 8, 0 );
+    Pkt_log<Log_pkt> log( 8 );
+    Pkt_log_reader<Log_pkt> reader( log );
+    Upload_window<Log_pkt> window( reader );
+    Sink_health health( 1 );
+    Upload_window_batch_t batch;
+    Upload_window_batch_t retry;
+    health.set_backoff( 10, 10 );
+    for ( uint32_t src = 1; src <= 5; src++ ) {
+        publish( pool, log, src, log.all_readers() );
+    }
+    start( window, batch, lane_backlog, 16 );
+
+    // ACT
+    window.complete( batch, 0x0A, 207, true, health, 1000 );
+    uint16_t due[Upload_batch::max_pkts];
+    uint8_t early = window.lane_due( due, 16, 1000 );
+    uint8_t n_due = window.lane_due( due, 16, 1010 );
+    window.on_start( retry, due, n_due, true );
+    uint32_t first_src  = window.peek( retry, 0 )->src;
+    uint32_t second_src = window.peek( retry, 1 )->src;
+    window.complete( retry, 0, 200, true, health, 1020 );
+
+    // ASSERT
+    Upload_sink_stats_t stats = window.get_stats();
+    EXPECT_EQ( 0, early );
+    ASSERT_EQ( 2, n_due );
+    EXPECT_EQ( 2u, first_src );
+    EXPECT_EQ( 4u, second_src );
+    EXPECT_EQ( 0, reader.available() );    // los rechazados salen de la cola al pasar a la via
+    EXPECT_EQ( 5u, stats.delivered );
+    EXPECT_EQ( 2u, stats.failed );
+    EXPECT_EQ( 2u, stats.retried );
+    EXPECT_EQ( 0, stats.retry_lane );
+};